@@ -2981,6 +2981,8 @@ void CL_InitRef(void) {
 
 	ri.FS_ReadFile				 = FS_ReadFile;
 	ri.FS_FreeFile				 = FS_FreeFile;
+	ri.FS_MapFile				 = FS_MapFile;
+	ri.FS_UnmapFile				 = FS_UnmapFile;
 	ri.FS_WriteFile				 = FS_WriteFile;
 	ri.FS_FreeFileList			 = FS_FreeFileList;
 	ri.FS_ListFiles				 = FS_ListFiles;
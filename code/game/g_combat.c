@@ -899,11 +899,14 @@ explosions and melee attacks.
 ============
 */
 qboolean CanDamage(gentity_t *targ, vec3_t origin) {
-	vec3_t	dest;
-	trace_t tr;
-	vec3_t	midpoint;
-	vec3_t	offsetmins = {-15, -15, -15};
-	vec3_t	offsetmaxs = {15, 15, 15};
+	vec3_t		dest;
+	trace_t		tr;
+	trace_t		trs[4];
+	traceRay_t	rays[4];
+	vec3_t		midpoint;
+	vec3_t		offsetmins = {-15, -15, -15};
+	vec3_t		offsetmaxs = {15, 15, 15};
+	int			i, j;
 
 	// use the midpoint of the bounds instead of the origin, because
 	// bmodels may have their origin is 0,0,0
@@ -917,69 +920,24 @@ qboolean CanDamage(gentity_t *targ, vec3_t origin) {
 
 	// this should probably check in the plane of projection,
 	// rather than in world coordinate
-	VectorCopy(midpoint, dest);
-	dest[0] += offsetmaxs[0];
-	dest[1] += offsetmaxs[1];
-	dest[2] += offsetmaxs[2];
-	trap_Trace(&tr, origin, vec3_origin, vec3_origin, dest, ENTITYNUM_NONE, MASK_SOLID);
-
-	if (tr.fraction == 1.0) return qtrue;
-
-	VectorCopy(midpoint, dest);
-	dest[0] += offsetmaxs[0];
-	dest[1] += offsetmins[1];
-	dest[2] += offsetmaxs[2];
-	trap_Trace(&tr, origin, vec3_origin, vec3_origin, dest, ENTITYNUM_NONE, MASK_SOLID);
-
-	if (tr.fraction == 1.0) return qtrue;
-
-	VectorCopy(midpoint, dest);
-	dest[0] += offsetmins[0];
-	dest[1] += offsetmaxs[1];
-	dest[2] += offsetmaxs[2];
-	trap_Trace(&tr, origin, vec3_origin, vec3_origin, dest, ENTITYNUM_NONE, MASK_SOLID);
-
-	if (tr.fraction == 1.0) return qtrue;
-
-	VectorCopy(midpoint, dest);
-	dest[0] += offsetmins[0];
-	dest[1] += offsetmins[1];
-	dest[2] += offsetmaxs[2];
-	trap_Trace(&tr, origin, vec3_origin, vec3_origin, dest, ENTITYNUM_NONE, MASK_SOLID);
-
-	if (tr.fraction == 1.0) return qtrue;
-
-	VectorCopy(midpoint, dest);
-	dest[0] += offsetmaxs[0];
-	dest[1] += offsetmaxs[1];
-	dest[2] += offsetmins[2];
-	trap_Trace(&tr, origin, vec3_origin, vec3_origin, dest, ENTITYNUM_NONE, MASK_SOLID);
-
-	if (tr.fraction == 1.0) return qtrue;
-
-	VectorCopy(midpoint, dest);
-	dest[0] += offsetmaxs[0];
-	dest[1] += offsetmins[1];
-	dest[2] += offsetmins[2];
-	trap_Trace(&tr, origin, vec3_origin, vec3_origin, dest, ENTITYNUM_NONE, MASK_SOLID);
-
-	if (tr.fraction == 1.0) return qtrue;
-
-	VectorCopy(midpoint, dest);
-	dest[0] += offsetmins[0];
-	dest[1] += offsetmaxs[1];
-	dest[2] += offsetmins[2];
-	trap_Trace(&tr, origin, vec3_origin, vec3_origin, dest, ENTITYNUM_NONE, MASK_SOLID);
-
-	if (tr.fraction == 1.0) return qtrue;
-
-	VectorCopy(midpoint, dest);
-	dest[0] += offsetmins[0];
-	dest[1] += offsetmins[1];
-	dest[2] += offsetmins[2];
-	trap_Trace(&tr, origin, vec3_origin, vec3_origin, dest, ENTITYNUM_NONE, MASK_SOLID);
+	// the top corners go out in one batch, the bottom ones only if
+	// none of the top ones could be seen
+	for (i = 0; i < 8; i += 4) {
+		for (j = 0; j < 4; j++) {
+			VectorCopy(origin, rays[j].start);
+			VectorCopy(midpoint, rays[j].end);
+			rays[j].end[0] += (j & 2) ? offsetmins[0] : offsetmaxs[0];
+			rays[j].end[1] += (j & 1) ? offsetmins[1] : offsetmaxs[1];
+			rays[j].end[2] += i ? offsetmins[2] : offsetmaxs[2];
+			VectorClear(rays[j].mins);
+			VectorClear(rays[j].maxs);
+		}
+		trap_TraceBatch(trs, rays, 4, ENTITYNUM_NONE, MASK_SOLID);
 
-	if (tr.fraction == 1.0) return qtrue;
+		for (j = 0; j < 4; j++) {
+			if (trs[j].fraction == 1.0) return qtrue;
+		}
+	}
 
 	return qfalse;
 }
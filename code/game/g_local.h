@@ -755,6 +755,7 @@ void	 trap_GetServerinfo(char *buffer, int bufferSize);
 void	 trap_SetBrushModel(gentity_t *ent, const char *name);
 void	 trap_Trace(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
 					int passEntityNum, int contentmask);
+void	 trap_TraceBatch(trace_t *results, const traceRay_t *rays, int numRays, int passEntityNum, int contentmask);
 int		 trap_PointContents(const vec3_t point, int passEntityNum);
 qboolean trap_InPVS(const vec3_t p1, const vec3_t p2);
 qboolean trap_InPVSIgnorePortals(const vec3_t p1, const vec3_t p2);
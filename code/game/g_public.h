@@ -228,6 +228,10 @@ typedef enum {
 	// 1.32
 	G_FS_SEEK,
 
+	G_TRACEBATCH, // ( trace_t *results, const traceRay_t *rays, int numRays, int passEntityNum, int contentmask );
+	// up to MAX_TRACE_BATCH traces in one call, each result is the same as
+	// trap_Trace of that ray would give
+
 	BOTLIB_SETUP = 200, // ( void );
 	BOTLIB_SHUTDOWN,	// ( void );
 	BOTLIB_LIBVAR_SET,
@@ -423,3 +427,40 @@ typedef enum {
 
 	BOTAI_START_FRAME // ( int time );
 } gameExport_t;
+
+//
+// functions the server hands a native game through dllImports
+//
+// the version only ever goes up by appending fields, a module built against
+// an older table keeps working with a newer server
+#define GAME_IMPORT_VERSION 1
+
+struct aas_areainfo_s;
+
+typedef struct {
+	int version; // GAME_IMPORT_VERSION of the server that filled it
+
+	void (*Trace)(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
+				  int passEntityNum, int contentmask);
+	void (*TraceCapsule)(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
+						 int passEntityNum, int contentmask);
+	void (*TraceBatch)(trace_t *results, const traceRay_t *rays, int numRays, int passEntityNum, int contentmask);
+	int (*PointContents)(const vec3_t point, int passEntityNum);
+	qboolean (*InPVS)(const vec3_t p1, const vec3_t p2);
+	void (*LinkEntity)(sharedEntity_t *ent);
+	void (*UnlinkEntity)(sharedEntity_t *ent);
+	int (*EntitiesInBox)(const vec3_t mins, const vec3_t maxs, int *list, int maxcount);
+	qboolean (*EntityContact)(const vec3_t mins, const vec3_t maxs, const sharedEntity_t *ent);
+
+	int (*AAS_PointAreaNum)(vec3_t point);
+	int (*AAS_TraceAreas)(vec3_t start, vec3_t end, int *areas, vec3_t *points, int maxareas);
+	int (*AAS_BBoxAreas)(vec3_t absmins, vec3_t absmaxs, int *areas, int maxareas);
+	int (*AAS_AreaInfo)(int areanum, struct aas_areainfo_s *info);
+	int (*AAS_PointContents)(vec3_t point);
+	int (*AAS_AreaReachability)(int areanum);
+	int (*AAS_AreaTravelTimeToGoalArea)(int areanum, vec3_t origin, int goalareanum, int travelflags);
+	int (*AAS_EnableRoutingArea)(int areanum, int enable);
+	void (*AAS_PresenceTypeBoundingBox)(int presencetype, vec3_t mins, vec3_t maxs);
+	float (*AAS_Time)(void);
+	int (*AAS_Swimming)(vec3_t origin);
+} gameImports_t;
@@ -32,6 +32,15 @@ static intptr_t(QDECL *syscall)(intptr_t arg, ...) = (intptr_t(QDECL *)(intptr_t
 
 Q_EXPORT void dllEntry(intptr_t(QDECL *syscallptr)(intptr_t arg, ...)) { syscall = syscallptr; }
 
+// set when the server offers direct entry points for the hottest syscalls
+static const gameImports_t *imports;
+
+Q_EXPORT qboolean dllImports(int version, const gameImports_t *table) {
+	// a table older than this module lacks fields it would call
+	imports = table && version >= GAME_IMPORT_VERSION ? table : NULL;
+	return imports != NULL;
+}
+
 int PASSFLOAT(float x) {
 	floatint_t fi;
 	fi.f = x;
@@ -108,19 +117,39 @@ void trap_SetBrushModel(gentity_t *ent, const char *name) { syscall(G_SET_BRUSH_
 
 void trap_Trace(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
 				int passEntityNum, int contentmask) {
+	if (imports) {
+		imports->Trace(results, start, mins, maxs, end, passEntityNum, contentmask);
+		return;
+	}
 	syscall(G_TRACE, results, start, mins, maxs, end, passEntityNum, contentmask);
 }
 
 void trap_TraceCapsule(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
 					   int passEntityNum, int contentmask) {
+	if (imports) {
+		imports->TraceCapsule(results, start, mins, maxs, end, passEntityNum, contentmask);
+		return;
+	}
 	syscall(G_TRACECAPSULE, results, start, mins, maxs, end, passEntityNum, contentmask);
 }
 
+void trap_TraceBatch(trace_t *results, const traceRay_t *rays, int numRays, int passEntityNum, int contentmask) {
+	if (imports) {
+		imports->TraceBatch(results, rays, numRays, passEntityNum, contentmask);
+		return;
+	}
+	syscall(G_TRACEBATCH, results, rays, numRays, passEntityNum, contentmask);
+}
+
 int trap_PointContents(const vec3_t point, int passEntityNum) {
+	if (imports) { return imports->PointContents(point, passEntityNum); }
 	return syscall(G_POINT_CONTENTS, point, passEntityNum);
 }
 
-qboolean trap_InPVS(const vec3_t p1, const vec3_t p2) { return syscall(G_IN_PVS, p1, p2); }
+qboolean trap_InPVS(const vec3_t p1, const vec3_t p2) {
+	if (imports) { return imports->InPVS(p1, p2); }
+	return syscall(G_IN_PVS, p1, p2);
+}
 
 qboolean trap_InPVSIgnorePortals(const vec3_t p1, const vec3_t p2) { return syscall(G_IN_PVS_IGNORE_PORTALS, p1, p2); }
 
@@ -128,15 +157,29 @@ void trap_AdjustAreaPortalState(gentity_t *ent, qboolean open) { syscall(G_ADJUS
 
 qboolean trap_AreasConnected(int area1, int area2) { return syscall(G_AREAS_CONNECTED, area1, area2); }
 
-void trap_LinkEntity(gentity_t *ent) { syscall(G_LINKENTITY, ent); }
+void trap_LinkEntity(gentity_t *ent) {
+	if (imports) {
+		imports->LinkEntity((sharedEntity_t *)ent);
+		return;
+	}
+	syscall(G_LINKENTITY, ent);
+}
 
-void trap_UnlinkEntity(gentity_t *ent) { syscall(G_UNLINKENTITY, ent); }
+void trap_UnlinkEntity(gentity_t *ent) {
+	if (imports) {
+		imports->UnlinkEntity((sharedEntity_t *)ent);
+		return;
+	}
+	syscall(G_UNLINKENTITY, ent);
+}
 
 int trap_EntitiesInBox(const vec3_t mins, const vec3_t maxs, int *list, int maxcount) {
+	if (imports) { return imports->EntitiesInBox(mins, maxs, list, maxcount); }
 	return syscall(G_ENTITIES_IN_BOX, mins, maxs, list, maxcount);
 }
 
 qboolean trap_EntityContact(const vec3_t mins, const vec3_t maxs, const gentity_t *ent) {
+	if (imports) { return imports->EntityContact(mins, maxs, (const sharedEntity_t *)ent); }
 	return syscall(G_ENTITY_CONTACT, mins, maxs, ent);
 }
 
@@ -204,34 +247,49 @@ void trap_AAS_EntityInfo(int entnum, void /* struct aas_entityinfo_s */ *info) {
 int trap_AAS_Initialized(void) { return syscall(BOTLIB_AAS_INITIALIZED); }
 
 void trap_AAS_PresenceTypeBoundingBox(int presencetype, vec3_t mins, vec3_t maxs) {
+	if (imports) {
+		imports->AAS_PresenceTypeBoundingBox(presencetype, mins, maxs);
+		return;
+	}
 	syscall(BOTLIB_AAS_PRESENCE_TYPE_BOUNDING_BOX, presencetype, mins, maxs);
 }
 
 float trap_AAS_Time(void) {
 	floatint_t fi;
+
+	if (imports) { return imports->AAS_Time(); }
 	fi.i = syscall(BOTLIB_AAS_TIME);
 	return fi.f;
 }
 
-int trap_AAS_PointAreaNum(vec3_t point) { return syscall(BOTLIB_AAS_POINT_AREA_NUM, point); }
+int trap_AAS_PointAreaNum(vec3_t point) {
+	if (imports) { return imports->AAS_PointAreaNum(point); }
+	return syscall(BOTLIB_AAS_POINT_AREA_NUM, point);
+}
 
 int trap_AAS_PointReachabilityAreaIndex(vec3_t point) {
 	return syscall(BOTLIB_AAS_POINT_REACHABILITY_AREA_INDEX, point);
 }
 
 int trap_AAS_TraceAreas(vec3_t start, vec3_t end, int *areas, vec3_t *points, int maxareas) {
+	if (imports) { return imports->AAS_TraceAreas(start, end, areas, points, maxareas); }
 	return syscall(BOTLIB_AAS_TRACE_AREAS, start, end, areas, points, maxareas);
 }
 
 int trap_AAS_BBoxAreas(vec3_t absmins, vec3_t absmaxs, int *areas, int maxareas) {
+	if (imports) { return imports->AAS_BBoxAreas(absmins, absmaxs, areas, maxareas); }
 	return syscall(BOTLIB_AAS_BBOX_AREAS, absmins, absmaxs, areas, maxareas);
 }
 
 int trap_AAS_AreaInfo(int areanum, void /* struct aas_areainfo_s */ *info) {
+	if (imports) { return imports->AAS_AreaInfo(areanum, info); }
 	return syscall(BOTLIB_AAS_AREA_INFO, areanum, info);
 }
 
-int trap_AAS_PointContents(vec3_t point) { return syscall(BOTLIB_AAS_POINT_CONTENTS, point); }
+int trap_AAS_PointContents(vec3_t point) {
+	if (imports) { return imports->AAS_PointContents(point); }
+	return syscall(BOTLIB_AAS_POINT_CONTENTS, point);
+}
 
 int trap_AAS_NextBSPEntity(int ent) { return syscall(BOTLIB_AAS_NEXT_BSP_ENTITY, ent); }
 
@@ -251,13 +309,18 @@ int trap_AAS_IntForBSPEpairKey(int ent, char *key, int *value) {
 	return syscall(BOTLIB_AAS_INT_FOR_BSP_EPAIR_KEY, ent, key, value);
 }
 
-int trap_AAS_AreaReachability(int areanum) { return syscall(BOTLIB_AAS_AREA_REACHABILITY, areanum); }
+int trap_AAS_AreaReachability(int areanum) {
+	if (imports) { return imports->AAS_AreaReachability(areanum); }
+	return syscall(BOTLIB_AAS_AREA_REACHABILITY, areanum);
+}
 
 int trap_AAS_AreaTravelTimeToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags) {
+	if (imports) { return imports->AAS_AreaTravelTimeToGoalArea(areanum, origin, goalareanum, travelflags); }
 	return syscall(BOTLIB_AAS_AREA_TRAVEL_TIME_TO_GOAL_AREA, areanum, origin, goalareanum, travelflags);
 }
 
 int trap_AAS_EnableRoutingArea(int areanum, int enable) {
+	if (imports) { return imports->AAS_EnableRoutingArea(areanum, enable); }
 	return syscall(BOTLIB_AAS_ENABLE_ROUTING_AREA, areanum, enable);
 }
 
@@ -274,7 +337,10 @@ int trap_AAS_AlternativeRouteGoals(vec3_t start, int startareanum, vec3_t goal,
 				   altroutegoals, maxaltroutegoals, type);
 }
 
-int trap_AAS_Swimming(vec3_t origin) { return syscall(BOTLIB_AAS_SWIMMING, origin); }
+int trap_AAS_Swimming(vec3_t origin) {
+	if (imports) { return imports->AAS_Swimming(origin); }
+	return syscall(BOTLIB_AAS_SWIMMING, origin);
+}
 
 int trap_AAS_PredictClientMovement(void /* struct aas_clientmove_s */ *move, int entnum, vec3_t origin,
 								   int presencetype, int onground, vec3_t velocity, vec3_t cmdmove, int cmdframes,
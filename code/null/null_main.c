@@ -47,6 +47,8 @@ char *Sys_GetClipboardData(void) { return NULL; }
 
 int Sys_Milliseconds(void) { return 0; }
 
+int64_t Sys_Microseconds(void) { return 0; }
+
 FILE *Sys_FOpen(const char *ospath, const char *mode) { return fopen(ospath, mode); }
 
 void Sys_Mkdir(char *path) {}
@@ -40,17 +40,17 @@ void SetPlaneSignbits(cplane_t *out) {
 #endif // BSPC
 
 // to allow boxes to be treated as brush models, we allocate
-// some extra indexes along with those needed by the map
+// some extra indexes along with those needed by the map, the
+// box brush itself lives in a per thread cmBoxHull_t
 #define BOX_BRUSHES 1
-#define BOX_SIDES	6
 #define BOX_LEAFS	2
-#define BOX_PLANES	12
 
 #define LL(x)		x = LittleLong(x)
 
 clipMap_t cm;
-int		  c_pointcontents;
-int		  c_traces, c_brush_traces, c_patch_traces;
+atomic_int c_pointcontents;
+atomic_int c_traces, c_brush_traces, c_patch_traces;
+atomic_int cm_counting;
 
 byte *cmod_base;
 
@@ -58,14 +58,24 @@ byte *cmod_base;
 cvar_t *cm_noAreas;
 cvar_t *cm_noCurves;
 cvar_t *cm_playerCurveClip;
+cvar_t *cm_debugSurfaceUpdate;
+cvar_t *cm_patchCache;
 #endif
 
-cmodel_t  box_model;
-cplane_t *box_planes;
-cbrush_t *box_brush;
+typedef struct {
+	qboolean	   initialized;
+	cmodel_t	   model;
+	cplane_t	   planes[12];
+	cbrushside_t   sides[6];
+	cbrush_t	   brush;
+	cbrushPlanes_t packed[BRUSH_PLANE_BLOCKS(6)];
+} cmBoxHull_t;
 
-void CM_InitBoxHull(void);
-void CM_FloodAreaConnections(void);
+static CM_THREAD_LOCAL cmBoxHull_t boxHull;
+
+void				CM_InitBoxHull(void);
+static cmBoxHull_t *CM_BoxHull(void);
+void				CM_FloodAreaConnections(void);
 
 /*
 ===============================================================================
@@ -147,35 +157,147 @@ void CMod_LoadSubmodels(lump_t *l) {
 	}
 }
 
+/*
+=================
+CM_OrderLeafBrushes
+
+Rewrites the leaf brush lists in the order the leafs are reached, so the
+brushes of neighbouring leafs sit next to each other.  Leafs the tree does
+not reach go last.  Maps whose leafs share or skip parts of the lump keep
+the file order.
+=================
+*/
+static void CM_OrderLeafBrushes(int *leafOrder, int numLeafOrder) {
+	int		*ordered;
+	byte	*used, *leafDone;
+	cLeaf_t *leaf;
+	int		 i, j, n, next;
+
+	ordered	 = Hunk_AllocateTempMemory(cm.numLeafBrushes * sizeof(*ordered) + cm.numLeafBrushes + cm.numLeafs);
+	used	 = (byte *)(ordered + cm.numLeafBrushes);
+	leafDone = used + cm.numLeafBrushes;
+	memset(used, 0, cm.numLeafBrushes + cm.numLeafs);
+
+	// a leaf may hang off several nodes, only its first one counts
+	for (i = n = 0; i < numLeafOrder; i++) {
+		if (leafDone[leafOrder[i]]) { continue; }
+		leafDone[leafOrder[i]] = 1;
+		leafOrder[n++]		   = leafOrder[i];
+	}
+	for (i = 0; i < cm.numLeafs; i++) {
+		if (!leafDone[i]) { leafOrder[n++] = i; }
+	}
+
+	next = 0;
+	for (i = 0; i < n; i++) {
+		leaf = &cm.leafs[leafOrder[i]];
+		if (leaf->firstLeafBrush < 0 || leaf->numLeafBrushes < 0 ||
+			leaf->firstLeafBrush + leaf->numLeafBrushes > cm.numLeafBrushes) {
+			break;
+		}
+		for (j = leaf->firstLeafBrush; j < leaf->firstLeafBrush + leaf->numLeafBrushes; j++) {
+			if (used[j]) { break; }
+			used[j]			= 1;
+			ordered[next++] = cm.leafbrushes[j];
+		}
+		if (j != leaf->firstLeafBrush + leaf->numLeafBrushes) { break; }
+	}
+
+	if (i == n && next == cm.numLeafBrushes) {
+		memcpy(cm.leafbrushes, ordered, next * sizeof(*ordered));
+		for (i = next = 0; i < n; i++) {
+			leaf				 = &cm.leafs[leafOrder[i]];
+			leaf->firstLeafBrush = next;
+			next += leaf->numLeafBrushes;
+		}
+	}
+
+	Hunk_FreeTempMemory(ordered);
+}
+
 /*
 =================
 CMod_LoadNodes
 
+Lays the nodes out depth first from the root, which is the order traces
+walk them, so a trace mostly moves forward through memory instead of
+jumping between the node and plane arrays.  The leaf brush lists are
+reordered the same way.
 =================
 */
 void CMod_LoadNodes(lump_t *l) {
 	dnode_t *in;
-	int		 child;
 	cNode_t *out;
 	int		 i, j, count;
+	int		 num, child, planeNum;
+	int		*order, *stack, *leafOrder;
+	int		 numStack, numOrdered, numLeafOrder;
 
 	in = (void *)(cmod_base + l->fileofs);
 	if (l->filelen % sizeof(*in)) Com_Error(ERR_DROP, "MOD_LoadBmodel: funny lump size");
 	count = l->filelen / sizeof(*in);
 
 	if (count < 1) Com_Error(ERR_DROP, "Map has no nodes");
-	cm.nodes	= Hunk_Alloc(count * sizeof(*cm.nodes), h_high);
+	cm.nodes	= Hunk_Alloc(count * sizeof(*cm.nodes) + 63, h_high);
+	cm.nodes	= (cNode_t *)(((intptr_t)cm.nodes + 63) & ~63); // the hunk only aligns to 32
 	cm.numNodes = count;
 
-	out = cm.nodes;
+	// order[] maps file numbers to positions, -2 while waiting on the stack.
+	// Every node is pushed once and there are count + 1 leaf children at most
+	order	  = Hunk_AllocateTempMemory((count + (2 * count + 1) + (count + 1 + cm.numLeafs)) * sizeof(*order));
+	stack	  = order + count;
+	leafOrder = stack + 2 * count + 1;
+	for (i = 0; i < count; i++) { order[i] = -1; }
+
+	numStack	 = 0;
+	numOrdered	 = 0;
+	numLeafOrder = 0;
+	stack[numStack++] = 0;
+	order[0]		  = -2;
+	while (numStack) {
+		num = stack[--numStack];
+		if (num < 0) {
+			leafOrder[numLeafOrder++] = -1 - num;
+			continue;
+		}
+		order[num] = numOrdered++;
+
+		// push the back first so the front comes right after this node
+		for (j = 1; j >= 0; j--) {
+			child = LittleLong(in[num].children[j]);
+			if (child >= count || child < -cm.numLeafs) {
+				Com_Error(ERR_DROP, "CMod_LoadNodes: bad child %i on node %i", child, num);
+			}
+			if (child >= 0) {
+				if (order[child] != -1) { Com_Error(ERR_DROP, "CMod_LoadNodes: node %i has two parents", child); }
+				order[child] = -2;
+			}
+			stack[numStack++] = child;
+		}
+	}
 
-	for (i = 0; i < count; i++, out++, in++) {
-		out->plane = cm.planes + LittleLong(in->planeNum);
+	// anything the root doesn't reach goes at the end, nothing walks it
+	for (i = 0; i < count; i++) {
+		if (order[i] == -1) { order[i] = numOrdered++; }
+	}
+
+	for (i = 0; i < count; i++) {
+		planeNum = LittleLong(in[i].planeNum);
+		if (planeNum < 0 || planeNum >= cm.numPlanes) {
+			Com_Error(ERR_DROP, "CMod_LoadNodes: bad planeNum %i on node %i", planeNum, i);
+		}
+
+		out		   = &cm.nodes[order[i]];
+		out->plane = cm.planes[planeNum];
 		for (j = 0; j < 2; j++) {
-			child			 = LittleLong(in->children[j]);
-			out->children[j] = child;
+			child			 = LittleLong(in[i].children[j]);
+			out->children[j] = child < 0 ? child : order[child];
 		}
 	}
+
+	CM_OrderLeafBrushes(leafOrder, numLeafOrder);
+
+	Hunk_FreeTempMemory(order);
 }
 
 /*
@@ -195,6 +317,41 @@ void CM_BoundBrush(cbrush_t *b) {
 	b->bounds[1][2] = b->sides[5].plane->dist;
 }
 
+/*
+=================
+CM_PackBrushPlanes
+
+Copies the side planes of a brush into its packed blocks.  This has to be
+redone whenever one of the planes changes, as the box hull planes do.
+=================
+*/
+void CM_PackBrushPlanes(cbrush_t *b) {
+	int				i, j, lane;
+	cbrushPlanes_t *block;
+	cplane_t	   *plane;
+
+	for (i = 0; i < BRUSH_PLANE_BLOCKS(b->numsides) * BRUSH_PLANE_LANES; i++) {
+		block = &b->planes[i / BRUSH_PLANE_LANES];
+		lane  = i % BRUSH_PLANE_LANES;
+
+		if (i >= b->numsides) {
+			for (j = 0; j < 3; j++) {
+				block->normal[j][lane]	 = 0;
+				block->negative[j][lane] = 0;
+			}
+			block->dist[lane] = BRUSH_PLANE_PADDING;
+			continue;
+		}
+
+		plane = b->sides[i].plane;
+		for (j = 0; j < 3; j++) {
+			block->normal[j][lane]	 = plane->normal[j];
+			block->negative[j][lane] = (plane->signbits & (1 << j)) ? ~0 : 0;
+		}
+		block->dist[lane] = plane->dist;
+	}
+}
+
 /*
 =================
 CMod_LoadBrushes
@@ -202,9 +359,11 @@ CMod_LoadBrushes
 =================
 */
 void CMod_LoadBrushes(lump_t *l) {
-	dbrush_t *in;
-	cbrush_t *out;
-	int		  i, count;
+	dbrush_t	   *in;
+	cbrush_t	   *out;
+	int				i, count;
+	int				numBlocks;
+	cbrushPlanes_t *blocks;
 
 	in = (void *)(cmod_base + l->fileofs);
 	if (l->filelen % sizeof(*in)) { Com_Error(ERR_DROP, "MOD_LoadBmodel: funny lump size"); }
@@ -227,6 +386,16 @@ void CMod_LoadBrushes(lump_t *l) {
 
 		CM_BoundBrush(out);
 	}
+
+	// pack the side planes of every brush into one allocation
+	for (i = 0, numBlocks = 0; i < count; i++) { numBlocks += BRUSH_PLANE_BLOCKS(cm.brushes[i].numsides); }
+	blocks = Hunk_Alloc(numBlocks * sizeof(*blocks), h_high);
+
+	for (i = 0, out = cm.brushes; i < count; i++, out++) {
+		out->planes = blocks;
+		CM_PackBrushPlanes(out);
+		blocks += BRUSH_PLANE_BLOCKS(out->numsides);
+	}
 }
 
 /*
@@ -283,7 +452,7 @@ void CMod_LoadPlanes(lump_t *l) {
 	count = l->filelen / sizeof(*in);
 
 	if (count < 1) Com_Error(ERR_DROP, "Map with no planes");
-	cm.planes	 = Hunk_Alloc((BOX_PLANES + count) * sizeof(*cm.planes), h_high);
+	cm.planes	 = Hunk_Alloc(count * sizeof(*cm.planes), h_high);
 	cm.numPlanes = count;
 
 	out = cm.planes;
@@ -363,7 +532,7 @@ void CMod_LoadBrushSides(lump_t *l) {
 	if (l->filelen % sizeof(*in)) { Com_Error(ERR_DROP, "MOD_LoadBmodel: funny lump size"); }
 	count = l->filelen / sizeof(*in);
 
-	cm.brushsides	 = Hunk_Alloc((BOX_SIDES + count) * sizeof(*cm.brushsides), h_high);
+	cm.brushsides	 = Hunk_Alloc(count * sizeof(*cm.brushsides), h_high);
 	cm.numBrushSides = count;
 
 	out = cm.brushsides;
@@ -385,8 +554,15 @@ CMod_LoadEntityString
 =================
 */
 void CMod_LoadEntityString(lump_t *l) {
-	cm.entityString	  = Hunk_Alloc(l->filelen, h_high);
 	cm.numEntityChars = l->filelen;
+
+	// the parsers only read it, so a terminated lump can stay in the mapped image
+	if (cm.mapFile && l->filelen && !cmod_base[l->fileofs + l->filelen - 1]) {
+		cm.entityString = (char *)cmod_base + l->fileofs;
+		return;
+	}
+
+	cm.entityString = Hunk_Alloc(l->filelen, h_high);
 	memcpy(cm.entityString, cmod_base + l->fileofs, l->filelen);
 }
 
@@ -410,30 +586,262 @@ void CMod_LoadVisibility(lump_t *l) {
 	buf = cmod_base + l->fileofs;
 
 	cm.vised		= qtrue;
-	cm.visibility	= Hunk_Alloc(len, h_high);
 	cm.numClusters	= LittleLong(((int *)buf)[0]);
 	cm.clusterBytes = LittleLong(((int *)buf)[1]);
+
+	// never written after load, so it can be shared with the mapped image
+	if (cm.mapFile) {
+		cm.visibility = buf + VIS_HEADER;
+		return;
+	}
+
+	cm.visibility = Hunk_Alloc(len, h_high);
 	memcpy(cm.visibility, buf + VIS_HEADER, len - VIS_HEADER);
 }
 
 //==================================================================
 
+/*
+=================================================================
+
+PATCH COLLIDE CACHE
+
+Generating the patch collision is a large part of loading maps with
+a lot of curves, so the result is saved under cmcache/ and reused
+when the same map is loaded again.  The cache is keyed by the
+checksum of the bsp, every entry holds the surface number it was
+built from.
+
+cm_patchCache 0: always generate
+cm_patchCache 1: load from the cache, write it if anything was missing
+cm_patchCache 2: generate, compare against the cache and rewrite it on differences
+
+=================================================================
+*/
+
+#define PATCH_CACHE_IDENT	(('L' << 24) + ('O' << 16) + ('C' << 8) + 'P') // little-endian "PCOL"
+#define PATCH_CACHE_VERSION 1
+
+typedef struct {
+	int ident;
+	int version;
+	int checksum; // of the whole bsp file
+	int numSurfaces;
+	int numPatches;
+} patchCacheHeader_t;
+
+typedef struct {
+	int surfaceNum;
+	int blocks; // for the c_totalPatchBlocks statistic
+	int size;	// bytes of patch collide data following
+} patchCacheEntry_t;
+
+typedef struct {
+	const byte *data; // NULL if not cached
+	int			size;
+	int			blocks;
+} patchCacheSlot_t;
+
+typedef struct {
+	char			  path[MAX_OSPATH]; // below the home path, with the game dir
+	void			 *buffer;
+	patchCacheSlot_t *slots; // by surface number
+} patchCache_t;
+
+/*
+=================
+CM_PatchCachePath
+
+The cache is only ever read from and written to the home path, never
+from a pk3, so a download can't hand us collision data
+=================
+*/
+static void CM_PatchCachePath(const char *name, char *path, int size) {
+	char base[MAX_QPATH];
+
+	COM_StripExtension(name, base, sizeof(base));
+	Com_sprintf(path, size, "%s/cmcache/%s.pcol", FS_GetCurrentGameDir(), base);
+}
+
+/*
+=================
+CM_LoadPatchCache
+
+Indexes the cache file by surface number, entries are left out
+if the file does not match the map
+=================
+*/
+static void CM_LoadPatchCache(patchCache_t *cache, unsigned checksum, int numSurfaces) {
+	patchCacheHeader_t header;
+	patchCacheEntry_t  entry;
+	const byte		  *data;
+	fileHandle_t	   f;
+	int				   length, ofs;
+	int				   i;
+
+	length = FS_SV_FOpenFileRead(cache->path, &f);
+	if (!f) {
+		return;
+	}
+	if (length < (int)sizeof(header)) {
+		Com_Printf("CM_LoadPatchCache: %s is truncated\n", cache->path);
+		FS_FCloseFile(f);
+		return;
+	}
+
+	cache->buffer = Hunk_AllocateTempMemory(length);
+	if (FS_Read(cache->buffer, length, f) != length) {
+		Com_Printf("CM_LoadPatchCache: couldn't read %s\n", cache->path);
+		FS_FCloseFile(f);
+		return;
+	}
+	FS_FCloseFile(f);
+
+	data = cache->buffer;
+
+	memcpy(&header, data, sizeof(header));
+	for (i = 0; i < sizeof(header) / 4; i++) { ((int *)&header)[i] = LittleLong(((int *)&header)[i]); }
+
+	if (header.ident != PATCH_CACHE_IDENT || header.version != PATCH_CACHE_VERSION) {
+		Com_DPrintf("CM_LoadPatchCache: %s is from an old version\n", cache->path);
+		return;
+	}
+	if (header.checksum != (int)checksum || header.numSurfaces != numSurfaces) {
+		Com_DPrintf("CM_LoadPatchCache: %s is from a different map\n", cache->path);
+		return;
+	}
+
+	ofs = sizeof(header);
+	for (i = 0; i < header.numPatches; i++) {
+		if (length - ofs < (int)sizeof(entry)) {
+			break;
+		}
+		memcpy(&entry, data + ofs, sizeof(entry));
+		entry.surfaceNum = LittleLong(entry.surfaceNum);
+		entry.blocks	 = LittleLong(entry.blocks);
+		entry.size		 = LittleLong(entry.size);
+		ofs += sizeof(entry);
+
+		if (entry.surfaceNum < 0 || entry.surfaceNum >= numSurfaces || entry.size < 0 || entry.size > length - ofs) {
+			break;
+		}
+
+		cache->slots[entry.surfaceNum].data	  = data + ofs;
+		cache->slots[entry.surfaceNum].size	  = entry.size;
+		cache->slots[entry.surfaceNum].blocks = entry.blocks;
+		ofs += entry.size;
+	}
+
+	if (i != header.numPatches) {
+		Com_Printf("CM_LoadPatchCache: %s is damaged, only %i of %i patches used\n", cache->path, i, header.numPatches);
+	}
+}
+
+/*
+=================
+CM_WritePatchCache
+
+Saves the collision of every loaded patch
+=================
+*/
+static void CM_WritePatchCache(patchCache_t *cache, unsigned checksum) {
+	patchCacheHeader_t header;
+	patchCacheEntry_t  entry;
+	byte			  *buffer, *out;
+	cPatch_t		  *patch;
+	fileHandle_t	   f;
+	int				   size;
+	int				   i;
+
+	header.ident	   = LittleLong(PATCH_CACHE_IDENT);
+	header.version	   = LittleLong(PATCH_CACHE_VERSION);
+	header.checksum	   = LittleLong(checksum);
+	header.numSurfaces = LittleLong(cm.numSurfaces);
+	header.numPatches  = 0;
+
+	size = sizeof(header);
+	for (i = 0; i < cm.numSurfaces; i++) {
+		patch = cm.surfaces[i];
+		if (patch) {
+			size += sizeof(entry) + CM_PatchCollideCacheSize(patch->pc);
+			header.numPatches++;
+		}
+	}
+	header.numPatches = LittleLong(header.numPatches);
+
+	buffer = Hunk_AllocateTempMemory(size);
+	memcpy(buffer, &header, sizeof(header));
+	out = buffer + sizeof(header);
+
+	for (i = 0; i < cm.numSurfaces; i++) {
+		patch = cm.surfaces[i];
+		if (!patch) {
+			continue;
+		}
+
+		entry.surfaceNum = LittleLong(i);
+		entry.blocks	 = LittleLong(cache->slots[i].blocks);
+		entry.size		 = LittleLong(CM_PatchCollideCacheSize(patch->pc));
+		memcpy(out, &entry, sizeof(entry));
+		out += sizeof(entry);
+
+		out += CM_WritePatchCollide(patch->pc, out);
+	}
+
+	f = FS_SV_FOpenFileWrite(cache->path);
+	if (f) {
+		FS_Write(buffer, out - buffer, f);
+		FS_FCloseFile(f);
+	} else {
+		Com_Printf("CM_WritePatchCache: couldn't write %s\n", cache->path);
+	}
+	Hunk_FreeTempMemory(buffer);
+}
+
+/*
+=================
+CM_ComparePatchCache
+
+Returns qtrue if the generated patch collision is identical to the cached data
+=================
+*/
+static qboolean CM_ComparePatchCache(const patchCache_t *cache, int surfaceNum, const struct patchCollide_s *pc) {
+	byte	*buffer;
+	int		 size;
+	qboolean same;
+
+	size = CM_PatchCollideCacheSize(pc);
+	if (size != cache->slots[surfaceNum].size) {
+		return qfalse;
+	}
+
+	buffer = Hunk_AllocateTempMemory(size);
+	CM_WritePatchCollide(pc, buffer);
+	same = !memcmp(buffer, cache->slots[surfaceNum].data, size);
+	Hunk_FreeTempMemory(buffer);
+
+	return same;
+}
+
 /*
 =================
 CMod_LoadPatches
 =================
 */
 #define MAX_PATCH_VERTS 1024
-void CMod_LoadPatches(lump_t *surfs, lump_t *verts) {
-	drawVert_t *dv, *dv_p;
-	dsurface_t *in;
-	int			count;
-	int			i, j;
-	int			c;
-	cPatch_t   *patch;
-	vec3_t		points[MAX_PATCH_VERTS];
-	int			width, height;
-	int			shaderNum;
+void CMod_LoadPatches(lump_t *surfs, lump_t *verts, const char *name, unsigned checksum) {
+	drawVert_t	 *dv, *dv_p;
+	dsurface_t	 *in;
+	int			  count;
+	int			  i, j;
+	int			  c;
+	cPatch_t	 *patch;
+	vec3_t		  points[MAX_PATCH_VERTS];
+	int			  width, height;
+	int			  shaderNum;
+	patchCache_t *cache;
+	int			  mode, blocks;
+	int			  numPatches, numLoaded, numMissing, numDiffer;
 
 	in = (void *)(cmod_base + surfs->fileofs);
 	if (surfs->filelen % sizeof(*in)) Com_Error(ERR_DROP, "MOD_LoadBmodel: funny lump size");
@@ -443,6 +851,20 @@ void CMod_LoadPatches(lump_t *surfs, lump_t *verts) {
 	dv = (void *)(cmod_base + verts->fileofs);
 	if (verts->filelen % sizeof(*dv)) Com_Error(ERR_DROP, "MOD_LoadBmodel: funny lump size");
 
+#ifndef BSPC
+	mode = cm_patchCache->integer;
+#else
+	mode = 0;
+#endif
+	cache = NULL;
+	if (mode) {
+		cache		 = Z_Malloc(sizeof(*cache));
+		cache->slots = Z_Malloc(count * sizeof(*cache->slots));
+		CM_PatchCachePath(name, cache->path, sizeof(cache->path));
+		CM_LoadPatchCache(cache, checksum, count);
+	}
+	numPatches = numLoaded = numMissing = numDiffer = 0;
+
 	// scan through all the surfaces, but only load patches,
 	// not planar faces
 	for (i = 0; i < count; i++, in++) {
@@ -470,8 +892,47 @@ void CMod_LoadPatches(lump_t *surfs, lump_t *verts) {
 		patch->contents		= cm.shaders[shaderNum].contentFlags;
 		patch->surfaceFlags = cm.shaders[shaderNum].surfaceFlags;
 
-		// create the internal facet structure
+		numPatches++;
+
+		// load the internal facet structure from the cache
+		if (mode == 1 && cache->slots[i].data) {
+			patch->pc = CM_ReadPatchCollide(cache->slots[i].data, cache->slots[i].size);
+			if (patch->pc) {
+				c_totalPatchBlocks += cache->slots[i].blocks;
+				numLoaded++;
+				continue;
+			}
+		}
+
+		// or create it
+		blocks	  = c_totalPatchBlocks;
 		patch->pc = CM_GeneratePatchCollide(width, height, points);
+
+		if (cache) {
+			cache->slots[i].blocks = c_totalPatchBlocks - blocks;
+			if (!cache->slots[i].data) {
+				numMissing++;
+			} else if (mode == 2 && !CM_ComparePatchCache(cache, i, patch->pc)) {
+				Com_Printf("CMod_LoadPatches: cached collision for surface %i differs\n", i);
+				numDiffer++;
+			} else if (mode == 1) {
+				numMissing++; // could not be read
+			}
+		}
+	}
+
+	if (cache) {
+		if (mode == 2) {
+			Com_Printf("%i patches checked against %s, %i differ\n", numPatches, cache->path, numDiffer);
+		} else {
+			Com_DPrintf("%i of %i patches loaded from %s\n", numLoaded, numPatches, cache->path);
+		}
+
+		// the cache file is temp memory and has to go before writing
+		if (cache->buffer) { Hunk_FreeTempMemory(cache->buffer); }
+		if (numMissing || numDiffer) { CM_WritePatchCache(cache, checksum); }
+		Z_Free(cache->slots);
+		Z_Free(cache);
 	}
 }
 
@@ -498,6 +959,20 @@ unsigned CM_Checksum(dheader_t *header) {
 	return LittleLong(Com_BlockChecksum(checksums, 11 * 4));
 }
 
+/*
+==================
+CM_ReleaseMapFile
+==================
+*/
+static void CM_ReleaseMapFile(void) {
+#ifndef BSPC
+	if (cm.mapFile) {
+		FS_UnmapFile(cm.mapFile);
+		cm.mapFile = NULL;
+	}
+#endif
+}
+
 /*
 ==================
 CM_LoadMap
@@ -521,6 +996,9 @@ void CM_LoadMap(const char *name, qboolean clientload, int *checksum) {
 	cm_noAreas		   = Cvar_Get("cm_noAreas", "0", CVAR_CHEAT);
 	cm_noCurves		   = Cvar_Get("cm_noCurves", "0", CVAR_CHEAT);
 	cm_playerCurveClip = Cvar_Get("cm_playerCurveClip", "1", CVAR_ARCHIVE | CVAR_CHEAT);
+	// registered here rather than on first use, traces may run on any thread
+	cm_debugSurfaceUpdate = Cvar_Get("r_debugSurfaceUpdate", "1", 0);
+	cm_patchCache		  = Cvar_Get("cm_patchCache", "1", CVAR_ARCHIVE);
 #endif
 	Com_DPrintf("CM_LoadMap( %s, %i )\n", name, clientload);
 
@@ -530,6 +1008,8 @@ void CM_LoadMap(const char *name, qboolean clientload, int *checksum) {
 	}
 
 	// free old stuff
+	CM_StopRecording();
+	CM_ReleaseMapFile();
 	memset(&cm, 0, sizeof(cm));
 	CM_ClearLevelPatches();
 
@@ -546,7 +1026,12 @@ void CM_LoadMap(const char *name, qboolean clientload, int *checksum) {
 	// load the file
 	//
 #ifndef BSPC
-	length = FS_ReadFile(name, &buf.v);
+	length = FS_MapFile(name, &cm.mapFile);
+	if (cm.mapFile) {
+		buf.v = (void *)cm.mapFile;
+	} else {
+		length = FS_ReadFile(name, &buf.v);
+	}
 #else
 	length = LoadQuakeFile((quakefile_t *)name, &buf.v);
 #endif
@@ -556,6 +1041,9 @@ void CM_LoadMap(const char *name, qboolean clientload, int *checksum) {
 	last_checksum = LittleLong(Com_BlockChecksum(buf.i, length));
 	*checksum	  = last_checksum;
 
+	Q_strncpyz(cm.mapName, name, sizeof(cm.mapName));
+	cm.checksum = last_checksum;
+
 	header = *(dheader_t *)buf.i;
 	for (i = 0; i < sizeof(dheader_t) / 4; i++) { ((int *)&header)[i] = LittleLong(((int *)&header)[i]); }
 
@@ -578,10 +1066,10 @@ void CM_LoadMap(const char *name, qboolean clientload, int *checksum) {
 	CMod_LoadNodes(&header.lumps[LUMP_NODES]);
 	CMod_LoadEntityString(&header.lumps[LUMP_ENTITIES]);
 	CMod_LoadVisibility(&header.lumps[LUMP_VISIBILITY]);
-	CMod_LoadPatches(&header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS]);
+	CMod_LoadPatches(&header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS], name, last_checksum);
 
-	// we are NOT freeing the file, because it is cached for the ref
-	FS_FreeFile(buf.v);
+	// a mapped image is kept until the next map, the entity string and visibility point into it
+	if (!cm.mapFile) { FS_FreeFile(buf.v); }
 
 	CM_InitBoxHull();
 
@@ -597,10 +1085,19 @@ CM_ClearMap
 ==================
 */
 void CM_ClearMap(void) {
+	CM_StopRecording();
+	CM_ReleaseMapFile();
 	memset(&cm, 0, sizeof(cm));
 	CM_ClearLevelPatches();
 }
 
+/*
+==================
+CM_CountQueries
+==================
+*/
+void CM_CountQueries(qboolean count) { atomic_store_explicit(&cm_counting, count, memory_order_relaxed); }
+
 /*
 ==================
 CM_ClipHandleToModel
@@ -609,7 +1106,7 @@ CM_ClipHandleToModel
 cmodel_t *CM_ClipHandleToModel(clipHandle_t handle) {
 	if (handle < 0) { Com_Error(ERR_DROP, "CM_ClipHandleToModel: bad handle %i", handle); }
 	if (handle < cm.numSubModels) { return &cm.cmodels[handle]; }
-	if (handle == BOX_MODEL_HANDLE) { return &box_model; }
+	if (handle == BOX_MODEL_HANDLE) { return &CM_BoxHull()->model; }
 	if (handle < MAX_SUBMODELS) {
 		Com_Error(ERR_DROP, "CM_ClipHandleToModel: bad handle %i < %i < %i", cm.numSubModels, handle, MAX_SUBMODELS);
 	}
@@ -650,51 +1147,80 @@ int CM_LeafArea(int leafnum) {
 ===================
 CM_InitBoxHull
 
+The box brush is referenced from the map through a single extra leaf
+brush index, CM_LeafBrush maps that index to the calling thread's hull.
+===================
+*/
+void CM_InitBoxHull(void) { cm.leafbrushes[cm.numLeafBrushes] = cm.numBrushes; }
+
+/*
+===================
+CM_BoxHull
+
 Set up the planes and nodes so that the six floats of a bounding box
 can just be stored out and get a proper clipping hull structure.
+Every thread gets its own hull so temp box traces can run concurrently.
 ===================
 */
-void CM_InitBoxHull(void) {
+static cmBoxHull_t *CM_BoxHull(void) {
+	cmBoxHull_t	 *hull = &boxHull;
 	int			  i;
 	int			  side;
 	cplane_t	 *p;
 	cbrushside_t *s;
 
-	box_planes = &cm.planes[cm.numPlanes];
-
-	box_brush			= &cm.brushes[cm.numBrushes];
-	box_brush->numsides = 6;
-	box_brush->sides	= cm.brushsides + cm.numBrushSides;
-	box_brush->contents = CONTENTS_BODY;
-
-	box_model.leaf.numLeafBrushes = 1;
-	//	box_model.leaf.firstLeafBrush = cm.numBrushes;
-	box_model.leaf.firstLeafBrush	  = cm.numLeafBrushes;
-	cm.leafbrushes[cm.numLeafBrushes] = cm.numBrushes;
+	if (!hull->initialized) {
+		hull->brush.numsides = 6;
+		hull->brush.sides	 = hull->sides;
+		hull->brush.contents = CONTENTS_BODY;
+		hull->brush.planes	 = hull->packed;
+
+		for (i = 0; i < 6; i++) {
+			side = i & 1;
+
+			// brush sides
+			s				= &hull->sides[i];
+			s->plane		= &hull->planes[i * 2 + side];
+			s->surfaceFlags = 0;
+
+			// planes
+			p			= &hull->planes[i * 2];
+			p->type		= i >> 1;
+			p->signbits = 0;
+			VectorClear(p->normal);
+			p->normal[i >> 1] = 1;
+
+			p			= &hull->planes[i * 2 + 1];
+			p->type		= 3 + (i >> 1);
+			p->signbits = 0;
+			VectorClear(p->normal);
+			p->normal[i >> 1] = -1;
+
+			SetPlaneSignbits(p);
+		}
 
-	for (i = 0; i < 6; i++) {
-		side = i & 1;
+		CM_PackBrushPlanes(&hull->brush);
+		hull->initialized = qtrue;
+	}
 
-		// brush sides
-		s				= &cm.brushsides[cm.numBrushSides + i];
-		s->plane		= cm.planes + (cm.numPlanes + i * 2 + side);
-		s->surfaceFlags = 0;
+	// the map may have changed since the last use on this thread
+	hull->model.leaf.numLeafBrushes = 1;
+	hull->model.leaf.firstLeafBrush = cm.numLeafBrushes;
 
-		// planes
-		p			= &box_planes[i * 2];
-		p->type		= i >> 1;
-		p->signbits = 0;
-		VectorClear(p->normal);
-		p->normal[i >> 1] = 1;
+	return hull;
+}
 
-		p			= &box_planes[i * 2 + 1];
-		p->type		= 3 + (i >> 1);
-		p->signbits = 0;
-		VectorClear(p->normal);
-		p->normal[i >> 1] = -1;
+/*
+===================
+CM_LeafBrush
 
-		SetPlaneSignbits(p);
-	}
+Brush referenced by a leaf brush index, the index one past the map
+brushes is the calling thread's temp box.
+===================
+*/
+cbrush_t *CM_LeafBrush(int brushnum) {
+	if (brushnum == cm.numBrushes) { return &boxHull.brush; }
+	return &cm.brushes[brushnum];
 }
 
 /*
@@ -704,30 +1230,34 @@ CM_TempBoxModel
 To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
 Capsules are handled differently though.
+The box is per thread and stays valid until the next CM_TempBoxModel
+call on the same thread.
 ===================
 */
 clipHandle_t CM_TempBoxModel(const vec3_t mins, const vec3_t maxs, int capsule) {
+	cmBoxHull_t *hull = CM_BoxHull();
 
-	VectorCopy(mins, box_model.mins);
-	VectorCopy(maxs, box_model.maxs);
+	VectorCopy(mins, hull->model.mins);
+	VectorCopy(maxs, hull->model.maxs);
 
 	if (capsule) { return CAPSULE_MODEL_HANDLE; }
 
-	box_planes[0].dist	= maxs[0];
-	box_planes[1].dist	= -maxs[0];
-	box_planes[2].dist	= mins[0];
-	box_planes[3].dist	= -mins[0];
-	box_planes[4].dist	= maxs[1];
-	box_planes[5].dist	= -maxs[1];
-	box_planes[6].dist	= mins[1];
-	box_planes[7].dist	= -mins[1];
-	box_planes[8].dist	= maxs[2];
-	box_planes[9].dist	= -maxs[2];
-	box_planes[10].dist = mins[2];
-	box_planes[11].dist = -mins[2];
-
-	VectorCopy(mins, box_brush->bounds[0]);
-	VectorCopy(maxs, box_brush->bounds[1]);
+	hull->planes[0].dist  = maxs[0];
+	hull->planes[1].dist  = -maxs[0];
+	hull->planes[2].dist  = mins[0];
+	hull->planes[3].dist  = -mins[0];
+	hull->planes[4].dist  = maxs[1];
+	hull->planes[5].dist  = -maxs[1];
+	hull->planes[6].dist  = mins[1];
+	hull->planes[7].dist  = -mins[1];
+	hull->planes[8].dist  = maxs[2];
+	hull->planes[9].dist  = -maxs[2];
+	hull->planes[10].dist = mins[2];
+	hull->planes[11].dist = -mins[2];
+	CM_PackBrushPlanes(&hull->brush);
+
+	VectorCopy(mins, hull->brush.bounds[0]);
+	VectorCopy(maxs, hull->brush.bounds[1]);
 
 	return BOX_MODEL_HANDLE;
 }
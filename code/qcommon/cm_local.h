@@ -24,13 +24,18 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "qcommon.h"
 #include "cm_polylib.h"
 
+#include <stdatomic.h>
+
 #define MAX_SUBMODELS		 256
 #define BOX_MODEL_HANDLE	 255
 #define CAPSULE_MODEL_HANDLE 254
 
+// nodes are stored depth first, front child right after its parent, with
+// the plane copied in so walking the tree only reads this array
 typedef struct {
-	cplane_t *plane;
-	int		  children[2]; // negative numbers are leafs
+	cplane_t plane;
+	int		 children[2]; // negative numbers are leafs
+	int		 pad;		  // 32 bytes, never split across cache lines
 } cNode_t;
 
 typedef struct {
@@ -55,17 +60,28 @@ typedef struct {
 	int		  shaderNum;
 } cbrushside_t;
 
+// brush side planes packed four at a time, structure of arrays, so
+// cm_trace.c can test a whole block of planes with one set of SIMD ops
+#define BRUSH_PLANE_LANES		4
+#define BRUSH_PLANE_BLOCKS(n)	(((n) + BRUSH_PLANE_LANES - 1) / BRUSH_PLANE_LANES)
+#define BRUSH_PLANE_PADDING		1e30f // dist of unused lanes, nothing is ever in front of them
+
 typedef struct {
-	int			  shaderNum; // the shader that determined the contents
-	int			  contents;
-	vec3_t		  bounds[2];
-	int			  numsides;
-	cbrushside_t *sides;
-	int			  checkcount; // to avoid repeated testings
+	float normal[3][BRUSH_PLANE_LANES];
+	float dist[BRUSH_PLANE_LANES];
+	int	  negative[3][BRUSH_PLANE_LANES]; // all bits set where plane->signbits has the axis bit
+} cbrushPlanes_t;
+
+typedef struct {
+	int				shaderNum; // the shader that determined the contents
+	int				contents;
+	vec3_t			bounds[2];
+	int				numsides;
+	cbrushside_t   *sides;
+	cbrushPlanes_t *planes; // BRUSH_PLANE_BLOCKS(numsides) copies of the side planes
 } cbrush_t;
 
 typedef struct {
-	int					   checkcount; // to avoid repeated testings
 	int					   surfaceFlags;
 	int					   contents;
 	struct patchCollide_s *pc;
@@ -122,19 +138,80 @@ typedef struct {
 	cPatch_t **surfaces; // non-patches will be NULL
 
 	int floodvalid;
-	int checkcount; // incremented on each trace
+
+	char	 mapName[MAX_QPATH]; // unlike name, also set for client loads
+	unsigned checksum;			 // of the whole bsp file
+
+	const void *mapFile; // FS_MapFile image the entity string and visibility point into, NULL if copied
 } clipMap_t;
 
+// Collision queries may run on several threads at once against a loaded
+// map: nothing in the map is written while tracing.  The per-query state
+// that used to live in the map (brush and patch visit stamps, the temp
+// box hull) is kept per thread instead.  Loading or clearing a map while
+// another thread is tracing is not supported.
+#ifdef _MSC_VER
+#define CM_THREAD_LOCAL __declspec(thread)
+#else
+#define CM_THREAD_LOCAL _Thread_local
+#endif
+
+// visit stamps, so a brush or patch that sits in several leafs is only
+// tested once per trace.  A batched trace shares one stamp between up to
+// CM_TRACE_PACKET traces and keeps a bit per trace.
+#define CM_TRACE_PACKET 16
+
+typedef struct {
+	int checkcount;
+	int rays; // traces of the packet that already tested it
+} cmVisit_t;
+
+typedef struct {
+	int		   checkcount; // incremented on each query of this thread
+	int		   numBrushes; // cm.numBrushes + the box hull brush
+	int		   numPatches;
+	cmVisit_t *brushes;
+	cmVisit_t *patches;
+} cmVisits_t;
+
+static ID_INLINE qboolean CM_FirstVisit(cmVisit_t *v, int checkcount, int rayBit) {
+	if (v->checkcount != checkcount) {
+		v->checkcount = checkcount;
+		v->rays		  = rayBit;
+		return qtrue;
+	}
+	if (v->rays & rayBit) { return qfalse; }
+	v->rays |= rayBit;
+	return qtrue;
+}
+
 // keep 1/8 unit away to keep the position valid before network snapping
 // and to avoid various numeric issues
 #define SURFACE_CLIP_EPSILON (0.125)
 
 extern clipMap_t cm;
-extern int		 c_pointcontents;
-extern int		 c_traces, c_brush_traces, c_patch_traces;
+extern atomic_int c_pointcontents;
+extern atomic_int c_traces, c_brush_traces, c_patch_traces;
+extern atomic_int cm_counting;
 extern cvar_t	*cm_noAreas;
 extern cvar_t	*cm_noCurves;
 extern cvar_t	*cm_playerCurveClip;
+extern cvar_t	*cm_debugSurfaceUpdate;
+extern cvar_t	*cm_patchCache;
+
+// statistics only, may be bumped from any thread.  Only counted while someone
+// is looking, so the hot paths don't pay for a locked add on every query
+#define CM_COUNT(c)                                                                                                    \
+	do {                                                                                                               \
+		if (atomic_load_explicit(&cm_counting, memory_order_relaxed)) {                                                \
+			atomic_fetch_add_explicit(&(c), 1, memory_order_relaxed);                                                  \
+		}                                                                                                              \
+	} while (0)
+
+// cm_load.c
+
+void	  CM_PackBrushPlanes(cbrush_t *b);
+cbrush_t *CM_LeafBrush(int brushnum);
 
 // cm_test.c
 
@@ -147,20 +224,29 @@ typedef struct {
 } sphere_t;
 
 typedef struct {
-	vec3_t	 start;
-	vec3_t	 end;
-	vec3_t	 size[2];	  // size of the box being swept through the model
-	vec3_t	 offsets[8];  // [signbits][x] = either size[0][x] or size[1][x]
-	float	 maxOffset;	  // longest corner length from origin
-	vec3_t	 extents;	  // greatest of abs(size[0]) and abs(size[1])
-	vec3_t	 bounds[2];	  // enclosing box of start and end surrounding by size
-	vec3_t	 modelOrigin; // origin of the model tracing through
-	int		 contents;	  // ored contents of the model tracing through
-	qboolean isPoint;	  // optimized case
-	trace_t	 trace;		  // returned from trace call
-	sphere_t sphere;	  // sphere for oriendted capsule collision
+	vec3_t		start;
+	vec3_t		end;
+	vec3_t		size[2];	 // size of the box being swept through the model
+	vec3_t		offsets[8];	 // [signbits][x] = either size[0][x] or size[1][x]
+	float		maxOffset;	 // longest corner length from origin
+	vec3_t		extents;	 // greatest of abs(size[0]) and abs(size[1])
+	vec3_t		bounds[2];	 // enclosing box of start and end surrounding by size
+	vec3_t		modelOrigin; // origin of the model tracing through
+	int			contents;	 // ored contents of the model tracing through
+	qboolean	isPoint;	 // optimized case
+	trace_t		trace;		 // returned from trace call
+	sphere_t	sphere;		 // sphere for oriendted capsule collision
+	cmVisits_t *visits;		 // brushes and patches already tested by this trace
+	int			rayBit;		 // this trace's bit in the visit masks
 } traceWork_t;
 
+// the part of a trace that still has to be walked through a subtree
+typedef struct {
+	traceWork_t *tw;
+	float		 p1f, p2f;
+	vec3_t		 p1, p2;
+} cmTraceSegment_t;
+
 typedef struct leafList_s {
 	int		 count;
 	int		 maxcount;
@@ -169,8 +255,11 @@ typedef struct leafList_s {
 	vec3_t	 bounds[2];
 	int		 lastLeaf; // for overflows where each leaf can't be stored individually
 	void (*storeLeafs)(struct leafList_s *ll, int nodenum);
+	cmVisits_t *visits; // only used by CM_StoreBrushes
 } leafList_t;
 
+cmVisits_t *CM_BeginVisits(void);
+
 int CM_BoxBrushes(const vec3_t mins, const vec3_t maxs, cbrush_t **list, int listsize);
 
 void CM_StoreLeafs(leafList_t *ll, int nodenum);
@@ -182,9 +271,58 @@ cmodel_t *CM_ClipHandleToModel(clipHandle_t handle);
 qboolean  CM_BoundsIntersect(const vec3_t mins, const vec3_t maxs, const vec3_t mins2, const vec3_t maxs2);
 qboolean  CM_BoundsIntersectPoint(const vec3_t mins, const vec3_t maxs, const vec3_t point);
 
+// cm_trace.c
+
+extern qboolean cm_scalarPlanes;
+
 // cm_patch.c
 
+extern int c_totalPatchBlocks;
+
 struct patchCollide_s *CM_GeneratePatchCollide(int width, int height, vec3_t *points);
 void				   CM_TraceThroughPatchCollide(traceWork_t *tw, const struct patchCollide_s *pc);
 qboolean			   CM_PositionTestInPatchCollide(traceWork_t *tw, const struct patchCollide_s *pc);
 void				   CM_ClearLevelPatches(void);
+int					   CM_PatchCollideCacheSize(const struct patchCollide_s *pc);
+int					   CM_WritePatchCollide(const struct patchCollide_s *pc, byte *out);
+struct patchCollide_s *CM_ReadPatchCollide(const byte *data, int size);
+
+// cm_record.c
+
+#define CM_RECORD_IDENT	  (('G' << 24) + ('O' << 16) + ('L' << 8) + 'C') // little-endian "CLOG"
+#define CM_RECORD_VERSION 1
+
+typedef struct {
+	int	 ident;
+	int	 version;
+	int	 checksum; // of the bsp the queries were made on
+	char map[MAX_QPATH];
+} cmRecordHeader_t;
+
+typedef enum { CMQ_POINT, CMQ_TRANSFORMED_POINT, CMQ_TRACE, CMQ_TRANSFORMED_TRACE, CMQ_NUM_TYPES } cmQueryType_t;
+
+typedef struct {
+	cmQueryType_t type;
+	clipHandle_t  model;
+	qboolean	  capsule;
+	qboolean	  tempBox; // model is the temp box with these bounds
+	vec3_t		  boxMins, boxMaxs;
+	vec3_t		  start; // the point for point contents
+	vec3_t		  end, mins, maxs;
+	int			  brushmask;
+	vec3_t		  origin, angles; // transformed queries only
+	int			  contents;		  // point contents result
+	trace_t		  trace;		  // trace result
+} cmQuery_t;
+
+extern atomic_int cm_recording;
+
+#define CM_RECORDING() atomic_load_explicit(&cm_recording, memory_order_relaxed)
+
+void CM_RecordPointContents(const vec3_t p, clipHandle_t model, const vec3_t origin, const vec3_t angles, int contents);
+void CM_RecordTrace(const trace_t *trace, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs,
+					clipHandle_t model, int brushmask, int capsule, const vec3_t origin, const vec3_t angles);
+int		 CM_ReadQuery(const byte *data, int size, cmQuery_t *q);
+void	 CM_RunQuery(const cmQuery_t *q, cmQuery_t *out);
+qboolean CM_SameQueryResult(const cmQuery_t *q, const cmQuery_t *result);
+void	 CM_StopRecording(void);
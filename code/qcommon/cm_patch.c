@@ -32,6 +32,9 @@ struct patchCollide_s	*CM_GeneratePatchCollide( int width, int height, const vec
 void CM_TraceThroughPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 qboolean CM_PositionTestInPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 void CM_DrawDebugSurface( void (*drawPoly)(int color, int numPoints, flaot *points) );
+int CM_PatchCollideCacheSize( const struct patchCollide_s *pc );
+int CM_WritePatchCollide( const struct patchCollide_s *pc, byte *out );
+struct patchCollide_s *CM_ReadPatchCollide( const byte *data, int size );
 
 
 WARNING: this may misbehave with meshes that have rows or columns that only
@@ -84,8 +87,10 @@ int c_totalPatchBlocks;
 int c_totalPatchSurfaces;
 int c_totalPatchEdges;
 
-static const patchCollide_t *debugPatchCollide;
-static const facet_t		*debugFacet;
+// last facet hit by a trace on this thread, so traces running on other
+// threads never hand the renderer a mismatched collide/facet pair
+static CM_THREAD_LOCAL const patchCollide_t *debugPatchCollide;
+static CM_THREAD_LOCAL const facet_t		*debugFacet;
 static qboolean				 debugBlock;
 static vec3_t				 debugBlockPoints[4];
 
@@ -1120,6 +1125,184 @@ struct patchCollide_s *CM_GeneratePatchCollide(int width, int height, vec3_t *po
 /*
 ================================================================================
 
+PATCH COLLIDE CACHE
+
+Generated patch collision can be written out as little endian ints and floats and
+read back on a later load of the same map, skipping the subdivision and facet work.
+
+================================================================================
+*/
+
+typedef struct {
+	const byte *data;
+	int			size;
+	int			ofs;
+	qboolean	overflowed;
+} patchCacheReader_t;
+
+static void CM_CacheWriteInt(byte **out, int value) {
+	value = LittleLong(value);
+	memcpy(*out, &value, 4);
+	*out += 4;
+}
+
+static void CM_CacheWriteFloat(byte **out, float value) {
+	value = LittleFloat(value);
+	memcpy(*out, &value, 4);
+	*out += 4;
+}
+
+static int CM_CacheReadInt(patchCacheReader_t *r) {
+	int value;
+
+	if (r->ofs + 4 > r->size) {
+		r->overflowed = qtrue;
+		return 0;
+	}
+	memcpy(&value, r->data + r->ofs, 4);
+	r->ofs += 4;
+	return LittleLong(value);
+}
+
+static float CM_CacheReadFloat(patchCacheReader_t *r) {
+	float value;
+
+	if (r->ofs + 4 > r->size) {
+		r->overflowed = qtrue;
+		return 0;
+	}
+	memcpy(&value, r->data + r->ofs, 4);
+	r->ofs += 4;
+	return LittleFloat(value);
+}
+
+/*
+===================
+CM_PatchCollideCacheSize
+
+Number of bytes CM_WritePatchCollide will write
+===================
+*/
+int CM_PatchCollideCacheSize(const struct patchCollide_s *pc) {
+	int size;
+	int i;
+
+	size = (6 + 2) * 4;
+	size += pc->numPlanes * 5 * 4;
+	for (i = 0; i < pc->numFacets; i++) { size += (2 + pc->facets[i].numBorders * 3) * 4; }
+
+	return size;
+}
+
+/*
+===================
+CM_WritePatchCollide
+
+Returns the number of bytes written to out
+===================
+*/
+int CM_WritePatchCollide(const struct patchCollide_s *pc, byte *out) {
+	const facet_t *facet;
+	byte		  *start;
+	int			   i, j;
+
+	start = out;
+
+	for (i = 0; i < 3; i++) { CM_CacheWriteFloat(&out, pc->bounds[0][i]); }
+	for (i = 0; i < 3; i++) { CM_CacheWriteFloat(&out, pc->bounds[1][i]); }
+	CM_CacheWriteInt(&out, pc->numPlanes);
+	CM_CacheWriteInt(&out, pc->numFacets);
+
+	for (i = 0; i < pc->numPlanes; i++) {
+		for (j = 0; j < 4; j++) { CM_CacheWriteFloat(&out, pc->planes[i].plane[j]); }
+		CM_CacheWriteInt(&out, pc->planes[i].signbits);
+	}
+
+	for (i = 0, facet = pc->facets; i < pc->numFacets; i++, facet++) {
+		CM_CacheWriteInt(&out, facet->surfacePlane);
+		CM_CacheWriteInt(&out, facet->numBorders);
+		for (j = 0; j < facet->numBorders; j++) {
+			CM_CacheWriteInt(&out, facet->borderPlanes[j]);
+			CM_CacheWriteInt(&out, facet->borderInward[j]);
+			CM_CacheWriteInt(&out, facet->borderNoAdjust[j]);
+		}
+	}
+
+	return out - start;
+}
+
+/*
+===================
+CM_ReadPatchCollide
+
+Loads patch collision written by CM_WritePatchCollide, returns NULL
+if the data is truncated or out of range.  Uses the same scratch
+planes and facets as CM_GeneratePatchCollide.
+===================
+*/
+struct patchCollide_s *CM_ReadPatchCollide(const byte *data, int size) {
+	patchCacheReader_t r;
+	patchCollide_t	  *pf;
+	vec3_t			   bounds[2];
+	int				   planeCount, facetCount;
+	facet_t			  *facet;
+	int				   i, j;
+
+	r.data		 = data;
+	r.size		 = size;
+	r.ofs		 = 0;
+	r.overflowed = qfalse;
+
+	for (i = 0; i < 3; i++) { bounds[0][i] = CM_CacheReadFloat(&r); }
+	for (i = 0; i < 3; i++) { bounds[1][i] = CM_CacheReadFloat(&r); }
+	planeCount = CM_CacheReadInt(&r);
+	facetCount = CM_CacheReadInt(&r);
+	if (r.overflowed || planeCount < 0 || planeCount > MAX_PATCH_PLANES || facetCount < 0 || facetCount > MAX_FACETS) {
+		return NULL;
+	}
+
+	for (i = 0; i < planeCount; i++) {
+		for (j = 0; j < 4; j++) { planes[i].plane[j] = CM_CacheReadFloat(&r); }
+		planes[i].signbits = CM_CacheReadInt(&r);
+		// indexes the trace offsets, so it has to agree with the normal
+		if (planes[i].signbits != CM_SignbitsForNormal(planes[i].plane)) { return NULL; }
+	}
+
+	for (i = 0, facet = facets; i < facetCount; i++, facet++) {
+		facet->surfacePlane = CM_CacheReadInt(&r);
+		facet->numBorders	= CM_CacheReadInt(&r);
+		if (facet->surfacePlane < 0 || facet->surfacePlane >= planeCount || facet->numBorders < 0 ||
+			facet->numBorders > (int)ARRAY_LEN(facet->borderPlanes)) {
+			return NULL;
+		}
+		for (j = 0; j < facet->numBorders; j++) {
+			facet->borderPlanes[j]	 = CM_CacheReadInt(&r);
+			facet->borderInward[j]	 = CM_CacheReadInt(&r);
+			facet->borderNoAdjust[j] = CM_CacheReadInt(&r);
+			// generated facets never keep a -1 border, see CM_ValidateFacet
+			if (facet->borderPlanes[j] < 0 || facet->borderPlanes[j] >= planeCount) { return NULL; }
+		}
+		if (r.overflowed) { return NULL; }
+	}
+
+	if (r.overflowed || r.ofs != size) { return NULL; }
+
+	pf = Hunk_Alloc(sizeof(*pf), h_high);
+	VectorCopy(bounds[0], pf->bounds[0]);
+	VectorCopy(bounds[1], pf->bounds[1]);
+	pf->numPlanes = planeCount;
+	pf->numFacets = facetCount;
+	pf->facets	  = Hunk_Alloc(facetCount * sizeof(*pf->facets), h_high);
+	memcpy(pf->facets, facets, facetCount * sizeof(*pf->facets));
+	pf->planes = Hunk_Alloc(planeCount * sizeof(*pf->planes), h_high);
+	memcpy(pf->planes, planes, planeCount * sizeof(*pf->planes));
+
+	return pf;
+}
+
+/*
+================================================================================
+
 TRACE TESTING
 
 ================================================================================
@@ -1141,9 +1324,6 @@ void CM_TracePointThroughPatchCollide(traceWork_t *tw, const struct patchCollide
 	int					i, j, k;
 	float				offset;
 	float				d1, d2;
-#ifndef BSPC
-	static cvar_t *cv;
-#endif // BSPC
 
 #ifndef BSPC
 	if (!cm_playerCurveClip->integer || !tw->isPoint) { return; }
@@ -1190,8 +1370,7 @@ void CM_TracePointThroughPatchCollide(traceWork_t *tw, const struct patchCollide
 		if (j == facet->numBorders) {
 			// we hit this facet
 #ifndef BSPC
-			if (!cv) { cv = Cvar_Get("r_debugSurfaceUpdate", "1", 0); }
-			if (cv->integer) {
+			if (cm_debugSurfaceUpdate->integer) {
 				debugPatchCollide = pc;
 				debugFacet		  = facet;
 			}
@@ -1260,9 +1439,6 @@ void CM_TraceThroughPatchCollide(traceWork_t *tw, const struct patchCollide_s *p
 	facet_t		 *facet;
 	float		  plane[4] = {0, 0, 0, 0}, bestplane[4] = {0, 0, 0, 0};
 	vec3_t		  startp, endp;
-#ifndef BSPC
-	static cvar_t *cv;
-#endif // BSPC
 
 	if (!CM_BoundsIntersect(tw->bounds[0], tw->bounds[1], pc->bounds[0], pc->bounds[1])) { return; }
 
@@ -1347,8 +1523,7 @@ void CM_TraceThroughPatchCollide(traceWork_t *tw, const struct patchCollide_s *p
 			if (enterFrac < tw->trace.fraction) {
 				if (enterFrac < 0) { enterFrac = 0; }
 #ifndef BSPC
-				if (!cv) { cv = Cvar_Get("r_debugSurfaceUpdate", "1", 0); }
-				if (cv && cv->integer) {
+				if (cm_debugSurfaceUpdate->integer) {
 					debugPatchCollide = pc;
 					debugFacet		  = facet;
 				}
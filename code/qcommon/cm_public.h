@@ -22,6 +22,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "qfiles.h"
 
+// Once a map is loaded, point contents, traces and leaf queries may be
+// called from any number of threads at once.  CM_LoadMap and CM_ClearMap
+// must not overlap with them.  The temp box model is per thread and is
+// only valid on the thread that called CM_TempBoxModel.
+
 void		 CM_LoadMap(const char *name, qboolean clientload, int *checksum);
 void		 CM_ClearMap(void);
 clipHandle_t CM_InlineModel(int index); // 0 = world, 1 + are bmodels
@@ -39,6 +44,8 @@ int CM_TransformedPointContents(const vec3_t p, clipHandle_t model, const vec3_t
 
 void CM_BoxTrace(trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs, clipHandle_t model,
 				 int brushmask, int capsule);
+void CM_BoxTraceBatch(trace_t *results, const traceRay_t *rays, int numRays, clipHandle_t model, int brushmask,
+					  int capsule);
 void CM_TransformedBoxTrace(trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs,
 							clipHandle_t model, int brushmask, const vec3_t origin, const vec3_t angles, int capsule);
 
@@ -50,6 +57,20 @@ int CM_PointLeafnum(const vec3_t p);
 // overflow if return listsize and if *lastLeaf != list[listsize-1]
 int CM_BoxLeafnums(const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf);
 
+// the deepest part of the tree a box was found in, so the next lookup for a
+// box that barely moved can skip the walk down to it.  All zero is the root
+typedef struct {
+	int		 node;		 // node, or -1 - leaf, the whole box is in
+	vec3_t	 mins, maxs; // space of the node, bounded by the axial planes above it
+	qboolean reused;	 // the last lookup started from the previous cell
+} leafCell_t;
+
+// CM_BoxLeafnums starting from the cell of the previous lookup when the box
+// is still inside it, the cell is updated to the one of this box.  Returns
+// the same leafs as CM_BoxLeafnums.  Cells are only valid for the loaded map
+int CM_BoxLeafnumsCell(const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf,
+					   leafCell_t *cell);
+
 int CM_LeafCluster(int leafnum);
 int CM_LeafArea(int leafnum);
 
@@ -58,5 +79,12 @@ qboolean CM_AreasConnected(int area1, int area2);
 
 int CM_WriteAreaBits(byte *buffer, int area);
 
+// turns the trace and point contents statistics on or off
+void CM_CountQueries(qboolean count);
+
+// cm_record.c
+void CM_Record_f(void);
+void CM_StopRecord_f(void);
+
 // cm_patch.c
 void CM_DrawDebugSurface(void (*drawPoly)(int color, int numPoints, float *points));
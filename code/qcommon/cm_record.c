@@ -0,0 +1,454 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cm_record.c -- collision query log for the cmbench tool
+
+#include "cm_local.h"
+
+/*
+===============================================================================
+
+QUERY RECORDING
+
+While recording, every point contents and box trace query is written with
+its result to a log, so the exact same work can be replayed and timed
+outside of the game against the same bsp.
+
+The log starts with a cmRecordHeader_t, followed by one record per query:
+
+  byte	type		cmQueryType_t
+  byte	flags		CMQ_CAPSULE, CMQ_TEMPBOX, CMQ_ALLSOLID, CMQ_STARTSOLID
+  int	model
+  vec3	boxMins, boxMaxs	only with CMQ_TEMPBOX
+  vec3	start
+  vec3	end, mins, maxs		traces only
+  int	brushmask			traces only
+  vec3	origin, angles		transformed queries only
+  int	contents			point contents result, or trace contents
+  float	fraction, endpos[3], normal[3], dist		traces only
+  int	surfaceFlags		traces only
+
+All values are little endian.
+
+===============================================================================
+*/
+
+#define CMQ_CAPSULE	   1
+#define CMQ_TEMPBOX	   2 // the query was against the temp box model, its bounds are stored
+#define CMQ_ALLSOLID   4
+#define CMQ_STARTSOLID 8
+
+#define RECORD_BUFFER_SIZE 0x10000
+#define MAX_QUERY_SIZE	   256 // largest record is a transformed trace against the temp box
+
+static struct {
+	fileHandle_t file;
+	atomic_flag	 lock;
+	byte		 buffer[RECORD_BUFFER_SIZE];
+	int			 used;
+	int			 numQueries;
+} cmRecord = {.lock = ATOMIC_FLAG_INIT};
+
+atomic_int cm_recording;
+
+static void CM_RecordInt(byte **out, int value) {
+	value = LittleLong(value);
+	memcpy(*out, &value, 4);
+	*out += 4;
+}
+
+static void CM_RecordFloat(byte **out, float value) {
+	value = LittleFloat(value);
+	memcpy(*out, &value, 4);
+	*out += 4;
+}
+
+static void CM_RecordVector(byte **out, const vec3_t v) {
+	CM_RecordFloat(out, v[0]);
+	CM_RecordFloat(out, v[1]);
+	CM_RecordFloat(out, v[2]);
+}
+
+static int CM_ReadRecordInt(const byte **in) {
+	int value;
+
+	memcpy(&value, *in, 4);
+	*in += 4;
+	return LittleLong(value);
+}
+
+static float CM_ReadRecordFloat(const byte **in) {
+	float value;
+
+	memcpy(&value, *in, 4);
+	*in += 4;
+	return LittleFloat(value);
+}
+
+static void CM_ReadRecordVector(const byte **in, vec3_t v) {
+	v[0] = CM_ReadRecordFloat(in);
+	v[1] = CM_ReadRecordFloat(in);
+	v[2] = CM_ReadRecordFloat(in);
+}
+
+/*
+==================
+CM_QuerySize
+
+Bytes of a record with the given type and flags
+==================
+*/
+static int CM_QuerySize(int type, int flags) {
+	int size;
+
+	size = 2 + 4 + 12;
+	if (flags & CMQ_TEMPBOX) { size += 24; }
+	if (type == CMQ_TRACE || type == CMQ_TRANSFORMED_TRACE) { size += 36 + 4 + 32 + 4; }
+	if (type == CMQ_TRANSFORMED_POINT || type == CMQ_TRANSFORMED_TRACE) { size += 24; }
+	size += 4;
+
+	return size;
+}
+
+/*
+==================
+CM_FlushRecording
+
+Must be called with the lock held
+==================
+*/
+static void CM_FlushRecording(void) {
+	if (cmRecord.used) {
+		FS_Write(cmRecord.buffer, cmRecord.used, cmRecord.file);
+		cmRecord.used = 0;
+	}
+}
+
+/*
+==================
+CM_RecordQuery
+
+Appends a query and its result to the log.  Queries from other threads
+are serialized, but the log is written from whichever thread fills the
+buffer, so recording is meant for the main thread queries of a normal
+game or bot match.
+==================
+*/
+static void CM_RecordQuery(const cmQuery_t *q) {
+	byte	 record[MAX_QUERY_SIZE];
+	byte	*out;
+	cmodel_t *box;
+	int		 flags;
+
+	flags = 0;
+	if (q->capsule) { flags |= CMQ_CAPSULE; }
+	if (q->model == BOX_MODEL_HANDLE || q->model == CAPSULE_MODEL_HANDLE) { flags |= CMQ_TEMPBOX; }
+	if (q->trace.allsolid) { flags |= CMQ_ALLSOLID; }
+	if (q->trace.startsolid) { flags |= CMQ_STARTSOLID; }
+
+	out	   = record;
+	*out++ = q->type;
+	*out++ = flags;
+	CM_RecordInt(&out, q->model);
+	if (flags & CMQ_TEMPBOX) {
+		// the bounds are the same for box and capsule handles
+		box = CM_ClipHandleToModel(BOX_MODEL_HANDLE);
+		CM_RecordVector(&out, box->mins);
+		CM_RecordVector(&out, box->maxs);
+	}
+	CM_RecordVector(&out, q->start);
+	if (q->type == CMQ_TRACE || q->type == CMQ_TRANSFORMED_TRACE) {
+		CM_RecordVector(&out, q->end);
+		CM_RecordVector(&out, q->mins);
+		CM_RecordVector(&out, q->maxs);
+		CM_RecordInt(&out, q->brushmask);
+	}
+	if (q->type == CMQ_TRANSFORMED_POINT || q->type == CMQ_TRANSFORMED_TRACE) {
+		CM_RecordVector(&out, q->origin);
+		CM_RecordVector(&out, q->angles);
+	}
+	if (q->type == CMQ_TRACE || q->type == CMQ_TRANSFORMED_TRACE) {
+		CM_RecordInt(&out, q->trace.contents);
+		CM_RecordFloat(&out, q->trace.fraction);
+		CM_RecordVector(&out, q->trace.endpos);
+		CM_RecordVector(&out, q->trace.plane.normal);
+		CM_RecordFloat(&out, q->trace.plane.dist);
+		CM_RecordInt(&out, q->trace.surfaceFlags);
+	} else {
+		CM_RecordInt(&out, q->contents);
+	}
+
+	while (atomic_flag_test_and_set_explicit(&cmRecord.lock, memory_order_acquire)) {}
+
+	if (cmRecord.file) {
+		if (cmRecord.used + (out - record) > RECORD_BUFFER_SIZE) { CM_FlushRecording(); }
+		memcpy(cmRecord.buffer + cmRecord.used, record, out - record);
+		cmRecord.used += out - record;
+		cmRecord.numQueries++;
+	}
+
+	atomic_flag_clear_explicit(&cmRecord.lock, memory_order_release);
+}
+
+/*
+==================
+CM_RecordPointContents
+
+origin and angles are NULL for untransformed queries
+==================
+*/
+void CM_RecordPointContents(const vec3_t p, clipHandle_t model, const vec3_t origin, const vec3_t angles, int contents) {
+	cmQuery_t q;
+
+	memset(&q, 0, sizeof(q));
+	q.type	= origin ? CMQ_TRANSFORMED_POINT : CMQ_POINT;
+	q.model = model;
+	VectorCopy(p, q.start);
+	if (origin) {
+		VectorCopy(origin, q.origin);
+		VectorCopy(angles, q.angles);
+	}
+	q.contents = contents;
+
+	CM_RecordQuery(&q);
+}
+
+/*
+==================
+CM_RecordTrace
+
+origin and angles are NULL for untransformed traces
+==================
+*/
+void CM_RecordTrace(const trace_t *trace, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs,
+					clipHandle_t model, int brushmask, int capsule, const vec3_t origin, const vec3_t angles) {
+	cmQuery_t q;
+
+	memset(&q, 0, sizeof(q));
+	q.type	  = origin ? CMQ_TRANSFORMED_TRACE : CMQ_TRACE;
+	q.model	  = model;
+	q.capsule = capsule;
+	VectorCopy(start, q.start);
+	VectorCopy(end, q.end);
+	VectorCopy(mins ? mins : vec3_origin, q.mins);
+	VectorCopy(maxs ? maxs : vec3_origin, q.maxs);
+	q.brushmask = brushmask;
+	if (origin) {
+		VectorCopy(origin, q.origin);
+		VectorCopy(angles, q.angles);
+	}
+	q.trace = *trace;
+
+	CM_RecordQuery(&q);
+}
+
+/*
+==================
+CM_ReadQuery
+
+Decodes the record at data, returns its size or 0 if the record is
+truncated or not valid
+==================
+*/
+int CM_ReadQuery(const byte *data, int size, cmQuery_t *q) {
+	const byte *in;
+	int			flags;
+
+	if (size < 2) { return 0; }
+
+	memset(q, 0, sizeof(*q));
+	q->type = data[0];
+	flags	= data[1];
+	if (q->type >= CMQ_NUM_TYPES || size < CM_QuerySize(q->type, flags)) { return 0; }
+
+	in		   = data + 2;
+	q->model   = CM_ReadRecordInt(&in);
+	q->capsule = (flags & CMQ_CAPSULE) ? qtrue : qfalse;
+	q->tempBox = (flags & CMQ_TEMPBOX) ? qtrue : qfalse;
+	if (q->tempBox) {
+		CM_ReadRecordVector(&in, q->boxMins);
+		CM_ReadRecordVector(&in, q->boxMaxs);
+	}
+	CM_ReadRecordVector(&in, q->start);
+	if (q->type == CMQ_TRACE || q->type == CMQ_TRANSFORMED_TRACE) {
+		CM_ReadRecordVector(&in, q->end);
+		CM_ReadRecordVector(&in, q->mins);
+		CM_ReadRecordVector(&in, q->maxs);
+		q->brushmask = CM_ReadRecordInt(&in);
+	}
+	if (q->type == CMQ_TRANSFORMED_POINT || q->type == CMQ_TRANSFORMED_TRACE) {
+		CM_ReadRecordVector(&in, q->origin);
+		CM_ReadRecordVector(&in, q->angles);
+	}
+	if (q->type == CMQ_TRACE || q->type == CMQ_TRANSFORMED_TRACE) {
+		q->trace.allsolid	= (flags & CMQ_ALLSOLID) ? qtrue : qfalse;
+		q->trace.startsolid = (flags & CMQ_STARTSOLID) ? qtrue : qfalse;
+		q->trace.contents	= CM_ReadRecordInt(&in);
+		q->trace.fraction	= CM_ReadRecordFloat(&in);
+		CM_ReadRecordVector(&in, q->trace.endpos);
+		CM_ReadRecordVector(&in, q->trace.plane.normal);
+		q->trace.plane.dist	  = CM_ReadRecordFloat(&in);
+		q->trace.surfaceFlags = CM_ReadRecordInt(&in);
+	} else {
+		q->contents = CM_ReadRecordInt(&in);
+	}
+
+	return in - data;
+}
+
+/*
+==================
+CM_RunQuery
+
+Runs a decoded query again and stores the result in out
+==================
+*/
+void CM_RunQuery(const cmQuery_t *q, cmQuery_t *out) {
+	clipHandle_t model;
+
+	model = q->model;
+	if (q->tempBox) { model = CM_TempBoxModel(q->boxMins, q->boxMaxs, model == CAPSULE_MODEL_HANDLE); }
+
+	switch (q->type) {
+	case CMQ_POINT: out->contents = CM_PointContents(q->start, model); break;
+	case CMQ_TRANSFORMED_POINT: out->contents = CM_TransformedPointContents(q->start, model, q->origin, q->angles); break;
+	case CMQ_TRACE:
+		CM_BoxTrace(&out->trace, q->start, q->end, (float *)q->mins, (float *)q->maxs, model, q->brushmask, q->capsule);
+		break;
+	case CMQ_TRANSFORMED_TRACE:
+		CM_TransformedBoxTrace(&out->trace, q->start, q->end, (float *)q->mins, (float *)q->maxs, model, q->brushmask,
+							   q->origin, q->angles, q->capsule);
+		break;
+	default: break;
+	}
+}
+
+/*
+==================
+CM_SameQueryResult
+
+Compares the parts of the results that are stored in the log
+==================
+*/
+qboolean CM_SameQueryResult(const cmQuery_t *q, const cmQuery_t *result) {
+	const trace_t *a, *b;
+
+	if (q->type == CMQ_POINT || q->type == CMQ_TRANSFORMED_POINT) { return q->contents == result->contents; }
+
+	a = &q->trace;
+	b = &result->trace;
+	return a->allsolid == b->allsolid && a->startsolid == b->startsolid && a->contents == b->contents &&
+		   a->fraction == b->fraction && VectorCompare(a->endpos, b->endpos) &&
+		   VectorCompare(a->plane.normal, b->plane.normal) && a->plane.dist == b->plane.dist &&
+		   a->surfaceFlags == b->surfaceFlags;
+}
+
+/*
+==================
+CM_StopRecording
+==================
+*/
+void CM_StopRecording(void) {
+	fileHandle_t file;
+	int			 numQueries;
+
+	if (!cmRecord.file) { return; }
+
+	atomic_store(&cm_recording, 0);
+
+	while (atomic_flag_test_and_set_explicit(&cmRecord.lock, memory_order_acquire)) {}
+	CM_FlushRecording();
+	file			   = cmRecord.file;
+	numQueries		   = cmRecord.numQueries;
+	cmRecord.file	   = 0;
+	atomic_flag_clear_explicit(&cmRecord.lock, memory_order_release);
+
+	FS_FCloseFile(file);
+	Com_Printf("Stopped collision recording, %i queries\n", numQueries);
+}
+
+/*
+==================
+CM_Record_f
+
+cmrecord [name]
+==================
+*/
+void CM_Record_f(void) {
+	cmRecordHeader_t header;
+	char			 base[MAX_QPATH];
+	char			 name[MAX_QPATH];
+
+	if (Cmd_Argc() > 2) {
+		Com_Printf("usage: cmrecord [name]\n");
+		return;
+	}
+
+	if (!cm.numNodes) {
+		Com_Printf("No map loaded.\n");
+		return;
+	}
+
+	if (cmRecord.file) {
+		Com_Printf("Already recording.\n");
+		return;
+	}
+
+	if (Cmd_Argc() == 2) {
+		Com_sprintf(name, sizeof(name), "cmlogs/%s.cmlog", Cmd_Argv(1));
+	} else {
+		COM_StripExtension(COM_SkipPath(cm.mapName), base, sizeof(base));
+		Com_sprintf(name, sizeof(name), "cmlogs/%s.cmlog", base);
+	}
+
+	cmRecord.file = FS_FOpenFileWrite(name);
+	if (!cmRecord.file) {
+		Com_Printf("ERROR: couldn't open %s\n", name);
+		return;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.ident	= LittleLong(CM_RECORD_IDENT);
+	header.version	= LittleLong(CM_RECORD_VERSION);
+	header.checksum = LittleLong(cm.checksum);
+	Q_strncpyz(header.map, cm.mapName, sizeof(header.map));
+	FS_Write(&header, sizeof(header), cmRecord.file);
+
+	cmRecord.used		= 0;
+	cmRecord.numQueries = 0;
+	atomic_store(&cm_recording, 1);
+
+	Com_Printf("Recording collision queries on %s to %s\n", cm.mapName, name);
+}
+
+/*
+==================
+CM_StopRecord_f
+==================
+*/
+void CM_StopRecord_f(void) {
+	if (!cmRecord.file) {
+		Com_Printf("Not recording collision queries.\n");
+		return;
+	}
+
+	CM_StopRecording();
+}
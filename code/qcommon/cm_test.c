@@ -21,6 +21,36 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "cm_local.h"
 
+static CM_THREAD_LOCAL cmVisits_t visits;
+
+/*
+==================
+CM_BeginVisits
+
+Starts a new query on the calling thread, every brush and patch counts
+as unvisited afterwards.  The stamp arrays follow the loaded map size, a
+stale stamp left from an older map is always below the current count.
+==================
+*/
+cmVisits_t *CM_BeginVisits(void) {
+	cmVisits_t *v		   = &visits;
+	int			numBrushes = cm.numBrushes + 1; // the box hull brush
+
+	if (v->numBrushes != numBrushes || v->numPatches != cm.numSurfaces) {
+		free(v->brushes);
+		free(v->patches);
+		v->brushes = calloc(numBrushes, sizeof(*v->brushes));
+		v->patches = calloc(cm.numSurfaces + 1, sizeof(*v->patches));
+		if (!v->brushes || !v->patches) { Com_Error(ERR_FATAL, "CM_BeginVisits: out of memory"); }
+		v->numBrushes = numBrushes;
+		v->numPatches = cm.numSurfaces;
+		v->checkcount = 0;
+	}
+
+	v->checkcount++;
+	return v;
+}
+
 /*
 ==================
 CM_PointLeafnum_r
@@ -34,7 +64,7 @@ int CM_PointLeafnum_r(const vec3_t p, int num) {
 
 	while (num >= 0) {
 		node  = cm.nodes + num;
-		plane = node->plane;
+		plane = &node->plane;
 
 		if (plane->type < 3)
 			d = p[plane->type] - plane->dist;
@@ -46,7 +76,7 @@ int CM_PointLeafnum_r(const vec3_t p, int num) {
 			num = node->children[0];
 	}
 
-	c_pointcontents++; // optimize counter
+	CM_COUNT(c_pointcontents); // optimize counter
 
 	return -1 - num;
 }
@@ -94,11 +124,11 @@ void CM_StoreBrushes(leafList_t *ll, int nodenum) {
 
 	for (k = 0; k < leaf->numLeafBrushes; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-		b		 = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount) {
+		if (!CM_FirstVisit(&ll->visits->brushes[brushnum], ll->visits->checkcount, 1)) {
 			continue; // already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+
+		b = CM_LeafBrush(brushnum);
 		for (i = 0; i < 3; i++) {
 			if (b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i]) { break; }
 		}
@@ -139,7 +169,7 @@ void CM_BoxLeafnums_r(leafList_t *ll, int nodenum) {
 		}
 
 		node  = &cm.nodes[nodenum];
-		plane = node->plane;
+		plane = &node->plane;
 		s	  = BoxOnPlaneSide(ll->bounds[0], ll->bounds[1], plane);
 		if (s == 1) {
 			nodenum = node->children[0];
@@ -161,8 +191,6 @@ CM_BoxLeafnums
 int CM_BoxLeafnums(const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf) {
 	leafList_t ll;
 
-	cm.checkcount++;
-
 	VectorCopy(mins, ll.bounds[0]);
 	VectorCopy(maxs, ll.bounds[1]);
 	ll.count	  = 0;
@@ -171,6 +199,7 @@ int CM_BoxLeafnums(const vec3_t mins, const vec3_t maxs, int *list, int listsize
 	ll.storeLeafs = CM_StoreLeafs;
 	ll.lastLeaf	  = 0;
 	ll.overflowed = qfalse;
+	ll.visits	  = NULL;
 
 	CM_BoxLeafnums_r(&ll, 0);
 
@@ -178,6 +207,67 @@ int CM_BoxLeafnums(const vec3_t mins, const vec3_t maxs, int *list, int listsize
 	return ll.count;
 }
 
+/*
+==================
+CM_BoxLeafnumsCell
+
+The walk only stores leafs below the first node the box straddles, so
+starting there gives the same list.  The cell is only narrowed by axial
+planes, a box inside it is on the same side of every one of them.
+==================
+*/
+int CM_BoxLeafnumsCell(const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf,
+					   leafCell_t *cell) {
+	leafList_t ll;
+	cNode_t	  *node;
+	int		   i, num, s;
+
+	VectorCopy(mins, ll.bounds[0]);
+	VectorCopy(maxs, ll.bounds[1]);
+	ll.count	  = 0;
+	ll.maxcount	  = listsize;
+	ll.list		  = list;
+	ll.storeLeafs = CM_StoreLeafs;
+	ll.lastLeaf	  = 0;
+	ll.overflowed = qfalse;
+	ll.visits	  = NULL;
+
+	// a flat box on a plane counts as in front of it, start those at the root
+	for (i = 0; i < 3; i++) {
+		if (mins[i] < cell->mins[i] || maxs[i] > cell->maxs[i] || mins[i] >= maxs[i]) { break; }
+	}
+	cell->reused = i == 3 && cell->node;
+	if (!cell->reused) {
+		cell->node = 0;
+		VectorSet(cell->mins, MIN_WORLD_COORD, MIN_WORLD_COORD, MIN_WORLD_COORD);
+		VectorSet(cell->maxs, MAX_WORLD_COORD, MAX_WORLD_COORD, MAX_WORLD_COORD);
+	}
+
+	// go down while the box is on one side of axial planes
+	num = cell->node;
+	while (num >= 0) {
+		node = &cm.nodes[num];
+		if (node->plane.type >= 3) { break; }
+
+		s = BoxOnPlaneSide(ll.bounds[0], ll.bounds[1], &node->plane);
+		if (s == 1) {
+			cell->mins[node->plane.type] = node->plane.dist;
+			num							 = node->children[0];
+		} else if (s == 2) {
+			cell->maxs[node->plane.type] = node->plane.dist;
+			num							 = node->children[1];
+		} else {
+			break;
+		}
+	}
+	cell->node = num;
+
+	CM_BoxLeafnums_r(&ll, num);
+
+	*lastLeaf = ll.lastLeaf;
+	return ll.count;
+}
+
 /*
 ==================
 CM_BoxBrushes
@@ -186,8 +276,6 @@ CM_BoxBrushes
 int CM_BoxBrushes(const vec3_t mins, const vec3_t maxs, cbrush_t **list, int listsize) {
 	leafList_t ll;
 
-	cm.checkcount++;
-
 	VectorCopy(mins, ll.bounds[0]);
 	VectorCopy(maxs, ll.bounds[1]);
 	ll.count	  = 0;
@@ -196,6 +284,7 @@ int CM_BoxBrushes(const vec3_t mins, const vec3_t maxs, cbrush_t **list, int lis
 	ll.storeLeafs = CM_StoreBrushes;
 	ll.lastLeaf	  = 0;
 	ll.overflowed = qfalse;
+	ll.visits	  = CM_BeginVisits();
 
 	CM_BoxLeafnums_r(&ll, 0);
 
@@ -206,11 +295,11 @@ int CM_BoxBrushes(const vec3_t mins, const vec3_t maxs, cbrush_t **list, int lis
 
 /*
 ==================
-CM_PointContents
+CM_PointContentsInModel
 
 ==================
 */
-int CM_PointContents(const vec3_t p, clipHandle_t model) {
+static int CM_PointContentsInModel(const vec3_t p, clipHandle_t model) {
 	int		  leafnum;
 	int		  i, k;
 	int		  brushnum;
@@ -235,7 +324,7 @@ int CM_PointContents(const vec3_t p, clipHandle_t model) {
 	contents = 0;
 	for (k = 0; k < leaf->numLeafBrushes; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-		b		 = &cm.brushes[brushnum];
+		b		 = CM_LeafBrush(brushnum);
 
 		if (!CM_BoundsIntersectPoint(b->bounds[0], b->bounds[1], p)) { continue; }
 
@@ -253,6 +342,21 @@ int CM_PointContents(const vec3_t p, clipHandle_t model) {
 	return contents;
 }
 
+/*
+==================
+CM_PointContents
+
+==================
+*/
+int CM_PointContents(const vec3_t p, clipHandle_t model) {
+	int contents;
+
+	contents = CM_PointContentsInModel(p, model);
+	if (CM_RECORDING()) { CM_RecordPointContents(p, model, NULL, NULL, contents); }
+
+	return contents;
+}
+
 /*
 ==================
 CM_TransformedPointContents
@@ -265,6 +369,7 @@ int CM_TransformedPointContents(const vec3_t p, clipHandle_t model, const vec3_t
 	vec3_t p_l;
 	vec3_t temp;
 	vec3_t forward, right, up;
+	int	   contents;
 
 	// subtract origin offset
 	VectorSubtract(p, origin, p_l);
@@ -279,7 +384,10 @@ int CM_TransformedPointContents(const vec3_t p, clipHandle_t model, const vec3_t
 		p_l[2] = DotProduct(temp, up);
 	}
 
-	return CM_PointContents(p_l, model);
+	contents = CM_PointContentsInModel(p_l, model);
+	if (CM_RECORDING()) { CM_RecordPointContents(p, model, origin, angles, contents); }
+
+	return contents;
 }
 
 /*
@@ -28,6 +28,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 // #define CAPSULE_DEBUG
 
+// test the packed planes one lane at a time even where there is SSE code,
+// cmbench -scalar compares the two
+qboolean cm_scalarPlanes;
+
 /*
 ===============================================================================
 
@@ -142,6 +146,166 @@ float SquareRootFloat(float number) {
 /*
 ===============================================================================
 
+PACKED PLANE TESTS
+
+The brush tests below work on BRUSH_PLANE_LANES planes at a time, using the
+packed copies of the side planes made by CM_PackBrushPlanes.  The SSE code
+does the same multiplies and adds in the same order as the scalar DotProduct
+code, so traces come out bit for bit the same either way.
+
+===============================================================================
+*/
+
+/*
+================
+CM_BoxPlaneDistances
+
+Distances of start and end from a block of planes, each plane pushed out
+by the corner of the trace box that reaches it first.  Returns a bit for
+every lane the move is completely in front of, which means the brush
+can't be hit at all.
+================
+*/
+static ID_INLINE int CM_BoxPlaneDistances(const traceWork_t *tw, const cbrushPlanes_t *block, const vec3_t start,
+										  const vec3_t end, float *d1, float *d2) {
+	int	   lane, inFront = 0;
+	vec3_t normal, offset;
+	float  dist;
+
+#if idx64
+	if (!cm_scalarPlanes) {
+		__m128 nx, ny, nz, ox, oy, oz, neg, dists, v1, v2;
+
+		nx = _mm_loadu_ps(block->normal[0]);
+		ny = _mm_loadu_ps(block->normal[1]);
+		nz = _mm_loadu_ps(block->normal[2]);
+
+		// tw->offsets[plane->signbits]
+		neg = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)block->negative[0]));
+		ox	= _mm_or_ps(_mm_and_ps(neg, _mm_set1_ps(tw->size[1][0])), _mm_andnot_ps(neg, _mm_set1_ps(tw->size[0][0])));
+		neg = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)block->negative[1]));
+		oy	= _mm_or_ps(_mm_and_ps(neg, _mm_set1_ps(tw->size[1][1])), _mm_andnot_ps(neg, _mm_set1_ps(tw->size[0][1])));
+		neg = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)block->negative[2]));
+		oz	= _mm_or_ps(_mm_and_ps(neg, _mm_set1_ps(tw->size[1][2])), _mm_andnot_ps(neg, _mm_set1_ps(tw->size[0][2])));
+
+		dists = _mm_sub_ps(_mm_loadu_ps(block->dist),
+						   _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, nx), _mm_mul_ps(oy, ny)), _mm_mul_ps(oz, nz)));
+
+		v1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(start[0]), nx), _mm_mul_ps(_mm_set1_ps(start[1]), ny)),
+						_mm_mul_ps(_mm_set1_ps(start[2]), nz));
+		v1 = _mm_sub_ps(v1, dists);
+		v2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(end[0]), nx), _mm_mul_ps(_mm_set1_ps(end[1]), ny)),
+						_mm_mul_ps(_mm_set1_ps(end[2]), nz));
+		v2 = _mm_sub_ps(v2, dists);
+
+		_mm_storeu_ps(d1, v1);
+		_mm_storeu_ps(d2, v2);
+
+		// d1 > 0 && (d2 >= SURFACE_CLIP_EPSILON || d2 >= d1)
+		return _mm_movemask_ps(_mm_and_ps(
+			_mm_cmpgt_ps(v1, _mm_setzero_ps()),
+			_mm_or_ps(_mm_cmpge_ps(v2, _mm_set1_ps(SURFACE_CLIP_EPSILON)), _mm_cmpge_ps(v2, v1))));
+	}
+#endif
+
+	for (lane = 0; lane < BRUSH_PLANE_LANES; lane++) {
+		normal[0] = block->normal[0][lane];
+		normal[1] = block->normal[1][lane];
+		normal[2] = block->normal[2][lane];
+		offset[0] = tw->size[block->negative[0][lane] ? 1 : 0][0];
+		offset[1] = tw->size[block->negative[1][lane] ? 1 : 0][1];
+		offset[2] = tw->size[block->negative[2][lane] ? 1 : 0][2];
+
+		dist	 = block->dist[lane] - DotProduct(offset, normal);
+		d1[lane] = DotProduct(start, normal) - dist;
+		d2[lane] = DotProduct(end, normal) - dist;
+
+		if (d1[lane] > 0 && (d2[lane] >= SURFACE_CLIP_EPSILON || d2[lane] >= d1[lane])) { inFront |= 1 << lane; }
+	}
+
+	return inFront;
+}
+
+/*
+================
+CM_SpherePlaneDistances
+
+Same as CM_BoxPlaneDistances for the capsule, measuring from whichever end
+sphere is closest to each plane
+================
+*/
+static ID_INLINE int CM_SpherePlaneDistances(const traceWork_t *tw, const cbrushPlanes_t *block, const vec3_t start,
+											 const vec3_t end, float *d1, float *d2) {
+	const float *so = tw->sphere.offset;
+	int			 lane, inFront = 0;
+	vec3_t		 normal, startp, endp;
+	float		 dist;
+
+#if idx64
+	if (!cm_scalarPlanes) {
+		__m128 nx, ny, nz, t, dists, px, py, pz, v1, v2;
+
+		nx = _mm_loadu_ps(block->normal[0]);
+		ny = _mm_loadu_ps(block->normal[1]);
+		nz = _mm_loadu_ps(block->normal[2]);
+
+		dists = _mm_add_ps(_mm_loadu_ps(block->dist), _mm_set1_ps(tw->sphere.radius));
+
+		// lanes where the lower sphere is closest
+		t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(so[0])), _mm_mul_ps(ny, _mm_set1_ps(so[1]))),
+					   _mm_mul_ps(nz, _mm_set1_ps(so[2])));
+		t = _mm_cmpgt_ps(t, _mm_setzero_ps());
+
+#define SPHERE_POINT(p, i)                                                                                             \
+	_mm_or_ps(_mm_and_ps(t, _mm_set1_ps((p)[i] - so[i])), _mm_andnot_ps(t, _mm_set1_ps((p)[i] + so[i])))
+
+		px = SPHERE_POINT(start, 0);
+		py = SPHERE_POINT(start, 1);
+		pz = SPHERE_POINT(start, 2);
+		v1 = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, nx), _mm_mul_ps(py, ny)), _mm_mul_ps(pz, nz)), dists);
+
+		px = SPHERE_POINT(end, 0);
+		py = SPHERE_POINT(end, 1);
+		pz = SPHERE_POINT(end, 2);
+		v2 = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, nx), _mm_mul_ps(py, ny)), _mm_mul_ps(pz, nz)), dists);
+
+#undef SPHERE_POINT
+
+		_mm_storeu_ps(d1, v1);
+		_mm_storeu_ps(d2, v2);
+
+		return _mm_movemask_ps(_mm_and_ps(
+			_mm_cmpgt_ps(v1, _mm_setzero_ps()),
+			_mm_or_ps(_mm_cmpge_ps(v2, _mm_set1_ps(SURFACE_CLIP_EPSILON)), _mm_cmpge_ps(v2, v1))));
+	}
+#endif
+
+	for (lane = 0; lane < BRUSH_PLANE_LANES; lane++) {
+		normal[0] = block->normal[0][lane];
+		normal[1] = block->normal[1][lane];
+		normal[2] = block->normal[2][lane];
+
+		dist = block->dist[lane] + tw->sphere.radius;
+		if (DotProduct(normal, so) > 0) {
+			VectorSubtract(start, so, startp);
+			VectorSubtract(end, so, endp);
+		} else {
+			VectorAdd(start, so, startp);
+			VectorAdd(end, so, endp);
+		}
+
+		d1[lane] = DotProduct(startp, normal) - dist;
+		d2[lane] = DotProduct(endp, normal) - dist;
+
+		if (d1[lane] > 0 && (d2[lane] >= SURFACE_CLIP_EPSILON || d2[lane] >= d1[lane])) { inFront |= 1 << lane; }
+	}
+
+	return inFront;
+}
+
+/*
+===============================================================================
+
 POSITION TESTING
 
 ===============================================================================
@@ -153,13 +317,9 @@ CM_TestBoxInBrush
 ================
 */
 void CM_TestBoxInBrush(traceWork_t *tw, cbrush_t *brush) {
-	int			  i;
-	cplane_t	 *plane;
-	float		  dist;
-	float		  d1;
-	cbrushside_t *side;
-	float		  t;
-	vec3_t		  startp;
+	int	  i;
+	int	  inFront;
+	float d1[BRUSH_PLANE_LANES], d2[BRUSH_PLANE_LANES];
 
 	if (!brush->numsides) { return; }
 
@@ -170,41 +330,20 @@ void CM_TestBoxInBrush(traceWork_t *tw, cbrush_t *brush) {
 		return;
 	}
 
-	if (tw->sphere.use) {
-		// the first six planes are the axial planes, so we only
-		// need to test the remainder
-		for (i = 6; i < brush->numsides; i++) {
-			side  = brush->sides + i;
-			plane = side->plane;
-
-			// adjust the plane distance appropriately for radius
-			dist = plane->dist + tw->sphere.radius;
-			// find the closest point on the capsule to the plane
-			t = DotProduct(plane->normal, tw->sphere.offset);
-			if (t > 0) {
-				VectorSubtract(tw->start, tw->sphere.offset, startp);
-			} else {
-				VectorAdd(tw->start, tw->sphere.offset, startp);
-			}
-			d1 = DotProduct(startp, plane->normal) - dist;
-			// if completely in front of face, no intersection
-			if (d1 > 0) { return; }
+	// the first six planes are the axial planes, so we only
+	// need to test the remainder
+	for (i = 6 - 6 % BRUSH_PLANE_LANES; i < brush->numsides; i += BRUSH_PLANE_LANES) {
+		// with start == end, a lane is in front exactly when d1 > 0
+		if (tw->sphere.use) {
+			inFront = CM_SpherePlaneDistances(tw, &brush->planes[i / BRUSH_PLANE_LANES], tw->start, tw->start, d1, d2);
+		} else {
+			inFront = CM_BoxPlaneDistances(tw, &brush->planes[i / BRUSH_PLANE_LANES], tw->start, tw->start, d1, d2);
 		}
-	} else {
-		// the first six planes are the axial planes, so we only
-		// need to test the remainder
-		for (i = 6; i < brush->numsides; i++) {
-			side  = brush->sides + i;
-			plane = side->plane;
-
-			// adjust the plane distance appropriately for mins/maxs
-			dist = plane->dist - DotProduct(tw->offsets[plane->signbits], plane->normal);
 
-			d1 = DotProduct(tw->start, plane->normal) - dist;
+		if (i < 6) { inFront &= ~0U << (6 - i); }
 
-			// if completely in front of face, no intersection
-			if (d1 > 0) { return; }
-		}
+		// if completely in front of face, no intersection
+		if (inFront) { return; }
 	}
 
 	// inside this brush
@@ -221,17 +360,18 @@ CM_TestInLeaf
 void CM_TestInLeaf(traceWork_t *tw, cLeaf_t *leaf) {
 	int		  k;
 	int		  brushnum;
+	int		  surfnum;
 	cbrush_t *b;
 	cPatch_t *patch;
 
 	// test box position against all brushes in the leaf
 	for (k = 0; k < leaf->numLeafBrushes; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-		b		 = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount) {
+		if (!CM_FirstVisit(&tw->visits->brushes[brushnum], tw->visits->checkcount, tw->rayBit)) {
 			continue; // already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+
+		b = CM_LeafBrush(brushnum);
 
 		if (!(b->contents & tw->contents)) { continue; }
 
@@ -246,12 +386,12 @@ void CM_TestInLeaf(traceWork_t *tw, cLeaf_t *leaf) {
 	if (!cm_noCurves->integer) {
 #endif // BSPC
 		for (k = 0; k < leaf->numLeafSurfaces; k++) {
-			patch = cm.surfaces[cm.leafsurfaces[leaf->firstLeafSurface + k]];
+			surfnum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+			patch	= cm.surfaces[surfnum];
 			if (!patch) { continue; }
-			if (patch->checkcount == cm.checkcount) {
+			if (!CM_FirstVisit(&tw->visits->patches[surfnum], tw->visits->checkcount, tw->rayBit)) {
 				continue; // already checked this brush in another leaf
 			}
-			patch->checkcount = cm.checkcount;
 
 			if (!(patch->contents & tw->contents)) { continue; }
 
@@ -397,13 +537,10 @@ void CM_PositionTest(traceWork_t *tw) {
 	ll.storeLeafs = CM_StoreLeafs;
 	ll.lastLeaf	  = 0;
 	ll.overflowed = qfalse;
-
-	cm.checkcount++;
+	ll.visits	  = NULL;
 
 	CM_BoxLeafnums_r(&ll, 0);
 
-	cm.checkcount++;
-
 	// test the contents of the leafs
 	for (i = 0; i < ll.count; i++) {
 		CM_TestInLeaf(tw, &cm.leafs[leafs[i]]);
@@ -428,7 +565,7 @@ CM_TraceThroughPatch
 void CM_TraceThroughPatch(traceWork_t *tw, cPatch_t *patch) {
 	float oldFrac;
 
-	c_patch_traces++;
+	CM_COUNT(c_patch_traces);
 
 	oldFrac = tw->trace.fraction;
 
@@ -446,17 +583,15 @@ CM_TraceThroughBrush
 ================
 */
 void CM_TraceThroughBrush(traceWork_t *tw, cbrush_t *brush) {
-	int			  i;
+	int			  i, lane;
 	cplane_t	 *plane, *clipplane;
-	float		  dist;
 	float		  enterFrac, leaveFrac;
 	float		  d1, d2;
+	float		  dists1[BRUSH_PLANE_LANES], dists2[BRUSH_PLANE_LANES];
+	int			  inFront;
 	qboolean	  getout, startout;
 	float		  f;
 	cbrushside_t *side, *leadside;
-	float		  t;
-	vec3_t		  startp;
-	vec3_t		  endp;
 
 	enterFrac = -1.0;
 	leaveFrac = 1.0;
@@ -464,92 +599,47 @@ void CM_TraceThroughBrush(traceWork_t *tw, cbrush_t *brush) {
 
 	if (!brush->numsides) { return; }
 
-	c_brush_traces++;
+	CM_COUNT(c_brush_traces);
 
 	getout	 = qfalse;
 	startout = qfalse;
 
 	leadside = NULL;
 
-	if (tw->sphere.use) {
-		//
-		// compare the trace against all planes of the brush
-		// find the latest time the trace crosses a plane towards the interior
-		// and the earliest time the trace crosses a plane towards the exterior
-		//
-		for (i = 0; i < brush->numsides; i++) {
-			side  = brush->sides + i;
-			plane = side->plane;
+	//
+	// compare the trace against all planes of the brush
+	// find the latest time the trace crosses a plane towards the interior
+	// and the earliest time the trace crosses a plane towards the exterior
+	//
+	for (i = 0; i < brush->numsides; i += BRUSH_PLANE_LANES) {
+		if (tw->sphere.use) {
+			// planes are pushed out by the radius, measured from the closest sphere
+			inFront =
+				CM_SpherePlaneDistances(tw, &brush->planes[i / BRUSH_PLANE_LANES], tw->start, tw->end, dists1, dists2);
+		} else {
+			// planes are pushed out by the box corner closest to them
+			inFront =
+				CM_BoxPlaneDistances(tw, &brush->planes[i / BRUSH_PLANE_LANES], tw->start, tw->end, dists1, dists2);
+		}
 
-			// adjust the plane distance appropriately for radius
-			dist = plane->dist + tw->sphere.radius;
+		// if completely in front of face, no intersection with the entire brush
+		if (inFront) { return; }
 
-			// find the closest point on the capsule to the plane
-			t = DotProduct(plane->normal, tw->sphere.offset);
-			if (t > 0) {
-				VectorSubtract(tw->start, tw->sphere.offset, startp);
-				VectorSubtract(tw->end, tw->sphere.offset, endp);
-			} else {
-				VectorAdd(tw->start, tw->sphere.offset, startp);
-				VectorAdd(tw->end, tw->sphere.offset, endp);
-			}
-
-			d1 = DotProduct(startp, plane->normal) - dist;
-			d2 = DotProduct(endp, plane->normal) - dist;
+		for (lane = 0; lane < BRUSH_PLANE_LANES && i + lane < brush->numsides; lane++) {
+			d1 = dists1[lane];
+			d2 = dists2[lane];
 
 			if (d2 > 0) {
 				getout = qtrue; // endpoint is not in solid
 			}
 			if (d1 > 0) { startout = qtrue; }
 
-			// if completely in front of face, no intersection with the entire brush
-			if (d1 > 0 && (d2 >= SURFACE_CLIP_EPSILON || d2 >= d1)) { return; }
-
 			// if it doesn't cross the plane, the plane isn't relevant
 			if (d1 <= 0 && d2 <= 0) { continue; }
 
-			// crosses face
-			if (d1 > d2) { // enter
-				f = (d1 - SURFACE_CLIP_EPSILON) / (d1 - d2);
-				if (f < 0) { f = 0; }
-				if (f > enterFrac) {
-					enterFrac = f;
-					clipplane = plane;
-					leadside  = side;
-				}
-			} else { // leave
-				f = (d1 + SURFACE_CLIP_EPSILON) / (d1 - d2);
-				if (f > 1) { f = 1; }
-				if (f < leaveFrac) { leaveFrac = f; }
-			}
-		}
-	} else {
-		//
-		// compare the trace against all planes of the brush
-		// find the latest time the trace crosses a plane towards the interior
-		// and the earliest time the trace crosses a plane towards the exterior
-		//
-		for (i = 0; i < brush->numsides; i++) {
-			side  = brush->sides + i;
+			side  = brush->sides + i + lane;
 			plane = side->plane;
 
-			// adjust the plane distance appropriately for mins/maxs
-			dist = plane->dist - DotProduct(tw->offsets[plane->signbits], plane->normal);
-
-			d1 = DotProduct(tw->start, plane->normal) - dist;
-			d2 = DotProduct(tw->end, plane->normal) - dist;
-
-			if (d2 > 0) {
-				getout = qtrue; // endpoint is not in solid
-			}
-			if (d1 > 0) { startout = qtrue; }
-
-			// if completely in front of face, no intersection with the entire brush
-			if (d1 > 0 && (d2 >= SURFACE_CLIP_EPSILON || d2 >= d1)) { return; }
-
-			// if it doesn't cross the plane, the plane isn't relevant
-			if (d1 <= 0 && d2 <= 0) { continue; }
-
 			// crosses face
 			if (d1 > d2) { // enter
 				f = (d1 - SURFACE_CLIP_EPSILON) / (d1 - d2);
@@ -600,18 +690,18 @@ CM_TraceThroughLeaf
 void CM_TraceThroughLeaf(traceWork_t *tw, cLeaf_t *leaf) {
 	int		  k;
 	int		  brushnum;
+	int		  surfnum;
 	cbrush_t *b;
 	cPatch_t *patch;
 
 	// trace line against all brushes in the leaf
 	for (k = 0; k < leaf->numLeafBrushes; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-
-		b = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount) {
+		if (!CM_FirstVisit(&tw->visits->brushes[brushnum], tw->visits->checkcount, tw->rayBit)) {
 			continue; // already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+
+		b = CM_LeafBrush(brushnum);
 
 		if (!(b->contents & tw->contents)) { continue; }
 
@@ -628,12 +718,12 @@ void CM_TraceThroughLeaf(traceWork_t *tw, cLeaf_t *leaf) {
 	if (!cm_noCurves->integer) {
 #endif
 		for (k = 0; k < leaf->numLeafSurfaces; k++) {
-			patch = cm.surfaces[cm.leafsurfaces[leaf->firstLeafSurface + k]];
+			surfnum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+			patch	= cm.surfaces[surfnum];
 			if (!patch) { continue; }
-			if (patch->checkcount == cm.checkcount) {
+			if (!CM_FirstVisit(&tw->visits->patches[surfnum], tw->visits->checkcount, tw->rayBit)) {
 				continue; // already checked this patch in another leaf
 			}
-			patch->checkcount = cm.checkcount;
 
 			if (!(patch->contents & tw->contents)) { continue; }
 
@@ -643,6 +733,75 @@ void CM_TraceThroughLeaf(traceWork_t *tw, cLeaf_t *leaf) {
 	}
 }
 
+/*
+================
+CM_TraceThroughLeafPacket
+
+CM_TraceThroughLeaf for every trace of a packet, each brush and patch
+of the leaf is fetched once for all of them
+================
+*/
+void CM_TraceThroughLeafPacket(cmTraceSegment_t *segs, int numSegs, cLeaf_t *leaf) {
+	int			 i, k;
+	int			 brushnum;
+	int			 surfnum;
+	int			 active;
+	cbrush_t	*b;
+	cPatch_t	*patch;
+	traceWork_t *tw;
+	cmVisits_t	*visits;
+
+	visits = segs[0].tw->visits;
+	active = (1 << numSegs) - 1; // traces that haven't been stopped in this leaf yet
+
+	// trace lines against all brushes in the leaf
+	for (k = 0; k < leaf->numLeafBrushes && active; k++) {
+		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
+		b		 = CM_LeafBrush(brushnum);
+
+		for (i = 0; i < numSegs; i++) {
+			if (!(active & (1 << i))) { continue; }
+			tw = segs[i].tw;
+			if (!CM_FirstVisit(&visits->brushes[brushnum], visits->checkcount, tw->rayBit)) {
+				continue; // already checked this brush in another leaf
+			}
+
+			if (!(b->contents & tw->contents)) { continue; }
+
+			if (!CM_BoundsIntersect(tw->bounds[0], tw->bounds[1], b->bounds[0], b->bounds[1])) { continue; }
+
+			CM_TraceThroughBrush(tw, b);
+			if (!tw->trace.fraction) { active &= ~(1 << i); }
+		}
+	}
+
+	// trace lines against all patches in the leaf
+#ifdef BSPC
+	if (1) {
+#else
+	if (!cm_noCurves->integer) {
+#endif
+		for (k = 0; k < leaf->numLeafSurfaces && active; k++) {
+			surfnum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+			patch	= cm.surfaces[surfnum];
+			if (!patch) { continue; }
+
+			for (i = 0; i < numSegs; i++) {
+				if (!(active & (1 << i))) { continue; }
+				tw = segs[i].tw;
+				if (!CM_FirstVisit(&visits->patches[surfnum], visits->checkcount, tw->rayBit)) {
+					continue; // already checked this patch in another leaf
+				}
+
+				if (!(patch->contents & tw->contents)) { continue; }
+
+				CM_TraceThroughPatch(tw, patch);
+				if (!tw->trace.fraction) { active &= ~(1 << i); }
+			}
+		}
+	}
+}
+
 #define RADIUS_EPSILON 1.0f
 
 /*
@@ -919,6 +1078,37 @@ void CM_TraceBoundingBoxThroughCapsule(traceWork_t *tw, clipHandle_t model) {
 
 //=========================================================================================
 
+/*
+==================
+CM_SplitSegment
+
+Part of a segment up to (first) or past (!first) the crosspoint at frac
+==================
+*/
+static void CM_SplitSegment(cmTraceSegment_t *out, const cmTraceSegment_t *in, float frac, qboolean first) {
+	float  midf;
+	vec3_t mid;
+
+	midf = in->p1f + (in->p2f - in->p1f) * frac;
+
+	mid[0] = in->p1[0] + frac * (in->p2[0] - in->p1[0]);
+	mid[1] = in->p1[1] + frac * (in->p2[1] - in->p1[1]);
+	mid[2] = in->p1[2] + frac * (in->p2[2] - in->p1[2]);
+
+	out->tw = in->tw;
+	if (first) {
+		out->p1f = in->p1f;
+		out->p2f = midf;
+		VectorCopy(in->p1, out->p1);
+		VectorCopy(mid, out->p2);
+	} else {
+		out->p1f = midf;
+		out->p2f = in->p2f;
+		VectorCopy(mid, out->p1);
+		VectorCopy(in->p2, out->p2);
+	}
+}
+
 /*
 ==================
 CM_TraceThroughTree
@@ -954,7 +1144,7 @@ void CM_TraceThroughTree(traceWork_t *tw, int num, float p1f, float p2f, vec3_t
 	// and the offset for the size of the box
 	//
 	node  = cm.nodes + num;
-	plane = node->plane;
+	plane = &node->plane;
 
 	// adjust the plane distance appropriately for mins/maxs
 	if (plane->type < 3) {
@@ -1024,206 +1214,430 @@ void CM_TraceThroughTree(traceWork_t *tw, int num, float p1f, float p2f, vec3_t
 	CM_TraceThroughTree(tw, node->children[side ^ 1], midf, p2f, mid, p2);
 }
 
-//======================================================================
-
 /*
 ==================
-CM_Trace
+CM_TraceThroughTreePacket
+
+CM_TraceThroughTree for a packet of traces walking the tree together.
+Every trace still visits its leafs in the order it would on its own, so
+a trace gives the same result whether it is batched or not.  segs is
+reordered.
 ==================
 */
-void CM_Trace(trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs, clipHandle_t model,
-			  const vec3_t origin, int brushmask, int capsule, sphere_t *sphere) {
-	int			i;
-	traceWork_t tw;
-	vec3_t		offset;
-	cmodel_t   *cmod;
+void CM_TraceThroughTreePacket(cmTraceSegment_t *segs, int numSegs, int num) {
+	cmTraceSegment_t sub[CM_TRACE_PACKET];
+	float			 frac[CM_TRACE_PACKET], frac2[CM_TRACE_PACKET];
+	int				 route[CM_TRACE_PACKET];
+	int				 i, n;
+	cNode_t			*node;
+	cplane_t		*plane;
+	traceWork_t		*tw;
+	float			 t1, t2, offset;
+	float			 idist;
+
+	for (i = n = 0; i < numSegs; i++) {
+		if (segs[i].tw->trace.fraction <= segs[i].p1f) {
+			continue; // already hit something nearer
+		}
+		segs[n++] = segs[i];
+	}
+	if (!n) { return; }
+	if (n == 1) {
+		CM_TraceThroughTree(segs[0].tw, num, segs[0].p1f, segs[0].p2f, segs[0].p1, segs[0].p2);
+		return;
+	}
+	numSegs = n;
 
-	cmod = CM_ClipHandleToModel(model);
+	// if < 0, we are in a leaf node
+	if (num < 0) {
+		CM_TraceThroughLeafPacket(segs, numSegs, &cm.leafs[-1 - num]);
+		return;
+	}
+
+	//
+	// find the point distances to the separating plane
+	// and the offset for the size of the box
+	//
+	node  = cm.nodes + num;
+	plane = &node->plane;
 
-	cm.checkcount++; // for multi-check avoidance
+	for (i = 0; i < numSegs; i++) {
+		tw = segs[i].tw;
 
-	c_traces++; // for statistics, may be zeroed
+		// adjust the plane distance appropriately for mins/maxs
+		if (plane->type < 3) {
+			t1	   = segs[i].p1[plane->type] - plane->dist;
+			t2	   = segs[i].p2[plane->type] - plane->dist;
+			offset = tw->extents[plane->type];
+		} else {
+			t1 = DotProduct(plane->normal, segs[i].p1) - plane->dist;
+			t2 = DotProduct(plane->normal, segs[i].p2) - plane->dist;
+			if (tw->isPoint) {
+				offset = 0;
+			} else {
+				// this is silly
+				offset = 2048;
+			}
+		}
 
-	// fill in a default trace
-	memset(&tw, 0, sizeof(tw));
-	tw.trace.fraction = 1; // assume it goes the entire distance until shown otherwise
-	VectorCopy(origin, tw.modelOrigin);
+		// see which sides we need to consider
+		if (t1 >= offset + 1 && t2 >= offset + 1) {
+			route[i] = 0; // front only
+			continue;
+		}
+		if (t1 < -offset - 1 && t2 < -offset - 1) {
+			route[i] = 1; // back only
+			continue;
+		}
 
-	if (!cm.numNodes) {
-		*results = tw.trace;
+		// put the crosspoint SURFACE_CLIP_EPSILON pixels on the near side
+		if (t1 < t2) {
+			idist	 = 1.0 / (t1 - t2);
+			route[i] = 3; // back first
+			frac2[i] = (t1 + offset + SURFACE_CLIP_EPSILON) * idist;
+			frac[i]	 = (t1 - offset + SURFACE_CLIP_EPSILON) * idist;
+		} else if (t1 > t2) {
+			idist	 = 1.0 / (t1 - t2);
+			route[i] = 2; // front first
+			frac2[i] = (t1 - offset - SURFACE_CLIP_EPSILON) * idist;
+			frac[i]	 = (t1 + offset + SURFACE_CLIP_EPSILON) * idist;
+		} else {
+			route[i] = 2;
+			frac[i]	 = 1;
+			frac2[i] = 0;
+		}
 
-		return; // map not loaded, shouldn't happen
+		// move up to the node, and go past it
+		if (frac[i] < 0) { frac[i] = 0; }
+		if (frac[i] > 1) { frac[i] = 1; }
+		if (frac2[i] < 0) { frac2[i] = 0; }
+		if (frac2[i] > 1) { frac2[i] = 1; }
 	}
 
-	// allow NULL to be passed in for 0,0,0
-	if (!mins) { mins = vec3_origin; }
-	if (!maxs) { maxs = vec3_origin; }
+	// front children first, then the back, then the front again for the
+	// traces that started behind the plane
+	for (i = n = 0; i < numSegs; i++) {
+		if (route[i] == 0) {
+			sub[n++] = segs[i];
+		} else if (route[i] == 2) {
+			CM_SplitSegment(&sub[n++], &segs[i], frac[i], qtrue);
+		}
+	}
+	if (n) { CM_TraceThroughTreePacket(sub, n, node->children[0]); }
+
+	for (i = n = 0; i < numSegs; i++) {
+		if (route[i] == 1) {
+			sub[n++] = segs[i];
+		} else if (route[i] == 2) {
+			CM_SplitSegment(&sub[n++], &segs[i], frac2[i], qfalse);
+		} else if (route[i] == 3) {
+			CM_SplitSegment(&sub[n++], &segs[i], frac[i], qtrue);
+		}
+	}
+	if (n) { CM_TraceThroughTreePacket(sub, n, node->children[1]); }
+
+	for (i = n = 0; i < numSegs; i++) {
+		if (route[i] == 3) { CM_SplitSegment(&sub[n++], &segs[i], frac2[i], qfalse); }
+	}
+	if (n) { CM_TraceThroughTreePacket(sub, n, node->children[0]); }
+}
+
+//======================================================================
+
+/*
+==================
+CM_TraceSetup
+
+Fills in the trace work for one sweep
+==================
+*/
+static void CM_TraceSetup(traceWork_t *tw, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs,
+						  const vec3_t origin, int brushmask, int capsule, const sphere_t *sphere) {
+	int	   i;
+	vec3_t offset;
+
+	// fill in a default trace
+	memset(tw, 0, sizeof(*tw));
+	tw->trace.fraction = 1; // assume it goes the entire distance until shown otherwise
+	VectorCopy(origin, tw->modelOrigin);
 
 	// set basic parms
-	tw.contents = brushmask;
+	tw->contents = brushmask;
 
 	// adjust so that mins and maxs are always symetric, which
 	// avoids some complications with plane expanding of rotated
 	// bmodels
 	for (i = 0; i < 3; i++) {
-		offset[i]	  = (mins[i] + maxs[i]) * 0.5;
-		tw.size[0][i] = mins[i] - offset[i];
-		tw.size[1][i] = maxs[i] - offset[i];
-		tw.start[i]	  = start[i] + offset[i];
-		tw.end[i]	  = end[i] + offset[i];
+		offset[i]	   = (mins[i] + maxs[i]) * 0.5;
+		tw->size[0][i] = mins[i] - offset[i];
+		tw->size[1][i] = maxs[i] - offset[i];
+		tw->start[i]   = start[i] + offset[i];
+		tw->end[i]	   = end[i] + offset[i];
 	}
 
 	// if a sphere is already specified
 	if (sphere) {
-		tw.sphere = *sphere;
+		tw->sphere = *sphere;
 	} else {
-		tw.sphere.use		 = capsule;
-		tw.sphere.radius	 = (tw.size[1][0] > tw.size[1][2]) ? tw.size[1][2] : tw.size[1][0];
-		tw.sphere.halfheight = tw.size[1][2];
-		VectorSet(tw.sphere.offset, 0, 0, tw.size[1][2] - tw.sphere.radius);
+		tw->sphere.use		  = capsule;
+		tw->sphere.radius	  = (tw->size[1][0] > tw->size[1][2]) ? tw->size[1][2] : tw->size[1][0];
+		tw->sphere.halfheight = tw->size[1][2];
+		VectorSet(tw->sphere.offset, 0, 0, tw->size[1][2] - tw->sphere.radius);
 	}
 
-	tw.maxOffset = tw.size[1][0] + tw.size[1][1] + tw.size[1][2];
+	tw->maxOffset = tw->size[1][0] + tw->size[1][1] + tw->size[1][2];
 
-	// tw.offsets[signbits] = vector to appropriate corner from origin
-	tw.offsets[0][0] = tw.size[0][0];
-	tw.offsets[0][1] = tw.size[0][1];
-	tw.offsets[0][2] = tw.size[0][2];
+	// tw->offsets[signbits] = vector to appropriate corner from origin
+	tw->offsets[0][0] = tw->size[0][0];
+	tw->offsets[0][1] = tw->size[0][1];
+	tw->offsets[0][2] = tw->size[0][2];
 
-	tw.offsets[1][0] = tw.size[1][0];
-	tw.offsets[1][1] = tw.size[0][1];
-	tw.offsets[1][2] = tw.size[0][2];
+	tw->offsets[1][0] = tw->size[1][0];
+	tw->offsets[1][1] = tw->size[0][1];
+	tw->offsets[1][2] = tw->size[0][2];
 
-	tw.offsets[2][0] = tw.size[0][0];
-	tw.offsets[2][1] = tw.size[1][1];
-	tw.offsets[2][2] = tw.size[0][2];
+	tw->offsets[2][0] = tw->size[0][0];
+	tw->offsets[2][1] = tw->size[1][1];
+	tw->offsets[2][2] = tw->size[0][2];
 
-	tw.offsets[3][0] = tw.size[1][0];
-	tw.offsets[3][1] = tw.size[1][1];
-	tw.offsets[3][2] = tw.size[0][2];
+	tw->offsets[3][0] = tw->size[1][0];
+	tw->offsets[3][1] = tw->size[1][1];
+	tw->offsets[3][2] = tw->size[0][2];
 
-	tw.offsets[4][0] = tw.size[0][0];
-	tw.offsets[4][1] = tw.size[0][1];
-	tw.offsets[4][2] = tw.size[1][2];
+	tw->offsets[4][0] = tw->size[0][0];
+	tw->offsets[4][1] = tw->size[0][1];
+	tw->offsets[4][2] = tw->size[1][2];
 
-	tw.offsets[5][0] = tw.size[1][0];
-	tw.offsets[5][1] = tw.size[0][1];
-	tw.offsets[5][2] = tw.size[1][2];
+	tw->offsets[5][0] = tw->size[1][0];
+	tw->offsets[5][1] = tw->size[0][1];
+	tw->offsets[5][2] = tw->size[1][2];
 
-	tw.offsets[6][0] = tw.size[0][0];
-	tw.offsets[6][1] = tw.size[1][1];
-	tw.offsets[6][2] = tw.size[1][2];
+	tw->offsets[6][0] = tw->size[0][0];
+	tw->offsets[6][1] = tw->size[1][1];
+	tw->offsets[6][2] = tw->size[1][2];
 
-	tw.offsets[7][0] = tw.size[1][0];
-	tw.offsets[7][1] = tw.size[1][1];
-	tw.offsets[7][2] = tw.size[1][2];
+	tw->offsets[7][0] = tw->size[1][0];
+	tw->offsets[7][1] = tw->size[1][1];
+	tw->offsets[7][2] = tw->size[1][2];
 
 	//
 	// calculate bounds
 	//
-	if (tw.sphere.use) {
+	if (tw->sphere.use) {
 		for (i = 0; i < 3; i++) {
-			if (tw.start[i] < tw.end[i]) {
-				tw.bounds[0][i] = tw.start[i] - fabs(tw.sphere.offset[i]) - tw.sphere.radius;
-				tw.bounds[1][i] = tw.end[i] + fabs(tw.sphere.offset[i]) + tw.sphere.radius;
+			if (tw->start[i] < tw->end[i]) {
+				tw->bounds[0][i] = tw->start[i] - fabs(tw->sphere.offset[i]) - tw->sphere.radius;
+				tw->bounds[1][i] = tw->end[i] + fabs(tw->sphere.offset[i]) + tw->sphere.radius;
 			} else {
-				tw.bounds[0][i] = tw.end[i] - fabs(tw.sphere.offset[i]) - tw.sphere.radius;
-				tw.bounds[1][i] = tw.start[i] + fabs(tw.sphere.offset[i]) + tw.sphere.radius;
+				tw->bounds[0][i] = tw->end[i] - fabs(tw->sphere.offset[i]) - tw->sphere.radius;
+				tw->bounds[1][i] = tw->start[i] + fabs(tw->sphere.offset[i]) + tw->sphere.radius;
 			}
 		}
 	} else {
 		for (i = 0; i < 3; i++) {
-			if (tw.start[i] < tw.end[i]) {
-				tw.bounds[0][i] = tw.start[i] + tw.size[0][i];
-				tw.bounds[1][i] = tw.end[i] + tw.size[1][i];
+			if (tw->start[i] < tw->end[i]) {
+				tw->bounds[0][i] = tw->start[i] + tw->size[0][i];
+				tw->bounds[1][i] = tw->end[i] + tw->size[1][i];
 			} else {
-				tw.bounds[0][i] = tw.end[i] + tw.size[0][i];
-				tw.bounds[1][i] = tw.start[i] + tw.size[1][i];
+				tw->bounds[0][i] = tw->end[i] + tw->size[0][i];
+				tw->bounds[1][i] = tw->start[i] + tw->size[1][i];
 			}
 		}
 	}
+}
 
+/*
+==================
+CM_TraceModel
+
+Everything but sweeps through the world tree, which CM_TraceBatch
+gathers into packets
+==================
+*/
+static void CM_TraceModel(traceWork_t *tw, clipHandle_t model, cmodel_t *cmod, qboolean positionTest) {
 	//
 	// check for position test special case
 	//
-	if (start[0] == end[0] && start[1] == end[1] && start[2] == end[2]) {
+	if (positionTest) {
 		if (model) {
 #ifdef ALWAYS_BBOX_VS_BBOX // FIXME - compile time flag?
 			if (model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE) {
-				tw.sphere.use = qfalse;
-				CM_TestInLeaf(&tw, &cmod->leaf);
+				tw->sphere.use = qfalse;
+				CM_TestInLeaf(tw, &cmod->leaf);
 			} else
 #elif defined(ALWAYS_CAPSULE_VS_CAPSULE)
 			if (model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE) {
-				CM_TestCapsuleInCapsule(&tw, model);
+				CM_TestCapsuleInCapsule(tw, model);
 			} else
 #endif
 				if (model == CAPSULE_MODEL_HANDLE) {
-				if (tw.sphere.use) {
-					CM_TestCapsuleInCapsule(&tw, model);
+				if (tw->sphere.use) {
+					CM_TestCapsuleInCapsule(tw, model);
 				} else {
-					CM_TestBoundingBoxInCapsule(&tw, model);
+					CM_TestBoundingBoxInCapsule(tw, model);
 				}
 			} else {
-				CM_TestInLeaf(&tw, &cmod->leaf);
+				CM_TestInLeaf(tw, &cmod->leaf);
 			}
 		} else {
-			CM_PositionTest(&tw);
-		}
-	} else {
-		//
-		// check for point special case
-		//
-		if (tw.size[0][0] == 0 && tw.size[0][1] == 0 && tw.size[0][2] == 0) {
-			tw.isPoint = qtrue;
-			VectorClear(tw.extents);
-		} else {
-			tw.isPoint	  = qfalse;
-			tw.extents[0] = tw.size[1][0];
-			tw.extents[1] = tw.size[1][1];
-			tw.extents[2] = tw.size[1][2];
+			CM_PositionTest(tw);
 		}
+		return;
+	}
 
-		//
-		// general sweeping through world
-		//
-		if (model) {
+	//
+	// general sweeping through a model
+	//
 #ifdef ALWAYS_BBOX_VS_BBOX
-			if (model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE) {
-				tw.sphere.use = qfalse;
-				CM_TraceThroughLeaf(&tw, &cmod->leaf);
-			} else
+	if (model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE) {
+		tw->sphere.use = qfalse;
+		CM_TraceThroughLeaf(tw, &cmod->leaf);
+	} else
 #elif defined(ALWAYS_CAPSULE_VS_CAPSULE)
-			if (model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE) {
-				CM_TraceCapsuleThroughCapsule(&tw, model);
-			} else
+	if (model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE) {
+		CM_TraceCapsuleThroughCapsule(tw, model);
+	} else
 #endif
-				if (model == CAPSULE_MODEL_HANDLE) {
-				if (tw.sphere.use) {
-					CM_TraceCapsuleThroughCapsule(&tw, model);
+		if (model == CAPSULE_MODEL_HANDLE) {
+		if (tw->sphere.use) {
+			CM_TraceCapsuleThroughCapsule(tw, model);
+		} else {
+			CM_TraceBoundingBoxThroughCapsule(tw, model);
+		}
+	} else {
+		CM_TraceThroughLeaf(tw, &cmod->leaf);
+	}
+}
+
+/*
+==================
+CM_TraceBatch
+
+Traces are handled in packets of CM_TRACE_PACKET that share the visit
+stamps and walk the world tree together.
+==================
+*/
+static void CM_TraceBatch(trace_t *results, const traceRay_t *rays, int numRays, clipHandle_t model,
+						  const vec3_t origin, int brushmask, int capsule, const sphere_t *sphere) {
+	traceWork_t		  tws[CM_TRACE_PACKET];
+	cmTraceSegment_t  segs[CM_TRACE_PACKET];
+	int				  first, count, numSegs;
+	int				  i, j;
+	traceWork_t		 *tw;
+	const traceRay_t *ray;
+	cmVisits_t		 *visits;
+	cmodel_t		 *cmod;
+	vec3_t			  capsuleMins, capsuleMaxs;
+
+	cmod = CM_ClipHandleToModel(model);
+
+	// tracing against the capsule replaces it with a temp box, each
+	// trace of the batch has to start from the callers capsule again
+	if (model == CAPSULE_MODEL_HANDLE) { CM_ModelBounds(model, capsuleMins, capsuleMaxs); }
+
+	for (first = 0; first < numRays; first += CM_TRACE_PACKET) {
+		count	= (numRays - first < CM_TRACE_PACKET) ? numRays - first : CM_TRACE_PACKET;
+		visits	= CM_BeginVisits(); // for multi-check avoidance
+		numSegs = 0;
+
+		for (i = 0; i < count; i++) {
+			ray = &rays[first + i];
+			tw	= &tws[i];
+
+			CM_COUNT(c_traces); // for statistics, may be zeroed
+
+			CM_TraceSetup(tw, ray->start, ray->end, ray->mins, ray->maxs, origin, brushmask, capsule, sphere);
+			tw->visits = visits;
+			tw->rayBit = 1 << i;
+
+			if (!cm.numNodes) {
+				continue; // map not loaded, shouldn't happen
+			}
+
+			if (model == CAPSULE_MODEL_HANDLE) { CM_TempBoxModel(capsuleMins, capsuleMaxs, qtrue); }
+
+			if (ray->start[0] == ray->end[0] && ray->start[1] == ray->end[1] && ray->start[2] == ray->end[2]) {
+				CM_TraceModel(tw, model, cmod, qtrue);
+				continue;
+			}
+
+			//
+			// check for point special case
+			//
+			if (tw->size[0][0] == 0 && tw->size[0][1] == 0 && tw->size[0][2] == 0) {
+				tw->isPoint = qtrue;
+				VectorClear(tw->extents);
+			} else {
+				tw->isPoint	   = qfalse;
+				tw->extents[0] = tw->size[1][0];
+				tw->extents[1] = tw->size[1][1];
+				tw->extents[2] = tw->size[1][2];
+			}
+
+			if (model) {
+				CM_TraceModel(tw, model, cmod, qfalse);
+				continue;
+			}
+
+			// general sweeping through world
+			segs[numSegs].tw  = tw;
+			segs[numSegs].p1f = 0;
+			segs[numSegs].p2f = 1;
+			VectorCopy(tw->start, segs[numSegs].p1);
+			VectorCopy(tw->end, segs[numSegs].p2);
+			numSegs++;
+		}
+
+		if (numSegs == 1) {
+			CM_TraceThroughTree(segs[0].tw, 0, 0, 1, segs[0].p1, segs[0].p2);
+		} else if (numSegs) {
+			CM_TraceThroughTreePacket(segs, numSegs, 0);
+		}
+
+		for (i = 0; i < count; i++) {
+			ray = &rays[first + i];
+			tw	= &tws[i];
+
+			if (cm.numNodes) {
+				// generate endpos from the original, unmodified start/end
+				if (tw->trace.fraction == 1) {
+					VectorCopy(ray->end, tw->trace.endpos);
 				} else {
-					CM_TraceBoundingBoxThroughCapsule(&tw, model);
+					for (j = 0; j < 3; j++) {
+						tw->trace.endpos[j] = ray->start[j] + tw->trace.fraction * (ray->end[j] - ray->start[j]);
+					}
 				}
-			} else {
-				CM_TraceThroughLeaf(&tw, &cmod->leaf);
 			}
-		} else {
-			CM_TraceThroughTree(&tw, 0, 0, 1, tw.start, tw.end);
+
+			// If allsolid is set (was entirely inside something solid), the plane is not valid.
+			// If fraction == 1.0, we never hit anything, and thus the plane is not valid.
+			// Otherwise, the normal on the plane should have unit length
+			assert(tw->trace.allsolid || tw->trace.fraction == 1.0 ||
+				   VectorLengthSquared(tw->trace.plane.normal) > 0.9999);
+			results[first + i] = tw->trace;
 		}
 	}
+}
 
-	// generate endpos from the original, unmodified start/end
-	if (tw.trace.fraction == 1) {
-		VectorCopy(end, tw.trace.endpos);
-	} else {
-		for (i = 0; i < 3; i++) { tw.trace.endpos[i] = start[i] + tw.trace.fraction * (end[i] - start[i]); }
-	}
+/*
+==================
+CM_Trace
+==================
+*/
+void CM_Trace(trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs, clipHandle_t model,
+			  const vec3_t origin, int brushmask, int capsule, sphere_t *sphere) {
+	traceRay_t ray;
 
-	// If allsolid is set (was entirely inside something solid), the plane is not valid.
-	// If fraction == 1.0, we never hit anything, and thus the plane is not valid.
-	// Otherwise, the normal on the plane should have unit length
-	assert(tw.trace.allsolid || tw.trace.fraction == 1.0 || VectorLengthSquared(tw.trace.plane.normal) > 0.9999);
-	*results = tw.trace;
+	// allow NULL to be passed in for 0,0,0
+	if (!mins) { mins = vec3_origin; }
+	if (!maxs) { maxs = vec3_origin; }
+
+	VectorCopy(start, ray.start);
+	VectorCopy(end, ray.end);
+	VectorCopy(mins, ray.mins);
+	VectorCopy(maxs, ray.maxs);
+
+	CM_TraceBatch(results, &ray, 1, model, origin, brushmask, capsule, sphere);
 }
 
 /*
@@ -1234,6 +1648,30 @@ CM_BoxTrace
 void CM_BoxTrace(trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs, clipHandle_t model,
 				 int brushmask, int capsule) {
 	CM_Trace(results, start, end, mins, maxs, model, vec3_origin, brushmask, capsule, NULL);
+	if (CM_RECORDING()) { CM_RecordTrace(results, start, end, mins, maxs, model, brushmask, capsule, NULL, NULL); }
+}
+
+/*
+==================
+CM_BoxTraceBatch
+
+Sweeps numRays boxes through the same model with one call, the results
+are identical to numRays CM_BoxTrace calls
+==================
+*/
+void CM_BoxTraceBatch(trace_t *results, const traceRay_t *rays, int numRays, clipHandle_t model, int brushmask,
+					  int capsule) {
+	int i;
+
+	CM_TraceBatch(results, rays, numRays, model, vec3_origin, brushmask, capsule, NULL);
+
+	// logged as single traces, they give the same results
+	if (CM_RECORDING()) {
+		for (i = 0; i < numRays; i++) {
+			CM_RecordTrace(&results[i], rays[i].start, rays[i].end, rays[i].mins, rays[i].maxs, model, brushmask,
+						   capsule, NULL, NULL);
+		}
+	}
 }
 
 /*
@@ -1326,4 +1764,8 @@ void CM_TransformedBoxTrace(trace_t *results, const vec3_t start, const vec3_t e
 	trace.endpos[2] = start[2] + trace.fraction * (end[2] - start[2]);
 
 	*results = trace;
+
+	if (CM_RECORDING()) {
+		CM_RecordTrace(results, start, end, mins, maxs, model, brushmask, capsule, origin, angles);
+	}
 }
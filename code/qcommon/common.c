@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "q_shared.h"
 #include "qcommon.h"
 #include <setjmp.h>
+#include <stdatomic.h>
 #ifndef _WIN32
 #include <netinet/in.h>
 #include <sys/stat.h> // umask
@@ -2465,6 +2466,9 @@ void Com_Init(char *commandLine) {
 	}
 	Cmd_AddCommand("quit", Com_Quit_f);
 	Cmd_AddCommand("changeVectors", MSG_ReportChangeVectors_f);
+	Cmd_AddCommand("huffbench", MSG_HuffmanBenchmark_f);
+	Cmd_AddCommand("cmrecord", CM_Record_f);
+	Cmd_AddCommand("cmstoprecord", CM_StopRecord_f);
 	Cmd_AddCommand("writeconfig", Com_WriteConfig_f);
 	Cmd_SetCommandCompletionFunc("writeconfig", Cmd_CompleteCfgName);
 	Cmd_AddCommand("game_restart", Com_GameRestart_f);
@@ -2928,6 +2932,7 @@ void Com_Frame(void) {
 #endif
 
 	NET_FlushPacketQueue();
+	NET_FlushSendQueue();
 
 	//
 	// report timing information
@@ -2949,10 +2954,11 @@ void Com_Frame(void) {
 	//
 	// trace optimization tracking
 	//
+	CM_CountQueries(com_showtrace->integer != 0);
 	if (com_showtrace->integer) {
 
-		extern int c_traces, c_brush_traces, c_patch_traces;
-		extern int c_pointcontents;
+		extern atomic_int c_traces, c_brush_traces, c_patch_traces;
+		extern atomic_int c_pointcontents;
 
 		Com_Printf("%4i traces  (%ib %ip) %4i points\n", c_traces, c_brush_traces, c_patch_traces, c_pointcontents);
 		c_traces		= 0;
@@ -273,6 +273,20 @@ typedef struct {
 
 static fileHandleData_t fsh[MAX_FILE_HANDLES];
 
+// read only file images shared by every FS_MapFile caller until the last FS_UnmapFile
+#define MAX_MAPPED_FILES 8
+
+typedef struct {
+	char  name[MAX_OSPATH]; // pk3 or qpath the image came from
+	long  offset;			// of the image within name
+	long  length;
+	void *data;
+	void *handle;
+	int	  refs;
+} mappedFile_t;
+
+static mappedFile_t fs_mappedFiles[MAX_MAPPED_FILES];
+
 // TTimo - https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=540
 // wether we did a reorder on the current search path when joining the server
 static qboolean fs_reordered;
@@ -1701,6 +1715,144 @@ void FS_FreeFile(void *buffer) {
 	if (fs_loadStack == 0) { Hunk_ClearTempMemory(); }
 }
 
+/*
+=============
+FS_MapFile
+
+Maps qpath read only instead of copying it to the heap, so large files are
+paged in once and shared by every loader that maps them at the same time.
+Only loose files and entries stored uncompressed at a 4 byte aligned offset
+in a pk3 can be mapped, so structs in the image can be read in place.
+Returns -1 otherwise and the caller should fall back to FS_ReadFile. The
+image is not NUL terminated.
+=============
+*/
+long FS_MapFile(const char *qpath, const void **buffer) {
+	fileHandle_t  h;
+	searchpath_t *search;
+	mappedFile_t *mf, *slot;
+	unz_file_info info;
+	const char	 *name;
+	FILE		 *f;
+	long		  len, offset;
+	int			  i;
+
+	if (!fs_searchpaths) { Com_Error(ERR_FATAL, "Filesystem call made without initialization"); }
+
+	if (!qpath || !qpath[0]) { Com_Error(ERR_FATAL, "FS_MapFile with empty name"); }
+
+	*buffer = NULL;
+
+	len = FS_FOpenFileRead(qpath, &h, qfalse);
+	if (!h) { return -1; }
+	if (len <= 0) {
+		FS_FCloseFile(h);
+		return -1;
+	}
+
+	if (fsh[h].zipFile) {
+		unzFile z = fsh[h].handleFiles.file.z;
+
+		// deflated and encrypted entries have no image to share
+		if (unzGetCurrentFileInfo(z, &info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK || info.compression_method != 0 ||
+			(info.flag & 1) || info.compressed_size != info.uncompressed_size) {
+			FS_FCloseFile(h);
+			return -1;
+		}
+		offset = (long)unzGetCurrentFileZStreamPos64(z);
+		if (offset & 3) {
+			FS_FCloseFile(h);
+			return -1;
+		}
+
+		name = NULL;
+		for (search = fs_searchpaths; search; search = search->next) {
+			if (search->pack && search->pack->handle == z) {
+				name = search->pack->pakFilename;
+				break;
+			}
+		}
+		if (!name) {
+			FS_FCloseFile(h);
+			return -1;
+		}
+	} else {
+		name   = qpath;
+		offset = 0;
+	}
+
+	// reuse a live image of the same file
+	slot = NULL;
+	for (i = 0, mf = fs_mappedFiles; i < MAX_MAPPED_FILES; i++, mf++) {
+		if (!mf->refs) {
+			if (!slot) { slot = mf; }
+			continue;
+		}
+		if (mf->offset == offset && mf->length == len && !Q_stricmp(mf->name, name)) {
+			FS_FCloseFile(h);
+			mf->refs++;
+			*buffer = mf->data;
+			return len;
+		}
+	}
+	if (!slot) {
+		FS_FCloseFile(h);
+		return -1;
+	}
+
+	if (fsh[h].zipFile) {
+		slot->data = NULL;
+		f		   = Sys_FOpen(name, "rb");
+		if (f) {
+			// a damaged pk3 can claim more than it holds, and touching
+			// a mapping past the end of the file faults
+			if (!fseek(f, 0, SEEK_END) && offset + len <= ftell(f)) {
+				slot->data = Sys_MapFile(f, offset, len, &slot->handle);
+			}
+			fclose(f);
+		}
+	} else {
+		slot->data = Sys_MapFile(fsh[h].handleFiles.file.o, 0, len, &slot->handle);
+	}
+	FS_FCloseFile(h);
+
+	if (!slot->data) { return -1; }
+
+	Q_strncpyz(slot->name, name, sizeof(slot->name));
+	slot->offset = offset;
+	slot->length = len;
+	slot->refs	 = 1;
+
+	fs_loadCount++;
+
+	*buffer = slot->data;
+	return len;
+}
+
+/*
+=============
+FS_UnmapFile
+=============
+*/
+void FS_UnmapFile(const void *buffer) {
+	mappedFile_t *mf;
+	int			  i;
+
+	if (!buffer) { Com_Error(ERR_FATAL, "FS_UnmapFile( NULL )"); }
+
+	for (i = 0, mf = fs_mappedFiles; i < MAX_MAPPED_FILES; i++, mf++) {
+		if (mf->refs && mf->data == buffer) {
+			if (!--mf->refs) {
+				Sys_UnmapFile(mf->data, mf->length, mf->handle);
+				mf->data = NULL;
+			}
+			return;
+		}
+	}
+
+	Com_Error(ERR_FATAL, "FS_UnmapFile: %p was not mapped", buffer);
+}
+
 /*
 ============
 FS_WriteFile
@@ -3350,6 +3502,31 @@ const char *FS_ReferencedPakNames(void) {
 	return info;
 }
 
+/*
+=====================
+FS_PakOSPath
+
+Looks up the full path of a loaded pk3 from its "gamedir/basename" name,
+as listed by FS_ReferencedPakNames
+=====================
+*/
+qboolean FS_PakOSPath(const char *pakName, char *ospath, int size) {
+	searchpath_t *search;
+	char		  name[MAX_OSPATH * 2];
+
+	for (search = fs_searchpaths; search; search = search->next) {
+		if (search->pack) {
+			Com_sprintf(name, sizeof(name), "%s/%s", search->pack->pakGamename, search->pack->pakBasename);
+			if (!FS_FilenameCompare(name, pakName)) {
+				Q_strncpyz(ospath, search->pack->pakFilename, size);
+				return qtrue;
+			}
+		}
+	}
+
+	return qfalse;
+}
+
 /*
 =====================
 FS_ClearPakReferences
@@ -29,12 +29,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static int bloc = 0;
 
+// the offset based functions below keep their bit cursor in the caller's
+// offset instead of bloc, so they can be used from several threads at once
+
 void Huff_putBit(int bit, byte *fout, int *offset) {
-	bloc = *offset;
-	if ((bloc & 7) == 0) { fout[(bloc >> 3)] = 0; }
-	fout[(bloc >> 3)] |= bit << (bloc & 7);
-	bloc++;
-	*offset = bloc;
+	int pos = *offset;
+	if ((pos & 7) == 0) { fout[(pos >> 3)] = 0; }
+	fout[(pos >> 3)] |= bit << (pos & 7);
+	*offset = pos + 1;
 }
 
 int Huff_getBloc(void) { return bloc; }
@@ -42,12 +44,9 @@ int Huff_getBloc(void) { return bloc; }
 void Huff_setBloc(int _bloc) { bloc = _bloc; }
 
 int Huff_getBit(byte *fin, int *offset) {
-	int t;
-	bloc = *offset;
-	t	 = (fin[(bloc >> 3)] >> (bloc & 7)) & 0x1;
-	bloc++;
-	*offset = bloc;
-	return t;
+	int pos = *offset;
+	*offset = pos + 1;
+	return (fin[(pos >> 3)] >> (pos & 7)) & 0x1;
 }
 
 /* Add a bit to the output file (buffered) */
@@ -252,18 +251,19 @@ int Huff_Receive(node_t *node, int *ch, byte *fin) {
 
 /* Get a symbol */
 void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxoffset) {
-	bloc = *offset;
+	int pos = *offset;
 	while (node && node->symbol == INTERNAL_NODE) {
-		if (bloc >= maxoffset) {
+		if (pos >= maxoffset) {
 			*ch		= 0;
 			*offset = maxoffset + 1;
 			return;
 		}
-		if (get_bit(fin)) {
+		if ((fin[(pos >> 3)] >> (pos & 7)) & 0x1) {
 			node = node->right;
 		} else {
 			node = node->left;
 		}
+		pos++;
 	}
 	if (!node) {
 		*ch = 0;
@@ -271,7 +271,7 @@ void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxof
 		//		Com_Error(ERR_DROP, "Illegal tree!");
 	}
 	*ch		= node->symbol;
-	*offset = bloc;
+	*offset = pos;
 }
 
 /* Send the prefix code for this node */
@@ -290,6 +290,18 @@ static void send(node_t *node, node_t *child, byte *fout, int maxoffset) {
 	}
 }
 
+/* Send the prefix code for this node, using the caller's bit offset */
+static void offsetSend(node_t *node, node_t *child, byte *fout, int *offset, int maxoffset) {
+	if (node->parent) { offsetSend(node->parent, node, fout, offset, maxoffset); }
+	if (child) {
+		if (*offset >= maxoffset) {
+			*offset = maxoffset + 1;
+			return;
+		}
+		Huff_putBit(node->right == child, fout, offset);
+	}
+}
+
 /* Send a symbol */
 void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset) {
 	int i;
@@ -303,9 +315,112 @@ void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset) {
 }
 
 void Huff_offsetTransmit(huff_t *huff, int ch, byte *fout, int *offset, int maxoffset) {
-	bloc = *offset;
-	send(huff->loc[ch], NULL, fout, maxoffset);
-	*offset = bloc;
+	offsetSend(huff->loc[ch], NULL, fout, offset, maxoffset);
+}
+
+/*
+==============================================================================
+
+Lookup tables for a tree that doesn't change anymore, such as the one
+MSG_initHuffman builds.  They produce exactly the same bits as the tree
+walks above, which they fall back to for long codes and near the end of
+the buffer.
+
+==============================================================================
+*/
+
+/* Fill the decode entries of every leaf within HUFF_LOOKUP_BITS of the root */
+static void Huff_fillDecodeTable(huffTable_t *table, node_t *node, unsigned int code, int length) {
+	int i;
+
+	if (!node) { return; }
+
+	if (node->symbol != INTERNAL_NODE) {
+		for (i = code; i < (1 << HUFF_LOOKUP_BITS); i += 1 << length) {
+			table->decode[i] = node->symbol | (length << HUFF_LENGTH_SHIFT);
+		}
+		return;
+	}
+
+	if (length == HUFF_LOOKUP_BITS) { return; }
+
+	Huff_fillDecodeTable(table, node->left, code, length + 1);
+	Huff_fillDecodeTable(table, node->right, code | (1 << length), length + 1);
+}
+
+void Huff_BuildTable(huff_t *huff, huffTable_t *table) {
+	node_t		*node;
+	unsigned int code;
+	int			 ch, length;
+
+	memset(table, 0, sizeof(*table));
+
+	// the code of every symbol, first bit sent in bit 0
+	for (ch = 0; ch < HMAX; ch++) {
+		if (!huff->loc[ch]) { continue; }
+
+		code   = 0;
+		length = 0;
+		for (node = huff->loc[ch]; node->parent; node = node->parent) {
+			code = (code << 1) | (node->parent->right == node);
+			length++;
+		}
+
+		// too long to keep, those are sent with the tree
+		if (length > 32) { continue; }
+
+		table->code[ch]	  = code;
+		table->length[ch] = length;
+	}
+
+	Huff_fillDecodeTable(table, huff->tree, 0, 0);
+}
+
+/* Get a symbol, looking up HUFF_LOOKUP_BITS at once */
+void Huff_tableReceive(const huffTable_t *table, node_t *tree, int *ch, byte *fin, int *offset, int maxoffset) {
+	int			 pos = *offset;
+	unsigned int bits, entry;
+
+	// the three bytes peeked at must all be in the message
+	if (pos + 24 <= maxoffset) {
+		bits  = fin[pos >> 3] | (fin[(pos >> 3) + 1] << 8) | (fin[(pos >> 3) + 2] << 16);
+		entry = table->decode[(bits >> (pos & 7)) & ((1 << HUFF_LOOKUP_BITS) - 1)];
+		if (entry) {
+			*ch		= entry & ((1 << HUFF_LENGTH_SHIFT) - 1);
+			*offset = pos + (entry >> HUFF_LENGTH_SHIFT);
+			return;
+		}
+	}
+
+	Huff_offsetReceive(tree, ch, fin, offset, maxoffset);
+}
+
+/* Send a symbol with its whole code at once */
+void Huff_tableTransmit(const huffTable_t *table, huff_t *huff, int ch, byte *fout, int *offset, int maxoffset) {
+	int			 pos	= *offset;
+	int			 length = table->length[ch];
+	unsigned int code	= table->code[ch];
+	int			 n;
+
+	// running out of room stops in the middle of the code, leave that to the tree
+	if (!length || pos + length > maxoffset) {
+		Huff_offsetTransmit(huff, ch, fout, offset, maxoffset);
+		return;
+	}
+
+	while (length > 0) {
+		if (!(pos & 7)) { fout[pos >> 3] = 0; }
+		fout[pos >> 3] |= (code << (pos & 7)) & 0xff;
+
+		n = 8 - (pos & 7);
+		if (n > length) { n = length; }
+
+		code >>= n;
+		length -= n;
+		pos += n;
+	}
+
+	*offset = pos;
 }
 
 void Huff_Decompress(msg_t *mbuf, int offset) {
@@ -354,8 +469,6 @@ void Huff_Decompress(msg_t *mbuf, int offset) {
 	memcpy(mbuf->data + offset, seq, cch);
 }
 
-extern int oldsize;
-
 void Huff_Compress(msg_t *mbuf, int offset) {
 	int	   i, ch, size;
 	byte   seq[65536];
@@ -22,7 +22,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "q_shared.h"
 #include "qcommon.h"
 
-static huffman_t msgHuff;
+static huffman_t	msgHuff;
+static huffTable_t msgCompressTable, msgDecompressTable; // the msgHuff trees never change once built
 
 static qboolean msgInit = qfalse;
 
@@ -37,8 +38,6 @@ Handles byte ordering and avoids alignment errors
 ==============================================================================
 */
 
-int oldsize = 0;
-
 void MSG_initHuffman(void);
 
 void MSG_Init(msg_t *buf, byte *data, int length) {
@@ -95,8 +94,6 @@ bit functions
 void MSG_WriteBits(msg_t *msg, int value, int bits) {
 	int i;
 
-	oldsize += bits;
-
 	if (msg->overflowed) { return; }
 
 	if (bits == 0 || bits < -31 || bits > 32) { Com_Error(ERR_DROP, "MSG_WriteBits: bad bits %i", bits); }
@@ -143,7 +140,8 @@ void MSG_WriteBits(msg_t *msg, int value, int bits) {
 		}
 		if (bits) {
 			for (i = 0; i < bits; i += 8) {
-				Huff_offsetTransmit(&msgHuff.compressor, (value & 0xff), msg->data, &msg->bit, msg->maxsize << 3);
+				Huff_tableTransmit(&msgCompressTable, &msgHuff.compressor, (value & 0xff), msg->data, &msg->bit,
+								   msg->maxsize << 3);
 				value = (value >> 8);
 
 				if (msg->bit > msg->maxsize << 3) {
@@ -156,6 +154,45 @@ void MSG_WriteBits(msg_t *msg, int value, int bits) {
 	}
 }
 
+/*
+=================
+MSG_WriteBitString
+
+Appends bits taken from another bitstream message.  They are Huffman coded
+already, so they are copied as they are instead of being encoded again.
+=================
+*/
+void MSG_WriteBitString(msg_t *msg, const byte *data, int bits) {
+	int i, shift, pos;
+
+	if (msg->overflowed) { return; }
+
+	if (msg->oob) { Com_Error(ERR_DROP, "MSG_WriteBitString: oob message"); }
+
+	if (msg->bit + bits > msg->maxsize << 3) {
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	// whole bytes, the bits above the write position in the current
+	// byte are always clear
+	shift = msg->bit & 7;
+	for (i = 0; i + 8 <= bits; i += 8) {
+		pos = msg->bit >> 3;
+		if (shift) {
+			msg->data[pos] |= data[i >> 3] << shift;
+			msg->data[pos + 1] = data[i >> 3] >> (8 - shift);
+		} else {
+			msg->data[pos] = data[i >> 3];
+		}
+		msg->bit += 8;
+	}
+
+	for (; i < bits; i++) { Huff_putBit((data[i >> 3] >> (i & 7)) & 1, msg->data, &msg->bit); }
+
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
 int MSG_ReadBits(msg_t *msg, int bits) {
 	int		 value;
 	int		 get;
@@ -211,7 +248,8 @@ int MSG_ReadBits(msg_t *msg, int bits) {
 		if (bits) {
 			//			fp = fopen("c:\\netchan.bin", "a");
 			for (i = 0; i < bits; i += 8) {
-				Huff_offsetReceive(msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize << 3);
+				Huff_tableReceive(&msgDecompressTable, msgHuff.decompressor.tree, &get, msg->data, &msg->bit,
+								  msg->cursize << 3);
 				//				fwrite(&get, 1, 1, fp);
 				value = (unsigned int)value | ((unsigned int)get << (i + nbits));
 
@@ -558,7 +596,6 @@ void MSG_WriteDeltaUsercmdKey(msg_t *msg, int key, usercmd_t *from, usercmd_t *t
 		from->forwardmove == to->forwardmove && from->rightmove == to->rightmove && from->upmove == to->upmove &&
 		from->buttons == to->buttons && from->weapon == to->weapon) {
 		MSG_WriteBits(msg, 0, 1); // no change
-		oldsize += 7;
 		return;
 	}
 	key ^= to->serverTime;
@@ -762,8 +799,6 @@ void MSG_WriteDeltaEntity(msg_t *msg, struct entityState_s *from, struct entityS
 
 	MSG_WriteByte(msg, lc); // # of changes
 
-	oldsize += numFields;
-
 	for (i = 0, field = entityStateFields; i < lc; i++, field++) {
 		fromF = (int *)((byte *)from + field->offset);
 		toF	  = (int *)((byte *)to + field->offset);
@@ -782,7 +817,6 @@ void MSG_WriteDeltaEntity(msg_t *msg, struct entityState_s *from, struct entityS
 
 			if (fullFloat == 0.0f) {
 				MSG_WriteBits(msg, 0, 1);
-				oldsize += FLOAT_INT_BITS;
 			} else {
 				MSG_WriteBits(msg, 1, 1);
 				if (trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 &&
@@ -1020,8 +1054,6 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 
 	MSG_WriteByte(msg, lc); // # of changes
 
-	oldsize += numFields - lc;
-
 	for (i = 0, field = playerStateFields; i < lc; i++, field++) {
 		fromF = (int *)((byte *)from + field->offset);
 		toF	  = (int *)((byte *)to + field->offset);
@@ -1076,7 +1108,6 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 
 	if (!statsbits && !persistantbits && !ammobits && !powerupbits) {
 		MSG_WriteBits(msg, 0, 1); // no change
-		oldsize += 4;
 		return;
 	}
 	MSG_WriteBits(msg, 1, 1); // changed
@@ -1515,6 +1546,180 @@ void MSG_initHuffman(void) {
 			Huff_addRef(&msgHuff.decompressor, (byte)i); // Do update
 		}
 	}
+
+	Huff_BuildTable(&msgHuff.compressor, &msgCompressTable);
+	Huff_BuildTable(&msgHuff.decompressor, &msgDecompressTable);
+}
+
+#define HUFF_BENCHMARK_MSEC	   500				    // time each way for at least this long
+#define HUFF_BENCHMARK_DECODED (MAX_MSGLEN * 8)	    // every bit can decode to a byte
+#define HUFF_BENCHMARK_ENCODED (MAX_MSGLEN * 8 * 4) // and no code is longer than 32 bits
+
+/*
+=================
+MSG_BenchmarkDecode
+
+Decodes one Huffman coded message, returns the number of bytes
+=================
+*/
+static int MSG_BenchmarkDecode(const byte *in, int len, byte *out, qboolean table) {
+	int bit, ch, numBytes;
+
+	numBytes = 0;
+	for (bit = 0; bit < len << 3;) {
+		if (table) {
+			Huff_tableReceive(&msgDecompressTable, msgHuff.decompressor.tree, &ch, (byte *)in, &bit, len << 3);
+		} else {
+			Huff_offsetReceive(msgHuff.decompressor.tree, &ch, (byte *)in, &bit, len << 3);
+		}
+		out[numBytes++] = ch;
+	}
+
+	return numBytes;
+}
+
+/*
+=================
+MSG_BenchmarkEncode
+
+Huffman codes the bytes of one message, returns the number of bits
+=================
+*/
+static int MSG_BenchmarkEncode(const byte *in, int numBytes, byte *out, qboolean table) {
+	int i, bit;
+
+	bit = 0;
+	for (i = 0; i < numBytes; i++) {
+		if (table) {
+			Huff_tableTransmit(&msgCompressTable, &msgHuff.compressor, in[i], out, &bit, HUFF_BENCHMARK_ENCODED * 8);
+		} else {
+			Huff_offsetTransmit(&msgHuff.compressor, in[i], out, &bit, HUFF_BENCHMARK_ENCODED * 8);
+		}
+	}
+
+	return bit;
+}
+
+/*
+=================
+MSG_HuffmanBenchmark_f
+
+Decodes and encodes the messages recorded in a demo with the msgHuff tree
+walks and with the lookup tables, makes sure both give the same result and
+reports the time each takes per byte
+=================
+*/
+void MSG_HuffmanBenchmark_f(void) {
+	byte	   *file, *payload, *stream, *decoded[2], *encoded[2];
+	int			msgLen[1024], decodedLen[1024];
+	int			fileLen, numMsgs, payloadSize, numBytes, numBits[2], len[2];
+	int			i, m, pos, runs, start;
+	float		nsPerByte[4];
+	const byte *in;
+	const char *mismatch;
+
+	if (Cmd_Argc() != 2) {
+		Com_Printf("usage: huffbench <demo file>\n");
+		return;
+	}
+
+	fileLen = FS_ReadFile(Cmd_Argv(1), (void **)&file);
+	if (fileLen <= 0) {
+		Com_Printf("Couldn't read %s\n", Cmd_Argv(1));
+		return;
+	}
+
+	if (!msgInit) { MSG_initHuffman(); }
+
+	// gather the message payloads back to back, each one is a sequence
+	// number and a length followed by the Huffman coded message
+	payload		= Hunk_AllocateTempMemory(fileLen);
+	numMsgs		= 0;
+	payloadSize = 0;
+	for (pos = 0; pos + 8 <= fileLen && numMsgs < ARRAY_LEN(msgLen); pos += 8 + len[0]) {
+		len[0] = LittleLong(*(int *)(file + pos + 4));
+		if (len[0] <= 0 || len[0] > MAX_MSGLEN || pos + 8 + len[0] > fileLen) { break; }
+
+		memcpy(payload + payloadSize, file + pos + 8, len[0]);
+		msgLen[numMsgs++] = len[0];
+		payloadSize += len[0];
+	}
+	FS_FreeFile(file);
+
+	if (!payloadSize) {
+		Com_Printf("No messages in %s\n", Cmd_Argv(1));
+		Hunk_FreeTempMemory(payload);
+		return;
+	}
+
+	// reused for every message
+	decoded[0] = Hunk_AllocateTempMemory(HUFF_BENCHMARK_DECODED);
+	decoded[1] = Hunk_AllocateTempMemory(HUFF_BENCHMARK_DECODED);
+	encoded[0] = Hunk_AllocateTempMemory(HUFF_BENCHMARK_ENCODED);
+	encoded[1] = Hunk_AllocateTempMemory(HUFF_BENCHMARK_ENCODED);
+
+	// check the tables against the tree one message at a time
+	mismatch = NULL;
+	numBytes = 0;
+	for (m = 0, in = payload; m < numMsgs && !mismatch; in += msgLen[m], m++) {
+		len[0] = MSG_BenchmarkDecode(in, msgLen[m], decoded[0], qfalse);
+		len[1] = MSG_BenchmarkDecode(in, msgLen[m], decoded[1], qtrue);
+		if (len[0] != len[1] || memcmp(decoded[0], decoded[1], len[0])) {
+			mismatch = "decoding";
+			break;
+		}
+
+		numBits[0] = MSG_BenchmarkEncode(decoded[0], len[0], encoded[0], qfalse);
+		numBits[1] = MSG_BenchmarkEncode(decoded[0], len[0], encoded[1], qtrue);
+		if (numBits[0] != numBits[1] || memcmp(encoded[0], encoded[1], (numBits[0] + 7) >> 3)) {
+			mismatch = "encoding";
+			break;
+		}
+
+		decodedLen[m] = len[0];
+		numBytes += len[0];
+	}
+
+	if (mismatch) {
+		Com_Printf("^1table %s doesn't match the tree in message %i\n", mismatch, m);
+	} else {
+		// keep the decoded messages so the encoders can be timed on their own
+		stream = Hunk_AllocateTempMemory(numBytes);
+		for (m = 0, in = payload, pos = 0; m < numMsgs; in += msgLen[m], pos += decodedLen[m], m++) {
+			MSG_BenchmarkDecode(in, msgLen[m], stream + pos, qfalse);
+		}
+
+		for (i = 0; i < 4; i++) {
+			start = Sys_Milliseconds();
+			runs  = 0;
+			do {
+				for (m = 0, in = payload, pos = 0; m < numMsgs; in += msgLen[m], pos += decodedLen[m], m++) {
+					if (i < 2) {
+						MSG_BenchmarkDecode(in, msgLen[m], decoded[i], i);
+					} else {
+						MSG_BenchmarkEncode(stream + pos, decodedLen[m], encoded[i - 2], i - 2);
+					}
+				}
+				runs++;
+			} while (Sys_Milliseconds() - start < HUFF_BENCHMARK_MSEC);
+
+			nsPerByte[i] = (Sys_Milliseconds() - start) * 1000000.0f / runs / numBytes;
+		}
+
+		Com_Printf("%i messages, %i bytes coded, %i bytes decoded\n", numMsgs, payloadSize, numBytes);
+		Com_Printf("decode: %.1f ns/byte with the tree, %.1f ns/byte with the table, %.1fx\n", nsPerByte[0],
+				   nsPerByte[1], nsPerByte[0] / nsPerByte[1]);
+		Com_Printf("encode: %.1f ns/byte with the tree, %.1f ns/byte with the table, %.1fx\n", nsPerByte[2],
+				   nsPerByte[3], nsPerByte[2] / nsPerByte[3]);
+
+		Hunk_FreeTempMemory(stream);
+	}
+
+	Hunk_FreeTempMemory(encoded[1]);
+	Hunk_FreeTempMemory(encoded[0]);
+	Hunk_FreeTempMemory(decoded[1]);
+	Hunk_FreeTempMemory(decoded[0]);
+	Hunk_FreeTempMemory(payload);
 }
 
 /*
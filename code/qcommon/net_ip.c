@@ -20,9 +20,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 ===========================================================================
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // recvmmsg and sendmmsg
+#endif
+
 #include "qcommon/q_shared.h"
 #include "qcommon/qcommon.h"
 
+#ifdef __linux__
+#define NET_BATCH_IO // batched datagram syscalls and epoll
+#endif
+
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -81,6 +89,10 @@ static qboolean winsockInitialized = qfalse;
 #include <sys/filio.h>
 #endif
 
+#ifdef NET_BATCH_IO
+#include <sys/epoll.h>
+#endif
+
 typedef int SOCKET;
 #define INVALID_SOCKET -1
 #define SOCKET_ERROR   -1
@@ -111,6 +123,10 @@ static cvar_t *net_mcast6iface;
 
 static cvar_t *net_dropsim;
 
+#ifdef NET_BATCH_IO
+static cvar_t *net_batch;
+#endif
+
 static struct sockaddr socksRelayAddr;
 
 static SOCKET ip_socket			= INVALID_SOCKET;
@@ -144,6 +160,39 @@ typedef struct {
 static nip_localaddr_t localIP[MAX_IPS];
 static int			   numIP;
 
+#ifdef NET_BATCH_IO
+#define NET_BATCH_SIZE		32	 // datagrams per recvmmsg/sendmmsg
+#define NET_BATCH_PACKETLEN 1500 // bigger packets are sent on their own
+
+// datagrams read from one socket by the last recvmmsg
+typedef struct {
+	int						count;
+	int						current; // next one to hand out
+	struct mmsghdr			msgs[NET_BATCH_SIZE];
+	struct iovec			iovecs[NET_BATCH_SIZE];
+	struct sockaddr_storage addrs[NET_BATCH_SIZE];
+	byte					data[NET_BATCH_SIZE][MAX_MSGLEN + 1];
+} netRecvBatch_t;
+
+// datagrams waiting for the end of the frame to be sent from one socket
+typedef struct {
+	int						count;
+	struct mmsghdr			msgs[NET_BATCH_SIZE];
+	struct iovec			iovecs[NET_BATCH_SIZE];
+	struct sockaddr_storage addrs[NET_BATCH_SIZE];
+	qboolean				broadcast[NET_BATCH_SIZE];
+	byte					data[NET_BATCH_SIZE][NET_BATCH_PACKETLEN];
+} netSendBatch_t;
+
+static netRecvBatch_t ip_recvBatch, ip6_recvBatch, multicast6_recvBatch;
+static netSendBatch_t ip_sendBatch, ip6_sendBatch;
+
+static int epoll_fd = -1; // watches ip_socket and ip6_socket, created by NET_Sleep
+
+static int net_recvCalls, net_recvPackets;
+static int net_sendCalls, net_sendPackets;
+#endif
+
 //=============================================================================
 
 /*
@@ -442,6 +491,75 @@ qboolean NET_IsLocalAddress(netadr_t adr) { return adr.type == NA_LOOPBACK; }
 
 //=============================================================================
 
+#ifdef NET_BATCH_IO
+/*
+==================
+NET_GetBatchedPacket
+
+Hands out the datagrams of a socket one by one, reading up to
+NET_BATCH_SIZE of them at once when the last batch is used up
+==================
+*/
+static qboolean NET_GetBatchedPacket(netRecvBatch_t *batch, SOCKET sock, netadr_t *net_from, msg_t *net_message,
+									 fd_set *fdr) {
+	struct mmsghdr *msg;
+	int				i, ret, err;
+
+	while (1) {
+		if (batch->current == batch->count) {
+			if (sock == INVALID_SOCKET || !FD_ISSET(sock, fdr)) { return qfalse; }
+
+			for (i = 0; i < NET_BATCH_SIZE; i++) {
+				batch->iovecs[i].iov_base = batch->data[i];
+				batch->iovecs[i].iov_len  = sizeof(batch->data[i]);
+
+				memset(&batch->msgs[i], 0, sizeof(batch->msgs[i]));
+				batch->msgs[i].msg_hdr.msg_name	   = &batch->addrs[i];
+				batch->msgs[i].msg_hdr.msg_namelen = sizeof(batch->addrs[i]);
+				batch->msgs[i].msg_hdr.msg_iov	   = &batch->iovecs[i];
+				batch->msgs[i].msg_hdr.msg_iovlen  = 1;
+			}
+
+			batch->count   = 0;
+			batch->current = 0;
+
+			ret = recvmmsg(sock, batch->msgs, NET_BATCH_SIZE, MSG_DONTWAIT, NULL);
+			net_recvCalls++;
+
+			if (ret == SOCKET_ERROR) {
+				err = socketError;
+
+				if (err != EAGAIN && err != ECONNRESET) Com_Printf("NET_GetPacket: %s\n", NET_ErrorString());
+
+				FD_CLR(sock, fdr);
+				return qfalse;
+			}
+
+			// a short read means the socket is empty, wait for the next wakeup
+			if (ret < NET_BATCH_SIZE) { FD_CLR(sock, fdr); }
+			if (ret == 0) { return qfalse; }
+
+			batch->count = ret;
+			net_recvPackets += ret;
+		}
+
+		msg = &batch->msgs[batch->current++];
+
+		SockadrToNetadr((struct sockaddr *)msg->msg_hdr.msg_name, net_from);
+		net_message->readcount = 0;
+
+		if (msg->msg_len >= net_message->maxsize) {
+			Com_Printf("Oversize packet from %s\n", NET_AdrToString(*net_from));
+			continue;
+		}
+
+		memcpy(net_message->data, msg->msg_hdr.msg_iov->iov_base, msg->msg_len);
+		net_message->cursize = msg->msg_len;
+		return qtrue;
+	}
+}
+#endif
+
 /*
 ==================
 NET_GetPacket
@@ -455,6 +573,19 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr) {
 	socklen_t				fromlen;
 	int						err;
 
+#ifdef NET_BATCH_IO
+	// socks relayed packets need unwrapping, those are read one by one
+	if (net_batch->integer && !usingSocks) {
+		if (NET_GetBatchedPacket(&ip_recvBatch, ip_socket, net_from, net_message, fdr)) { return qtrue; }
+		if (NET_GetBatchedPacket(&ip6_recvBatch, ip6_socket, net_from, net_message, fdr)) { return qtrue; }
+		if (multicast6_socket != ip6_socket &&
+			NET_GetBatchedPacket(&multicast6_recvBatch, multicast6_socket, net_from, net_message, fdr)) {
+			return qtrue;
+		}
+		return qfalse;
+	}
+#endif
+
 	if (ip_socket != INVALID_SOCKET && FD_ISSET(ip_socket, fdr)) {
 		fromlen = sizeof(from);
 		ret =
@@ -546,6 +677,130 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr) {
 
 //=============================================================================
 
+#ifdef NET_BATCH_IO
+/*
+==================
+NET_SendBatch
+
+Sends everything queued for a socket with as few sendmmsg calls as possible
+==================
+*/
+static void NET_SendBatch(netSendBatch_t *batch, SOCKET sock) {
+	int sent, ret, err;
+
+	sent = 0;
+	while (sent < batch->count && sock != INVALID_SOCKET) {
+		ret = sendmmsg(sock, batch->msgs + sent, batch->count - sent, 0);
+		net_sendCalls++;
+
+		if (ret == SOCKET_ERROR) {
+			err = socketError;
+
+			// wouldblock is silent, and some PPP links do not allow broadcasts
+			if (err != EAGAIN && !(err == EADDRNOTAVAIL && batch->broadcast[sent])) {
+				Com_Printf("Sys_SendPacket: %s\n", NET_ErrorString());
+			}
+
+			// drop the packet that failed and go on with the rest
+			ret = 1;
+		} else {
+			net_sendPackets += ret;
+		}
+
+		sent += ret;
+	}
+
+	batch->count = 0;
+}
+
+/*
+==================
+NET_FlushSendQueue
+
+Sends the packets Sys_SendPacket queued since the last flush, called at the
+end of every frame and before sleeping
+==================
+*/
+void NET_FlushSendQueue(void) {
+	NET_SendBatch(&ip_sendBatch, ip_socket);
+	NET_SendBatch(&ip6_sendBatch, ip6_socket);
+}
+
+/*
+==================
+NET_QueueBatchedPacket
+==================
+*/
+static void NET_QueueBatchedPacket(netSendBatch_t *batch, SOCKET sock, int length, const void *data,
+								   const struct sockaddr_storage *addr, socklen_t addrlen, qboolean broadcast) {
+	struct mmsghdr *msg;
+	struct iovec   *iov;
+
+	if (batch->count == NET_BATCH_SIZE) { NET_SendBatch(batch, sock); }
+
+	memcpy(batch->data[batch->count], data, length);
+	batch->addrs[batch->count]	   = *addr;
+	batch->broadcast[batch->count] = broadcast;
+
+	iov			  = &batch->iovecs[batch->count];
+	iov->iov_base = batch->data[batch->count];
+	iov->iov_len  = length;
+
+	msg = &batch->msgs[batch->count];
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_hdr.msg_name	 = &batch->addrs[batch->count];
+	msg->msg_hdr.msg_namelen = addrlen;
+	msg->msg_hdr.msg_iov	 = iov;
+	msg->msg_hdr.msg_iovlen	 = 1;
+
+	batch->count++;
+}
+
+/*
+==================
+NET_BatchStats_f
+==================
+*/
+static void NET_BatchStats_f(void) {
+	if (!net_batch->integer) { Com_Printf("batched network I/O is disabled (net_batch 0)\n"); }
+
+	Com_Printf("received %i packets with %i recvmmsg calls", net_recvPackets, net_recvCalls);
+	if (net_recvCalls) { Com_Printf(", %.1f per call", (float)net_recvPackets / net_recvCalls); }
+	Com_Printf("\nsent %i packets with %i sendmmsg calls", net_sendPackets, net_sendCalls);
+	if (net_sendCalls) { Com_Printf(", %.1f per call", (float)net_sendPackets / net_sendCalls); }
+	Com_Printf("\n");
+
+	net_recvCalls	= 0;
+	net_recvPackets = 0;
+	net_sendCalls	= 0;
+	net_sendPackets = 0;
+}
+
+/*
+==================
+NET_ResetBatches
+
+Forgets everything buffered for sockets that are about to be closed
+==================
+*/
+static void NET_ResetBatches(void) {
+	NET_FlushSendQueue();
+
+	ip_recvBatch.count		   = ip_recvBatch.current		  = 0;
+	ip6_recvBatch.count		   = ip6_recvBatch.current		  = 0;
+	multicast6_recvBatch.count = multicast6_recvBatch.current = 0;
+
+	if (epoll_fd != -1) {
+		close(epoll_fd);
+		epoll_fd = -1;
+	}
+}
+#else
+void NET_FlushSendQueue(void) {}
+#endif
+
+//=============================================================================
+
 static char socksBuf[4096];
 
 /*
@@ -581,7 +836,22 @@ void Sys_SendPacket(int length, const void *data, netadr_t to) {
 		*(short *)&socksBuf[8] = ((struct sockaddr_in *)&addr)->sin_port;
 		memcpy(&socksBuf[10], data, length);
 		ret = sendto(ip_socket, socksBuf, length + 10, 0, &socksRelayAddr, sizeof(socksRelayAddr));
+#ifdef NET_BATCH_IO
+	} else if (net_batch->integer && length <= NET_BATCH_PACKETLEN) {
+		// sent together with the rest of the frame's packets
+		if (addr.ss_family == AF_INET)
+			NET_QueueBatchedPacket(&ip_sendBatch, ip_socket, length, data, &addr, sizeof(struct sockaddr_in),
+								   to.type == NA_BROADCAST);
+		else if (addr.ss_family == AF_INET6)
+			NET_QueueBatchedPacket(&ip6_sendBatch, ip6_socket, length, data, &addr, sizeof(struct sockaddr_in6),
+								   qfalse);
+		return;
+#endif
 	} else {
+#ifdef NET_BATCH_IO
+		// keep the order of the packets sent to each address
+		NET_FlushSendQueue();
+#endif
 		if (addr.ss_family == AF_INET)
 			ret = sendto(ip_socket, data, length, 0, (struct sockaddr *)&addr, sizeof(struct sockaddr_in));
 		else if (addr.ss_family == AF_INET6)
@@ -1299,6 +1569,10 @@ static qboolean NET_GetCvars(void) {
 
 	net_dropsim = Cvar_Get("net_dropsim", "", CVAR_TEMP);
 
+#ifdef NET_BATCH_IO
+	net_batch = Cvar_Get("net_batch", "1", CVAR_ARCHIVE);
+#endif
+
 	return modified ? qtrue : qfalse;
 }
 
@@ -1340,6 +1614,10 @@ void NET_Config(qboolean enableNetworking) {
 	}
 
 	if (stop) {
+#ifdef NET_BATCH_IO
+		NET_ResetBatches();
+#endif
+
 		if (ip_socket != INVALID_SOCKET) {
 			closesocket(ip_socket);
 			ip_socket = INVALID_SOCKET;
@@ -1392,6 +1670,9 @@ void NET_Init(void) {
 	NET_Config(qtrue);
 
 	Cmd_AddCommand("net_restart", NET_Restart_f);
+#ifdef NET_BATCH_IO
+	Cmd_AddCommand("net_batchstats", NET_BatchStats_f);
+#endif
 }
 
 /*
@@ -1442,6 +1723,48 @@ void NET_Event(fd_set *fdr) {
 	}
 }
 
+#ifdef NET_BATCH_IO
+/*
+====================
+NET_EpollSleep
+
+NET_Sleep with epoll instead of select, returns qfalse if epoll can't be used
+====================
+*/
+static qboolean NET_EpollSleep(int msec) {
+	struct epoll_event event, events[2];
+	fd_set			   fdr;
+	int				   i, retval;
+
+	if (epoll_fd == -1) {
+		epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (epoll_fd == -1) { return qfalse; }
+
+		event.events = EPOLLIN;
+		if (ip_socket != INVALID_SOCKET) {
+			event.data.fd = ip_socket;
+			epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ip_socket, &event);
+		}
+		if (ip6_socket != INVALID_SOCKET) {
+			event.data.fd = ip6_socket;
+			epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ip6_socket, &event);
+		}
+	}
+
+	retval = epoll_wait(epoll_fd, events, ARRAY_LEN(events), msec);
+
+	if (retval == SOCKET_ERROR) {
+		if (errno != EINTR) Com_Printf("Warning: epoll_wait() syscall failed: %s\n", NET_ErrorString());
+	} else if (retval > 0) {
+		FD_ZERO(&fdr);
+		for (i = 0; i < retval; i++) { FD_SET(events[i].data.fd, &fdr); }
+		NET_Event(&fdr);
+	}
+
+	return qtrue;
+}
+#endif
+
 /*
 ====================
 NET_Sleep
@@ -1457,6 +1780,15 @@ void NET_Sleep(int msec) {
 
 	if (msec < 0) msec = 0;
 
+	// nothing should wait in the send queue while we sleep
+	NET_FlushSendQueue();
+
+#ifdef NET_BATCH_IO
+	if (net_batch->integer && (ip_socket != INVALID_SOCKET || ip6_socket != INVALID_SOCKET) && NET_EpollSleep(msec)) {
+		return;
+	}
+#endif
+
 	FD_ZERO(&fdr);
 
 	if (ip_socket != INVALID_SOCKET) {
@@ -1012,6 +1012,17 @@ typedef struct {
 // trace->entityNum can also be 0 to (MAX_GENTITIES-1)
 // or ENTITYNUM_NONE, ENTITYNUM_WORLD
 
+// one sweep of a batched trace, all rays of a batch share the
+// model, contents mask and pass entity
+#define MAX_TRACE_BATCH 64
+
+typedef struct {
+	vec3_t start;
+	vec3_t end;
+	vec3_t mins;
+	vec3_t maxs;
+} traceRay_t;
+
 // markfragments are returned by R_MarkFragments()
 typedef struct {
 	int firstPoint;
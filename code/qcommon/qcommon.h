@@ -67,6 +67,7 @@ struct entityState_s;
 struct playerState_s;
 
 void MSG_WriteBits(msg_t *msg, int value, int bits);
+void MSG_WriteBitString(msg_t *msg, const byte *data, int bits);
 
 void MSG_WriteChar(msg_t *sb, int c);
 void MSG_WriteByte(msg_t *sb, int c);
@@ -105,6 +106,7 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 void MSG_ReadDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct playerState_s *to);
 
 void MSG_ReportChangeVectors_f(void);
+void MSG_HuffmanBenchmark_f(void);
 
 //============================================================================
 
@@ -359,6 +361,12 @@ vm_t *VM_Restart(vm_t *vm, qboolean unpure);
 
 intptr_t QDECL VM_Call(vm_t *vm, int callNum, ...);
 
+vmInterpret_t VM_Interpreter(vm_t *vm);
+// how the module actually ended up running, vm_game only asks for one
+
+qboolean VM_BindImports(vm_t *vm, int version, const void *imports);
+// hands a native module a table of direct entry points if it exports dllImports
+
 void VM_Debug(int level);
 
 void *VM_ArgPtr(intptr_t intValue);
@@ -667,6 +675,14 @@ void FS_ForceFlush(fileHandle_t f);
 void FS_FreeFile(void *buffer);
 // frees the memory returned by FS_ReadFile
 
+long FS_MapFile(const char *qpath, const void **buffer);
+// maps a loose file or a pk3 entry stored uncompressed read only and shares the image
+// with other callers, returns -1 if it can't be mapped so FS_ReadFile should be used
+// the image is not NUL terminated
+
+void FS_UnmapFile(const void *buffer);
+// releases an image returned by FS_MapFile
+
 void FS_WriteFile(const char *qpath, const void *buffer, int size);
 // writes a complete file, creating any subdirectories needed
 
@@ -702,6 +718,9 @@ const char *FS_ReferencedPakPureChecksums(void);
 // AND referenced pk3 files. Servers with sv_pure set will get this string
 // back from clients for pure validation
 
+qboolean FS_PakOSPath(const char *pakName, char *ospath, int size);
+// Finds the full path of a loaded pk3 given its "gamedir/basename" name.
+
 void FS_ClearPakReferences(int flags);
 // clears referenced booleans on loaded pk3s
 
@@ -1069,7 +1088,8 @@ void Sys_Print(const char *msg);
 
 // Sys_Milliseconds should only be used for profiling purposes,
 // any game related timing information should come from event timestamps
-int Sys_Milliseconds(void);
+int		Sys_Milliseconds(void);
+int64_t Sys_Microseconds(void);
 
 qboolean Sys_RandomBytes(byte *string, int len);
 
@@ -1081,6 +1101,7 @@ cpuFeatures_t Sys_GetProcessorFeatures(void);
 void Sys_SetErrorText(const char *text);
 
 void Sys_SendPacket(int length, const void *data, netadr_t to);
+void NET_FlushSendQueue(void);
 
 qboolean Sys_StringToAdr(const char *s, netadr_t *a, netadrtype_t family);
 // Does NOT parse port numbers, only base addresses.
@@ -1089,6 +1110,8 @@ qboolean Sys_IsLANAddress(netadr_t adr);
 void	 Sys_ShowIP(void);
 
 FILE	*Sys_FOpen(const char *ospath, const char *mode);
+void	*Sys_MapFile(FILE *f, long offset, long length, void **handle);
+void	 Sys_UnmapFile(void *data, long length, void *handle);
 qboolean Sys_Mkdir(const char *path);
 FILE	*Sys_Mkfifo(const char *ospath);
 char	*Sys_Cwd(void);
@@ -1116,6 +1139,26 @@ qboolean Sys_LowPhysicalMemory(void);
 
 void Sys_SetEnv(const char *name, const char *value);
 
+// worker threads for data parallel jobs, see sys_thread.c
+#define MAX_WORKER_THREADS 32
+
+typedef void (*sysJobFunc_t)(void *data, int index);
+
+void Sys_SetWorkerThreads(int count);
+int	 Sys_WorkerThreads(void);
+void Sys_RunJobs(sysJobFunc_t func, void *data, int count);
+
+// periodic samples of the main thread's program counter and stack pointer, the
+// callback runs in a signal handler or while the main thread is suspended, so it
+// must not allocate, print or take locks
+typedef void (*sysSampleFunc_t)(void *pc, void *sp);
+
+qboolean Sys_StartSampling(int hz, sysSampleFunc_t func);
+void	 Sys_StopSampling(void);
+
+// load address and executable range of the loaded module containing address
+qboolean Sys_ModuleCode(void *address, byte **base, byte **code, size_t *codeSize);
+
 typedef enum { DR_YES = 0, DR_NO = 1, DR_OK = 0, DR_CANCEL = 1 } dialogResult_t;
 
 typedef enum { DT_INFO, DT_WARNING, DT_ERROR, DT_YES_NO, DT_OK_CANCEL } dialogType_t;
@@ -1161,6 +1204,16 @@ typedef struct {
 	huff_t decompressor;
 } huffman_t;
 
+// see Huff_BuildTable
+#define HUFF_LOOKUP_BITS  11
+#define HUFF_LENGTH_SHIFT 9
+
+typedef struct {
+	unsigned int   code[HMAX];	 // first bit sent in bit 0
+	byte		   length[HMAX]; // 0 if the code is too long to keep
+	unsigned short decode[1 << HUFF_LOOKUP_BITS]; // symbol | length << HUFF_LENGTH_SHIFT, 0 for longer codes
+} huffTable_t;
+
 void Huff_Compress(msg_t *buf, int offset);
 void Huff_Decompress(msg_t *buf, int offset);
 void Huff_Init(huffman_t *huff);
@@ -1169,6 +1222,9 @@ int	 Huff_Receive(node_t *node, int *ch, byte *fin);
 void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset);
 void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxoffset);
 void Huff_offsetTransmit(huff_t *huff, int ch, byte *fout, int *offset, int maxoffset);
+void Huff_BuildTable(huff_t *huff, huffTable_t *table);
+void Huff_tableReceive(const huffTable_t *table, node_t *tree, int *ch, byte *fin, int *offset, int maxoffset);
+void Huff_tableTransmit(const huffTable_t *table, huff_t *huff, int ch, byte *fout, int *offset, int maxoffset);
 void Huff_putBit(int bit, byte *fout, int *offset);
 int	 Huff_getBit(byte *fout, int *offset);
 
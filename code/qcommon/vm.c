@@ -34,10 +34,15 @@ and one exported function: Perform
 */
 
 #include "vm_local.h"
+#include "sys/sys_loadlib.h"
 
-vm_t *currentVM = NULL;
-vm_t *lastVM	= NULL;
-int	  vm_debugLevel;
+vm_t   *currentVM = NULL;
+vm_t   *lastVM	  = NULL;
+int		vm_debugLevel;
+cvar_t *vm_superInstructions;
+cvar_t *vm_proveBounds;
+
+static cvar_t *vm_directImports;
 
 // used by Com_Error to get rid of running vm's before longjmp
 static int forced_unload;
@@ -47,6 +52,8 @@ vm_t vmTable[MAX_VM];
 
 void VM_VmInfo_f(void);
 void VM_VmProfile_f(void);
+void VM_VmSample_f(void);
+void VM_VmSyscalls_f(void);
 
 #if 0 // 64bit!
 // converts a VM pointer to a C pointer and
@@ -67,9 +74,14 @@ void VM_Init(void) {
 	Cvar_Get("vm_cgame", "2", CVAR_ARCHIVE); // !@# SHIP WITH SET TO 2
 	Cvar_Get("vm_game", "2", CVAR_ARCHIVE);	 // !@# SHIP WITH SET TO 2
 	Cvar_Get("vm_ui", "2", CVAR_ARCHIVE);	 // !@# SHIP WITH SET TO 2
+	vm_superInstructions = Cvar_Get("vm_superInstructions", "1", 0);
+	vm_proveBounds		 = Cvar_Get("vm_proveBounds", "1", 0);
+	vm_directImports	 = Cvar_Get("vm_directImports", "1", 0);
 
 	Cmd_AddCommand("vmprofile", VM_VmProfile_f);
 	Cmd_AddCommand("vminfo", VM_VmInfo_f);
+	Cmd_AddCommand("vmsample", VM_VmSample_f);
+	Cmd_AddCommand("vmsyscalls", VM_VmSyscalls_f);
 
 	memset(vmTable, 0, sizeof(vmTable));
 }
@@ -138,6 +150,35 @@ int VM_SymbolToValue(vm_t *vm, const char *symbol) {
 	return 0;
 }
 
+/*
+=====================
+VM_CompiledInstruction
+
+Finds the bytecode instruction a native code address of a compiled vm belongs
+to, the instruction pointers are absolute and never decrease. Returns -1 for
+the support routines in front of the first instruction.
+=====================
+*/
+static int VM_CompiledInstruction(vm_t *vm, const byte *code) {
+	intptr_t address = (intptr_t)code;
+	int		 low, high, mid;
+
+	if (!vm->instructionCount || address < vm->instructionPointers[0]) { return -1; }
+
+	low	 = 0;
+	high = vm->instructionCount - 1;
+	while (low < high) {
+		mid = (low + high + 1) / 2;
+		if (vm->instructionPointers[mid] <= address) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+
+	return low;
+}
+
 /*
 =====================
 VM_SymbolForCompiledPointer // ICY CHANGED
@@ -196,6 +237,7 @@ void VM_LoadSymbols(vm_t *vm) {
 	vmSymbol_t	*sym  = NULL;
 	int			 segment, numInstructions;
 	int			 value, chars, count = 0;
+	char		*token;
 
 	// don't load symbols if not developer
 	if (!com_developer->integer) { return; }
@@ -204,7 +246,7 @@ void VM_LoadSymbols(vm_t *vm) {
 	Com_sprintf(symbols, sizeof(symbols), "vm/%s.map", name);
 
 	void *mapfile = NULL;
-	if (!FS_ReadFile(symbols, &mapfile)) {
+	if (FS_ReadFile(symbols, &mapfile) < 0 || !mapfile) {
 		Com_Printf("Couldn't load symbol file: %s\n", symbols);
 		return;
 	}
@@ -213,8 +255,10 @@ void VM_LoadSymbols(vm_t *vm) {
 
 	// parse the symbols
 	char *text_p = mapfile;
-	while (*text_p) {
-		segment = ParseHex(COM_Parse(&text_p));
+	while (1) {
+		token = COM_Parse(&text_p);
+		if (!token[0]) { break; }
+		segment = ParseHex(token);
 		if (segment) {
 			COM_Parse(&text_p);
 			COM_Parse(&text_p);
@@ -222,7 +266,8 @@ void VM_LoadSymbols(vm_t *vm) {
 		}
 
 		value = ParseHex(COM_Parse(&text_p));
-		chars = strlen(COM_Parse(&text_p));
+		token = COM_Parse(&text_p);
+		chars = strlen(token);
 		if (chars <= 0) {
 			Com_Printf("WARNING: incomplete line at end of file\n");
 			break;
@@ -233,15 +278,14 @@ void VM_LoadSymbols(vm_t *vm) {
 		*prev	  = sym;
 		prev	  = &sym->next;
 
-		// convert value from an instruction number to a code offset
-		if (value >= 0 && value < numInstructions) { value = vm->instructionPointers[value]; }
+		// convert value from an instruction number to a code offset, compiled vms keep
+		// instruction numbers as native addresses don't fit and are mapped back instead
+		if (!vm->compiled && value >= 0 && value < numInstructions) { value = vm->instructionPointers[value]; }
 		sym->symValue = value;
 
-		Q_strncpyz(sym->symName, text_p, chars);
-		sym->symName[chars] = '\0';
+		Q_strncpyz(sym->symName, token, chars + 1);
 
 		count++;
-		text_p += chars;
 	}
 
 	vm->numSymbols = count;
@@ -298,7 +342,7 @@ int32_t QDECL VM_DllSyscall(intptr_t arg, ...) { // ICY CHANGED
 
 	va_end(ap);
 
-	return currentVM->systemCall(args);
+	return VM_SystemCall(currentVM, args);
 }
 
 /*
@@ -385,13 +429,13 @@ vmHeader_t *VM_LoadQVM(vm_t *vm, qboolean alloc, qboolean unpure) {
 	if (alloc) {
 		// allocate zero filled space for initialized and uninitialized data
 		// leave some space beyond data mask so we can secure all mask
-		// operations
-		vm->dataAlloc = dataLength + 4;
+		// operations and the unmasked frame accesses of compiled code
+		vm->dataAlloc = dataLength + VM_DATA_GUARD;
 		vm->dataBase  = Hunk_Alloc(vm->dataAlloc, h_high);
 		vm->dataMask  = dataLength - 1;
 	} else {
 		// clear the data, but make sure we're not clearing more than allocated
-		if (vm->dataAlloc != dataLength + 4) {
+		if (vm->dataAlloc != dataLength + VM_DATA_GUARD) {
 			VM_Free(vm);
 			FS_FreeFile(header.v);
 
@@ -590,6 +634,34 @@ vm_t *VM_Create(const char *module, intptr_t (*systemCalls)(intptr_t *), vmInter
 	return vm;
 }
 
+/*
+=================
+VM_BindImports
+
+Offers a native module a table of engine functions that it can call directly
+instead of going through its syscall entry point. Modules without a dllImports
+export, or that refuse the version, keep using syscalls for everything.
+=================
+*/
+qboolean VM_BindImports(vm_t *vm, int version, const void *imports) {
+	qboolean(QDECL * dllImports)(int version, const void *imports);
+
+	vm->directImports = qfalse;
+	if (!vm->dllHandle) { return qfalse; }
+
+	dllImports = Sys_LoadFunction(vm->dllHandle, "dllImports");
+	if (!dllImports) { return qfalse; }
+
+	// a NULL table unbinds one left over from before a restart
+	if (!vm_directImports->integer) { imports = NULL; }
+	if (!dllImports(version, imports) || !imports) { return qfalse; }
+
+	Com_Printf("%s uses direct imports version %i\n", vm->name, version);
+	vm->directImports = qtrue;
+
+	return qtrue;
+}
+
 /*
 ==============
 VM_Free
@@ -640,6 +712,11 @@ void VM_Forced_Unload_Start(void) { forced_unload = 1; }
 
 void VM_Forced_Unload_Done(void) { forced_unload = 0; }
 
+vmInterpret_t VM_Interpreter(vm_t *vm) {
+	if (vm->dllHandle) { return VMI_NATIVE; }
+	return vm->compiled ? VMI_COMPILED : VMI_BYTECODE;
+}
+
 void *VM_ArgPtr(intptr_t intValue) {
 	if (!intValue) { return NULL; }
 	// currentVM is missing on reconnect
@@ -705,6 +782,7 @@ intptr_t QDECL VM_Call(vm_t *vm, int callnum, ...) {
 
 	if (vm_debugLevel) { Com_Printf("VM_Call( %d )\n", callnum); }
 
+	if (!vm->callLevel) { vm->stackTop = (byte *)&oldVM; }
 	++vm->callLevel;
 	// if we have a dll loaded, call it directly
 	if (vm->entryPoint) {
@@ -822,13 +900,16 @@ void VM_VmInfo_f(void) {
 		if (!vm->name[0]) { break; }
 		Com_Printf("%s : ", vm->name);
 		if (vm->dllHandle) {
-			Com_Printf("native\n");
+			Com_Printf(vm->directImports ? "native, direct imports\n" : "native\n");
 			continue;
 		}
 		if (vm->compiled) {
 			Com_Printf("compiled on load\n");
+			Com_Printf("    proven acc. : %7i\n", vm->numProvenAccesses);
+			Com_Printf("    masked acc. : %7i\n", vm->numMaskedAccesses);
 		} else {
 			Com_Printf("interpreted\n");
+			Com_Printf("    superinstr. : %7i\n", vm->numSuperInstructions);
 		}
 		Com_Printf("    code length : %7i\n", vm->codeLength);
 		Com_Printf("    table length: %7i\n", vm->instructionCount * 4);
@@ -836,6 +917,464 @@ void VM_VmInfo_f(void) {
 	}
 }
 
+/*
+==============================================================================
+
+SAMPLING PROFILER
+
+vmsample start [hz] samples the main thread while a compiled or native module
+runs. Neither the generated code nor the game dlls keep frame pointers, so the
+callers are found by scanning the native stack between the sample and the
+outermost VM_Call for words that point into the module's code, a stale return
+address can show up as an extra frame. vmsample stop [file] writes one
+"vm;caller;...;leaf count" line per distinct stack for flamegraph.pl.
+Interpreted modules are counted per function by vmprofile instead.
+
+==============================================================================
+*/
+
+#define VM_SAMPLE_DEFAULT_HZ 500
+#define VM_SAMPLE_BUFFER	 (1 << 20)	  // ints of sample records
+#define VM_SAMPLE_MAX_FRAMES 64
+#define VM_SAMPLE_MAX_SCAN	 (256 * 1024) // bytes of native stack scanned per sample
+#define VM_SAMPLE_ENGINE	 -1			  // engine code called from the module
+
+typedef struct {
+	void  *dllHandle; // module the range was looked up for
+	byte  *base;
+	byte  *code;
+	size_t codeSize;
+} vmSampleModule_t;
+
+typedef struct {
+	int count;
+	int offset; // of the first record with this stack
+} vmSampleStack_t;
+
+typedef struct {
+	int				*buffer; // (numValues << 8 | vm index) followed by the leaf and its callers
+	int				 used;
+	int				 samples;
+	int				 outside; // no vm was running
+	int				 dropped; // the buffer was full
+	vmSampleModule_t modules[MAX_VM];
+} vmSampler_t;
+
+static vmSampler_t vmSampler;
+
+/*
+==============
+VM_SampleValue
+
+The instruction number for compiled vms, the offset from the module's load
+address for native ones.
+==============
+*/
+static int VM_SampleValue(vm_t *vm, const vmSampleModule_t *module, byte *address, byte *start, byte *end) {
+	if (address < start || address >= end) { return VM_SAMPLE_ENGINE; }
+	if (vm->compiled) { return VM_CompiledInstruction(vm, address); }
+
+	return (int)(address - module->base);
+}
+
+/*
+==============
+VM_Sample
+
+Called with the main thread interrupted, so it only writes to the
+preallocated buffer.
+==============
+*/
+static void VM_Sample(void *pc, void *sp) {
+	vm_t			 *vm;
+	vmSampleModule_t *module;
+	byte			 *start, *end, **word, **top;
+	int				 *record, count, value;
+
+	vm = currentVM;
+	if (!vm || vm->callLevel <= 0 || !vm->stackTop) {
+		vmSampler.outside++;
+		return;
+	}
+	if (vmSampler.used + 2 + VM_SAMPLE_MAX_FRAMES > VM_SAMPLE_BUFFER) {
+		vmSampler.dropped++;
+		return;
+	}
+
+	module = &vmSampler.modules[vm - vmTable];
+	start  = NULL;
+	end	   = NULL;
+	if (vm->compiled && vm->instructionPointers) {
+		start = vm->codeBase;
+		end	  = vm->codeBase + vm->codeLength;
+	} else if (vm->dllHandle && vm->dllHandle == module->dllHandle) {
+		start = module->code;
+		end	  = module->code + module->codeSize;
+	}
+
+	record = vmSampler.buffer + vmSampler.used;
+	count  = 0;
+	if (start) {
+		record[1 + count++] = VM_SampleValue(vm, module, pc, start, end);
+
+		// return addresses point just past their call
+		top = (byte **)MIN(vm->stackTop, (byte *)sp + VM_SAMPLE_MAX_SCAN);
+		for (word = sp; word < top && count < VM_SAMPLE_MAX_FRAMES; word++) {
+			if (*word <= start || *word > end) { continue; }
+
+			value = VM_SampleValue(vm, module, *word - 1, start, end);
+			if (value >= 0) { record[1 + count++] = value; }
+		}
+	}
+
+	record[0] = (count << 8) | (int)(vm - vmTable);
+	vmSampler.used += 1 + count;
+	vmSampler.samples++;
+}
+
+/*
+==============
+VM_SampleLabel
+==============
+*/
+static const char *VM_SampleLabel(vm_t *vm, int value) {
+	static char label[MAX_QPATH];
+	vmSymbol_t *sym;
+
+	if (value == VM_SAMPLE_ENGINE) { return "[engine]"; }
+
+	if (vm->dllHandle) {
+		Com_sprintf(label, sizeof(label), "%s+0x%x", vm->name, value);
+		return label;
+	}
+
+	sym = VM_ValueToFunctionSymbol(vm, value);
+	if (sym) { return sym->symName; }
+
+	Com_sprintf(label, sizeof(label), "%s#%i", vm->name, value);
+	return label;
+}
+
+/*
+==============
+VM_SampleHash
+==============
+*/
+static unsigned VM_SampleHash(const int *record) {
+	unsigned hash;
+	int		 i;
+
+	hash = 0;
+	for (i = 0; i <= record[0] >> 8; i++) { hash = hash * 31 + record[i]; }
+
+	return hash;
+}
+
+/*
+==============
+VM_StartSampling
+==============
+*/
+static void VM_StartSampling(int hz) {
+	vmSampleModule_t *module;
+	vm_t			 *vm;
+	int				  i;
+
+	if (vmSampler.buffer) {
+		Com_Printf("vmsample is already running\n");
+		return;
+	}
+
+	memset(&vmSampler, 0, sizeof(vmSampler));
+
+	// the sampler can't ask the loader, modules loaded later get no frames
+	for (i = 0; i < MAX_VM; i++) {
+		vm	   = &vmTable[i];
+		module = &vmSampler.modules[i];
+		if (!vm->dllHandle) { continue; }
+
+		if (Sys_ModuleCode((void *)vm->entryPoint, &module->base, &module->code, &module->codeSize)) {
+			module->dllHandle = vm->dllHandle;
+		} else {
+			Com_Printf("WARNING: no code range for %s, its samples won't have frames\n", vm->name);
+		}
+	}
+
+	vmSampler.buffer = Z_Malloc(VM_SAMPLE_BUFFER * sizeof(*vmSampler.buffer));
+	if (!Sys_StartSampling(hz, VM_Sample)) {
+		Com_Printf("vmsample isn't supported on this platform\n");
+		Z_Free(vmSampler.buffer);
+		vmSampler.buffer = NULL;
+		return;
+	}
+
+	Com_Printf("sampling vms at %i Hz\n", hz);
+}
+
+/*
+==============
+VM_StopSampling
+
+Merges identical stacks and writes them root first.
+==============
+*/
+static void VM_StopSampling(const char *name) {
+	char			 filename[MAX_QPATH];
+	char			 line[VM_SAMPLE_MAX_FRAMES * MAX_QPATH];
+	vmSampleStack_t *stacks;
+	fileHandle_t	 f;
+	vm_t			*vm;
+	int				*record, *other;
+	int				 vmSamples[MAX_VM];
+	int				 size, offset, hash, numStacks, i, j;
+
+	if (!vmSampler.buffer) {
+		Com_Printf("vmsample isn't running\n");
+		return;
+	}
+
+	Sys_StopSampling();
+
+	size = 16;
+	while (size < vmSampler.samples * 2) { size <<= 1; }
+	stacks = Z_Malloc(size * sizeof(*stacks));
+
+	memset(vmSamples, 0, sizeof(vmSamples));
+	for (offset = 0; offset < vmSampler.used; offset += 1 + (record[0] >> 8)) {
+		record = vmSampler.buffer + offset;
+		vmSamples[record[0] & 255]++;
+
+		for (hash = VM_SampleHash(record) & (size - 1); stacks[hash].count; hash = (hash + 1) & (size - 1)) {
+			other = vmSampler.buffer + stacks[hash].offset;
+			if (other[0] == record[0] && !memcmp(other + 1, record + 1, (record[0] >> 8) * sizeof(*record))) { break; }
+		}
+
+		if (!stacks[hash].count) { stacks[hash].offset = offset; }
+		stacks[hash].count++;
+	}
+
+	Q_strncpyz(filename, name, sizeof(filename));
+	COM_DefaultExtension(filename, sizeof(filename), ".folded");
+
+	numStacks = 0;
+	f		  = FS_FOpenFileWrite(filename);
+	if (f) {
+		for (i = 0; i < size; i++) {
+			if (!stacks[i].count) { continue; }
+
+			record = vmSampler.buffer + stacks[i].offset;
+			vm	   = &vmTable[record[0] & 255];
+			Q_strncpyz(line, vm->name[0] ? vm->name : "vm", sizeof(line));
+			if (!(record[0] >> 8)) { Q_strcat(line, sizeof(line), vm->dllHandle ? ";[native]" : ";[interpreted]"); }
+
+			// the leaf comes first in the record
+			for (j = record[0] >> 8; j > 0; j--) {
+				Q_strcat(line, sizeof(line), ";");
+				Q_strcat(line, sizeof(line), VM_SampleLabel(vm, record[j]));
+			}
+
+			Q_strcat(line, sizeof(line), va(" %i\n", stacks[i].count));
+			FS_Write(line, strlen(line), f);
+			numStacks++;
+		}
+		FS_FCloseFile(f);
+	} else {
+		Com_Printf("couldn't write %s\n", filename);
+	}
+
+	Com_Printf("%i samples, %i distinct stacks written to %s\n", vmSampler.samples, numStacks, filename);
+	if (vmSampler.outside) { Com_Printf("%i samples outside of a vm call\n", vmSampler.outside); }
+	if (vmSampler.dropped) { Com_Printf("%i samples dropped, the buffer was full\n", vmSampler.dropped); }
+	for (i = 0; i < MAX_VM; i++) {
+		vm = &vmTable[i];
+		if (!vmSamples[i] || !vm->name[0] || vm->dllHandle) { continue; }
+
+		if (!vm->compiled) {
+			Com_Printf("%s is interpreted, use vmprofile for it\n", vm->name);
+		} else if (!vm->symbols) {
+			Com_Printf("no symbols for %s, load it with developer 1 to get function names\n", vm->name);
+		}
+	}
+
+	Z_Free(stacks);
+	Z_Free(vmSampler.buffer);
+	vmSampler.buffer = NULL;
+}
+
+/*
+==============
+VM_VmSample_f
+
+==============
+*/
+void VM_VmSample_f(void) {
+	const char *cmd;
+	int			hz;
+
+	cmd = Cmd_Argv(1);
+	if (!Q_stricmp(cmd, "start")) {
+		hz = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : VM_SAMPLE_DEFAULT_HZ;
+		VM_StartSampling(MAX(10, MIN(hz, 1000)));
+	} else if (!Q_stricmp(cmd, "stop")) {
+		VM_StopSampling(Cmd_Argc() > 2 ? Cmd_Argv(2) : "vmsamples");
+	} else {
+		Com_Printf("usage: vmsample start [hz] | stop [file]\n");
+		if (vmSampler.buffer) { Com_Printf("%i samples so far\n", vmSampler.samples); }
+	}
+}
+
+/*
+==============================================================================
+
+SYSCALL PROFILER
+
+vmsyscalls start counts every call a module makes through its syscall entry
+point and the time spent in the engine handling it, vmsyscalls prints the
+profile so far and vmsyscalls stop prints it and stops. Calls a native module
+makes through a table from VM_BindImports don't pass through here, set
+vm_directImports 0 before loading it to count them too.
+
+==============================================================================
+*/
+
+#define VM_MAX_PROFILED_SYSCALLS 1024 // the last slot counts everything out of range
+
+typedef struct {
+	int		calls;
+	int64_t usec; // including any vm calls made while handling it
+} vmSyscallStat_t;
+
+typedef struct {
+	int				num;
+	vmSyscallStat_t stat;
+} vmSyscallEntry_t;
+
+typedef struct {
+	vmSyscallStat_t *stats; // MAX_VM * VM_MAX_PROFILED_SYSCALLS while running
+	int64_t			 startTime;
+} vmSyscallProfile_t;
+
+static vmSyscallProfile_t vmSyscallProfile;
+
+/*
+==============
+VM_SystemCall
+
+Every syscall from a module goes through here so it can be profiled
+==============
+*/
+intptr_t VM_SystemCall(vm_t *vm, intptr_t *args) {
+	vmSyscallStat_t *stat;
+	int64_t			 start;
+	intptr_t		 num, r;
+
+	if (!vmSyscallProfile.stats) { return vm->systemCall(args); }
+
+	num	  = args[0];
+	start = Sys_Microseconds();
+	r	  = vm->systemCall(args);
+
+	// the call may have stopped the profile
+	if (vmSyscallProfile.stats) {
+		if (num < 0 || num >= VM_MAX_PROFILED_SYSCALLS) { num = VM_MAX_PROFILED_SYSCALLS - 1; }
+		stat = &vmSyscallProfile.stats[(vm - vmTable) * VM_MAX_PROFILED_SYSCALLS + num];
+		stat->calls++;
+		stat->usec += Sys_Microseconds() - start;
+	}
+
+	return r;
+}
+
+static int QDECL VM_SyscallSort(const void *a, const void *b) {
+	const vmSyscallEntry_t *ea, *eb;
+
+	ea = a;
+	eb = b;
+
+	if (ea->stat.usec > eb->stat.usec) { return -1; }
+	if (ea->stat.usec < eb->stat.usec) { return 1; }
+	return ea->num - eb->num;
+}
+
+/*
+==============
+VM_PrintSyscalls
+==============
+*/
+static void VM_PrintSyscalls(void) {
+	vmSyscallEntry_t entries[VM_MAX_PROFILED_SYSCALLS];
+	vmSyscallStat_t *stats;
+	vm_t			*vm;
+	int64_t			 wall, total;
+	int				 numEntries, calls, i, j;
+
+	wall = MAX(Sys_Microseconds() - vmSyscallProfile.startTime, 1);
+	Com_Printf("%.1f seconds profiled\n", wall / 1000000.0);
+
+	for (i = 0; i < MAX_VM; i++) {
+		vm = &vmTable[i];
+		if (!vm->name[0]) { continue; }
+
+		stats	   = vmSyscallProfile.stats + i * VM_MAX_PROFILED_SYSCALLS;
+		numEntries = 0;
+		calls	   = 0;
+		total	   = 0;
+		for (j = 0; j < VM_MAX_PROFILED_SYSCALLS; j++) {
+			if (!stats[j].calls) { continue; }
+
+			entries[numEntries].num	 = j;
+			entries[numEntries].stat = stats[j];
+			numEntries++;
+			calls += stats[j].calls;
+			total += stats[j].usec;
+		}
+
+		Com_Printf("%s: %i calls, %.2f msec, %.1f%% of the time\n", vm->name, calls, total / 1000.0,
+				   100.0 * total / wall);
+		if (vm->directImports) {
+			Com_Printf("    direct imports are bound and not counted, set vm_directImports 0 to include them\n");
+		}
+		if (!numEntries) { continue; }
+
+		qsort(entries, numEntries, sizeof(entries[0]), VM_SyscallSort);
+
+		Com_Printf("    syscall     calls      msec  usec/call\n");
+		for (j = 0; j < numEntries; j++) {
+			Com_Printf("    %s%6i %9i %9.2f %10.2f\n", entries[j].num == VM_MAX_PROFILED_SYSCALLS - 1 ? ">" : " ",
+					   entries[j].num, entries[j].stat.calls, entries[j].stat.usec / 1000.0,
+					   (double)entries[j].stat.usec / entries[j].stat.calls);
+		}
+	}
+}
+
+/*
+==============
+VM_VmSyscalls_f
+
+==============
+*/
+void VM_VmSyscalls_f(void) {
+	const char *cmd;
+
+	cmd = Cmd_Argv(1);
+	if (!Q_stricmp(cmd, "start")) {
+		if (!vmSyscallProfile.stats) {
+			vmSyscallProfile.stats = Z_Malloc(MAX_VM * VM_MAX_PROFILED_SYSCALLS * sizeof(*vmSyscallProfile.stats));
+		}
+		memset(vmSyscallProfile.stats, 0, MAX_VM * VM_MAX_PROFILED_SYSCALLS * sizeof(*vmSyscallProfile.stats));
+		vmSyscallProfile.startTime = Sys_Microseconds();
+	} else if (!vmSyscallProfile.stats) {
+		Com_Printf("usage: vmsyscalls start | stop\n");
+	} else {
+		VM_PrintSyscalls();
+
+		if (!Q_stricmp(cmd, "stop")) {
+			Z_Free(vmSyscallProfile.stats);
+			vmSyscallProfile.stats = NULL;
+		}
+	}
+}
+
 /*
 ===============
 VM_LogSyscalls
@@ -99,6 +99,37 @@ static ID_INLINE int loadWord(void *addr) {
 }
 #endif
 
+/*
+Superinstructions are written over the first opcode of a frequent pair by
+VM_PrepareInterpreter.  The second instruction is left in place with its
+operand, so it is still there for jumps that land on it and the handler just
+skips over it.
+*/
+typedef enum {
+	OPX_LOCAL_LOAD4 = OP_CVFI + 1,
+	OPX_CONST_LOAD4,
+	OPX_CONST_STORE4,
+	OPX_CONST_ARG,
+	OPX_CONST_ADD,
+	OPX_CONST_JUMP,
+	OPX_CONST_EQ,
+	OPX_CONST_NE,
+	OPX_CONST_LTI,
+	OPX_CONST_LEI,
+	OPX_CONST_GTI,
+	OPX_CONST_GEI,
+	OPX_ADD_LOAD4,
+	OPX_LOAD4_ARG,
+	OPX_LOAD4_STORE4
+} superOpcode_t;
+
+// with labels as values every handler jumps straight to the next one instead
+// of going back through the switch, which gives the branch predictor one
+// indirect jump per handler to learn instead of a single shared one
+#if defined(__GNUC__) && !defined(DEBUG_VM) && !defined(VM_SWITCH_DISPATCH)
+#define VM_THREADED_DISPATCH
+#endif
+
 char *VM_Indent(vm_t *vm) {
 	static char *string = "                                        ";
 	if (vm->callLevel > 20) { return string; }
@@ -116,6 +147,39 @@ void VM_StackTrace(vm_t *vm, int programCounter, int programStack) {
 	} while (programCounter != -1 && ++count < 32);
 }
 
+/*
+====================
+VM_SuperInstruction
+
+Returns the superinstruction for an opcode pair, or 0 if the pair isn't fused
+====================
+*/
+static int VM_SuperInstruction(int op, int next) {
+	switch (op) {
+	case OP_LOCAL: return next == OP_LOAD4 ? OPX_LOCAL_LOAD4 : 0;
+	case OP_CONST:
+		switch (next) {
+		case OP_LOAD4: return OPX_CONST_LOAD4;
+		case OP_STORE4: return OPX_CONST_STORE4;
+		case OP_ARG: return OPX_CONST_ARG;
+		case OP_ADD: return OPX_CONST_ADD;
+		case OP_JUMP: return OPX_CONST_JUMP;
+		case OP_EQ: return OPX_CONST_EQ;
+		case OP_NE: return OPX_CONST_NE;
+		case OP_LTI: return OPX_CONST_LTI;
+		case OP_LEI: return OPX_CONST_LEI;
+		case OP_GTI: return OPX_CONST_GTI;
+		case OP_GEI: return OPX_CONST_GEI;
+		default: return 0;
+		}
+	case OP_ADD: return next == OP_LOAD4 ? OPX_ADD_LOAD4 : 0;
+	case OP_LOAD4:
+		if (next == OP_ARG) { return OPX_LOAD4_ARG; }
+		return next == OP_STORE4 ? OPX_LOAD4_STORE4 : 0;
+	default: return 0;
+	}
+}
+
 /*
 ====================
 VM_PrepareInterpreter
@@ -234,6 +298,18 @@ void VM_PrepareInterpreter(vm_t *vm, vmHeader_t *header) {
 		default: break;
 		}
 	}
+
+	vm->numSuperInstructions = 0;
+	if (!vm_superInstructions->integer) { return; }
+
+	for (instruction = 0; instruction < header->instructionCount - 1; instruction++) {
+		int_pc = vm->instructionPointers[instruction];
+		op	   = VM_SuperInstruction(codeBase[int_pc], codeBase[vm->instructionPointers[instruction + 1]]);
+		if (op) {
+			codeBase[int_pc] = op;
+			vm->numSuperInstructions++;
+		}
+	}
 }
 
 /*
@@ -319,6 +395,102 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 
 #define r2 codeImage[programCounter]
 
+#ifdef VM_THREADED_DISPATCH
+	// anything without a handler goes through the switch, which ignores it
+	static const void *const dispatchTable[256] = {
+		[0 ... 255] = &&nextInstruction,
+		[OP_BREAK] = &&L_OP_BREAK,
+		[OP_ENTER] = &&L_OP_ENTER,
+		[OP_LEAVE] = &&L_OP_LEAVE,
+		[OP_CALL] = &&L_OP_CALL,
+		[OP_PUSH] = &&L_OP_PUSH,
+		[OP_POP] = &&L_OP_POP,
+		[OP_CONST] = &&L_OP_CONST,
+		[OP_LOCAL] = &&L_OP_LOCAL,
+		[OP_JUMP] = &&L_OP_JUMP,
+		[OP_EQ] = &&L_OP_EQ,
+		[OP_NE] = &&L_OP_NE,
+		[OP_LTI] = &&L_OP_LTI,
+		[OP_LEI] = &&L_OP_LEI,
+		[OP_GTI] = &&L_OP_GTI,
+		[OP_GEI] = &&L_OP_GEI,
+		[OP_LTU] = &&L_OP_LTU,
+		[OP_LEU] = &&L_OP_LEU,
+		[OP_GTU] = &&L_OP_GTU,
+		[OP_GEU] = &&L_OP_GEU,
+		[OP_EQF] = &&L_OP_EQF,
+		[OP_NEF] = &&L_OP_NEF,
+		[OP_LTF] = &&L_OP_LTF,
+		[OP_LEF] = &&L_OP_LEF,
+		[OP_GTF] = &&L_OP_GTF,
+		[OP_GEF] = &&L_OP_GEF,
+		[OP_LOAD1] = &&L_OP_LOAD1,
+		[OP_LOAD2] = &&L_OP_LOAD2,
+		[OP_LOAD4] = &&L_OP_LOAD4,
+		[OP_STORE1] = &&L_OP_STORE1,
+		[OP_STORE2] = &&L_OP_STORE2,
+		[OP_STORE4] = &&L_OP_STORE4,
+		[OP_ARG] = &&L_OP_ARG,
+		[OP_BLOCK_COPY] = &&L_OP_BLOCK_COPY,
+		[OP_SEX8] = &&L_OP_SEX8,
+		[OP_SEX16] = &&L_OP_SEX16,
+		[OP_NEGI] = &&L_OP_NEGI,
+		[OP_ADD] = &&L_OP_ADD,
+		[OP_SUB] = &&L_OP_SUB,
+		[OP_DIVI] = &&L_OP_DIVI,
+		[OP_DIVU] = &&L_OP_DIVU,
+		[OP_MODI] = &&L_OP_MODI,
+		[OP_MODU] = &&L_OP_MODU,
+		[OP_MULI] = &&L_OP_MULI,
+		[OP_MULU] = &&L_OP_MULU,
+		[OP_BAND] = &&L_OP_BAND,
+		[OP_BOR] = &&L_OP_BOR,
+		[OP_BXOR] = &&L_OP_BXOR,
+		[OP_BCOM] = &&L_OP_BCOM,
+		[OP_LSH] = &&L_OP_LSH,
+		[OP_RSHI] = &&L_OP_RSHI,
+		[OP_RSHU] = &&L_OP_RSHU,
+		[OP_NEGF] = &&L_OP_NEGF,
+		[OP_ADDF] = &&L_OP_ADDF,
+		[OP_SUBF] = &&L_OP_SUBF,
+		[OP_DIVF] = &&L_OP_DIVF,
+		[OP_MULF] = &&L_OP_MULF,
+		[OP_CVIF] = &&L_OP_CVIF,
+		[OP_CVFI] = &&L_OP_CVFI,
+		[OPX_LOCAL_LOAD4] = &&L_OPX_LOCAL_LOAD4,
+		[OPX_CONST_LOAD4] = &&L_OPX_CONST_LOAD4,
+		[OPX_CONST_STORE4] = &&L_OPX_CONST_STORE4,
+		[OPX_CONST_ARG] = &&L_OPX_CONST_ARG,
+		[OPX_CONST_ADD] = &&L_OPX_CONST_ADD,
+		[OPX_CONST_JUMP] = &&L_OPX_CONST_JUMP,
+		[OPX_CONST_EQ] = &&L_OPX_CONST_EQ,
+		[OPX_CONST_NE] = &&L_OPX_CONST_NE,
+		[OPX_CONST_LTI] = &&L_OPX_CONST_LTI,
+		[OPX_CONST_LEI] = &&L_OPX_CONST_LEI,
+		[OPX_CONST_GTI] = &&L_OPX_CONST_GTI,
+		[OPX_CONST_GEI] = &&L_OPX_CONST_GEI,
+		[OPX_ADD_LOAD4] = &&L_OPX_ADD_LOAD4,
+		[OPX_LOAD4_ARG] = &&L_OPX_LOAD4_ARG,
+		[OPX_LOAD4_STORE4] = &&L_OPX_LOAD4_STORE4,
+	};
+
+	// the switch is only used to enter the loop, the case labels double as
+	// dispatch targets. The opcode is clamped since a corrupted return address
+	// can make OP_LEAVE land on an operand
+#define VM_CASE(op) case op: L_##op
+#define NEXT_INSTRUCTION()                                                                                             \
+	do {                                                                                                               \
+		r0 = opStack[opStackOfs];                                                                                      \
+		r1 = opStack[(uint8_t)(opStackOfs - 1)];                                                                       \
+		goto *dispatchTable[(uint8_t)codeImage[programCounter++]];                                                     \
+	} while (0)
+#define NEXT_INSTRUCTION2() goto *dispatchTable[(uint8_t)codeImage[programCounter++]]
+#else
+#define VM_CASE(op)			case op
+#define NEXT_INSTRUCTION()	goto nextInstruction
+#define NEXT_INSTRUCTION2() goto nextInstruction2
+#endif
+
 	while (1) {
 		int opcode, r0, r1;
 		//		unsigned int	r2;
@@ -326,7 +498,9 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 	nextInstruction:
 		r0 = opStack[opStackOfs];
 		r1 = opStack[(uint8_t)(opStackOfs - 1)];
+#ifndef VM_THREADED_DISPATCH
 	nextInstruction2:
+#endif
 #ifdef DEBUG_VM
 		if ((unsigned)programCounter >= vm->codeLength) {
 			Com_Error(ERR_DROP, "VM pc out of range");
@@ -354,23 +528,23 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 			Com_Error(ERR_DROP, "Bad VM instruction"); // this should be scanned on load!
 			return 0;
 #endif
-		case OP_BREAK: vm->breakCount++; goto nextInstruction2;
-		case OP_CONST:
+		VM_CASE(OP_BREAK): vm->breakCount++; NEXT_INSTRUCTION2();
+		VM_CASE(OP_CONST):
 			opStackOfs++;
 			r1 = r0;
 			r0 = opStack[opStackOfs] = r2;
 
 			programCounter += 1;
-			goto nextInstruction2;
-		case OP_LOCAL:
+			NEXT_INSTRUCTION2();
+		VM_CASE(OP_LOCAL):
 			opStackOfs++;
 			r1 = r0;
 			r0 = opStack[opStackOfs] = r2 + programStack;
 
 			programCounter += 1;
-			goto nextInstruction2;
+			NEXT_INSTRUCTION2();
 
-		case OP_LOAD4:
+		VM_CASE(OP_LOAD4):
 #ifdef DEBUG_VM
 			if (opStack[opStackOfs] & 3) {
 				Com_Error(ERR_DROP, "OP_LOAD4 misaligned");
@@ -378,37 +552,37 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 			}
 #endif
 			r0 = opStack[opStackOfs] = *(int *)&image[r0 & dataMask];
-			goto nextInstruction2;
-		case OP_LOAD2: r0 = opStack[opStackOfs] = *(unsigned short *)&image[r0 & dataMask]; goto nextInstruction2;
-		case OP_LOAD1: r0 = opStack[opStackOfs] = image[r0 & dataMask]; goto nextInstruction2;
+			NEXT_INSTRUCTION2();
+		VM_CASE(OP_LOAD2): r0 = opStack[opStackOfs] = *(unsigned short *)&image[r0 & dataMask]; NEXT_INSTRUCTION2();
+		VM_CASE(OP_LOAD1): r0 = opStack[opStackOfs] = image[r0 & dataMask]; NEXT_INSTRUCTION2();
 
-		case OP_STORE4:
+		VM_CASE(OP_STORE4):
 			*(int *)&image[r1 & dataMask] = r0;
 			opStackOfs -= 2;
-			goto nextInstruction;
-		case OP_STORE2:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_STORE2):
 			*(short *)&image[r1 & dataMask] = r0;
 			opStackOfs -= 2;
-			goto nextInstruction;
-		case OP_STORE1:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_STORE1):
 			image[r1 & dataMask] = r0;
 			opStackOfs -= 2;
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
 
-		case OP_ARG:
+		VM_CASE(OP_ARG):
 			// single byte offset from programStack
 			*(int *)&image[(codeImage[programCounter] + programStack) & dataMask] = r0;
 			opStackOfs--;
 			programCounter += 1;
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
 
-		case OP_BLOCK_COPY:
+		VM_CASE(OP_BLOCK_COPY):
 			VM_BlockCopy(r1, r0, r2);
 			programCounter += 1;
 			opStackOfs -= 2;
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
 
-		case OP_CALL:
+		VM_CASE(OP_CALL):
 			// save current program counter
 			*(int *)&image[programStack] = programCounter;
 
@@ -441,10 +615,10 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 						int		*imagePtr = (int *)&image[programStack];
 						int		 i;
 						for (i = 0; i < ARRAY_LEN(argarr); ++i) { argarr[i] = *(++imagePtr); }
-						r = vm->systemCall(argarr);
+						r = VM_SystemCall(vm, argarr);
 					} else {
 						intptr_t *argptr = (intptr_t *)&image[programStack + 4];
-						r				 = vm->systemCall(argptr);
+						r				 = VM_SystemCall(vm, argptr);
 					}
 				}
 
@@ -468,13 +642,13 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 			} else {
 				programCounter = vm->instructionPointers[programCounter];
 			}
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
 
 		// push and pop are only needed for discarded or bad function return values
-		case OP_PUSH: opStackOfs++; goto nextInstruction;
-		case OP_POP: opStackOfs--; goto nextInstruction;
+		VM_CASE(OP_PUSH): opStackOfs++; NEXT_INSTRUCTION();
+		VM_CASE(OP_POP): opStackOfs--; NEXT_INSTRUCTION();
 
-		case OP_ENTER:
+		VM_CASE(OP_ENTER):
 #ifdef DEBUG_VM
 			profileSymbol = VM_ValueToFunctionSymbol(vm, programCounter);
 #endif
@@ -497,8 +671,8 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 				//				vm->callLevel++;
 			}
 #endif
-			goto nextInstruction;
-		case OP_LEAVE:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_LEAVE):
 			// remove our stack frame
 			v1 = r2;
 
@@ -520,7 +694,7 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 				Com_Error(ERR_DROP, "VM program counter out of range in OP_LEAVE");
 				return 0;
 			}
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
 
 			/*
 			===================================================================
@@ -528,7 +702,7 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 			===================================================================
 			*/
 
-		case OP_JUMP:
+		VM_CASE(OP_JUMP):
 			if ((unsigned)r0 >= vm->instructionCount) {
 				Com_Error(ERR_DROP, "VM program counter out of range in OP_JUMP");
 				return 0;
@@ -537,264 +711,373 @@ int VM_CallInterpreted(vm_t *vm, int *args) {
 			programCounter = vm->instructionPointers[r0];
 
 			opStackOfs--;
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
 
-		case OP_EQ:
+		VM_CASE(OP_EQ):
 			opStackOfs -= 2;
 			if (r1 == r0) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_NE:
+		VM_CASE(OP_NE):
 			opStackOfs -= 2;
 			if (r1 != r0) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_LTI:
+		VM_CASE(OP_LTI):
 			opStackOfs -= 2;
 			if (r1 < r0) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_LEI:
+		VM_CASE(OP_LEI):
 			opStackOfs -= 2;
 			if (r1 <= r0) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_GTI:
+		VM_CASE(OP_GTI):
 			opStackOfs -= 2;
 			if (r1 > r0) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_GEI:
+		VM_CASE(OP_GEI):
 			opStackOfs -= 2;
 			if (r1 >= r0) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_LTU:
+		VM_CASE(OP_LTU):
 			opStackOfs -= 2;
 			if (((unsigned)r1) < ((unsigned)r0)) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_LEU:
+		VM_CASE(OP_LEU):
 			opStackOfs -= 2;
 			if (((unsigned)r1) <= ((unsigned)r0)) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_GTU:
+		VM_CASE(OP_GTU):
 			opStackOfs -= 2;
 			if (((unsigned)r1) > ((unsigned)r0)) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_GEU:
+		VM_CASE(OP_GEU):
 			opStackOfs -= 2;
 			if (((unsigned)r1) >= ((unsigned)r0)) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_EQF:
+		VM_CASE(OP_EQF):
 			opStackOfs -= 2;
 
 			if (((float *)opStack)[(uint8_t)(opStackOfs + 1)] == ((float *)opStack)[(uint8_t)(opStackOfs + 2)]) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_NEF:
+		VM_CASE(OP_NEF):
 			opStackOfs -= 2;
 
 			if (((float *)opStack)[(uint8_t)(opStackOfs + 1)] != ((float *)opStack)[(uint8_t)(opStackOfs + 2)]) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_LTF:
+		VM_CASE(OP_LTF):
 			opStackOfs -= 2;
 
 			if (((float *)opStack)[(uint8_t)(opStackOfs + 1)] < ((float *)opStack)[(uint8_t)(opStackOfs + 2)]) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_LEF:
+		VM_CASE(OP_LEF):
 			opStackOfs -= 2;
 
 			if (((float *)opStack)[(uint8_t)((uint8_t)(opStackOfs + 1))] <=
 				((float *)opStack)[(uint8_t)((uint8_t)(opStackOfs + 2))]) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_GTF:
+		VM_CASE(OP_GTF):
 			opStackOfs -= 2;
 
 			if (((float *)opStack)[(uint8_t)(opStackOfs + 1)] > ((float *)opStack)[(uint8_t)(opStackOfs + 2)]) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
-		case OP_GEF:
+		VM_CASE(OP_GEF):
 			opStackOfs -= 2;
 
 			if (((float *)opStack)[(uint8_t)(opStackOfs + 1)] >= ((float *)opStack)[(uint8_t)(opStackOfs + 2)]) {
 				programCounter = r2; // vm->instructionPointers[r2];
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			} else {
 				programCounter += 1;
-				goto nextInstruction;
+				NEXT_INSTRUCTION();
 			}
 
 			//===================================================================
 
-		case OP_NEGI: opStack[opStackOfs] = -r0; goto nextInstruction;
-		case OP_ADD:
+		VM_CASE(OP_NEGI): opStack[opStackOfs] = -r0; NEXT_INSTRUCTION();
+		VM_CASE(OP_ADD):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 + r0;
-			goto nextInstruction;
-		case OP_SUB:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_SUB):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 - r0;
-			goto nextInstruction;
-		case OP_DIVI:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_DIVI):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 / r0;
-			goto nextInstruction;
-		case OP_DIVU:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_DIVU):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned)r1) / ((unsigned)r0);
-			goto nextInstruction;
-		case OP_MODI:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_MODI):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 % r0;
-			goto nextInstruction;
-		case OP_MODU:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_MODU):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned)r1) % ((unsigned)r0);
-			goto nextInstruction;
-		case OP_MULI:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_MULI):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 * r0;
-			goto nextInstruction;
-		case OP_MULU:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_MULU):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned)r1) * ((unsigned)r0);
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
 
-		case OP_BAND:
+		VM_CASE(OP_BAND):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned)r1) & ((unsigned)r0);
-			goto nextInstruction;
-		case OP_BOR:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_BOR):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned)r1) | ((unsigned)r0);
-			goto nextInstruction;
-		case OP_BXOR:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_BXOR):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned)r1) ^ ((unsigned)r0);
-			goto nextInstruction;
-		case OP_BCOM: opStack[opStackOfs] = ~((unsigned)r0); goto nextInstruction;
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_BCOM): opStack[opStackOfs] = ~((unsigned)r0); NEXT_INSTRUCTION();
 
-		case OP_LSH:
+		VM_CASE(OP_LSH):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 << r0;
-			goto nextInstruction;
-		case OP_RSHI:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_RSHI):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 >> r0;
-			goto nextInstruction;
-		case OP_RSHU:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_RSHU):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned)r1) >> r0;
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
 
-		case OP_NEGF: ((float *)opStack)[opStackOfs] = -((float *)opStack)[opStackOfs]; goto nextInstruction;
-		case OP_ADDF:
+		VM_CASE(OP_NEGF): ((float *)opStack)[opStackOfs] = -((float *)opStack)[opStackOfs]; NEXT_INSTRUCTION();
+		VM_CASE(OP_ADDF):
 			opStackOfs--;
 			((float *)opStack)[opStackOfs] =
 				((float *)opStack)[opStackOfs] + ((float *)opStack)[(uint8_t)(opStackOfs + 1)];
-			goto nextInstruction;
-		case OP_SUBF:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_SUBF):
 			opStackOfs--;
 			((float *)opStack)[opStackOfs] =
 				((float *)opStack)[opStackOfs] - ((float *)opStack)[(uint8_t)(opStackOfs + 1)];
-			goto nextInstruction;
-		case OP_DIVF:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_DIVF):
 			opStackOfs--;
 			((float *)opStack)[opStackOfs] =
 				((float *)opStack)[opStackOfs] / ((float *)opStack)[(uint8_t)(opStackOfs + 1)];
-			goto nextInstruction;
-		case OP_MULF:
+			NEXT_INSTRUCTION();
+		VM_CASE(OP_MULF):
 			opStackOfs--;
 			((float *)opStack)[opStackOfs] =
 				((float *)opStack)[opStackOfs] * ((float *)opStack)[(uint8_t)(opStackOfs + 1)];
-			goto nextInstruction;
+			NEXT_INSTRUCTION();
+
+		VM_CASE(OP_CVIF): ((float *)opStack)[opStackOfs] = (float)opStack[opStackOfs]; NEXT_INSTRUCTION();
+		VM_CASE(OP_CVFI): opStack[opStackOfs] = Q_ftol(((float *)opStack)[opStackOfs]); NEXT_INSTRUCTION();
+		VM_CASE(OP_SEX8): opStack[opStackOfs] = (signed char)opStack[opStackOfs]; NEXT_INSTRUCTION();
+		VM_CASE(OP_SEX16): opStack[opStackOfs] = (short)opStack[opStackOfs]; NEXT_INSTRUCTION();
+
+			/*
+			===================================================================
+			SUPERINSTRUCTIONS
+			r2 is the operand of the first instruction, the second one is
+			skipped over together with its operand
+			===================================================================
+			*/
+
+		VM_CASE(OPX_LOCAL_LOAD4):
+			opStackOfs++;
+			r1 = r0;
+			r0 = opStack[opStackOfs] = *(int *)&image[(r2 + programStack) & dataMask];
+
+			programCounter += 2;
+			NEXT_INSTRUCTION2();
+		VM_CASE(OPX_CONST_LOAD4):
+			opStackOfs++;
+			r1 = r0;
+			r0 = opStack[opStackOfs] = *(int *)&image[r2 & dataMask];
+
+			programCounter += 2;
+			NEXT_INSTRUCTION2();
+		VM_CASE(OPX_CONST_STORE4):
+			*(int *)&image[r0 & dataMask] = r2;
+			opStackOfs--;
+			programCounter += 2;
+			NEXT_INSTRUCTION();
+		VM_CASE(OPX_CONST_ARG):
+			*(int *)&image[(codeImage[programCounter + 2] + programStack) & dataMask] = r2;
+			programCounter += 3;
+			NEXT_INSTRUCTION2();
+		VM_CASE(OPX_CONST_ADD):
+			r0 = opStack[opStackOfs] = r0 + r2;
+			programCounter += 2;
+			NEXT_INSTRUCTION2();
+		VM_CASE(OPX_CONST_JUMP):
+			if ((unsigned)r2 >= vm->instructionCount) {
+				Com_Error(ERR_DROP, "VM program counter out of range in OP_JUMP");
+				return 0;
+			}
 
-		case OP_CVIF: ((float *)opStack)[opStackOfs] = (float)opStack[opStackOfs]; goto nextInstruction;
-		case OP_CVFI: opStack[opStackOfs] = Q_ftol(((float *)opStack)[opStackOfs]); goto nextInstruction;
-		case OP_SEX8: opStack[opStackOfs] = (signed char)opStack[opStackOfs]; goto nextInstruction;
-		case OP_SEX16: opStack[opStackOfs] = (short)opStack[opStackOfs]; goto nextInstruction;
+			programCounter = vm->instructionPointers[r2];
+			NEXT_INSTRUCTION2();
+
+		VM_CASE(OPX_CONST_EQ):
+			opStackOfs--;
+			if (r0 == r2) {
+				programCounter = codeImage[programCounter + 2];
+				NEXT_INSTRUCTION();
+			}
+			programCounter += 3;
+			NEXT_INSTRUCTION();
+		VM_CASE(OPX_CONST_NE):
+			opStackOfs--;
+			if (r0 != r2) {
+				programCounter = codeImage[programCounter + 2];
+				NEXT_INSTRUCTION();
+			}
+			programCounter += 3;
+			NEXT_INSTRUCTION();
+		VM_CASE(OPX_CONST_LTI):
+			opStackOfs--;
+			if (r0 < r2) {
+				programCounter = codeImage[programCounter + 2];
+				NEXT_INSTRUCTION();
+			}
+			programCounter += 3;
+			NEXT_INSTRUCTION();
+		VM_CASE(OPX_CONST_LEI):
+			opStackOfs--;
+			if (r0 <= r2) {
+				programCounter = codeImage[programCounter + 2];
+				NEXT_INSTRUCTION();
+			}
+			programCounter += 3;
+			NEXT_INSTRUCTION();
+		VM_CASE(OPX_CONST_GTI):
+			opStackOfs--;
+			if (r0 > r2) {
+				programCounter = codeImage[programCounter + 2];
+				NEXT_INSTRUCTION();
+			}
+			programCounter += 3;
+			NEXT_INSTRUCTION();
+		VM_CASE(OPX_CONST_GEI):
+			opStackOfs--;
+			if (r0 >= r2) {
+				programCounter = codeImage[programCounter + 2];
+				NEXT_INSTRUCTION();
+			}
+			programCounter += 3;
+			NEXT_INSTRUCTION();
+
+		VM_CASE(OPX_ADD_LOAD4):
+			opStackOfs--;
+			opStack[opStackOfs] = *(int *)&image[(r1 + r0) & dataMask];
+			programCounter += 1;
+			NEXT_INSTRUCTION();
+		VM_CASE(OPX_LOAD4_ARG):
+			*(int *)&image[(codeImage[programCounter + 1] + programStack) & dataMask] = *(int *)&image[r0 & dataMask];
+			opStackOfs--;
+			programCounter += 2;
+			NEXT_INSTRUCTION();
+		VM_CASE(OPX_LOAD4_STORE4):
+			*(int *)&image[r1 & dataMask] = *(int *)&image[r0 & dataMask];
+			opStackOfs -= 2;
+			programCounter += 1;
+			NEXT_INSTRUCTION();
 		}
 	}
 
@@ -40,6 +40,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define PROGRAM_STACK_SIZE 0x1000000 // Was 0x10000 64kb, now 10mb
 #define PROGRAM_STACK_MASK (PROGRAM_STACK_SIZE - 1)
 
+// allocated past dataMask, the compiler leaves frame accesses up to this far
+// from a range checked program stack unmasked
+#define VM_DATA_GUARD 0x10000
+
 typedef enum {
 	OP_UNDEF,
 
@@ -154,14 +158,18 @@ struct vm_s {
 	void	  *dllHandle;
 	vmMainProc entryPoint;
 	void (*destroy)(vm_t *self);
+	qboolean   directImports; // bound a table from VM_BindImports, those calls skip systemCall
 
 	// for interpreted modules
 	qboolean currentlyInterpreting;
+	int32_t	 numSuperInstructions; // opcode pairs fused by VM_PrepareInterpreter
 
 	qboolean compiled;
 	byte	*codeBase;
 	int32_t	 entryOfs;
 	int32_t	 codeLength;
+	int32_t	 numProvenAccesses; // loads and stores emitted without dataMask
+	int32_t	 numMaskedAccesses;
 
 	intptr_t *instructionPointers;
 	int32_t	  instructionCount;
@@ -176,6 +184,7 @@ struct vm_s {
 	struct vmSymbol_s *symbols;
 
 	int32_t callLevel;	   // counts recursive VM_Call
+	byte   *stackTop;	   // native stack at the outermost VM_Call, bounds the sampler's stack walk
 	int32_t breakFunction; // increment breakCount on function entry to this
 	int32_t breakCount;
 
@@ -185,6 +194,8 @@ struct vm_s {
 
 extern vm_t	  *currentVM;
 extern int32_t vm_debugLevel;
+extern cvar_t *vm_superInstructions;
+extern cvar_t *vm_proveBounds;
 
 void	VM_Compile(vm_t *vm, vmHeader_t *header);
 int32_t VM_CallCompiled(vm_t *vm, int32_t *args);
@@ -198,3 +209,5 @@ const char *VM_ValueToSymbol(vm_t *vm, int32_t value);
 void		VM_LogSyscalls(int32_t *args);
 
 void VM_BlockCopy(uint32_t dest, uint32_t src, size_t n);
+
+intptr_t VM_SystemCall(vm_t *vm, intptr_t *args);
@@ -350,7 +350,7 @@ static long int VM_AsmCall(int callSyscallInvNum, int callProgramStack) {
 		// generated code does not invert syscall number
 		argPosition[0] = -1 - callSyscallInvNum;
 
-		ret = currentVM->systemCall(argPosition);
+		ret = VM_SystemCall(currentVM, argPosition);
 	} else {
 		intptr_t args[MAX_VMSYSCALL_ARGS];
 
@@ -360,7 +360,7 @@ static long int VM_AsmCall(int callSyscallInvNum, int callProgramStack) {
 		int *argPosition = (int *)((byte *)currentVM->dataBase + callProgramStack + 4);
 		for (i = 1; i < ARRAY_LEN(args); i++) args[i] = argPosition[i];
 
-		ret = currentVM->systemCall(args);
+		ret = VM_SystemCall(currentVM, args);
 	}
 
 	currentVM = savedVM;
@@ -63,6 +63,8 @@ x86_64:
 	do {                                                                                                               \
 		Z_Free(buf);                                                                                                   \
 		Z_Free(jused);                                                                                                 \
+		Z_Free(addrKind);                                                                                              \
+		Z_Free(addrValue);                                                                                             \
 	} while (0)
 static byte *buf		 = NULL;
 static byte *jused		 = NULL;
@@ -71,6 +73,13 @@ static int	 compiledOfs = 0;
 static byte *code		 = NULL;
 static int	 pc			 = 0;
 
+// what the address operand of each load and store is known to be
+typedef enum { ADDR_UNKNOWN, ADDR_LOCAL, ADDR_CONST } addrKind_t;
+
+static byte	   *addrKind  = NULL;
+static int	   *addrValue = NULL;
+static qboolean proveBounds;
+
 #define FTOL_PTR
 
 static int instruction, pass;
@@ -85,7 +94,7 @@ typedef enum {
 	LAST_COMMAND_SUB_BL_2,
 } ELastCommand;
 
-typedef enum { VM_JMP_VIOLATION = 0, VM_BLOCK_COPY = 1 } ESysCallType;
+typedef enum { VM_JMP_VIOLATION = 0, VM_BLOCK_COPY = 1, VM_STACK_VIOLATION = 2 } ESysCallType;
 
 static ELastCommand LastCommand;
 
@@ -380,10 +389,10 @@ static void DoSyscall(void) {
 		args[0] = ~vm_syscallNum;
 		for (index = 1; index < ARRAY_LEN(args); index++) args[index] = data[index];
 
-		*ret = savedVM->systemCall(args);
+		*ret = VM_SystemCall(savedVM, args);
 #else
 		data[0] = ~vm_syscallNum;
-		*ret	= savedVM->systemCall((intptr_t *)data);
+		*ret	= VM_SystemCall(savedVM, (intptr_t *)data);
 #endif
 	} else {
 		switch (vm_syscallNum) {
@@ -393,6 +402,7 @@ static void DoSyscall(void) {
 
 			VM_BlockCopy(vm_opStackBase[(vm_opStackOfs - 1)], vm_opStackBase[vm_opStackOfs], vm_arg);
 			break;
+		case VM_STACK_VIOLATION: Com_Error(ERR_DROP, "program stack outside VM data"); break;
 		default: Com_Error(ERR_DROP, "Unknown VM operation %d", vm_syscallNum); break;
 		}
 	}
@@ -647,6 +657,258 @@ void EmitBranchConditions(vm_t *vm, int op) {
 	}
 }
 
+/*
+=================
+FindKnownAddresses
+Follow LOCAL and CONST values through the opStack, so loads and stores whose
+address is known at compile time can skip dataMask. The opStack is assumed
+unknown wherever code can be jumped to
+=================
+*/
+
+static void FindKnownAddresses(vm_t *vm, vmHeader_t *header) {
+	byte	kinds[256];
+	int		values[256];
+	uint8_t top, below;
+	int		op, v;
+	int		i;
+
+	if (!proveBounds || !vm->jumpTableTargets) return;
+
+	// branch and jump targets, the jump table targets are already marked
+	pc = 0;
+	for (i = 0; i < header->instructionCount && pc <= header->codeLength; i++) {
+		op = code[pc++];
+		switch (op) {
+		case OP_EQ:
+		case OP_NE:
+		case OP_LTI:
+		case OP_LEI:
+		case OP_GTI:
+		case OP_GEI:
+		case OP_LTU:
+		case OP_LEU:
+		case OP_GTU:
+		case OP_GEU:
+		case OP_EQF:
+		case OP_NEF:
+		case OP_LTF:
+		case OP_LEF:
+		case OP_GTF:
+		case OP_GEF:
+			v = Constant4();
+			JUSED(v);
+			break;
+		case OP_CONST:
+			v = Constant4();
+			if (code[pc] == OP_JUMP || (code[pc] == OP_CALL && v >= 0)) JUSED(v);
+			break;
+		case OP_ENTER:
+		case OP_LEAVE:
+		case OP_LOCAL:
+		case OP_BLOCK_COPY: pc += 4; break;
+		case OP_ARG: pc += 1; break;
+		default: break;
+		}
+	}
+
+	// the index wraps around like the bl register does
+	memset(kinds, ADDR_UNKNOWN, sizeof(kinds));
+	top = 0;
+	pc	= 0;
+	for (i = 0; i < header->instructionCount && pc <= header->codeLength; i++) {
+		if (jused[i]) memset(kinds, ADDR_UNKNOWN, sizeof(kinds));
+
+		below = top - 1;
+		op	  = code[pc++];
+		switch (op) {
+		case OP_CONST:
+		case OP_LOCAL:
+			top++;
+			kinds[top]	= (op == OP_CONST) ? ADDR_CONST : ADDR_LOCAL;
+			values[top] = Constant4();
+			break;
+		case OP_PUSH:
+			top++;
+			kinds[top] = ADDR_UNKNOWN;
+			break;
+		case OP_POP: top--; break;
+		case OP_ARG:
+			// stores to a small offset from the program stack
+			addrKind[i]	 = ADDR_LOCAL;
+			addrValue[i] = Constant1();
+			top--;
+			break;
+		case OP_LOAD1:
+		case OP_LOAD2:
+		case OP_LOAD4:
+			addrKind[i]	 = kinds[top];
+			addrValue[i] = values[top];
+			kinds[top]	 = ADDR_UNKNOWN;
+			break;
+		case OP_STORE1:
+		case OP_STORE2:
+		case OP_STORE4:
+			addrKind[i]	 = kinds[below];
+			addrValue[i] = values[below];
+			top -= 2;
+			break;
+		case OP_ADD:
+			if (kinds[top] == ADDR_CONST && kinds[below] != ADDR_UNKNOWN) {
+				values[below] = (unsigned)values[below] + values[top];
+			} else if (kinds[below] == ADDR_CONST && kinds[top] != ADDR_UNKNOWN) {
+				kinds[below]  = kinds[top];
+				values[below] = (unsigned)values[below] + values[top];
+			} else {
+				kinds[below] = ADDR_UNKNOWN;
+			}
+			top--;
+			break;
+		case OP_SUB:
+			if (kinds[top] == ADDR_CONST && kinds[below] != ADDR_UNKNOWN)
+				values[below] = (unsigned)values[below] - values[top];
+			else
+				kinds[below] = ADDR_UNKNOWN;
+			top--;
+			break;
+		case OP_DIVI:
+		case OP_DIVU:
+		case OP_MODI:
+		case OP_MODU:
+		case OP_MULI:
+		case OP_MULU:
+		case OP_BAND:
+		case OP_BOR:
+		case OP_BXOR:
+		case OP_LSH:
+		case OP_RSHI:
+		case OP_RSHU:
+		case OP_ADDF:
+		case OP_SUBF:
+		case OP_DIVF:
+		case OP_MULF:
+			kinds[below] = ADDR_UNKNOWN;
+			top--;
+			break;
+		case OP_CALL:
+		case OP_SEX8:
+		case OP_SEX16:
+		case OP_NEGI:
+		case OP_BCOM:
+		case OP_NEGF:
+		case OP_CVIF:
+		case OP_CVFI: kinds[top] = ADDR_UNKNOWN; break;
+		case OP_EQ:
+		case OP_NE:
+		case OP_LTI:
+		case OP_LEI:
+		case OP_GTI:
+		case OP_GEI:
+		case OP_LTU:
+		case OP_LEU:
+		case OP_GTU:
+		case OP_GEU:
+		case OP_EQF:
+		case OP_NEF:
+		case OP_LTF:
+		case OP_LEF:
+		case OP_GTF:
+		case OP_GEF:
+		case OP_BLOCK_COPY:
+			pc += 4;
+			top -= 2;
+			break;
+		default:
+			// OP_ENTER, OP_LEAVE, OP_JUMP and anything unexpected
+			if (op == OP_ENTER || op == OP_LEAVE) pc += 4;
+			memset(kinds, ADDR_UNKNOWN, sizeof(kinds));
+			break;
+		}
+	}
+}
+
+/*
+=================
+ProvenAddress
+Returns qtrue if the access of size bytes by instruction ins stays inside the
+data allocation without applying dataMask. The program stack is kept in range
+by the checks emitted after OP_ENTER and OP_LEAVE
+=================
+*/
+
+static qboolean ProvenAddress(vm_t *vm, int ins, int size) {
+	switch (addrKind[ins]) {
+	case ADDR_LOCAL: return addrValue[ins] >= 0 && addrValue[ins] <= VM_DATA_GUARD - size;
+	case ADDR_CONST: return (unsigned)addrValue[ins] <= vm->dataMask;
+	default: return qfalse;
+	}
+}
+
+static void CountAccesses(vm_t *vm, qboolean proven, int count) {
+	if (pass != 2) return;
+
+	if (proven)
+		vm->numProvenAccesses += count;
+	else
+		vm->numMaskedAccesses += count;
+}
+
+/*
+=================
+EmitDataAccess
+Instruction with a memory operand at the proven address of instruction ins,
+reg goes into the reg field of the ModR/M byte
+=================
+*/
+
+static void EmitDataAccess(vm_t *vm, const char *op, int reg, int ins) {
+	EmitRexString(0x41, op);
+#if idx64
+	if (addrKind[ins] == ADDR_LOCAL) {
+		Emit1(0x84 | (reg << 3)); // [r9 + rsi + 0x12345678]
+		Emit1(0x31);
+	} else
+		Emit1(0x81 | (reg << 3)); // [r9 + 0x12345678]
+	Emit4(addrValue[ins]);
+#else
+	if (addrKind[ins] == ADDR_LOCAL)
+		Emit1(0x86 | (reg << 3)); // [esi + 0x12345678]
+	else
+		Emit1(0x05 | (reg << 3)); // [0x12345678]
+	EmitPtr(vm->dataBase + addrValue[ins]);
+#endif
+}
+
+/*
+=================
+EmitDropAddress
+An access at a proven address doesn't read its address from the opStack, take
+back the store of it and the lea of a directly preceding OP_LOCAL
+=================
+*/
+
+static void EmitDropAddress(vm_t *vm) {
+	if (jlabel || LastCommand != LAST_COMMAND_MOV_STACK_EAX) return;
+
+	compiledOfs -= 3;					    // mov dword ptr [edi + ebx * 4], eax
+	if (pop1 == OP_LOCAL) compiledOfs -= 6; // lea eax, [0x12345678 + esi]
+	vm->instructionPointers[instruction - 1] = compiledOfs;
+}
+
+/*
+=================
+EmitStackCheck
+Error out if the program stack left VM data, unmasked OP_LOCAL accesses rely on it
+=================
+*/
+
+static void EmitStackCheck(vm_t *vm, int badStackOfs) {
+	EmitString("81 FE"); // cmp esi, 0x12345678
+	Emit4(vm->dataMask + 1);
+	EmitString("0F 87"); // ja badStack
+	Emit4(badStackOfs - compiledOfs - 4);
+}
+
 /*
 =================
 ConstOptimize
@@ -678,6 +940,7 @@ qboolean ConstOptimize(vm_t *vm, int callProcOfsSyscall) {
 		EmitString("8B 00"); // mov eax, dword ptr [eax]
 #endif
 		EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
+		CountAccesses(vm, qtrue, 1);
 
 		pc++; // OP_LOAD4
 		instruction += 1;
@@ -693,6 +956,7 @@ qboolean ConstOptimize(vm_t *vm, int callProcOfsSyscall) {
 		EmitString("0F B7 00"); // movzx eax, word ptr [eax]
 #endif
 		EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
+		CountAccesses(vm, qtrue, 1);
 
 		pc++; // OP_LOAD2
 		instruction += 1;
@@ -708,12 +972,26 @@ qboolean ConstOptimize(vm_t *vm, int callProcOfsSyscall) {
 		EmitString("0F B6 00"); // movzx eax, byte ptr [eax]
 #endif
 		EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
+		CountAccesses(vm, qtrue, 1);
 
 		pc++; // OP_LOAD1
 		instruction += 1;
 		return qtrue;
 
-	case OP_STORE4: EmitMovEAXStack(vm, vm->dataMask);
+	case OP_STORE4:
+		if (ProvenAddress(vm, instruction, 4)) {
+			EmitDropAddress(vm);
+			EmitDataAccess(vm, "C7", 0, instruction); // mov dword ptr [data + address], 0x12345678
+			Emit4(Constant4());
+			EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+			CountAccesses(vm, qtrue, 1);
+
+			pc++; // OP_STORE4
+			instruction += 1;
+			return qtrue;
+		}
+
+		EmitMovEAXStack(vm, vm->dataMask);
 #if idx64
 		EmitRexString(0x41, "C7 04 01"); // mov dword ptr [r9 + eax], 0x12345678
 		Emit4(Constant4());
@@ -723,11 +1001,26 @@ qboolean ConstOptimize(vm_t *vm, int callProcOfsSyscall) {
 		Emit4(Constant4());
 #endif
 		EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
-		pc++;								// OP_STORE4
+		CountAccesses(vm, qfalse, 1);
+		pc++; // OP_STORE4
 		instruction += 1;
 		return qtrue;
 
-	case OP_STORE2: EmitMovEAXStack(vm, vm->dataMask);
+	case OP_STORE2:
+		if (ProvenAddress(vm, instruction, 2)) {
+			EmitDropAddress(vm);
+			Emit1(0x66);
+			EmitDataAccess(vm, "C7", 0, instruction); // mov word ptr [data + address], 0x1234
+			Emit2(Constant4());
+			EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+			CountAccesses(vm, qtrue, 1);
+
+			pc++; // OP_STORE2
+			instruction += 1;
+			return qtrue;
+		}
+
+		EmitMovEAXStack(vm, vm->dataMask);
 #if idx64
 		Emit1(0x66); // mov word ptr [r9 + eax], 0x1234
 		EmitRexString(0x41, "C7 04 01");
@@ -738,12 +1031,26 @@ qboolean ConstOptimize(vm_t *vm, int callProcOfsSyscall) {
 		Emit2(Constant4());
 #endif
 		EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+		CountAccesses(vm, qfalse, 1);
 
 		pc++; // OP_STORE2
 		instruction += 1;
 		return qtrue;
 
-	case OP_STORE1: EmitMovEAXStack(vm, vm->dataMask);
+	case OP_STORE1:
+		if (ProvenAddress(vm, instruction, 1)) {
+			EmitDropAddress(vm);
+			EmitDataAccess(vm, "C6", 0, instruction); // mov byte ptr [data + address], 0x12
+			Emit1(Constant4());
+			EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+			CountAccesses(vm, qtrue, 1);
+
+			pc++; // OP_STORE1
+			instruction += 1;
+			return qtrue;
+		}
+
+		EmitMovEAXStack(vm, vm->dataMask);
 #if idx64
 		EmitRexString(0x41, "C6 04 01"); // mov byte [r9 + eax], 0x12
 		Emit1(Constant4());
@@ -753,6 +1060,7 @@ qboolean ConstOptimize(vm_t *vm, int callProcOfsSyscall) {
 		Emit1(Constant4());
 #endif
 		EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+		CountAccesses(vm, qfalse, 1);
 
 		pc++; // OP_STORE1
 		instruction += 1;
@@ -909,10 +1217,19 @@ qboolean ConstOptimize(vm_t *vm, int callProcOfsSyscall) {
 	case OP_LEU:
 	case OP_GTU:
 	case OP_GEU:
+		v = Constant4();
+
 		EmitMovEAXStack(vm, 0);
 		EmitCommand(LAST_COMMAND_SUB_BL_1);
-		EmitString("3D"); // cmp eax, 0x12345678
-		Emit4(Constant4());
+		if (v == 0) {
+			EmitString("85 C0"); // test eax, eax
+		} else if (iss8(v)) {
+			EmitString("83 F8"); // cmp eax, 0x7F
+			Emit1(v);
+		} else {
+			EmitString("3D"); // cmp eax, 0x12345678
+			Emit4(v);
+		}
 
 		pc++; // OP_*
 		EmitBranchConditions(vm, op1);
@@ -969,15 +1286,18 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 	int maxLength;
 	int v;
 	int i;
-	int callProcOfsSyscall, callProcOfs, callDoSyscallOfs;
+	int callProcOfsSyscall, callProcOfs, callDoSyscallOfs, badStackOfs;
 
-	jusedSize = header->instructionCount + 2;
+	jusedSize	= header->instructionCount + 2;
+	proveBounds = vm_proveBounds->integer;
 
 	// allocate a very large temp buffer, we will shrink it later
 	maxLength = header->codeLength * 8 + 64;
 	buf		  = Z_Malloc(maxLength);
 	jused	  = Z_Malloc(jusedSize);
 	code	  = Z_Malloc(header->codeLength + 32);
+	addrKind  = Z_Malloc(jusedSize);
+	addrValue = Z_Malloc(jusedSize * sizeof(*addrValue));
 
 	memset(jused, 0, jusedSize);
 	memset(buf, 0, maxLength);
@@ -993,13 +1313,23 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 	pc = -1; // a bogus value to be printed in out-of-bounds error messages
 	for (i = 0; i < vm->numJumpTableTargets; i++) { JUSED(*(int *)(vm->jumpTableTargets + (i * sizeof(int)))); }
 
+	FindKnownAddresses(vm, header);
+	vm->numProvenAccesses = 0;
+	vm->numMaskedAccesses = 0;
+
 	// Start buffer with x86-VM specific procedures
 	compiledOfs = 0;
 
 	callDoSyscallOfs   = compiledOfs;
 	callProcOfs		   = EmitCallDoSyscall(vm);
 	callProcOfsSyscall = EmitCallProcedure(vm, callDoSyscallOfs);
-	vm->entryOfs	   = compiledOfs;
+
+	badStackOfs = compiledOfs;
+	EmitString("B8"); // mov eax, 0x12345678
+	Emit4(VM_STACK_VIOLATION);
+	EmitCallRel(vm, callDoSyscallOfs);
+
+	vm->entryOfs = compiledOfs;
 
 	for (pass = 0; pass < 3; pass++) {
 		oc0	 = -23423;
@@ -1045,6 +1375,7 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 			case OP_ENTER:
 				EmitString("81 EE"); // sub esi, 0x12345678
 				Emit4(Constant4());
+				if (proveBounds) EmitStackCheck(vm, badStackOfs);
 				break;
 			case OP_CONST:
 				if (ConstOptimize(vm, callProcOfsSyscall)) break;
@@ -1067,8 +1398,16 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 				break;
 			case OP_ARG:
 				EmitMovEAXStack(vm, 0); // mov eax, dword ptr [edi + ebx * 4]
-				EmitString("8B D6");	// mov edx, esi
-				EmitString("81 C2");	// add edx, 0x12345678
+				if (ProvenAddress(vm, instruction - 1, 4)) {
+					EmitDataAccess(vm, "89", 0, instruction - 1); // mov dword ptr [data + address], eax
+					EmitCommand(LAST_COMMAND_SUB_BL_1);			  // sub bl, 1
+					CountAccesses(vm, qtrue, 1);
+					pc++; // argument offset
+					break;
+				}
+
+				EmitString("8B D6"); // mov edx, esi
+				EmitString("81 C2"); // add edx, 0x12345678
 				Emit4((Constant1() & 0xFF));
 				MASK_REG("E2", vm->dataMask); // and edx, 0x12345678
 #if idx64
@@ -1078,6 +1417,7 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 				Emit4((intptr_t)vm->dataBase);
 #endif
 				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				CountAccesses(vm, qfalse, 1);
 				break;
 			case OP_CALL: EmitCallRel(vm, callProcOfs); break;
 			case OP_PUSH: EmitPushStack(vm); break;
@@ -1088,9 +1428,43 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 				v = Constant4();
 				EmitString("81 C6"); // add	esi, 0x12345678
 				Emit4(v);
+				if (proveBounds) EmitStackCheck(vm, badStackOfs);
 				EmitString("C3"); // ret
 				break;
 			case OP_LOAD4:
+				// read, modify and write a proven address in place
+				if (code[pc] == OP_CONST && (code[pc + 5] == OP_ADD || code[pc + 5] == OP_SUB) &&
+					code[pc + 6] == OP_STORE4 && addrKind[instruction - 1] == addrKind[instruction + 2] &&
+					addrValue[instruction - 1] == addrValue[instruction + 2] && ProvenAddress(vm, instruction - 1, 4)) {
+					if (oc0 == oc1 && pop0 == OP_LOCAL && pop1 == OP_LOCAL) {
+						compiledOfs -= 12;
+						EmitDropAddress(vm);
+						vm->instructionPointers[instruction - 1] = compiledOfs;
+					}
+
+					pc++; // OP_CONST
+					v = Constant4();
+
+					if (v == 1) {
+						// inc or dec dword ptr [data + address]
+						EmitDataAccess(vm, "FF", code[pc] == OP_ADD ? 0 : 1, instruction - 1);
+					} else {
+						// add or sub dword ptr [data + address], 0x12345678
+						EmitDataAccess(vm, "81", code[pc] == OP_ADD ? 0 : 5, instruction - 1);
+						Emit4(v);
+					}
+
+					if (oc0 == oc1 && pop0 == OP_LOCAL && pop1 == OP_LOCAL)
+						EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+					else
+						EmitCommand(LAST_COMMAND_SUB_BL_2); // sub bl, 2
+					CountAccesses(vm, qtrue, 2);
+					pc++; // OP_ADD
+					pc++; // OP_STORE
+					instruction += 3;
+					break;
+				}
+
 				if (code[pc] == OP_CONST && code[pc + 5] == OP_ADD && code[pc + 6] == OP_STORE4) {
 					if (oc0 == oc1 && pop0 == OP_LOCAL && pop1 == OP_LOCAL) {
 						compiledOfs -= 12;
@@ -1138,6 +1512,7 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 						}
 					}
 
+					CountAccesses(vm, qfalse, 2);
 					EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
 					pc++;								// OP_ADD
 					pc++;								// OP_STORE
@@ -1191,6 +1566,7 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 #endif
 						}
 					}
+					CountAccesses(vm, qfalse, 2);
 					EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
 					pc++;								// OP_SUB
 					pc++;								// OP_STORE
@@ -1198,7 +1574,16 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 					break;
 				}
 
-				if (buf[compiledOfs - 3] == 0x89 && buf[compiledOfs - 2] == 0x04 && buf[compiledOfs - 1] == 0x9F) {
+				if (ProvenAddress(vm, instruction - 1, 4)) {
+					EmitDropAddress(vm);
+					EmitDataAccess(vm, "8B", 0, instruction - 1); // mov eax, dword ptr [data + address]
+					EmitCommand(LAST_COMMAND_MOV_STACK_EAX);	  // mov dword ptr [edi + ebx * 4], eax
+					CountAccesses(vm, qtrue, 1);
+					break;
+				}
+
+				CountAccesses(vm, qfalse, 1);
+				if (!jlabel && LastCommand == LAST_COMMAND_MOV_STACK_EAX) { // mov dword ptr [edi + ebx * 4], eax
 					compiledOfs -= 3;
 					vm->instructionPointers[instruction - 1] = compiledOfs;
 					MASK_REG("E0", vm->dataMask); // and eax, 0x12345678
@@ -1221,7 +1606,17 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 #endif
 				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
-			case OP_LOAD2: EmitMovEAXStack(vm, vm->dataMask);
+			case OP_LOAD2:
+				if (ProvenAddress(vm, instruction - 1, 2)) {
+					EmitDropAddress(vm);
+					EmitDataAccess(vm, "0F B7", 0, instruction - 1); // movzx eax, word ptr [data + address]
+					EmitCommand(LAST_COMMAND_MOV_STACK_EAX);		 // mov dword ptr [edi + ebx * 4], eax
+					CountAccesses(vm, qtrue, 1);
+					break;
+				}
+
+				CountAccesses(vm, qfalse, 1);
+				EmitMovEAXStack(vm, vm->dataMask);
 #if idx64
 				EmitRexString(0x41, "0F B7 04 01"); // movzx eax, word ptr [r9 + eax]
 #else
@@ -1230,7 +1625,17 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 #endif
 				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
-			case OP_LOAD1: EmitMovEAXStack(vm, vm->dataMask);
+			case OP_LOAD1:
+				if (ProvenAddress(vm, instruction - 1, 1)) {
+					EmitDropAddress(vm);
+					EmitDataAccess(vm, "0F B6", 0, instruction - 1); // movzx eax, byte ptr [data + address]
+					EmitCommand(LAST_COMMAND_MOV_STACK_EAX);		 // mov dword ptr [edi + ebx * 4], eax
+					CountAccesses(vm, qtrue, 1);
+					break;
+				}
+
+				CountAccesses(vm, qfalse, 1);
+				EmitMovEAXStack(vm, vm->dataMask);
 #if idx64
 				EmitRexString(0x41, "0F B6 04 01"); // movzx eax, byte ptr [r9 + eax]
 #else
@@ -1241,6 +1646,14 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 				break;
 			case OP_STORE4:
 				EmitMovEAXStack(vm, 0);
+				if (ProvenAddress(vm, instruction - 1, 4)) {
+					EmitDataAccess(vm, "89", 0, instruction - 1); // mov dword ptr [data + address], eax
+					EmitCommand(LAST_COMMAND_SUB_BL_2);			  // sub bl, 2
+					CountAccesses(vm, qtrue, 1);
+					break;
+				}
+
+				CountAccesses(vm, qfalse, 1);
 				EmitString("8B 54 9F FC");	  // mov edx, dword ptr -4[edi + ebx * 4]
 				MASK_REG("E2", vm->dataMask); // and edx, 0x12345678
 #if idx64
@@ -1253,6 +1666,15 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 				break;
 			case OP_STORE2:
 				EmitMovEAXStack(vm, 0);
+				if (ProvenAddress(vm, instruction - 1, 2)) {
+					Emit1(0x66);
+					EmitDataAccess(vm, "89", 0, instruction - 1); // mov word ptr [data + address], ax
+					EmitCommand(LAST_COMMAND_SUB_BL_2);			  // sub bl, 2
+					CountAccesses(vm, qtrue, 1);
+					break;
+				}
+
+				CountAccesses(vm, qfalse, 1);
 				EmitString("8B 54 9F FC");	  // mov edx, dword ptr -4[edi + ebx * 4]
 				MASK_REG("E2", vm->dataMask); // and edx, 0x12345678
 #if idx64
@@ -1266,6 +1688,14 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 				break;
 			case OP_STORE1:
 				EmitMovEAXStack(vm, 0);
+				if (ProvenAddress(vm, instruction - 1, 1)) {
+					EmitDataAccess(vm, "88", 0, instruction - 1); // mov byte ptr [data + address], al
+					EmitCommand(LAST_COMMAND_SUB_BL_2);			  // sub bl, 2
+					CountAccesses(vm, qtrue, 1);
+					break;
+				}
+
+				CountAccesses(vm, qfalse, 1);
 				EmitString("8B 54 9F FC");	  // mov edx, dword ptr -4[edi + ebx * 4]
 				MASK_REG("E2", vm->dataMask); // and edx, 0x12345678
 #if idx64
@@ -1337,87 +1767,107 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 				EmitCommand(LAST_COMMAND_MOV_STACK_EAX);
 				break;
 			case OP_ADD:
-				EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-				EmitString("01 44 9F FC");			// add dword ptr -4[edi + ebx * 4], eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovEAXStack(vm, 0);					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("03 04 9F");					 // add eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_SUB:
-				EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-				EmitString("29 44 9F FC");			// sub dword ptr -4[edi + ebx * 4], eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovEAXStack(vm, 0);					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("F7 D8");					 // neg eax
+				EmitString("03 04 9F");					 // add eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_DIVI:
-				EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
-				EmitString("99");					// cdq
-				EmitString("F7 3C 9F");				// idiv dword ptr [edi + ebx * 4]
-				EmitString("89 44 9F FC");			// mov dword ptr -4[edi + ebx * 4],eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovECXStack(vm);
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("8B 04 9F");					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitString("99");						 // cdq
+				EmitString("F7 F9");					 // idiv ecx
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_DIVU:
-				EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
-				EmitString("33 D2");				// xor edx, edx
-				EmitString("F7 34 9F");				// div dword ptr [edi + ebx * 4]
-				EmitString("89 44 9F FC");			// mov dword ptr -4[edi + ebx * 4],eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovECXStack(vm);
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("8B 04 9F");					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitString("33 D2");					 // xor edx, edx
+				EmitString("F7 F1");					 // div ecx
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_MODI:
-				EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
-				EmitString("99");					// cdq
-				EmitString("F7 3C 9F");				// idiv dword ptr [edi + ebx * 4]
-				EmitString("89 54 9F FC");			// mov dword ptr -4[edi + ebx * 4],edx
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovECXStack(vm);
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("8B 04 9F");					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitString("99");						 // cdq
+				EmitString("F7 F9");					 // idiv ecx
+				EmitString("8B C2");					 // mov eax, edx
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_MODU:
-				EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
-				EmitString("33 D2");				// xor edx, edx
-				EmitString("F7 34 9F");				// div dword ptr [edi + ebx * 4]
-				EmitString("89 54 9F FC");			// mov dword ptr -4[edi + ebx * 4],edx
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovECXStack(vm);
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("8B 04 9F");					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitString("33 D2");					 // xor edx, edx
+				EmitString("F7 F1");					 // div ecx
+				EmitString("8B C2");					 // mov eax, edx
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_MULI:
-				EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
-				EmitString("F7 2C 9F");				// imul dword ptr [edi + ebx * 4]
-				EmitString("89 44 9F FC");			// mov dword ptr -4[edi + ebx * 4],eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovEAXStack(vm, 0);					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("0F AF 04 9F");				 // imul eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_MULU:
-				EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
-				EmitString("F7 24 9F");				// mul dword ptr [edi + ebx * 4]
-				EmitString("89 44 9F FC");			// mov dword ptr -4[edi + ebx * 4],eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovEAXStack(vm, 0);					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("0F AF 04 9F");				 // imul eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_BAND:
-				EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-				EmitString("21 44 9F FC");			// and dword ptr -4[edi + ebx * 4],eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovEAXStack(vm, 0);					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("23 04 9F");					 // and eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_BOR:
-				EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-				EmitString("09 44 9F FC");			// or dword ptr -4[edi + ebx * 4],eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovEAXStack(vm, 0);					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("0B 04 9F");					 // or eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_BXOR:
-				EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-				EmitString("31 44 9F FC");			// xor dword ptr -4[edi + ebx * 4],eax
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitMovEAXStack(vm, 0);					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("33 04 9F");					 // xor eax, dword ptr [edi + ebx * 4]
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_BCOM:
-				EmitString("F7 14 9F"); // not dword ptr [edi + ebx * 4]
+				EmitMovEAXStack(vm, 0);
+				EmitString("F7 D0"); // not eax
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX);
 				break;
 			case OP_LSH:
 				EmitMovECXStack(vm);
-				EmitString("D3 64 9F FC");			// shl dword ptr -4[edi + ebx * 4], cl
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("8B 04 9F");					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitString("D3 E0");					 // shl eax, cl
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_RSHI:
 				EmitMovECXStack(vm);
-				EmitString("D3 7C 9F FC");			// sar dword ptr -4[edi + ebx * 4], cl
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("8B 04 9F");					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitString("D3 F8");					 // sar eax, cl
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_RSHU:
 				EmitMovECXStack(vm);
-				EmitString("D3 6C 9F FC");			// shr dword ptr -4[edi + ebx * 4], cl
-				EmitCommand(LAST_COMMAND_SUB_BL_1); // sub bl, 1
+				EmitCommand(LAST_COMMAND_SUB_BL_1);		 // sub bl, 1
+				EmitString("8B 04 9F");					 // mov eax, dword ptr [edi + ebx * 4]
+				EmitString("D3 E8");					 // shr eax, cl
+				EmitCommand(LAST_COMMAND_MOV_STACK_EAX); // mov dword ptr [edi + ebx * 4], eax
 				break;
 			case OP_NEGF:
 				EmitString("D9 04 9F"); // fld dword ptr [edi + ebx * 4]
@@ -1539,7 +1989,13 @@ void VM_Compile(vm_t *vm, vmHeader_t *header) {
 	Z_Free(code);
 	Z_Free(buf);
 	Z_Free(jused);
+	Z_Free(addrKind);
+	Z_Free(addrValue);
 	Com_Printf("VM file %s compiled to %i bytes of code\n", vm->name, compiledOfs);
+	if (proveBounds) {
+		Com_Printf("%i of %i memory accesses proven in range\n", vm->numProvenAccesses,
+				   vm->numProvenAccesses + vm->numMaskedAccesses);
+	}
 
 	vm->destroy = VM_Destroy_Compiled;
 
@@ -37,8 +37,9 @@ void RE_LoadWorldMap( const char *name );
 
 */
 
-static world_t s_worldData;
-static byte	  *fileBase;
+static world_t	   s_worldData;
+static byte		  *fileBase;
+static const void *s_worldMapFile; // FS_MapFile image fileBase points into while loading
 
 int c_subdivisions;
 int c_gridVerts;
@@ -2090,13 +2091,13 @@ void R_LoadEntities(lump_t *l) {
 	w->lightGridSize[1] = 64;
 	w->lightGridSize[2] = 128;
 
-	p = (char *)(fileBase + l->fileofs);
-
-	// store for reference by the cgame
+	// store for reference by the cgame, a mapped lump isn't guaranteed to be terminated
 	w->entityString = ri.Hunk_Alloc(l->filelen + 1, h_low);
-	strcpy(w->entityString, p);
+	memcpy(w->entityString, fileBase + l->fileofs, l->filelen);
 	w->entityParsePoint = w->entityString;
 
+	p = w->entityString;
+
 	token = COM_ParseExt(&p, qtrue);
 	if (!*token || *token != '{') { return; }
 
@@ -2459,8 +2460,8 @@ Called directly from cgame
 =================
 */
 void RE_LoadWorldMap(const char *name) {
-	int		   i;
-	dheader_t *header;
+	int		  i;
+	dheader_t header;
 	union {
 		byte *b;
 		void *v;
@@ -2494,8 +2495,18 @@ void RE_LoadWorldMap(const char *name) {
 
 	tr.worldMapLoaded = qtrue;
 
-	// load it
-	ri.FS_ReadFile(name, &buffer.v);
+	// left over from a load that errored out
+	if (s_worldMapFile) {
+		ri.FS_UnmapFile(s_worldMapFile);
+		s_worldMapFile = NULL;
+	}
+
+	// load it, the collision code usually has the same image mapped already
+	if (ri.FS_MapFile(name, &s_worldMapFile) >= 0) {
+		buffer.v = (void *)s_worldMapFile;
+	} else {
+		ri.FS_ReadFile(name, &buffer.v);
+	}
 	if (!buffer.b) { ri.Error(ERR_DROP, "RE_LoadWorldMap: %s not found", name); }
 
 	// clear tr.world so if the level fails to load, the next
@@ -2511,29 +2522,30 @@ void RE_LoadWorldMap(const char *name) {
 	startMarker = ri.Hunk_Alloc(0, h_low);
 	c_gridVerts = 0;
 
-	header	 = (dheader_t *)buffer.b;
-	fileBase = (byte *)header;
-
-	i = LittleLong(header->version);
-	if (i != BSP_VERSION) {
-		ri.Error(ERR_DROP, "RE_LoadWorldMap: %s has wrong version number (%i should be %i)", name, i, BSP_VERSION);
-	}
+	// the file itself may be read only
+	header	 = *(dheader_t *)buffer.b;
+	fileBase = buffer.b;
 
 	// swap all the lumps
-	for (i = 0; i < sizeof(dheader_t) / 4; i++) { ((int *)header)[i] = LittleLong(((int *)header)[i]); }
+	for (i = 0; i < sizeof(dheader_t) / 4; i++) { ((int *)&header)[i] = LittleLong(((int *)&header)[i]); }
+
+	if (header.version != BSP_VERSION) {
+		ri.Error(ERR_DROP, "RE_LoadWorldMap: %s has wrong version number (%i should be %i)", name, header.version,
+				 BSP_VERSION);
+	}
 
 	// load into heap
-	R_LoadEntities(&header->lumps[LUMP_ENTITIES]);
-	R_LoadShaders(&header->lumps[LUMP_SHADERS]);
-	R_LoadLightmaps(&header->lumps[LUMP_LIGHTMAPS], &header->lumps[LUMP_SURFACES]);
-	R_LoadPlanes(&header->lumps[LUMP_PLANES]);
-	R_LoadFogs(&header->lumps[LUMP_FOGS], &header->lumps[LUMP_BRUSHES], &header->lumps[LUMP_BRUSHSIDES]);
-	R_LoadSurfaces(&header->lumps[LUMP_SURFACES], &header->lumps[LUMP_DRAWVERTS], &header->lumps[LUMP_DRAWINDEXES]);
-	R_LoadMarksurfaces(&header->lumps[LUMP_LEAFSURFACES]);
-	R_LoadNodesAndLeafs(&header->lumps[LUMP_NODES], &header->lumps[LUMP_LEAFS]);
-	R_LoadSubmodels(&header->lumps[LUMP_MODELS]);
-	R_LoadVisibility(&header->lumps[LUMP_VISIBILITY]);
-	R_LoadLightGrid(&header->lumps[LUMP_LIGHTGRID]);
+	R_LoadEntities(&header.lumps[LUMP_ENTITIES]);
+	R_LoadShaders(&header.lumps[LUMP_SHADERS]);
+	R_LoadLightmaps(&header.lumps[LUMP_LIGHTMAPS], &header.lumps[LUMP_SURFACES]);
+	R_LoadPlanes(&header.lumps[LUMP_PLANES]);
+	R_LoadFogs(&header.lumps[LUMP_FOGS], &header.lumps[LUMP_BRUSHES], &header.lumps[LUMP_BRUSHSIDES]);
+	R_LoadSurfaces(&header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS], &header.lumps[LUMP_DRAWINDEXES]);
+	R_LoadMarksurfaces(&header.lumps[LUMP_LEAFSURFACES]);
+	R_LoadNodesAndLeafs(&header.lumps[LUMP_NODES], &header.lumps[LUMP_LEAFS]);
+	R_LoadSubmodels(&header.lumps[LUMP_MODELS]);
+	R_LoadVisibility(&header.lumps[LUMP_VISIBILITY]);
+	R_LoadLightGrid(&header.lumps[LUMP_LIGHTGRID]);
 
 	// determine vertex light directions
 	R_CalcVertexLightDirs();
@@ -2732,5 +2744,11 @@ void RE_LoadWorldMap(const char *name) {
 		R_RenderMissingCubemaps();
 	}
 
-	ri.FS_FreeFile(buffer.v);
+	if (s_worldMapFile) {
+		ri.FS_UnmapFile(s_worldMapFile);
+		s_worldMapFile = NULL;
+	} else {
+		ri.FS_FreeFile(buffer.v);
+	}
+	fileBase = NULL;
 }
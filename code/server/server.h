@@ -48,16 +48,28 @@ typedef struct voipServerPacket_s {
 } voipServerPacket_t;
 #endif
 
+// links an entity into the list of entities touching a cluster
+typedef struct clusterLink_s {
+	struct clusterLink_s *prev, *next;
+	int					  cluster;
+	int					  entityNum;
+} clusterLink_t;
+
 typedef struct svEntity_s {
-	struct worldSector_s *worldSector;
-	struct svEntity_s	 *nextEntityInWorldSector;
+	struct entityNode_s *worldNode; // leaf in the entity tree, NULL if not linked
 
 	entityState_t baseline;	   // for delta compression of initial sighting
 	int			  numClusters; // if -1, use headnode instead
 	int			  clusternums[MAX_ENT_CLUSTERS];
 	int			  lastCluster; // if all the clusters don't fit in clusternums
 	int			  areanum, areanum2;
-	int			  snapshotCounter; // used to prevent double adding from portal views
+
+	clusterLink_t clusterLinks[MAX_ENT_CLUSTERS]; // into sv.clusterEntities
+	int			  numClusterLinks;
+
+	qboolean   leafsValid;		   // the clusters and areas above are for leafMins / leafMaxs
+	vec3_t	   leafMins, leafMaxs; // absmin / absmax of the last leaf lookup
+	leafCell_t leafCell;		   // where that lookup ended up in the tree
 } svEntity_t;
 
 typedef enum {
@@ -75,12 +87,29 @@ typedef struct {
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=475
 	// the serverId associated with the current checksumFeed (always <= serverId)
 	int		   checksumFeedServerId;
-	int		   snapshotCounter; // incremented for each snapshot built
 	int		   timeResidual;	// <= 1000 / sv_frame->value
 	int		   nextFrameTime;	// when time > nextFrameTime, process world
 	char	  *configstrings[MAX_CONFIGSTRINGS];
 	svEntity_t svEntities[MAX_GENTITIES];
 
+	// linked entities indexed by the PVS clusters they touch, so snapshots
+	// only have to look at entities in clusters the client can see
+	int			   numClusters;
+	clusterLink_t **clusterEntities;					 // [numClusters]
+	byte			unclusteredEntities[MAX_GENTITIES / 8]; // not in the cluster lists, always tested
+	byte			broadcastEntities[MAX_GENTITIES / 8];	// SVF_BROADCAST, rebuilt before snapshots
+
+	// the configstrings and baselines part of the gamestate message, encoded
+	// once and copied into every client's gamestate until one of them changes
+	qboolean gamestateCached;
+	int		 gamestateBits;
+	byte	 gamestateData[MAX_MSGLEN];
+
+	// configstrings changed since the active clients were last sent them
+	qboolean configstringPending[MAX_CONFIGSTRINGS];
+	int		 numConfigstringsPending;
+	qboolean flushingConfigstrings;
+
 	char *entityParsePoint; // used during game VM init
 
 	// the game virtual machine will update these on init and changes
@@ -240,6 +269,9 @@ typedef struct {
 	netadr_t authorizeAddress; // authorize server address
 #endif
 	int masterResolveTime[MAX_MASTER_SERVERS]; // next svs.time that server should do dns lookup for master server
+
+	int		configstringUpdatesSuppressed; // overwritten before they were sent, see SV_FlushConfigstrings
+	int64_t configstringBytesSaved;
 } serverStatic_t;
 
 #define SERVER_MAXBANS 1024
@@ -285,6 +317,12 @@ extern cvar_t *sv_gametype;
 extern cvar_t *sv_pure;
 extern cvar_t *sv_floodProtect;
 extern cvar_t *sv_lanForceRate;
+extern cvar_t *sv_snapshotThreads;
+extern cvar_t *sv_deltaCache;
+extern cvar_t *sv_traceCache;
+extern cvar_t *sv_httpServer;
+extern cvar_t *sv_httpPort;
+extern cvar_t *sv_httpAddress;
 #ifndef STANDALONE
 extern cvar_t *sv_strictAuth;
 #endif
@@ -317,13 +355,16 @@ struct leakyBucket_s {
 
 	long hash;
 
-	leakyBucket_t *prev, *next;
+	leakyBucket_t *prev, *next;		// hash chain
+	leakyBucket_t *older, *newer;	// least recently used order
 };
 
 extern leakyBucket_t outboundLeakyBucket;
 
 qboolean SVC_RateLimit(leakyBucket_t *bucket, int burst, int period);
 qboolean SVC_RateLimitAddress(netadr_t from, int burst, int period);
+void	 SV_InvalidateQueryCache(void);
+void	 SV_QueryCacheStats_f(void);
 
 void	   SV_FinalMessage(char *message);
 void QDECL SV_SendServerCommand(client_t *cl, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
@@ -340,6 +381,8 @@ int	 SV_RateMsec(client_t *client);
 void SV_SetConfigstring(int index, const char *val);
 void SV_GetConfigstring(int index, char *buffer, int bufferSize);
 void SV_UpdateConfigstrings(client_t *client);
+void SV_FlushConfigstrings(void);
+void SV_ConfigstringStats_f(void);
 
 void SV_SetUserinfo(int index, const char *val);
 void SV_GetUserinfo(int index, char *buffer, int bufferSize);
@@ -386,6 +429,14 @@ void SV_WriteFrameToClient(client_t *client, msg_t *msg);
 void SV_SendMessageToClient(msg_t *msg, client_t *client);
 void SV_SendClientMessages(void);
 void SV_SendClientSnapshot(client_t *client);
+void SV_DeltaCacheStats_f(void);
+
+//
+// sv_http.c
+//
+void SV_HttpUpdate(void);
+void SV_HttpShutdown(void);
+void SV_HttpStatus_f(void);
 
 //
 // sv_game.c
@@ -399,6 +450,7 @@ void			SV_InitGameProgs(void);
 void			SV_ShutdownGameProgs(void);
 void			SV_RestartGameProgs(void);
 qboolean		SV_inPVS(const vec3_t p1, const vec3_t p2);
+void			SV_GameBench_f(void);
 
 //
 // sv_bot.c
@@ -440,6 +492,7 @@ void SV_LinkEntity(sharedEntity_t *ent);
 clipHandle_t SV_ClipHandleForEntity(const sharedEntity_t *ent);
 
 void SV_SectorList_f(void);
+void SV_TraceCacheStats_f(void);
 
 int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount);
 // fills in a table of entity numbers with entities that have bounding boxes
@@ -464,6 +517,10 @@ void SV_Trace(trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, co
 
 // passEntityNum is explicitly excluded from clipping checks (normally ENTITYNUM_NONE)
 
+void SV_TraceBatch(trace_t *results, const traceRay_t *rays, int numRays, int passEntityNum, int contentmask,
+				   int capsule);
+// SV_Trace for every ray, the world and the entity lookup are shared
+
 void SV_ClipToEntity(trace_t *trace, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
 					 int entityNum, int contentmask, int capsule);
 // clip to a specific entity
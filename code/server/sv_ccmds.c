@@ -1366,6 +1366,12 @@ void SV_AddOperatorCommands(void) {
 	Cmd_AddCommand("dumpuser", SV_DumpUser_f);
 	Cmd_AddCommand("map_restart", SV_MapRestart_f);
 	Cmd_AddCommand("sectorlist", SV_SectorList_f);
+	Cmd_AddCommand("tracecachestats", SV_TraceCacheStats_f);
+	Cmd_AddCommand("deltacachestats", SV_DeltaCacheStats_f);
+	Cmd_AddCommand("gamebench", SV_GameBench_f);
+	Cmd_AddCommand("configstringstats", SV_ConfigstringStats_f);
+	Cmd_AddCommand("querycachestats", SV_QueryCacheStats_f);
+	Cmd_AddCommand("httpstatus", SV_HttpStatus_f);
 	Cmd_AddCommand("map", SV_Map_f);
 	Cmd_SetCommandCompletionFunc("map", SV_CompleteMapName);
 #ifndef PRE_RELEASE_DEMO
@@ -639,6 +639,57 @@ void SV_DropClient(client_t *drop, const char *reason) {
 	if (i == sv_maxclients->integer) { SV_Heartbeat_f(); }
 }
 
+/*
+================
+SV_WriteGamestateBody
+
+Writes the configstrings and baselines, which are the same for every client
+================
+*/
+static void SV_WriteGamestateBody(msg_t *msg) {
+	int			   start;
+	entityState_t *base, nullstate;
+
+	// write the configstrings
+	for (start = 0; start < MAX_CONFIGSTRINGS; start++) {
+		if (sv.configstrings[start][0]) {
+			MSG_WriteByte(msg, svc_configstring);
+			MSG_WriteShort(msg, start);
+			MSG_WriteBigString(msg, sv.configstrings[start]);
+		}
+	}
+
+	// write the baselines
+	memset(&nullstate, 0, sizeof(nullstate));
+	for (start = 0; start < MAX_GENTITIES; start++) {
+		base = &sv.svEntities[start].baseline;
+		if (!base->number) { continue; }
+		MSG_WriteByte(msg, svc_baseline);
+		MSG_WriteDeltaEntity(msg, &nullstate, base, qtrue);
+	}
+
+	MSG_WriteByte(msg, svc_EOF);
+}
+
+/*
+================
+SV_CacheGamestateBody
+
+Encodes the gamestate body once for all the clients that connect or
+restart before the next configstring or baseline change
+================
+*/
+static void SV_CacheGamestateBody(void) {
+	msg_t msg;
+
+	MSG_Init(&msg, sv.gamestateData, sizeof(sv.gamestateData));
+	SV_WriteGamestateBody(&msg);
+
+	// an overflowed body is written out for each client like it used to be
+	sv.gamestateBits   = msg.bit;
+	sv.gamestateCached = !msg.overflowed;
+}
+
 /*
 ================
 SV_SendClientGameState
@@ -651,10 +702,8 @@ the wrong gamestate.
 ================
 */
 static void SV_SendClientGameState(client_t *client) {
-	int			   start;
-	entityState_t *base, nullstate;
-	msg_t		   msg;
-	byte		   msgBuffer[MAX_MSGLEN];
+	msg_t msg;
+	byte  msgBuffer[MAX_MSGLEN];
 
 	Com_DPrintf("SV_SendClientGameState() for %s\n", client->name);
 	Com_DPrintf("Going from CS_CONNECTED to CS_PRIMED for %s\n", client->name);
@@ -683,26 +732,14 @@ static void SV_SendClientGameState(client_t *client) {
 	MSG_WriteByte(&msg, svc_gamestate);
 	MSG_WriteLong(&msg, client->reliableSequence);
 
-	// write the configstrings
-	for (start = 0; start < MAX_CONFIGSTRINGS; start++) {
-		if (sv.configstrings[start][0]) {
-			MSG_WriteByte(&msg, svc_configstring);
-			MSG_WriteShort(&msg, start);
-			MSG_WriteBigString(&msg, sv.configstrings[start]);
-		}
-	}
-
-	// write the baselines
-	memset(&nullstate, 0, sizeof(nullstate));
-	for (start = 0; start < MAX_GENTITIES; start++) {
-		base = &sv.svEntities[start].baseline;
-		if (!base->number) { continue; }
-		MSG_WriteByte(&msg, svc_baseline);
-		MSG_WriteDeltaEntity(&msg, &nullstate, base, qtrue);
+	// the configstrings and baselines
+	if (!sv.gamestateCached) { SV_CacheGamestateBody(); }
+	if (sv.gamestateCached) {
+		MSG_WriteBitString(&msg, sv.gamestateData, sv.gamestateBits);
+	} else {
+		SV_WriteGamestateBody(&msg);
 	}
 
-	MSG_WriteByte(&msg, svc_EOF);
-
 	MSG_WriteLong(&msg, client - svs.clients);
 
 	// write the checksum feed
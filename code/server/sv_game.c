@@ -281,6 +281,12 @@ intptr_t SV_GameSystemCalls(intptr_t *args) {
 	case G_FS_FCLOSE_FILE: FS_FCloseFile(args[1]); return 0;
 	case G_FS_GETFILELIST: return FS_GetFileList(VMA(1), VMA(2), VMA(3), args[4]);
 	case G_FS_SEEK: return FS_Seek(args[1], args[2], args[3]);
+	case G_TRACEBATCH:
+		if (args[3] < 0 || args[3] > MAX_TRACE_BATCH) {
+			Com_Error(ERR_DROP, "G_TRACEBATCH: bad ray count %i", (int)args[3]);
+		}
+		SV_TraceBatch(VMA(1), VMA(2), args[3], args[4], args[5], /*int capsule*/ qfalse);
+		return 0;
 
 	case G_LOCATE_GAME_DATA: SV_LocateGameData(VMA(1), args[2], args[3], VMA(4), args[5]); return 0;
 	case G_DROP_CLIENT: SV_GameDropClient(args[1], VMA(2)); return 0;
@@ -551,6 +557,75 @@ intptr_t SV_GameSystemCalls(intptr_t *args) {
 	return 0;
 }
 
+/*
+==============================================================================
+
+DIRECT IMPORTS
+
+The hottest syscalls of a native game, called through a table instead of
+being packed into an argument array and switched on in SV_GameSystemCalls.
+
+==============================================================================
+*/
+
+static void SV_GameTrace(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
+						 int passEntityNum, int contentmask) {
+	SV_Trace(results, start, (float *)mins, (float *)maxs, end, passEntityNum, contentmask, /*int capsule*/ qfalse);
+}
+
+static void SV_GameTraceCapsule(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs,
+								const vec3_t end, int passEntityNum, int contentmask) {
+	SV_Trace(results, start, (float *)mins, (float *)maxs, end, passEntityNum, contentmask, /*int capsule*/ qtrue);
+}
+
+static void SV_GameTraceBatch(trace_t *results, const traceRay_t *rays, int numRays, int passEntityNum,
+							  int contentmask) {
+	if (numRays < 0 || numRays > MAX_TRACE_BATCH) { Com_Error(ERR_DROP, "G_TRACEBATCH: bad ray count %i", numRays); }
+	SV_TraceBatch(results, rays, numRays, passEntityNum, contentmask, /*int capsule*/ qfalse);
+}
+
+static qboolean SV_GameEntityContact(const vec3_t mins, const vec3_t maxs, const sharedEntity_t *ent) {
+	return SV_EntityContact((float *)mins, (float *)maxs, ent, /*int capsule*/ qfalse);
+}
+
+/*
+===============
+SV_BindGameImports
+
+Filled in again for every load, the botlib may not be there
+===============
+*/
+static void SV_BindGameImports(void) {
+	static gameImports_t imports;
+
+	if (!botlib_export) { return; }
+
+	imports.version		  = GAME_IMPORT_VERSION;
+	imports.Trace		  = SV_GameTrace;
+	imports.TraceCapsule  = SV_GameTraceCapsule;
+	imports.TraceBatch	  = SV_GameTraceBatch;
+	imports.PointContents = SV_PointContents;
+	imports.InPVS		  = SV_inPVS;
+	imports.LinkEntity	  = SV_LinkEntity;
+	imports.UnlinkEntity  = SV_UnlinkEntity;
+	imports.EntitiesInBox = SV_AreaEntities;
+	imports.EntityContact = SV_GameEntityContact;
+
+	imports.AAS_PointAreaNum			 = botlib_export->aas.AAS_PointAreaNum;
+	imports.AAS_TraceAreas				 = botlib_export->aas.AAS_TraceAreas;
+	imports.AAS_BBoxAreas				 = botlib_export->aas.AAS_BBoxAreas;
+	imports.AAS_AreaInfo				 = botlib_export->aas.AAS_AreaInfo;
+	imports.AAS_PointContents			 = botlib_export->aas.AAS_PointContents;
+	imports.AAS_AreaReachability		 = botlib_export->aas.AAS_AreaReachability;
+	imports.AAS_AreaTravelTimeToGoalArea = botlib_export->aas.AAS_AreaTravelTimeToGoalArea;
+	imports.AAS_EnableRoutingArea		 = botlib_export->aas.AAS_EnableRoutingArea;
+	imports.AAS_PresenceTypeBoundingBox	 = botlib_export->aas.AAS_PresenceTypeBoundingBox;
+	imports.AAS_Time					 = botlib_export->aas.AAS_Time;
+	imports.AAS_Swimming				 = botlib_export->aas.AAS_Swimming;
+
+	VM_BindImports(gvm, GAME_IMPORT_VERSION, &imports);
+}
+
 /*
 ===============
 SV_ShutdownGameProgs
@@ -584,6 +659,9 @@ static void SV_InitGameVM(qboolean restart) {
 	//   now done before GAME_INIT call
 	for (i = 0; i < sv_maxclients->integer; i++) { svs.clients[i].gentity = NULL; }
 
+	// a restarted native module is a freshly loaded dll
+	SV_BindGameImports();
+
 	// use the current msec count for a random seed
 	// init for this gamestate
 	VM_Call(gvm, GAME_INIT, sv.time, Com_Milliseconds(), restart);
@@ -633,6 +711,84 @@ void SV_InitGameProgs(void) {
 	SV_InitGameVM(qfalse);
 }
 
+/*
+====================
+SV_GameBench_f
+
+Runs the game and bot frames back to back without sending anything to the
+clients and reports the time per frame. The last result of each vm_game mode
+is kept, so loading the map again with another vm_game gives a comparison of
+the QVM against the native library under the same bot load.
+
+Only runs without remote players, and restarts the map afterwards because
+the game has seen its clock run ahead of everyone else's.
+====================
+*/
+#define GAMEBENCH_DEFAULT_FRAMES 1000
+#define GAMEBENCH_MAX_FRAMES	 10000
+
+void SV_GameBench_f(void) {
+	static float	   msecPerFrame[VMI_COMPILED + 1];
+	static const char *modeNames[VMI_COMPILED + 1] = {"native", "interpreted", "compiled"};
+	vmInterpret_t	   mode;
+	client_t		  *cl;
+	int				   i, frames, frameMsec, bots, start, msec, time;
+
+	if (sv.state != SS_GAME || !gvm) {
+		Com_Printf("Server is not running.\n");
+		return;
+	}
+
+	frames = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : GAMEBENCH_DEFAULT_FRAMES;
+	if (frames < 1) {
+		frames = 1;
+	} else if (frames > GAMEBENCH_MAX_FRAMES) {
+		frames = GAMEBENCH_MAX_FRAMES;
+	}
+
+	bots = 0;
+	for (i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++) {
+		if (cl->state < CS_CONNECTED) { continue; }
+		if (cl->netchan.remoteAddress.type == NA_BOT) {
+			bots++;
+		} else if (cl->netchan.remoteAddress.type != NA_LOOPBACK) {
+			Com_Printf("gamebench can't run with remote players connected.\n");
+			return;
+		}
+	}
+
+	frameMsec = sv_fps->integer > 0 ? 1000 / sv_fps->integer : 100;
+	if (frameMsec < 1) { frameMsec = 1; }
+
+	// only the game clock moves, svs.time is left alone so the local client doesn't time out
+	time  = sv.time;
+	start = Sys_Milliseconds();
+	for (i = 0; i < frames; i++) {
+		SV_BotFrame(sv.time);
+		sv.time += frameMsec;
+		VM_Call(gvm, GAME_RUN_FRAME, sv.time);
+	}
+	msec = Sys_Milliseconds() - start;
+
+	// snapshots go out on the old clock again, and the level starts over
+	// so the game doesn't see time go backwards
+	sv.time = time;
+	Cbuf_AddText("map_restart 0\n");
+
+	mode			  = VM_Interpreter(gvm);
+	msecPerFrame[mode] = (float)msec / frames;
+
+	Com_Printf("%i frames with %i bots, %s game: %i msec, %.3f msec/frame\n", frames, bots, modeNames[mode], msec,
+			   msecPerFrame[mode]);
+
+	if (mode != VMI_NATIVE && msecPerFrame[VMI_NATIVE] > 0) {
+		Com_Printf("%s is %.2fx the native frame time\n", modeNames[mode],
+				   msecPerFrame[mode] / msecPerFrame[VMI_NATIVE]);
+	} else if (mode == VMI_NATIVE && msecPerFrame[VMI_COMPILED] > 0) {
+		Com_Printf("compiled was %.2fx the native frame time\n", msecPerFrame[VMI_COMPILED] / msecPerFrame[mode]);
+	}
+}
+
 /*
 ====================
 SV_GameCommand
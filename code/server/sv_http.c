@@ -0,0 +1,773 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_http.c -- serves the referenced pk3s over HTTP for sv_dlURL downloads
+
+#include "server.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <io.h>
+
+typedef u_long ioctlarg_t;
+#define socketError		 WSAGetLastError()
+#define socketWouldBlock (WSAGetLastError() == WSAEWOULDBLOCK)
+
+#else
+
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR   -1
+#define closesocket	   close
+#define ioctlsocket	   ioctl
+typedef int ioctlarg_t;
+#define socketError		 errno
+#define socketWouldBlock (errno == EAGAIN || errno == EWOULDBLOCK)
+
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#define HTTP_SENDFILE // zero copy transmission
+#endif
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/*
+==============================================================================
+
+A small HTTP/1.1 server running on its own thread, so that clients with
+cl_allowDownload redirection can fetch the server's pk3s through cURL
+instead of through the game netchan.
+
+Only the pk3s listed by FS_ReferencedPakNames are served, minus the id
+paks, under the same "gamedir/name.pk3" path the client appends to
+sv_dlURL.  The main thread publishes that list on every map change; the
+HTTP thread never touches the filesystem code, only the full paths it
+was handed.  GET and HEAD are supported, with single byte ranges so
+interrupted downloads can resume.  Every connection is closed after its
+response.
+
+Try it with:  curl -v -r 100-199 http://localhost:27960/baseq3/map.pk3
+
+==============================================================================
+*/
+
+#define HTTP_MAX_CONNECTIONS 32
+#define HTTP_REQUEST_SIZE	 2048
+#define HTTP_HEADER_SIZE	 512
+#define HTTP_CHUNK_SIZE		 65536
+#define HTTP_TIMEOUT		 30000 // msec without progress before a connection is dropped
+
+typedef struct {
+	char name[MAX_QPATH];	 // "gamedir/name.pk3"
+	char ospath[MAX_OSPATH]; // where FS loaded it from
+} httpFile_t;
+
+typedef enum {
+	HTTP_FREE,
+	HTTP_REQUEST, // reading the request headers
+	HTTP_RESPONSE // sending the response header and body
+} httpState_t;
+
+typedef struct {
+	httpState_t state;
+	SOCKET		socket;
+	int			lastActivity;
+
+	char request[HTTP_REQUEST_SIZE];
+	int	 requestLength;
+
+	char header[HTTP_HEADER_SIZE];
+	int	 headerLength;
+	int	 headerSent;
+
+	int	 file; // -1 if there is no body to send
+	long offset;
+	long end; // one past the last byte to send
+} httpConnection_t;
+
+typedef struct {
+	qboolean  running;
+	pthread_t thread;
+	atomic_int quit;
+
+	SOCKET listenSocket;
+	int	   port;
+	char   url[MAX_CVAR_VALUE_STRING]; // what we put in sv_dlURL, if anything
+
+	pthread_mutex_t filesLock; // guards files and numFiles
+	httpFile_t	   *files;
+	int				numFiles;
+
+	httpConnection_t connections[HTTP_MAX_CONNECTIONS];
+
+	atomic_int		 requests;
+	atomic_int		 activeConnections;
+	atomic_llong	 bytesSent;
+} httpServer_t;
+
+static httpServer_t http = {.listenSocket = INVALID_SOCKET};
+
+/*
+==============================================================================
+
+HTTP THREAD
+
+Nothing in here may call into the rest of the engine, see sys_thread.c.
+Sys_Milliseconds and the q_shared string helpers are fine.
+
+==============================================================================
+*/
+
+/*
+=================
+SV_HttpSetNonBlocking
+=================
+*/
+static qboolean SV_HttpSetNonBlocking(SOCKET s) {
+	ioctlarg_t _true = 1;
+
+	return ioctlsocket(s, FIONBIO, &_true) != SOCKET_ERROR;
+}
+
+/*
+=================
+SV_HttpCloseConnection
+=================
+*/
+static void SV_HttpCloseConnection(httpConnection_t *conn) {
+	if (conn->file >= 0) { close(conn->file); }
+	closesocket(conn->socket);
+
+	conn->state	 = HTTP_FREE;
+	conn->socket = INVALID_SOCKET;
+	conn->file	 = -1;
+	atomic_fetch_sub(&http.activeConnections, 1);
+}
+
+/*
+=================
+SV_HttpSetResponse
+
+Queues a response header, with an empty body unless a file is attached later
+=================
+*/
+static void SV_HttpSetResponse(httpConnection_t *conn, const char *status, const char *extraHeaders,
+							   long contentLength) {
+	Com_sprintf(conn->header, sizeof(conn->header),
+				"HTTP/1.1 %s\r\n"
+				"Server: " Q3_VERSION "\r\n"
+				"Content-Length: %ld\r\n"
+				"Connection: close\r\n"
+				"%s"
+				"\r\n",
+				status, contentLength, extraHeaders);
+
+	conn->state		   = HTTP_RESPONSE;
+	conn->headerLength = strlen(conn->header);
+	conn->headerSent   = 0;
+	conn->offset = conn->end = 0;
+}
+
+/*
+=================
+SV_HttpDecodePath
+
+Strips the leading slash and any query string, and undoes percent escapes
+=================
+*/
+static qboolean SV_HttpDecodePath(const char *target, char *path, int size) {
+	int	 length = 0;
+	char hex[3] = {0};
+
+	if (*target != '/') { return qfalse; }
+	target++;
+
+	while (*target && *target != '?' && *target != '#') {
+		char c = *target++;
+
+		if (c == '%') {
+			if (!isxdigit(target[0]) || !isxdigit(target[1])) { return qfalse; }
+			hex[0] = target[0];
+			hex[1] = target[1];
+			c	   = (char)strtol(hex, NULL, 16);
+			target += 2;
+		}
+
+		if (!c || length >= size - 1) { return qfalse; }
+		path[length++] = c;
+	}
+	path[length] = 0;
+
+	return length > 0;
+}
+
+/*
+=================
+SV_HttpFindFile
+
+Copies out the full path of a published pk3
+=================
+*/
+static qboolean SV_HttpFindFile(const char *name, char *ospath, int size) {
+	qboolean found = qfalse;
+	int		 i;
+
+	pthread_mutex_lock(&http.filesLock);
+	for (i = 0; i < http.numFiles; i++) {
+		if (!Q_stricmp(http.files[i].name, name)) {
+			Q_strncpyz(ospath, http.files[i].ospath, size);
+			found = qtrue;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&http.filesLock);
+
+	return found;
+}
+
+/*
+=================
+SV_HttpParseRange
+
+Parses a single "bytes=" range against the file size.  Returns qfalse if
+the range can't be satisfied; anything we don't understand, such as a
+list of ranges, leaves the full file selected.
+=================
+*/
+static qboolean SV_HttpParseRange(const char *range, long size, long *start, long *end) {
+	char *p;
+	long  first, last;
+
+	*start = 0;
+	*end   = size;
+
+	while (*range == ' ') range++;
+	// range points into the whole request, the list can't go past its own line
+	if (Q_stricmpn(range, "bytes=", 6) || memchr(range, ',', strcspn(range, "\r\n"))) { return qtrue; }
+	range += 6;
+
+	if (*range == '-') {
+		// the last n bytes
+		last = strtol(range + 1, &p, 10);
+		if (p == range + 1 || last <= 0) { return qfalse; }
+		*start = last < size ? size - last : 0;
+		return size > 0;
+	}
+
+	first = strtol(range, &p, 10);
+	if (p == range || *p != '-' || first < 0) { return qtrue; }
+	range = p + 1;
+
+	if (isdigit(*range)) {
+		last = strtol(range, &p, 10);
+		if (last < first) { return qtrue; }
+		if (last < size) { *end = last + 1; }
+	}
+
+	if (first >= size) { return qfalse; }
+	*start = first;
+
+	return qtrue;
+}
+
+/*
+=================
+SV_HttpHandleRequest
+
+Called once the request headers are complete
+=================
+*/
+static void SV_HttpHandleRequest(httpConnection_t *conn) {
+	char		method[16], target[MAX_OSPATH], path[MAX_QPATH], ospath[MAX_OSPATH];
+	char		extra[256];
+	char	   *line, *range;
+	qboolean	head;
+	struct stat st;
+	long		start, end;
+	int			file;
+
+	atomic_fetch_add(&http.requests, 1);
+
+	if (sscanf(conn->request, "%15s %255s", method, target) != 2) {
+		SV_HttpSetResponse(conn, "400 Bad Request", "", 0);
+		return;
+	}
+
+	head = !strcmp(method, "HEAD");
+	if (!head && strcmp(method, "GET")) {
+		SV_HttpSetResponse(conn, "405 Method Not Allowed", "Allow: GET, HEAD\r\n", 0);
+		return;
+	}
+
+	if (!SV_HttpDecodePath(target, path, sizeof(path)) || !SV_HttpFindFile(path, ospath, sizeof(ospath))) {
+		SV_HttpSetResponse(conn, "404 Not Found", "", 0);
+		return;
+	}
+
+	file = open(ospath, O_RDONLY | O_BINARY);
+	if (file < 0 || fstat(file, &st) < 0) {
+		if (file >= 0) { close(file); }
+		SV_HttpSetResponse(conn, "404 Not Found", "", 0);
+		return;
+	}
+
+	// look for a Range header
+	range = NULL;
+	for (line = strstr(conn->request, "\r\n"); line; line = strstr(line, "\r\n")) {
+		line += 2;
+		if (!Q_stricmpn(line, "Range:", 6)) {
+			range = line + 6;
+			break;
+		}
+	}
+
+	if (range && !SV_HttpParseRange(range, st.st_size, &start, &end)) {
+		close(file);
+		Com_sprintf(extra, sizeof(extra), "Content-Range: bytes */%ld\r\n", (long)st.st_size);
+		SV_HttpSetResponse(conn, "416 Range Not Satisfiable", extra, 0);
+		return;
+	}
+
+	if (range && (start > 0 || end < st.st_size)) {
+		Com_sprintf(extra, sizeof(extra),
+					"Content-Type: application/octet-stream\r\n"
+					"Accept-Ranges: bytes\r\n"
+					"Content-Range: bytes %ld-%ld/%ld\r\n",
+					start, end - 1, (long)st.st_size);
+		SV_HttpSetResponse(conn, "206 Partial Content", extra, end - start);
+	} else {
+		start = 0;
+		end	  = st.st_size;
+		SV_HttpSetResponse(conn, "200 OK",
+						   "Content-Type: application/octet-stream\r\n"
+						   "Accept-Ranges: bytes\r\n",
+						   end);
+	}
+
+	if (head) {
+		close(file);
+		return;
+	}
+
+	conn->file	 = file;
+	conn->offset = start;
+	conn->end	 = end;
+}
+
+/*
+=================
+SV_HttpReadRequest
+
+Returns qfalse if the connection should be closed
+=================
+*/
+static qboolean SV_HttpReadRequest(httpConnection_t *conn) {
+	int ret;
+
+	ret = recv(conn->socket, conn->request + conn->requestLength, sizeof(conn->request) - 1 - conn->requestLength, 0);
+	if (ret == SOCKET_ERROR) { return socketWouldBlock; }
+	if (ret == 0) { return qfalse; }
+
+	conn->requestLength += ret;
+	conn->request[conn->requestLength] = 0;
+
+	if (strstr(conn->request, "\r\n\r\n")) {
+		SV_HttpHandleRequest(conn);
+	} else if (conn->requestLength >= sizeof(conn->request) - 1) {
+		SV_HttpSetResponse(conn, "431 Request Header Fields Too Large", "", 0);
+	}
+
+	return qtrue;
+}
+
+/*
+=================
+SV_HttpWriteResponse
+
+Returns qfalse once the response is finished or the connection failed
+=================
+*/
+static qboolean SV_HttpWriteResponse(httpConnection_t *conn) {
+	long ret;
+
+	if (conn->headerSent < conn->headerLength) {
+		ret = send(conn->socket, conn->header + conn->headerSent, conn->headerLength - conn->headerSent, 0);
+		if (ret == SOCKET_ERROR) { return socketWouldBlock; }
+
+		conn->headerSent += ret;
+		return conn->headerSent < conn->headerLength || conn->offset < conn->end;
+	}
+
+	if (conn->file < 0 || conn->offset >= conn->end) { return qfalse; }
+
+#ifdef HTTP_SENDFILE
+	{
+		off_t offset = conn->offset;
+
+		ret = sendfile(conn->socket, conn->file, &offset, MIN(conn->end - conn->offset, HTTP_CHUNK_SIZE));
+		if (ret < 0) { return errno == EAGAIN; }
+		if (ret == 0) { return qfalse; } // the file shrank under us
+	}
+#else
+	{
+		static char buffer[HTTP_CHUNK_SIZE];
+		long		length;
+
+		if (lseek(conn->file, conn->offset, SEEK_SET) < 0) { return qfalse; }
+		length = read(conn->file, buffer, MIN(conn->end - conn->offset, HTTP_CHUNK_SIZE));
+		if (length <= 0) { return qfalse; }
+
+		ret = send(conn->socket, buffer, length, 0);
+		if (ret == SOCKET_ERROR) { return socketWouldBlock; }
+	}
+#endif
+
+	conn->offset += ret;
+	atomic_fetch_add(&http.bytesSent, ret);
+
+	return conn->offset < conn->end;
+}
+
+/*
+=================
+SV_HttpAccept
+=================
+*/
+static void SV_HttpAccept(int now) {
+	httpConnection_t *conn;
+	SOCKET			  s;
+	int				  i;
+
+	while ((s = accept(http.listenSocket, NULL, NULL)) != INVALID_SOCKET) {
+		for (i = 0, conn = http.connections; i < HTTP_MAX_CONNECTIONS; i++, conn++) {
+			if (conn->state == HTTP_FREE) { break; }
+		}
+
+		if (i == HTTP_MAX_CONNECTIONS || !SV_HttpSetNonBlocking(s)) {
+			closesocket(s);
+			continue;
+		}
+
+		conn->state			= HTTP_REQUEST;
+		conn->socket		= s;
+		conn->lastActivity	= now;
+		conn->requestLength = 0;
+		conn->file			= -1;
+		atomic_fetch_add(&http.activeConnections, 1);
+	}
+}
+
+/*
+=================
+SV_HttpThread
+=================
+*/
+static void *SV_HttpThread(void *arg) {
+	httpConnection_t *conn;
+	fd_set			  readSet, writeSet;
+	struct timeval	  timeout;
+	SOCKET			  highest;
+	int				  i, now;
+	qboolean		  alive;
+
+	while (!atomic_load(&http.quit)) {
+		FD_ZERO(&readSet);
+		FD_ZERO(&writeSet);
+		FD_SET(http.listenSocket, &readSet);
+		highest = http.listenSocket;
+
+		for (i = 0, conn = http.connections; i < HTTP_MAX_CONNECTIONS; i++, conn++) {
+			if (conn->state == HTTP_FREE) { continue; }
+
+			FD_SET(conn->socket, conn->state == HTTP_REQUEST ? &readSet : &writeSet);
+			if (conn->socket > highest) { highest = conn->socket; }
+		}
+
+		// wake up regularly to notice the quit flag
+		timeout.tv_sec	= 0;
+		timeout.tv_usec = 250000;
+		if (select(highest + 1, &readSet, &writeSet, NULL, &timeout) == SOCKET_ERROR) { continue; }
+
+		now = Sys_Milliseconds();
+
+		if (FD_ISSET(http.listenSocket, &readSet)) { SV_HttpAccept(now); }
+
+		for (i = 0, conn = http.connections; i < HTTP_MAX_CONNECTIONS; i++, conn++) {
+			if (conn->state == HTTP_FREE) { continue; }
+
+			alive = qtrue;
+			if (conn->state == HTTP_REQUEST && FD_ISSET(conn->socket, &readSet)) {
+				alive			   = SV_HttpReadRequest(conn);
+				conn->lastActivity = now;
+			} else if (conn->state == HTTP_RESPONSE && FD_ISSET(conn->socket, &writeSet)) {
+				alive			   = SV_HttpWriteResponse(conn);
+				conn->lastActivity = now;
+			} else if (now - conn->lastActivity > HTTP_TIMEOUT) {
+				alive = qfalse;
+			}
+
+			if (!alive) { SV_HttpCloseConnection(conn); }
+		}
+	}
+
+	for (i = 0, conn = http.connections; i < HTTP_MAX_CONNECTIONS; i++, conn++) {
+		if (conn->state != HTTP_FREE) { SV_HttpCloseConnection(conn); }
+	}
+
+	return NULL;
+}
+
+/*
+==============================================================================
+
+MAIN THREAD
+
+==============================================================================
+*/
+
+/*
+=================
+SV_HttpPublishFiles
+
+Hands the HTTP thread the list of pk3s clients may download
+=================
+*/
+static void SV_HttpPublishFiles(void) {
+	const char *referenced = FS_ReferencedPakNames();
+	const char *s;
+	httpFile_t *files, *old;
+	httpFile_t *file;
+	char		pakName[MAX_QPATH];
+	int			count, length;
+
+	// one entry per space separated name, at most
+	for (count = 1, s = referenced; *s; s++) {
+		if (*s == ' ') { count++; }
+	}
+	files = Z_Malloc(count * sizeof(*files));
+
+	for (count = 0, s = referenced; *s;) {
+		while (*s == ' ') s++;
+		for (length = 0; s[length] && s[length] != ' '; length++) {}
+		if (!length) { break; }
+
+		Q_strncpyz(pakName, s, MIN(length + 1, sizeof(pakName)));
+		s += length;
+
+		// same rule as SV_WriteDownloadToClient
+#ifndef STANDALONE
+		if (FS_idPak(pakName, BASETA, NUM_TA_PAKS)) { continue; }
+#endif
+		if (FS_idPak(pakName, BASEGAME, NUM_ID_PAKS)) { continue; }
+
+		file = &files[count];
+		if (!FS_PakOSPath(pakName, file->ospath, sizeof(file->ospath))) { continue; }
+		Com_sprintf(file->name, sizeof(file->name), "%s.pk3", pakName);
+		count++;
+	}
+
+	pthread_mutex_lock(&http.filesLock);
+	old			  = http.files;
+	http.files	  = files;
+	http.numFiles = count;
+	pthread_mutex_unlock(&http.filesLock);
+
+	if (old) { Z_Free(old); }
+}
+
+/*
+=================
+SV_HttpAdvertise
+
+Points sv_dlURL at this server, unless the admin already set it to
+something else
+=================
+*/
+static void SV_HttpAdvertise(void) {
+	const char *address = sv_httpAddress->string;
+	const char *dlURL	= Cvar_VariableString("sv_dlURL");
+
+	if (*dlURL && strcmp(dlURL, http.url)) { return; }
+
+	if (!*address) {
+		address = Cvar_VariableString("net_ip");
+		if (!*address || !strcmp(address, "0.0.0.0") || !Q_stricmp(address, "localhost")) {
+			Com_Printf(S_COLOR_YELLOW "WARNING: set sv_httpAddress to the address clients should download from, "
+									  "or set sv_dlURL yourself\n");
+			return;
+		}
+	}
+
+	Com_sprintf(http.url, sizeof(http.url), "http://%s:%i", address, http.port);
+	Cvar_Set("sv_dlURL", http.url);
+}
+
+/*
+=================
+SV_HttpStart
+=================
+*/
+static qboolean SV_HttpStart(int port) {
+	struct sockaddr_in address;
+	const char		  *ip = Cvar_VariableString("net_ip");
+	int				   reuse = 1;
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family		= AF_INET;
+	address.sin_port		= htons(port);
+	address.sin_addr.s_addr = INADDR_ANY;
+	if (*ip && Q_stricmp(ip, "localhost") && inet_addr(ip) != INADDR_NONE) { address.sin_addr.s_addr = inet_addr(ip); }
+
+	http.listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (http.listenSocket == INVALID_SOCKET) {
+		Com_Printf(S_COLOR_YELLOW "WARNING: SV_HttpStart: socket: %i\n", socketError);
+		return qfalse;
+	}
+
+	setsockopt(http.listenSocket, SOL_SOCKET, SO_REUSEADDR, (char *)&reuse, sizeof(reuse));
+
+	if (bind(http.listenSocket, (struct sockaddr *)&address, sizeof(address)) == SOCKET_ERROR ||
+		listen(http.listenSocket, 16) == SOCKET_ERROR || !SV_HttpSetNonBlocking(http.listenSocket)) {
+		Com_Printf(S_COLOR_YELLOW "WARNING: SV_HttpStart: can't listen on TCP port %i: %i\n", port, socketError);
+		closesocket(http.listenSocket);
+		http.listenSocket = INVALID_SOCKET;
+		return qfalse;
+	}
+
+#ifndef _WIN32
+	// a client hanging up mid download must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	http.port = port;
+	atomic_store(&http.quit, 0);
+
+	if (pthread_create(&http.thread, NULL, SV_HttpThread, NULL)) {
+		Com_Printf(S_COLOR_YELLOW "WARNING: SV_HttpStart: can't create thread\n");
+		closesocket(http.listenSocket);
+		http.listenSocket = INVALID_SOCKET;
+		return qfalse;
+	}
+
+	http.running = qtrue;
+	Com_Printf("Serving pk3 downloads over HTTP on TCP port %i\n", port);
+
+	return qtrue;
+}
+
+/*
+=================
+SV_HttpShutdown
+
+Stops the HTTP thread and takes back sv_dlURL if we set it
+=================
+*/
+void SV_HttpShutdown(void) {
+	if (!http.running) { return; }
+
+	atomic_store(&http.quit, 1);
+	pthread_join(http.thread, NULL);
+
+	closesocket(http.listenSocket);
+	http.listenSocket = INVALID_SOCKET;
+	http.running	  = qfalse;
+
+	if (http.files) {
+		Z_Free(http.files);
+		http.files	  = NULL;
+		http.numFiles = 0;
+	}
+
+	if (*http.url && !strcmp(Cvar_VariableString("sv_dlURL"), http.url)) { Cvar_Set("sv_dlURL", ""); }
+	http.url[0] = 0;
+}
+
+/*
+=================
+SV_HttpUpdate
+
+Called when a new map is spawned, after the referenced pk3s are known
+=================
+*/
+void SV_HttpUpdate(void) {
+	static qboolean initialized = qfalse;
+	int				port;
+
+	if (!sv_httpServer->integer || !com_dedicated->integer) {
+		SV_HttpShutdown();
+		return;
+	}
+
+	if (!(sv_allowDownload->integer & DLF_ENABLE) || (sv_allowDownload->integer & DLF_NO_REDIRECT)) {
+		Com_Printf(S_COLOR_YELLOW "WARNING: sv_httpServer needs sv_allowDownload to allow redirected downloads\n");
+		SV_HttpShutdown();
+		return;
+	}
+
+	if (!initialized) {
+		pthread_mutex_init(&http.filesLock, NULL);
+		initialized = qtrue;
+	}
+
+	port = sv_httpPort->integer ? sv_httpPort->integer : Cvar_VariableIntegerValue("net_port");
+	if (http.running && port != http.port) { SV_HttpShutdown(); }
+
+	SV_HttpPublishFiles();
+
+	if (!http.running && !SV_HttpStart(port)) { return; }
+
+	SV_HttpAdvertise();
+}
+
+/*
+=================
+SV_HttpStatus_f
+=================
+*/
+void SV_HttpStatus_f(void) {
+	if (!http.running) {
+		Com_Printf("HTTP download server is not running\n");
+		return;
+	}
+
+	Com_Printf("HTTP download server on TCP port %i, %i pk3s published\n", http.port, http.numFiles);
+	Com_Printf("%i requests, %i connections open, %lli bytes sent\n", atomic_load(&http.requests),
+			   atomic_load(&http.activeConnections), (long long)atomic_load(&http.bytesSent));
+}
@@ -85,6 +85,68 @@ void SV_UpdateConfigstrings(client_t *client) {
 	}
 }
 
+/*
+===============
+SV_ConfigstringRecipient
+
+Active clients are sent every configstring change, except for the
+serverinfo if they asked not to
+===============
+*/
+static qboolean SV_ConfigstringRecipient(client_t *client, int index) {
+	if (client->state < CS_ACTIVE) { return qfalse; }
+
+	// do not always send server info to all clients
+	if (index == CS_SERVERINFO && client->gentity && (client->gentity->r.svFlags & SVF_NOSERVERINFO)) {
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+/*
+===============
+SV_FlushConfigstrings
+
+Sends the final value of every configstring that changed since the last
+flush to the active clients, so several changes to one index in a frame
+only cost one command.  Called after the game frame has run, and before
+any other server command is queued so the clients still get everything
+in order.
+===============
+*/
+void SV_FlushConfigstrings(void) {
+	int		  index, i;
+	client_t *client;
+
+	if (!sv.numConfigstringsPending || sv.flushingConfigstrings) { return; }
+
+	sv.flushingConfigstrings = qtrue;
+
+	for (index = 0; index < MAX_CONFIGSTRINGS && sv.numConfigstringsPending; index++) {
+		if (!sv.configstringPending[index]) { continue; }
+
+		sv.configstringPending[index] = qfalse;
+		sv.numConfigstringsPending--;
+
+		for (i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++) {
+			if (SV_ConfigstringRecipient(client, index)) { SV_SendConfigstring(client, index); }
+		}
+	}
+
+	sv.flushingConfigstrings = qfalse;
+}
+
+/*
+===============
+SV_ConfigstringStats_f
+===============
+*/
+void SV_ConfigstringStats_f(void) {
+	Com_Printf("%i configstring updates overwritten before they were sent, about %lli bytes saved\n",
+			   svs.configstringUpdatesSuppressed, (long long)svs.configstringBytesSaved);
+}
+
 /*
 ===============
 SV_SetConfigstring
@@ -92,7 +154,7 @@ SV_SetConfigstring
 ===============
 */
 void SV_SetConfigstring(int index, const char *val) {
-	int		  i;
+	int		  i, len;
 	client_t *client;
 
 	if (index < 0 || index >= MAX_CONFIGSTRINGS) { Com_Error(ERR_DROP, "SV_SetConfigstring: bad index %i", index); }
@@ -102,26 +164,34 @@ void SV_SetConfigstring(int index, const char *val) {
 	// don't bother broadcasting an update if no change
 	if (!strcmp(val, sv.configstrings[index])) { return; }
 
+	len = strlen(sv.configstrings[index]);
+
 	// change the string in sv
 	Z_Free(sv.configstrings[index]);
 	sv.configstrings[index] = CopyString(val);
+	sv.gamestateCached		= qfalse;
+
+	if (index == CS_SERVERINFO || index == CS_SYSTEMINFO) { SV_InvalidateQueryCache(); }
 
 	// send it to all the clients if we aren't
 	// spawning a new server
 	if (sv.state == SS_GAME || sv.restarting) {
 
-		// send the data to all relevant clients
 		for (i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++) {
-			if (client->state < CS_ACTIVE) {
-				if (client->state == CS_PRIMED) client->csUpdated[index] = qtrue;
-				continue;
-			}
-			// do not always send server info to all clients
-			if (index == CS_SERVERINFO && client->gentity && (client->gentity->r.svFlags & SVF_NOSERVERINFO)) {
-				continue;
+			if (client->state == CS_PRIMED) { client->csUpdated[index] = qtrue; }
+
+			// the previous value was never sent, count what that saved
+			if (sv.configstringPending[index] && SV_ConfigstringRecipient(client, index)) {
+				svs.configstringBytesSaved += len + strlen(va("cs %i \"\"\n", index));
 			}
+		}
 
-			SV_SendConfigstring(client, index);
+		// the active clients get the value it has when the frame is done
+		if (sv.configstringPending[index]) {
+			svs.configstringUpdatesSuppressed++;
+		} else {
+			sv.configstringPending[index] = qtrue;
+			sv.numConfigstringsPending++;
 		}
 	}
 }
@@ -193,6 +263,8 @@ static void SV_CreateBaseline(void) {
 		//
 		sv.svEntities[entnum].baseline = svent->s;
 	}
+
+	sv.gamestateCached = qfalse;
 }
 
 /*
@@ -521,6 +593,9 @@ void SV_SpawnServer(char *server, qboolean killBots) {
 	p = FS_ReferencedPakNames();
 	Cvar_Set("sv_referencedPakNames", p);
 
+	// let the HTTP download server know what it may hand out
+	SV_HttpUpdate();
+
 	// save systeminfo and serverinfo strings
 	Q_strncpyz(systemInfo, Cvar_InfoString_Big(CVAR_SYSTEMINFO), sizeof(systemInfo));
 	cvar_modifiedFlags &= ~CVAR_SYSTEMINFO;
@@ -604,6 +679,9 @@ void SV_Init(void) {
 
 	sv_allowDownload = Cvar_Get("sv_allowDownload", "0", CVAR_SERVERINFO);
 	Cvar_Get("sv_dlURL", "", CVAR_SERVERINFO | CVAR_ARCHIVE);
+	sv_httpServer  = Cvar_Get("sv_httpServer", "0", CVAR_ARCHIVE);
+	sv_httpPort	   = Cvar_Get("sv_httpPort", "0", CVAR_ARCHIVE);
+	sv_httpAddress = Cvar_Get("sv_httpAddress", "", CVAR_ARCHIVE);
 
 	sv_master[0] = Cvar_Get("sv_master1", MASTER_SERVER_NAME, 0);
 	sv_master[1] = Cvar_Get("sv_master2", "master.ioquake3.org", 0);
@@ -621,6 +699,12 @@ void SV_Init(void) {
 #endif
 	sv_banFile = Cvar_Get("sv_banFile", "serverbans.dat", CVAR_ARCHIVE);
 
+	// performance
+	sv_snapshotThreads = Cvar_Get("sv_snapshotThreads", "0", CVAR_ARCHIVE);
+	Cvar_CheckRange(sv_snapshotThreads, 0, MAX_WORKER_THREADS, qtrue);
+	sv_deltaCache = Cvar_Get("sv_deltaCache", "1", CVAR_ARCHIVE);
+	sv_traceCache = Cvar_Get("sv_traceCache", "0", CVAR_ARCHIVE);
+
 	// initialize bot cvars so they are listed and can be set before loading the botlib
 	SV_BotInitCvars();
 
@@ -681,6 +765,7 @@ void SV_Shutdown(char *finalmsg) {
 
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
+	SV_HttpShutdown();
 	SV_ShutdownGameProgs();
 
 	// free current level
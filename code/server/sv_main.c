@@ -58,6 +58,12 @@ cvar_t *sv_gametype;
 cvar_t *sv_pure;
 cvar_t *sv_floodProtect;
 cvar_t *sv_lanForceRate; // dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
+cvar_t *sv_snapshotThreads; // worker threads used to build and encode client snapshots
+cvar_t *sv_deltaCache;		// share entity delta encodings between the clients of a frame
+cvar_t *sv_traceCache;		// reuse world only SV_Trace results within a server frame
+cvar_t *sv_httpServer;		// serve the referenced pk3s over HTTP for sv_dlURL downloads
+cvar_t *sv_httpPort;		// TCP port for sv_httpServer, 0 for the same as net_port
+cvar_t *sv_httpAddress;		// host name or address clients reach sv_httpServer at
 #ifndef STANDALONE
 cvar_t *sv_strictAuth;
 #endif
@@ -152,6 +158,9 @@ void SV_AddServerCommand(client_t *client, const char *cmd) {
 	// do not send commands until the gamestate has been sent
 	if (client->state < CS_PRIMED) return;
 
+	// configstring changes still waiting for the end of the frame go first
+	SV_FlushConfigstrings();
+
 	client->reliableSequence++;
 	// if we would be losing an old command that hasn't been acknowledged,
 	// we must drop the connection
@@ -332,24 +341,38 @@ CONNECTIONLESS COMMANDS
 ==============================================================================
 */
 
-// This is deliberately quite large to make it more of an effort to DoS
+// This is deliberately quite large to make it more of an effort to DoS.
+// There is one hash chain per bucket so lookups stay short even when the
+// table is full of spoofed addresses.
 #define MAX_BUCKETS 16384
-#define MAX_HASHES	1024
+#define MAX_HASHES	16384
 
 static leakyBucket_t  buckets[MAX_BUCKETS];
 static leakyBucket_t *bucketHashes[MAX_HASHES];
+static int			  numBucketsUsed;
+static leakyBucket_t *bucketOldest, *bucketNewest; // least to most recently used
 leakyBucket_t		  outboundLeakyBucket;
 
 /*
 ================
 SVC_HashForAddress
+
+The hash is seeded at random on first use, so a flood can't pick
+source addresses that all land on the same chain
 ================
 */
 static long SVC_HashForAddress(netadr_t address) {
-	byte  *ip	= NULL;
-	size_t size = 0;
-	int	   i;
-	long   hash = 0;
+	static qboolean		seeded = qfalse;
+	static unsigned int seed;
+	byte			   *ip	 = NULL;
+	size_t				size = 0;
+	int					i;
+	unsigned int		hash;
+
+	if (!seeded) {
+		Com_RandomBytes((byte *)&seed, sizeof(seed));
+		seeded = qtrue;
+	}
 
 	switch (address.type) {
 	case NA_IP:
@@ -363,85 +386,143 @@ static long SVC_HashForAddress(netadr_t address) {
 	default: break;
 	}
 
-	for (i = 0; i < size; i++) { hash += (long)(ip[i]) * (i + 119); }
+	// FNV-1a over the address bytes, then mix the high bits down
+	hash = 2166136261u ^ seed;
+	for (i = 0; i < size; i++) {
+		hash ^= ip[i];
+		hash *= 16777619u;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
 
-	hash = (hash ^ (hash >> 10) ^ (hash >> 20));
-	hash &= (MAX_HASHES - 1);
+	return hash & (MAX_HASHES - 1);
+}
+
+/*
+================
+SVC_UnlinkBucketUse
+
+Remove a bucket from the least recently used list
+================
+*/
+static void SVC_UnlinkBucketUse(leakyBucket_t *bucket) {
+	if (bucket->older != NULL) {
+		bucket->older->newer = bucket->newer;
+	} else {
+		bucketOldest = bucket->newer;
+	}
+
+	if (bucket->newer != NULL) {
+		bucket->newer->older = bucket->older;
+	} else {
+		bucketNewest = bucket->older;
+	}
 
-	return hash;
+	bucket->older = bucket->newer = NULL;
+}
+
+/*
+================
+SVC_TouchBucket
+
+Move a bucket to the most recently used end of the list
+================
+*/
+static void SVC_TouchBucket(leakyBucket_t *bucket) {
+	if (bucket == bucketNewest) { return; }
+
+	if (bucket->older != NULL || bucket == bucketOldest) { SVC_UnlinkBucketUse(bucket); }
+
+	bucket->older = bucketNewest;
+	if (bucketNewest != NULL) {
+		bucketNewest->newer = bucket;
+	} else {
+		bucketOldest = bucket;
+	}
+	bucketNewest = bucket;
 }
 
 /*
 ================
 SVC_BucketForAddress
 
-Find or allocate a bucket for an address
+Find or allocate a bucket for an address.  Once every bucket has been
+handed out, only the least recently used one is considered for reuse:
+if it hasn't expired, none of the others have either.
 ================
 */
 static leakyBucket_t *SVC_BucketForAddress(netadr_t address, int burst, int period) {
 	leakyBucket_t *bucket = NULL;
-	int			   i;
-	long		   hash = SVC_HashForAddress(address);
-	int			   now	= Sys_Milliseconds();
+	long		   hash	  = SVC_HashForAddress(address);
+	int			   now	  = Sys_Milliseconds();
 
 	for (bucket = bucketHashes[hash]; bucket; bucket = bucket->next) {
 		switch (bucket->type) {
 		case NA_IP:
-			if (memcmp(bucket->ipv._4, address.ip, 4) == 0) { return bucket; }
+			if (memcmp(bucket->ipv._4, address.ip, 4) == 0) {
+				SVC_TouchBucket(bucket);
+				return bucket;
+			}
 			break;
 
 		case NA_IP6:
-			if (memcmp(bucket->ipv._6, address.ip6, 16) == 0) { return bucket; }
+			if (memcmp(bucket->ipv._6, address.ip6, 16) == 0) {
+				SVC_TouchBucket(bucket);
+				return bucket;
+			}
 			break;
 
 		default: break;
 		}
 	}
 
-	for (i = 0; i < MAX_BUCKETS; i++) {
+	if (numBucketsUsed < MAX_BUCKETS) {
+		bucket = &buckets[numBucketsUsed++];
+	} else {
 		int interval;
 
-		bucket	 = &buckets[i];
+		bucket	 = bucketOldest;
 		interval = now - bucket->lastTime;
 
-		// Reclaim expired buckets
-		if (bucket->lastTime > 0 && (interval > (burst * period) || interval < 0)) {
-			if (bucket->prev != NULL) {
-				bucket->prev->next = bucket->next;
-			} else {
-				bucketHashes[bucket->hash] = bucket->next;
-			}
+		// Couldn't allocate a bucket for this address
+		if (interval <= (burst * period) && interval >= 0) { return NULL; }
 
-			if (bucket->next != NULL) { bucket->next->prev = bucket->prev; }
-
-			memset(bucket, 0, sizeof(leakyBucket_t));
+		// Reclaim the expired bucket
+		if (bucket->prev != NULL) {
+			bucket->prev->next = bucket->next;
+		} else {
+			bucketHashes[bucket->hash] = bucket->next;
 		}
 
-		if (bucket->type == NA_BAD) {
-			bucket->type = address.type;
-			switch (address.type) {
-			case NA_IP: memcpy(bucket->ipv._4, address.ip, 4); break;
-			case NA_IP6: memcpy(bucket->ipv._6, address.ip6, 16); break;
-			default: break;
-			}
+		if (bucket->next != NULL) { bucket->next->prev = bucket->prev; }
 
-			bucket->lastTime = now;
-			bucket->burst	 = 0;
-			bucket->hash	 = hash;
+		SVC_UnlinkBucketUse(bucket);
+		memset(bucket, 0, sizeof(leakyBucket_t));
+	}
+
+	bucket->type = address.type;
+	switch (address.type) {
+	case NA_IP: memcpy(bucket->ipv._4, address.ip, 4); break;
+	case NA_IP6: memcpy(bucket->ipv._6, address.ip6, 16); break;
+	default: break;
+	}
 
-			// Add to the head of the relevant hash chain
-			bucket->next = bucketHashes[hash];
-			if (bucketHashes[hash] != NULL) { bucketHashes[hash]->prev = bucket; }
+	bucket->lastTime = now;
+	bucket->burst	 = 0;
+	bucket->hash	 = hash;
 
-			bucket->prev	   = NULL;
-			bucketHashes[hash] = bucket;
+	// Add to the head of the relevant hash chain
+	bucket->next = bucketHashes[hash];
+	if (bucketHashes[hash] != NULL) { bucketHashes[hash]->prev = bucket; }
 
-			return bucket;
-		}
-	}
+	bucket->prev	   = NULL;
+	bucketHashes[hash] = bucket;
 
-	// Couldn't allocate a bucket for this address
-	return NULL;
+	SVC_TouchBucket(bucket);
+
+	return bucket;
 }
 
 /*
@@ -487,24 +568,278 @@ qboolean SVC_RateLimitAddress(netadr_t from, int burst, int period) {
 	return SVC_RateLimit(bucket, burst, period);
 }
 
+/*
+==============================================================================
+
+QUERY RESPONSE CACHE
+
+getinfo and getstatus replies are the same for every caller except for
+the echoed challenge, so the bodies are kept here and only rebuilt after
+a serverinfo cvar or a player's score, ping, name or slot has changed.
+
+==============================================================================
+*/
+
+typedef struct {
+	qboolean connected;
+	qboolean bot;
+	int		 score;
+	int		 ping;
+	char	 name[MAX_NAME_LENGTH];
+} queryPlayer_t;
+
+typedef struct {
+	qboolean infoValid;
+	char	 info[MAX_INFO_STRING]; // infoResponse keys, minus the challenge
+	int		 infoLength;
+
+	qboolean statusValid;
+	char	 serverinfo[MAX_INFO_STRING]; // statusResponse keys, minus the challenge
+	int		 serverinfoLength;
+	char	 players[MAX_MSGLEN];
+	int		 playersLength;
+
+	queryPlayer_t player[MAX_CLIENTS];
+
+	int64_t hits;
+	int		rebuilds;
+} queryCache_t;
+
+static queryCache_t queryCache;
+
 /*
 ================
-SVC_Status
+SV_InvalidateQueryCache
 
-Responds with all the info that qplug or qspy can see about the server
-and all connected players.  Used for getting detailed information after
-the simple info query.
+Called whenever the serverinfo or systeminfo strings change
 ================
 */
-static void SVC_Status(netadr_t from) {
+void SV_InvalidateQueryCache(void) {
+	queryCache.infoValid   = qfalse;
+	queryCache.statusValid = qfalse;
+}
+
+/*
+================
+SV_UpdateQueryCache
+
+Called once per server frame, after the game has run, to notice
+player changes that show up in the query responses
+================
+*/
+static void SV_UpdateQueryCache(void) {
+	int			   i;
+	client_t	  *cl;
+	queryPlayer_t *qp;
+	qboolean	   connected, bot;
+
+	for (i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++) {
+		qp		  = &queryCache.player[i];
+		connected = (cl->state >= CS_CONNECTED);
+		bot		  = (cl->netchan.remoteAddress.type == NA_BOT);
+
+		if (connected != qp->connected || (connected && bot != qp->bot)) {
+			// the player counts in getinfo change as well
+			queryCache.infoValid   = qfalse;
+			queryCache.statusValid = qfalse;
+			qp->connected		   = connected;
+			qp->bot				   = bot;
+		}
+
+		if (!connected) { continue; }
+
+		if (queryCache.statusValid) {
+			if (SV_GameClientNum(i)->persistant[PERS_SCORE] != qp->score || cl->ping != qp->ping ||
+				strcmp(cl->name, qp->name)) {
+				queryCache.statusValid = qfalse;
+			}
+		}
+	}
+}
+
+/*
+================
+SVC_BuildInfoCache
+================
+*/
+static void SVC_BuildInfoCache(void) {
+	int	  i, count, humans;
+	char *gamedir;
+	char *infostring = queryCache.info;
+
+	// don't count privateclients
+	count = humans = 0;
+	for (i = sv_privateClients->integer; i < sv_maxclients->integer; i++) {
+		if (svs.clients[i].state >= CS_CONNECTED) {
+			count++;
+			if (svs.clients[i].netchan.remoteAddress.type != NA_BOT) { humans++; }
+		}
+	}
+
+	infostring[0] = 0;
+
+	Info_SetValueForKey(infostring, "gamename", com_gamename->string);
+
+#ifdef LEGACY_PROTOCOL
+	if (com_legacyprotocol->integer > 0)
+		Info_SetValueForKey(infostring, "protocol", va("%i", com_legacyprotocol->integer));
+	else
+#endif
+		Info_SetValueForKey(infostring, "protocol", va("%i", com_protocol->integer));
+
+	Info_SetValueForKey(infostring, "hostname", sv_hostname->string);
+	Info_SetValueForKey(infostring, "mapname", sv_mapname->string);
+	Info_SetValueForKey(infostring, "clients", va("%i", count));
+	Info_SetValueForKey(infostring, "g_humanplayers", va("%i", humans));
+	Info_SetValueForKey(infostring, "sv_maxclients", va("%i", sv_maxclients->integer - sv_privateClients->integer));
+	Info_SetValueForKey(infostring, "gametype", va("%i", sv_gametype->integer));
+	Info_SetValueForKey(infostring, "pure", va("%i", sv_pure->integer));
+	Info_SetValueForKey(infostring, "g_needpass", va("%d", Cvar_VariableIntegerValue("g_needpass")));
+
+#ifdef USE_VOIP
+	if (sv_voipProtocol->string && *sv_voipProtocol->string) {
+		Info_SetValueForKey(infostring, "voip", sv_voipProtocol->string);
+	}
+#endif
+
+	if (sv_minPing->integer) { Info_SetValueForKey(infostring, "minPing", va("%i", sv_minPing->integer)); }
+	if (sv_maxPing->integer) { Info_SetValueForKey(infostring, "maxPing", va("%i", sv_maxPing->integer)); }
+	gamedir = Cvar_VariableString("fs_game");
+	if (*gamedir) { Info_SetValueForKey(infostring, "game", gamedir); }
+
+	queryCache.infoLength = strlen(infostring);
+	queryCache.infoValid  = qtrue;
+	queryCache.rebuilds++;
+}
+
+/*
+================
+SVC_BuildStatusCache
+================
+*/
+static void SVC_BuildStatusCache(void) {
 	char		   player[1024];
-	char		   status[MAX_MSGLEN];
 	int			   i;
 	client_t	  *cl;
 	playerState_t *ps;
+	queryPlayer_t *qp;
 	int			   statusLength;
 	int			   playerLength;
-	char		   infostring[MAX_INFO_STRING];
+	qboolean	   full;
+
+	Q_strncpyz(queryCache.serverinfo, Cvar_InfoString(CVAR_SERVERINFO), sizeof(queryCache.serverinfo));
+	Info_RemoveKey(queryCache.serverinfo, "challenge");
+	queryCache.serverinfoLength = strlen(queryCache.serverinfo);
+
+	queryCache.players[0] = 0;
+	statusLength		  = 0;
+	full				  = qfalse;
+
+	for (i = 0; i < sv_maxclients->integer; i++) {
+		cl = &svs.clients[i];
+		if (cl->state >= CS_CONNECTED) {
+			ps = SV_GameClientNum(i);
+
+			// remember what this was built from, see SV_UpdateQueryCache
+			qp		  = &queryCache.player[i];
+			qp->score = ps->persistant[PERS_SCORE];
+			qp->ping  = cl->ping;
+			Q_strncpyz(qp->name, cl->name, sizeof(qp->name));
+
+			if (full) { continue; }
+
+			Com_sprintf(player, sizeof(player), "%i %i \"%s\"\n", ps->persistant[PERS_SCORE], cl->ping, cl->name);
+			playerLength = strlen(player);
+			if (statusLength + playerLength >= sizeof(queryCache.players)) {
+				full = qtrue; // can't hold any more
+				continue;
+			}
+			strcpy(queryCache.players + statusLength, player);
+			statusLength += playerLength;
+		}
+	}
+
+	queryCache.playersLength = statusLength;
+
+	queryCache.statusValid = qtrue;
+	queryCache.rebuilds++;
+}
+
+/*
+================
+SVC_CheckQueryCache
+
+Serverinfo cvars changed since the last frame haven't reached
+SV_SetConfigstring yet, so look at the modified flags as well
+================
+*/
+static void SVC_CheckQueryCache(void) {
+	if (cvar_modifiedFlags & (CVAR_SERVERINFO | CVAR_SYSTEMINFO)) { SV_InvalidateQueryCache(); }
+}
+
+/*
+================
+SVC_ChallengeLength
+
+Returns the length of the challenge to echo back, or 0 if it has to be
+left out for the same reasons Info_SetValueForKey would reject it
+================
+*/
+static int SVC_ChallengeLength(const char *challenge, int infoLength) {
+	int length = strlen(challenge);
+
+	if (!length) { return 0; }
+
+	if (strpbrk(challenge, "\\;\"")) {
+		Com_DPrintf("Ignoring challenge with a '\\', ';' or '\"': %s\n", challenge);
+		return 0;
+	}
+
+	if (infoLength + length + (int)strlen("\\challenge\\") >= MAX_INFO_STRING) {
+		Com_DPrintf("Info string length exceeded\n");
+		return 0;
+	}
+
+	return length;
+}
+
+/*
+================
+SVC_AppendResponse
+
+Appends to an out of band packet, silently truncating like NET_OutOfBandPrint
+================
+*/
+static void SVC_AppendResponse(char *packet, int *packetLength, const char *data, int length) {
+	if (*packetLength + length > MAX_MSGLEN - 1) { length = MAX_MSGLEN - 1 - *packetLength; }
+
+	memcpy(packet + *packetLength, data, length);
+	*packetLength += length;
+}
+
+/*
+================
+SV_QueryCacheStats_f
+================
+*/
+void SV_QueryCacheStats_f(void) {
+	Com_Printf("%lli query responses served from %i cache rebuilds\n", (long long)queryCache.hits, queryCache.rebuilds);
+}
+
+/*
+================
+SVC_Status
+
+Responds with all the info that qplug or qspy can see about the server
+and all connected players.  Used for getting detailed information after
+the simple info query.
+================
+*/
+static void SVC_Status(netadr_t from) {
+	char  packet[MAX_MSGLEN];
+	int	  packetLength;
+	char *challenge;
+	int	  challengeLength;
 
 	// ignore if we are in single player
 	if (Cvar_VariableValue("g_gametype") == GT_SINGLE_PLAYER || Cvar_VariableValue("ui_singlePlayerActive")) { return; }
@@ -523,32 +858,29 @@ static void SVC_Status(netadr_t from) {
 	}
 
 	// A maximum challenge length of 128 should be more than plenty.
-	if (strlen(Cmd_Argv(1)) > 128) return;
+	challenge = Cmd_Argv(1);
+	if (strlen(challenge) > 128) return;
 
-	strcpy(infostring, Cvar_InfoString(CVAR_SERVERINFO));
+	SVC_CheckQueryCache();
+	if (!queryCache.statusValid) { SVC_BuildStatusCache(); }
+	queryCache.hits++;
+
+	packetLength = 0;
+	SVC_AppendResponse(packet, &packetLength, "\xff\xff\xff\xff" "statusResponse\n", 4 + 15);
 
 	// echo back the parameter to status. so master servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey(infostring, "challenge", Cmd_Argv(1));
-
-	status[0]	 = 0;
-	statusLength = 0;
-
-	for (i = 0; i < sv_maxclients->integer; i++) {
-		cl = &svs.clients[i];
-		if (cl->state >= CS_CONNECTED) {
-			ps = SV_GameClientNum(i);
-			Com_sprintf(player, sizeof(player), "%i %i \"%s\"\n", ps->persistant[PERS_SCORE], cl->ping, cl->name);
-			playerLength = strlen(player);
-			if (statusLength + playerLength >= sizeof(status)) {
-				break; // can't hold any more
-			}
-			strcpy(status + statusLength, player);
-			statusLength += playerLength;
-		}
+	challengeLength = SVC_ChallengeLength(challenge, queryCache.serverinfoLength);
+	if (challengeLength) {
+		SVC_AppendResponse(packet, &packetLength, "\\challenge\\", 11);
+		SVC_AppendResponse(packet, &packetLength, challenge, challengeLength);
 	}
 
-	NET_OutOfBandPrint(NS_SERVER, from, "statusResponse\n%s\n%s", infostring, status);
+	SVC_AppendResponse(packet, &packetLength, queryCache.serverinfo, queryCache.serverinfoLength);
+	SVC_AppendResponse(packet, &packetLength, "\n", 1);
+	SVC_AppendResponse(packet, &packetLength, queryCache.players, queryCache.playersLength);
+
+	NET_SendPacket(NS_SERVER, packetLength, packet, from);
 }
 
 /*
@@ -560,9 +892,10 @@ if a user is interested in a server to do a full status
 ================
 */
 void SVC_Info(netadr_t from) {
-	int	  i, count, humans;
-	char *gamedir;
-	char  infostring[MAX_INFO_STRING];
+	char  packet[MAX_MSGLEN];
+	int	  packetLength;
+	char *challenge;
+	int	  challengeLength;
 
 	// ignore if we are in single player
 	if (Cvar_VariableValue("g_gametype") == GT_SINGLE_PLAYER || Cvar_VariableValue("ui_singlePlayerActive")) { return; }
@@ -586,53 +919,26 @@ void SVC_Info(netadr_t from) {
 	 */
 
 	// A maximum challenge length of 128 should be more than plenty.
-	if (strlen(Cmd_Argv(1)) > 128) return;
+	challenge = Cmd_Argv(1);
+	if (strlen(challenge) > 128) return;
 
-	// don't count privateclients
-	count = humans = 0;
-	for (i = sv_privateClients->integer; i < sv_maxclients->integer; i++) {
-		if (svs.clients[i].state >= CS_CONNECTED) {
-			count++;
-			if (svs.clients[i].netchan.remoteAddress.type != NA_BOT) { humans++; }
-		}
-	}
+	SVC_CheckQueryCache();
+	if (!queryCache.infoValid) { SVC_BuildInfoCache(); }
+	queryCache.hits++;
 
-	infostring[0] = 0;
+	packetLength = 0;
+	SVC_AppendResponse(packet, &packetLength, "\xff\xff\xff\xff" "infoResponse\n", 4 + 13);
+	SVC_AppendResponse(packet, &packetLength, queryCache.info, queryCache.infoLength);
 
 	// echo back the parameter to status. so servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey(infostring, "challenge", Cmd_Argv(1));
-
-	Info_SetValueForKey(infostring, "gamename", com_gamename->string);
-
-#ifdef LEGACY_PROTOCOL
-	if (com_legacyprotocol->integer > 0)
-		Info_SetValueForKey(infostring, "protocol", va("%i", com_legacyprotocol->integer));
-	else
-#endif
-		Info_SetValueForKey(infostring, "protocol", va("%i", com_protocol->integer));
-
-	Info_SetValueForKey(infostring, "hostname", sv_hostname->string);
-	Info_SetValueForKey(infostring, "mapname", sv_mapname->string);
-	Info_SetValueForKey(infostring, "clients", va("%i", count));
-	Info_SetValueForKey(infostring, "g_humanplayers", va("%i", humans));
-	Info_SetValueForKey(infostring, "sv_maxclients", va("%i", sv_maxclients->integer - sv_privateClients->integer));
-	Info_SetValueForKey(infostring, "gametype", va("%i", sv_gametype->integer));
-	Info_SetValueForKey(infostring, "pure", va("%i", sv_pure->integer));
-	Info_SetValueForKey(infostring, "g_needpass", va("%d", Cvar_VariableIntegerValue("g_needpass")));
-
-#ifdef USE_VOIP
-	if (sv_voipProtocol->string && *sv_voipProtocol->string) {
-		Info_SetValueForKey(infostring, "voip", sv_voipProtocol->string);
+	challengeLength = SVC_ChallengeLength(challenge, queryCache.infoLength);
+	if (challengeLength) {
+		SVC_AppendResponse(packet, &packetLength, "\\challenge\\", 11);
+		SVC_AppendResponse(packet, &packetLength, challenge, challengeLength);
 	}
-#endif
-
-	if (sv_minPing->integer) { Info_SetValueForKey(infostring, "minPing", va("%i", sv_minPing->integer)); }
-	if (sv_maxPing->integer) { Info_SetValueForKey(infostring, "maxPing", va("%i", sv_maxPing->integer)); }
-	gamedir = Cvar_VariableString("fs_game");
-	if (*gamedir) { Info_SetValueForKey(infostring, "game", gamedir); }
 
-	NET_OutOfBandPrint(NS_SERVER, from, "infoResponse\n%s", infostring);
+	NET_SendPacket(NS_SERVER, packetLength, packet, from);
 }
 
 /*
@@ -1059,6 +1365,12 @@ void SV_Frame(int msec) {
 		VM_Call(gvm, GAME_RUN_FRAME, sv.time);
 	}
 
+	// send the configstrings the game changed, once each
+	SV_FlushConfigstrings();
+
+	// notice score, ping and player changes for getinfo/getstatus
+	SV_UpdateQueryCache();
+
 	if (com_speeds->integer) { time_game = Sys_Milliseconds() - startTime; }
 
 	// check timeouts
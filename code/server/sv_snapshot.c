@@ -22,6 +22,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "server.h"
 
+#include <stdatomic.h>
+
 /*
 =============================================================================
 
@@ -44,6 +46,151 @@ A normal server packet will look like:
 =============================================================================
 */
 
+/*
+=============================================================================
+
+Delta entity cache
+
+Clients that get the same delta of an entity in a snapshot pass, from the
+same old state to the same new state, share one encoding of it.  That is
+usually a new entity sent from its baseline, or every client having acked
+the same previous snapshot.  The cached bits are Huffman coded already and
+are copied into each message as they are.
+
+=============================================================================
+*/
+
+#define DELTA_CACHE_SLOTS 4	  // encodings kept per entity and pass
+#define DELTA_CACHE_BYTES 256 // longer deltas are not cached
+
+typedef struct {
+	atomic_int	  ready; // the rest of the slot is filled in
+	qboolean	  force;
+	int			  bits;
+	entityState_t from;
+	entityState_t to;
+	byte		  data[DELTA_CACHE_BYTES];
+} deltaCacheSlot_t;
+
+typedef struct {
+	atomic_int		 used; // slots claimed this pass
+	deltaCacheSlot_t slots[DELTA_CACHE_SLOTS];
+} deltaCacheEntity_t;
+
+static deltaCacheEntity_t *svDeltaCache; // [MAX_GENTITIES]
+
+static atomic_int	svDeltaCacheHits;
+static atomic_int	svDeltaCacheMisses;
+static atomic_llong svDeltaCacheBitsSaved;
+
+/*
+=============
+SV_ClearDeltaCache
+
+Forgets the encodings of the previous snapshot pass
+=============
+*/
+static void SV_ClearDeltaCache(void) {
+	int i, j;
+
+	if (!sv_deltaCache->integer) { return; }
+
+	if (!svDeltaCache) { svDeltaCache = Z_Malloc(MAX_GENTITIES * sizeof(*svDeltaCache)); }
+
+	for (i = 0; i < MAX_GENTITIES; i++) {
+		if (!atomic_load_explicit(&svDeltaCache[i].used, memory_order_relaxed)) { continue; }
+
+		atomic_store_explicit(&svDeltaCache[i].used, 0, memory_order_relaxed);
+		for (j = 0; j < DELTA_CACHE_SLOTS; j++) {
+			atomic_store_explicit(&svDeltaCache[i].slots[j].ready, 0, memory_order_relaxed);
+		}
+	}
+}
+
+/*
+=============
+SV_WriteDeltaEntityCached
+
+MSG_WriteDeltaEntity for snapshots, safe to call from worker threads
+=============
+*/
+static void SV_WriteDeltaEntityCached(msg_t *msg, entityState_t *from, entityState_t *to, qboolean force) {
+	deltaCacheEntity_t *entity;
+	deltaCacheSlot_t   *slot;
+	msg_t				encoded;
+	byte				encodedBuf[DELTA_CACHE_BYTES];
+	int					i, used;
+
+	// removals are just the number and a bit
+	if (!svDeltaCache || !sv_deltaCache->integer || !to) {
+		MSG_WriteDeltaEntity(msg, from, to, force);
+		return;
+	}
+
+	entity = &svDeltaCache[to->number];
+
+	used = atomic_load_explicit(&entity->used, memory_order_relaxed);
+	if (used > DELTA_CACHE_SLOTS) { used = DELTA_CACHE_SLOTS; }
+
+	for (i = 0, slot = entity->slots; i < used; i++, slot++) {
+		if (!atomic_load_explicit(&slot->ready, memory_order_acquire)) { continue; }
+
+		if (slot->force != force || memcmp(&slot->to, to, sizeof(*to)) || memcmp(&slot->from, from, sizeof(*from))) {
+			continue;
+		}
+
+		MSG_WriteBitString(msg, slot->data, slot->bits);
+		atomic_fetch_add_explicit(&svDeltaCacheHits, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&svDeltaCacheBitsSaved, slot->bits, memory_order_relaxed);
+		return;
+	}
+
+	atomic_fetch_add_explicit(&svDeltaCacheMisses, 1, memory_order_relaxed);
+
+	MSG_Init(&encoded, encodedBuf, sizeof(encodedBuf));
+	MSG_WriteDeltaEntity(&encoded, from, to, force);
+	if (encoded.overflowed) {
+		MSG_WriteDeltaEntity(msg, from, to, force);
+		return;
+	}
+
+	MSG_WriteBitString(msg, encoded.data, encoded.bit);
+
+	// keep it for the other clients if there is room left
+	i = atomic_fetch_add_explicit(&entity->used, 1, memory_order_relaxed);
+	if (i >= DELTA_CACHE_SLOTS) { return; }
+
+	slot		= &entity->slots[i];
+	slot->force = force;
+	slot->bits	= encoded.bit;
+	slot->from	= *from;
+	slot->to	= *to;
+	memcpy(slot->data, encoded.data, (encoded.bit + 7) >> 3);
+	atomic_store_explicit(&slot->ready, 1, memory_order_release);
+}
+
+/*
+=============
+SV_DeltaCacheStats_f
+
+Reports how well the delta entity cache did since the last call
+=============
+*/
+void SV_DeltaCacheStats_f(void) {
+	int		hits, misses;
+	int64_t bitsSaved;
+
+	hits	  = atomic_exchange(&svDeltaCacheHits, 0);
+	misses	  = atomic_exchange(&svDeltaCacheMisses, 0);
+	bitsSaved = atomic_exchange(&svDeltaCacheBitsSaved, 0);
+
+	if (!sv_deltaCache->integer) { Com_Printf("delta entity cache is disabled (sv_deltaCache 0)\n"); }
+
+	Com_Printf("%i hits, %i misses", hits, misses);
+	if (hits + misses) { Com_Printf(", %.1f%% hit rate", 100.0 * hits / (hits + misses)); }
+	Com_Printf("\n%lli bits not encoded again\n", (long long)bitsSaved);
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -87,7 +234,7 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emitted if the entity has not changed at all
-			MSG_WriteDeltaEntity(msg, oldent, newent, qfalse);
+			SV_WriteDeltaEntityCached(msg, oldent, newent, qfalse);
 			oldindex++;
 			newindex++;
 			continue;
@@ -95,7 +242,7 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 
 		if (newnum < oldnum) {
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity(msg, &sv.svEntities[newnum].baseline, newent, qtrue);
+			SV_WriteDeltaEntityCached(msg, &sv.svEntities[newnum].baseline, newent, qtrue);
 			newindex++;
 			continue;
 		}
@@ -113,41 +260,56 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 
 /*
 ==================
-SV_WriteSnapshotToClient
+SV_SelectDeltaFrame
+
+Picks the previous frame the next snapshot will be delta compressed from,
+returns the frame distance that is sent to the client.  This has to be
+decided right after the entities of the new frame have been allocated,
+because later allocations can roll the old frame off the buffer.
 ==================
 */
-static void SV_WriteSnapshotToClient(client_t *client, msg_t *msg) {
-	clientSnapshot_t *frame, *oldframe;
-	int				  lastframe;
-	int				  i;
-	int				  snapFlags;
-
-	// this is the snapshot we are creating
-	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+static int SV_SelectDeltaFrame(client_t *client, clientSnapshot_t **oldframe) {
+	int lastframe;
 
 	// try to use a previous frame as the source for delta compressing the snapshot
 	if (client->deltaMessage <= 0 || client->state != CS_ACTIVE) {
 		// client is asking for a retransmit
-		oldframe  = NULL;
+		*oldframe = NULL;
 		lastframe = 0;
 	} else if (client->netchan.outgoingSequence - client->deltaMessage >= (PACKET_BACKUP - 3)) {
 		// client hasn't gotten a good message through in a long time
 		Com_DPrintf("%s: Delta request from out of date packet.\n", client->name);
-		oldframe  = NULL;
+		*oldframe = NULL;
 		lastframe = 0;
 	} else {
 		// we have a valid snapshot to delta from
-		oldframe  = &client->frames[client->deltaMessage & PACKET_MASK];
+		*oldframe = &client->frames[client->deltaMessage & PACKET_MASK];
 		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
 
 		// the snapshot's entities may still have rolled off the buffer, though
-		if (oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities) {
+		if ((*oldframe)->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities) {
 			Com_DPrintf("%s: Delta request from out of date entities.\n", client->name);
-			oldframe  = NULL;
+			*oldframe = NULL;
 			lastframe = 0;
 		}
 	}
 
+	return lastframe;
+}
+
+/*
+==================
+SV_WriteSnapshotToClient
+==================
+*/
+static void SV_WriteSnapshotToClient(client_t *client, msg_t *msg, clientSnapshot_t *oldframe, int lastframe) {
+	clientSnapshot_t *frame;
+	int				  i;
+	int				  snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
 	MSG_WriteByte(msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -224,11 +386,35 @@ Build a client snapshot structure
 =============================================================================
 */
 
+// everything in here is private to the snapshot being built, so several
+// snapshots can be built at the same time from worker threads
 typedef struct {
-	int numSnapshotEntities;
-	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	int			numSnapshotEntities;
+	int			snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	byte		added[MAX_GENTITIES / 8]; // used to prevent double adding from portal views
+	int			clientNum;				  // -1 when culling for a shared view
+	qboolean	viewDependent;			  // a shared view went through a portal it can't share
+	const char *error;					  // raised with Com_Error by the thread that owns the client
 } snapshotEntityNumbers_t;
 
+// the entities visible from a (cluster, area) viewpoint before the per client
+// filters are applied, shared by every client standing there this frame
+typedef struct {
+	int		 cluster;
+	int		 area;
+	vec3_t	 origin; // the first client's viewpoint, used to cull the view
+	qboolean shared; // qfalse if the result depends on the exact viewpoint
+	int		 areabytes;
+	byte	 areabits[MAX_MAP_AREA_BYTES];
+	byte	 visible[MAX_GENTITIES / 8];
+} snapshotView_t;
+
+static snapshotView_t *svSnapshotViews; // [MAX_CLIENTS]
+static int			   svNumSnapshotViews;
+
+#define SV_EntityAdded(eNums, num) ((eNums)->added[(num) >> 3] & (1 << ((num) & 7)))
+#define SV_MarkEntityAdded(eNums, num) ((eNums)->added[(num) >> 3] |= (1 << ((num) & 7)))
+
 /*
 =======================
 SV_QsortEntityNumbers
@@ -240,11 +426,10 @@ static int QDECL SV_QsortEntityNumbers(const void *a, const void *b) {
 	ea = (int *)a;
 	eb = (int *)b;
 
-	if (*ea == *eb) { Com_Error(ERR_DROP, "SV_QsortEntityStates: duplicated entity"); }
-
 	if (*ea < *eb) { return -1; }
+	if (*ea > *eb) { return 1; }
 
-	return 1;
+	return 0;
 }
 
 /*
@@ -254,8 +439,8 @@ SV_AddEntToSnapshot
 */
 static void SV_AddEntToSnapshot(svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums) {
 	// if we have already added this entity to this snapshot, don't add again
-	if (svEnt->snapshotCounter == sv.snapshotCounter) { return; }
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	if (SV_EntityAdded(eNums, gEnt->s.number)) { return; }
+	SV_MarkEntityAdded(eNums, gEnt->s.number);
 
 	// if we are full, silently discard entities
 	if (eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES) { return; }
@@ -264,12 +449,68 @@ static void SV_AddEntToSnapshot(svEntity_t *svEnt, sharedEntity_t *gEnt, snapsho
 	eNums->numSnapshotEntities++;
 }
 
+/*
+===============
+SV_EntityHiddenFromClient
+
+Applies the flags that restrict an entity to some of the clients
+===============
+*/
+static qboolean SV_EntityHiddenFromClient(sharedEntity_t *ent, int clientNum, snapshotEntityNumbers_t *eNums) {
+	// entities can be flagged to be sent to only one client
+	if (ent->r.svFlags & SVF_SINGLECLIENT) {
+		if (ent->r.singleClient != clientNum) { return qtrue; }
+	}
+	// entities can be flagged to be sent to everyone but one client
+	if (ent->r.svFlags & SVF_NOTSINGLECLIENT) {
+		if (ent->r.singleClient == clientNum) { return qtrue; }
+	}
+	// entities can be flagged to be sent to a given mask of clients
+	if (ent->r.svFlags & SVF_CLIENTMASK) {
+		if (clientNum >= 32) {
+			eNums->error = "SVF_CLIENTMASK: clientNum >= 32";
+			return qtrue;
+		}
+		if (~ent->r.singleClient & (1 << clientNum)) { return qtrue; }
+	}
+
+	return qfalse;
+}
+
+/*
+===============
+SV_GatherSnapshotCandidates
+
+Marks every entity that could be visible through the given pvs: the ones
+linked into a visible cluster, plus the ones that always have to be tested.
+The full visibility tests still have to be run on each of them.
+===============
+*/
+static void SV_GatherSnapshotCandidates(const byte *pvs, byte *candidates) {
+	clusterLink_t *link;
+	int			   i, c;
+
+	for (i = 0; i < MAX_GENTITIES / 8; i++) { candidates[i] = sv.unclusteredEntities[i] | sv.broadcastEntities[i]; }
+
+	for (c = 0; c < sv.numClusters; c++) {
+		if (!pvs[c >> 3]) {
+			c |= 7; // skip the whole byte
+			continue;
+		}
+		if (!(pvs[c >> 3] & (1 << (c & 7)))) { continue; }
+
+		for (link = sv.clusterEntities[c]; link; link = link->next) {
+			candidates[link->entityNum >> 3] |= 1 << (link->entityNum & 7);
+		}
+	}
+}
+
 /*
 ===============
 SV_AddEntitiesVisibleFromPoint
 ===============
 */
-static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *frame, snapshotEntityNumbers_t *eNums,
+static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, byte *areabits, int *areabytes, snapshotEntityNumbers_t *eNums,
 										   qboolean portal) {
 	int				e, i;
 	sharedEntity_t *ent;
@@ -279,6 +520,7 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
 	int				leafnum;
 	byte		   *clientpvs;
 	byte		   *bitvector;
+	byte			candidates[MAX_GENTITIES / 8];
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -290,42 +532,39 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
 	clientcluster = CM_LeafCluster(leafnum);
 
 	// calculate the visible areas
-	frame->areabytes = CM_WriteAreaBits(frame->areabits, clientarea);
+	*areabytes = CM_WriteAreaBits(areabits, clientarea);
 
 	clientpvs = CM_ClusterPVS(clientcluster);
 
+	// only look at entities that can possibly be seen, in entity number
+	// order so the same entities are dropped if the snapshot overflows
+	SV_GatherSnapshotCandidates(clientpvs, candidates);
+
 	for (e = 0; e < sv.num_entities; e++) {
+		if (!candidates[e >> 3]) {
+			e |= 7; // skip the whole byte
+			continue;
+		}
+		if (!(candidates[e >> 3] & (1 << (e & 7)))) { continue; }
+
 		ent = SV_GentityNum(e);
 
 		// never send entities that aren't linked in
 		if (!ent->r.linked) { continue; }
 
-		if (ent->s.number != e) {
-			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
-		}
-
 		// entities can be flagged to explicitly not be sent to the client
 		if (ent->r.svFlags & SVF_NOCLIENT) { continue; }
 
-		// entities can be flagged to be sent to only one client
-		if (ent->r.svFlags & SVF_SINGLECLIENT) {
-			if (ent->r.singleClient != frame->ps.clientNum) { continue; }
-		}
-		// entities can be flagged to be sent to everyone but one client
-		if (ent->r.svFlags & SVF_NOTSINGLECLIENT) {
-			if (ent->r.singleClient == frame->ps.clientNum) { continue; }
-		}
-		// entities can be flagged to be sent to a given mask of clients
-		if (ent->r.svFlags & SVF_CLIENTMASK) {
-			if (frame->ps.clientNum >= 32) Com_Error(ERR_DROP, "SVF_CLIENTMASK: clientNum >= 32");
-			if (~ent->r.singleClient & (1 << frame->ps.clientNum)) continue;
+		// a shared view is filtered for each client when it is copied out
+		if (eNums->clientNum >= 0 && SV_EntityHiddenFromClient(ent, eNums->clientNum, eNums)) {
+			if (eNums->error) { return; }
+			continue;
 		}
 
-		svEnt = SV_SvEntityForGentity(ent);
+		svEnt = &sv.svEntities[e];
 
 		// don't double add an entity through portals
-		if (svEnt->snapshotCounter == sv.snapshotCounter) { continue; }
+		if (SV_EntityAdded(eNums, e)) { continue; }
 
 		// broadcast entities are always sent
 		if (ent->r.svFlags & SVF_BROADCAST) {
@@ -373,19 +612,170 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
 
 		// if it's a portal entity, add everything visible from its camera position
 		if (ent->r.svFlags & SVF_PORTAL) {
+			// what a shared view sees through the portal must not depend on
+			// where exactly the client stands or on who the client is
+			if (eNums->clientNum < 0 &&
+				(ent->s.generic1 || e < sv_maxclients->integer ||
+				 (ent->r.svFlags & (SVF_SINGLECLIENT | SVF_NOTSINGLECLIENT | SVF_CLIENTMASK)))) {
+				eNums->viewDependent = qtrue;
+			}
 			if (ent->s.generic1) {
 				vec3_t dir;
 				VectorSubtract(ent->s.origin, origin, dir);
 				if (VectorLengthSquared(dir) > (float)ent->s.generic1 * ent->s.generic1) { continue; }
 			}
-			SV_AddEntitiesVisibleFromPoint(ent->s.origin2, frame, eNums, qtrue);
+			SV_AddEntitiesVisibleFromPoint(ent->s.origin2, areabits, areabytes, eNums, qtrue);
+			if (eNums->error) { return; }
 		}
 	}
 }
 
+/*
+===============
+SV_AddEntitiesFromView
+
+Copies the entities of a shared view that this client is allowed to see
+===============
+*/
+static void SV_AddEntitiesFromView(const snapshotView_t *view, clientSnapshot_t *frame, snapshotEntityNumbers_t *eNums) {
+	int				e;
+	sharedEntity_t *ent;
+
+	frame->areabytes = view->areabytes;
+	memcpy(frame->areabits, view->areabits, sizeof(frame->areabits));
+
+	// the view is a bitset, so the entities come out already sorted
+	for (e = 0; e < sv.num_entities; e++) {
+		if (!view->visible[e >> 3]) {
+			e |= 7; // skip the whole byte
+			continue;
+		}
+		if (!(view->visible[e >> 3] & (1 << (e & 7)))) { continue; }
+
+		// the client's own entity
+		if (SV_EntityAdded(eNums, e)) { continue; }
+
+		ent = SV_GentityNum(e);
+		if (SV_EntityHiddenFromClient(ent, eNums->clientNum, eNums)) {
+			if (eNums->error) { return; }
+			continue;
+		}
+
+		SV_AddEntToSnapshot(&sv.svEntities[e], ent, eNums);
+	}
+}
+
 /*
 =============
-SV_BuildClientSnapshot
+SV_ClientViewOrigin
+=============
+*/
+static void SV_ClientViewOrigin(const playerState_t *ps, vec3_t org) {
+	VectorCopy(ps->origin, org);
+	org[2] += ps->viewheight;
+}
+
+/*
+=============
+SV_SnapshotViewForClient
+
+Finds the view shared by the clients standing in the same cluster and area
+this frame, or starts a new one that SV_BuildSnapshotView has to cull.
+Main thread only.
+=============
+*/
+static snapshotView_t *SV_SnapshotViewForClient(client_t *client, qboolean *created) {
+	snapshotView_t *view;
+	vec3_t			org;
+	int				i, leafnum, cluster, area;
+
+	*created = qfalse;
+
+	if (!sv.state || !client->gentity || client->state == CS_ZOMBIE) { return NULL; }
+
+	SV_ClientViewOrigin(SV_GameClientNum(client - svs.clients), org);
+	leafnum = CM_PointLeafnum(org);
+	cluster = CM_LeafCluster(leafnum);
+	area	= CM_LeafArea(leafnum);
+
+	for (i = 0, view = svSnapshotViews; i < svNumSnapshotViews; i++, view++) {
+		if (view->cluster == cluster && view->area == area) { return view; }
+	}
+
+	if (!svSnapshotViews) { svSnapshotViews = Z_Malloc(MAX_CLIENTS * sizeof(*svSnapshotViews)); }
+	if (svNumSnapshotViews == MAX_CLIENTS) { return NULL; }
+
+	view		  = &svSnapshotViews[svNumSnapshotViews++];
+	view->cluster = cluster;
+	view->area	  = area;
+	VectorCopy(org, view->origin);
+	*created = qtrue;
+
+	return view;
+}
+
+/*
+=============
+SV_BuildSnapshotView
+
+Culls the entities for a view without the per client filters.  Safe to
+call for different views from worker threads.
+=============
+*/
+static void SV_BuildSnapshotView(snapshotView_t *view) {
+	snapshotEntityNumbers_t eNums;
+
+	eNums.numSnapshotEntities = 0;
+	eNums.clientNum			  = -1;
+	eNums.viewDependent		  = qfalse;
+	eNums.error				  = NULL;
+	memset(eNums.added, 0, sizeof(eNums.added));
+	memset(view->areabits, 0, sizeof(view->areabits));
+
+	// every visible entity is marked in added, even past MAX_SNAPSHOT_ENTITIES
+	SV_AddEntitiesVisibleFromPoint(view->origin, view->areabits, &view->areabytes, &eNums, qfalse);
+
+	memcpy(view->visible, eNums.added, sizeof(view->visible));
+	view->shared = !eNums.viewDependent && !eNums.error;
+}
+
+/*
+=============
+SV_PrepareSnapshots
+
+Makes sure every linked entity knows its own number before snapshots
+are built from it, collects the broadcast entities, which are sent
+no matter which clusters they are in, and forgets the previous pass'
+shared views and delta encodings
+=============
+*/
+static void SV_PrepareSnapshots(void) {
+	int				e;
+	sharedEntity_t *ent;
+
+	svNumSnapshotViews = 0;
+	SV_ClearDeltaCache();
+
+	if (!sv.state) { return; }
+
+	memset(sv.broadcastEntities, 0, sizeof(sv.broadcastEntities));
+
+	for (e = 0; e < sv.num_entities; e++) {
+		ent = SV_GentityNum(e);
+		if (!ent->r.linked) { continue; }
+
+		if (ent->s.number != e) {
+			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
+
+		if (ent->r.svFlags & SVF_BROADCAST) { sv.broadcastEntities[e >> 3] |= 1 << (e & 7); }
+	}
+}
+
+/*
+=============
+SV_BuildClientFrame
 
 Decides which entities are going to be visible to the client, and
 copies off the playerstate and areabits.
@@ -394,35 +784,38 @@ This properly handles multiple recursive portals, but the render
 currently doesn't.
 
 For viewing through other player's eyes, clent can be something other than client->gentity
+
+Only touches the client's own frame and eNums, so it is safe to call for
+different clients from worker threads.  Returns qfalse if the client has
+no entity to build a snapshot for.
+
+If the client has a shared view, its entities are filtered for the client
+instead of culling them again.
 =============
 */
-static void SV_BuildClientSnapshot(client_t *client) {
-	vec3_t					org;
-	clientSnapshot_t	   *frame;
-	snapshotEntityNumbers_t entityNumbers;
-	int						i;
-	sharedEntity_t		   *ent;
-	entityState_t		   *state;
-	svEntity_t			   *svEnt;
-	sharedEntity_t		   *clent;
-	int						clientNum;
-	playerState_t		   *ps;
-
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
+static qboolean SV_BuildClientFrame(client_t *client, snapshotEntityNumbers_t *eNums, const snapshotView_t *view) {
+	vec3_t			  org;
+	clientSnapshot_t *frame;
+	int				  i;
+	sharedEntity_t	 *clent;
+	int				  clientNum;
+	playerState_t	 *ps;
 
 	// this is the frame we are creating
 	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	eNums->numSnapshotEntities = 0;
+	eNums->viewDependent	   = qfalse;
+	eNums->error			   = NULL;
+	memset(eNums->added, 0, sizeof(eNums->added));
 	memset(frame->areabits, 0, sizeof(frame->areabits));
 
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=62
 	frame->num_entities = 0;
 
 	clent = client->gentity;
-	if (!clent || client->state == CS_ZOMBIE) { return; }
+	if (!clent || client->state == CS_ZOMBIE) { return qfalse; }
 
 	// grab the current playerState_t
 	ps		  = SV_GameClientNum(client - svs.clients);
@@ -431,42 +824,106 @@ static void SV_BuildClientSnapshot(client_t *client) {
 	// never send client's own entity, because it can
 	// be regenerated from the playerstate
 	clientNum = frame->ps.clientNum;
-	if (clientNum < 0 || clientNum >= MAX_GENTITIES) { Com_Error(ERR_DROP, "SV_SvEntityForGentity: bad gEnt"); }
-	svEnt = &sv.svEntities[clientNum];
-
-	svEnt->snapshotCounter = sv.snapshotCounter;
-
-	// find the client's viewpoint
-	VectorCopy(ps->origin, org);
-	org[2] += ps->viewheight;
-
-	// add all the entities directly visible to the eye, which
-	// may include portal entities that merge other viewpoints
-	SV_AddEntitiesVisibleFromPoint(org, frame, &entityNumbers, qfalse);
+	if (clientNum < 0 || clientNum >= MAX_GENTITIES) {
+		eNums->error = "SV_SvEntityForGentity: bad gEnt";
+		return qfalse;
+	}
+	eNums->clientNum = clientNum;
+	SV_MarkEntityAdded(eNums, clientNum);
 
-	// if there were portals visible, there may be out of order entities
-	// in the list which will need to be resorted for the delta compression
-	// to work correctly.  This also catches the error condition
-	// of an entity being included twice.
-	qsort(entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities, sizeof(entityNumbers.snapshotEntities[0]),
-		  SV_QsortEntityNumbers);
+	if (view && view->shared) {
+		SV_AddEntitiesFromView(view, frame, eNums);
+		if (eNums->error) { return qfalse; }
+	} else {
+		// find the client's viewpoint
+		SV_ClientViewOrigin(ps, org);
+
+		// add all the entities directly visible to the eye, which
+		// may include portal entities that merge other viewpoints
+		SV_AddEntitiesVisibleFromPoint(org, frame->areabits, &frame->areabytes, eNums, qfalse);
+		if (eNums->error) { return qfalse; }
+
+		// if there were portals visible, there may be out of order entities
+		// in the list which will need to be resorted for the delta compression
+		// to work correctly.  This also catches the error condition
+		// of an entity being included twice.
+		qsort(eNums->snapshotEntities, eNums->numSnapshotEntities, sizeof(eNums->snapshotEntities[0]),
+			  SV_QsortEntityNumbers);
+		for (i = 1; i < eNums->numSnapshotEntities; i++) {
+			if (eNums->snapshotEntities[i] == eNums->snapshotEntities[i - 1]) {
+				eNums->error = "SV_QsortEntityStates: duplicated entity";
+				return qfalse;
+			}
+		}
+	}
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
 	for (i = 0; i < MAX_MAP_AREA_BYTES / 4; i++) { ((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1; }
 
-	// copy the entity states out
-	frame->num_entities = 0;
+	return qtrue;
+}
+
+/*
+=============
+SV_AllocSnapshotEntities
+
+Reserves room for the frame's entities in the circular svs.snapshotEntities[],
+must be called in client order from the main thread
+=============
+*/
+static void SV_AllocSnapshotEntities(client_t *client, const snapshotEntityNumbers_t *eNums) {
+	clientSnapshot_t *frame;
+
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
 	frame->first_entity = svs.nextSnapshotEntities;
-	for (i = 0; i < entityNumbers.numSnapshotEntities; i++) {
-		ent	   = SV_GentityNum(entityNumbers.snapshotEntities[i]);
-		state  = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
-		*state = ent->s;
-		svs.nextSnapshotEntities++;
-		// this should never hit, map should always be restarted first in SV_Frame
-		if (svs.nextSnapshotEntities >= 0x7FFFFFFE) { Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped"); }
-		frame->num_entities++;
+	frame->num_entities = eNums->numSnapshotEntities;
+	svs.nextSnapshotEntities += eNums->numSnapshotEntities;
+
+	// this should never hit, map should always be restarted first in SV_Frame
+	if (svs.nextSnapshotEntities >= 0x7FFFFFFE) { Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped"); }
+}
+
+/*
+=============
+SV_CopySnapshotEntities
+
+Copies the entity states out into the space reserved by SV_AllocSnapshotEntities
+=============
+*/
+static void SV_CopySnapshotEntities(client_t *client, const snapshotEntityNumbers_t *eNums) {
+	clientSnapshot_t *frame;
+	int				  i;
+
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
+	for (i = 0; i < frame->num_entities; i++) {
+		svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities] =
+			SV_GentityNum(eNums->snapshotEntities[i])->s;
+	}
+}
+
+/*
+=============
+SV_BuildClientSnapshot
+=============
+*/
+static void SV_BuildClientSnapshot(client_t *client) {
+	snapshotEntityNumbers_t entityNumbers;
+	snapshotView_t		   *view;
+	qboolean				created;
+
+	view = SV_SnapshotViewForClient(client, &created);
+	if (created) { SV_BuildSnapshotView(view); }
+
+	if (!SV_BuildClientFrame(client, &entityNumbers, view)) {
+		if (entityNumbers.error) { Com_Error(ERR_DROP, "%s", entityNumbers.error); }
+		return;
 	}
+
+	SV_AllocSnapshotEntities(client, &entityNumbers);
+	SV_CopySnapshotEntities(client, &entityNumbers);
 }
 
 #ifdef USE_VOIP
@@ -530,15 +987,56 @@ void SV_SendMessageToClient(msg_t *msg, client_t *client) {
 
 /*
 =======================
-SV_SendClientSnapshot
+SV_WriteClientSnapshot
 
-Also called by SV_FinalMessage
+Writes everything that goes in front of the voip data, safe to call for
+different clients from worker threads
+=======================
+*/
+static void SV_WriteClientSnapshot(client_t *client, msg_t *msg, clientSnapshot_t *oldframe, int lastframe) {
+	// NOTE, MRE: all server->client messages now acknowledge
+	// let the client know which reliable clientCommands we have received
+	MSG_WriteLong(msg, client->lastClientCommand);
+
+	// (re)send any reliable server commands
+	SV_UpdateServerCommandsToClient(client, msg);
+
+	// send over all the relevant entityState_t
+	// and the playerState_t
+	SV_WriteSnapshotToClient(client, msg, oldframe, lastframe);
+}
 
+/*
+=======================
+SV_TransmitClientSnapshot
 =======================
 */
-void SV_SendClientSnapshot(client_t *client) {
-	byte  msg_buf[MAX_MSGLEN];
-	msg_t msg;
+static void SV_TransmitClientSnapshot(client_t *client, msg_t *msg) {
+#ifdef USE_VOIP
+	SV_WriteVoipToClient(client, msg);
+#endif
+
+	// check for overflow
+	if (msg->overflowed) {
+		Com_Printf("WARNING: msg overflowed for %s\n", client->name);
+		MSG_Clear(msg);
+	}
+
+	SV_SendMessageToClient(msg, client);
+}
+
+/*
+=======================
+SV_BuildAndSendClientSnapshot
+
+SV_PrepareSnapshots must have been called since the entities last changed
+=======================
+*/
+static void SV_BuildAndSendClientSnapshot(client_t *client) {
+	byte			  msg_buf[MAX_MSGLEN];
+	msg_t			  msg;
+	clientSnapshot_t *oldframe;
+	int				  lastframe;
 
 	// build the snapshot
 	SV_BuildClientSnapshot(client);
@@ -550,28 +1048,145 @@ void SV_SendClientSnapshot(client_t *client) {
 	MSG_Init(&msg, msg_buf, sizeof(msg_buf));
 	msg.allowoverflow = qtrue;
 
-	// NOTE, MRE: all server->client messages now acknowledge
-	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong(&msg, client->lastClientCommand);
+	lastframe = SV_SelectDeltaFrame(client, &oldframe);
+	SV_WriteClientSnapshot(client, &msg, oldframe, lastframe);
+	SV_TransmitClientSnapshot(client, &msg);
+}
 
-	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient(client, &msg);
+/*
+=======================
+SV_SendClientSnapshot
 
-	// send over all the relevant entityState_t
-	// and the playerState_t
-	SV_WriteSnapshotToClient(client, &msg);
+Also called by SV_FinalMessage
 
-#ifdef USE_VOIP
-	SV_WriteVoipToClient(client, &msg);
-#endif
+=======================
+*/
+void SV_SendClientSnapshot(client_t *client) {
+	SV_PrepareSnapshots();
+	SV_BuildAndSendClientSnapshot(client);
+}
 
-	// check for overflow
-	if (msg.overflowed) {
-		Com_Printf("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear(&msg);
+/*
+=============================================================================
+
+Threaded snapshots
+
+With sv_snapshotThreads set, the snapshots of all clients that are due in
+a frame are culled and delta encoded on worker threads.  Everything that
+depends on the order clients are processed in (snapshot entity allocation,
+delta frame selection, voip, transmission) stays on the main thread and runs
+in client order, so the messages are byte for byte the same as the ones
+SV_SendClientSnapshot would produce.
+
+=============================================================================
+*/
+
+typedef struct {
+	client_t			   *client;
+	snapshotView_t		   *view;
+	qboolean				built; // frame has entities to copy out
+	qboolean				isBot; // snapshot is built but never sent
+	qboolean				written;
+	clientSnapshot_t	   *oldframe;
+	int						lastframe;
+	snapshotEntityNumbers_t entityNumbers;
+	msg_t					msg;
+	byte					msgBuf[MAX_MSGLEN];
+} snapshotJob_t;
+
+static snapshotJob_t *svSnapshotJobs; // [MAX_CLIENTS]
+
+/*
+=======================
+SV_BuildSnapshotJob
+=======================
+*/
+static void SV_BuildSnapshotJob(void *data, int index) {
+	snapshotJob_t *job = &((snapshotJob_t *)data)[index];
+
+	job->built = SV_BuildClientFrame(job->client, &job->entityNumbers, job->view);
+}
+
+/*
+=======================
+SV_BuildSnapshotViewJob
+=======================
+*/
+static void SV_BuildSnapshotViewJob(void *data, int index) { SV_BuildSnapshotView(&((snapshotView_t *)data)[index]); }
+
+/*
+=======================
+SV_WriteSnapshotJob
+=======================
+*/
+static void SV_WriteSnapshotJob(void *data, int index) {
+	snapshotJob_t *job = &((snapshotJob_t *)data)[index];
+
+	if (job->written) { return; }
+
+	if (job->built) { SV_CopySnapshotEntities(job->client, &job->entityNumbers); }
+
+	if (!job->isBot) {
+		MSG_Init(&job->msg, job->msgBuf, sizeof(job->msgBuf));
+		job->msg.allowoverflow = qtrue;
+		SV_WriteClientSnapshot(job->client, &job->msg, job->oldframe, job->lastframe);
 	}
+}
+
+/*
+=======================
+SV_SendClientSnapshotsThreaded
+=======================
+*/
+static void SV_SendClientSnapshotsThreaded(client_t **clients, int numClients) {
+	snapshotJob_t *job;
+	qboolean	   created;
+	int			   i;
+
+	if (!svSnapshotJobs) { svSnapshotJobs = Z_Malloc(MAX_CLIENTS * sizeof(*svSnapshotJobs)); }
+
+	SV_PrepareSnapshots();
+
+	for (i = 0, job = svSnapshotJobs; i < numClients; i++, job++) {
+		job->client	   = clients[i];
+		job->view	   = SV_SnapshotViewForClient(job->client, &created);
+		job->isBot	   = job->client->gentity && (job->client->gentity->r.svFlags & SVF_BOT);
+		job->written   = qfalse;
+		job->oldframe  = NULL;
+		job->lastframe = 0;
+	}
+
+	// cull the entities once for every distinct viewpoint, then filter
+	// them for every client
+	Sys_RunJobs(SV_BuildSnapshotViewJob, svSnapshotViews, svNumSnapshotViews);
+	Sys_RunJobs(SV_BuildSnapshotJob, svSnapshotJobs, numClients);
+
+	// hand out the snapshot entities in client order and pick the delta frames
+	// the same way a serial pass over the clients would
+	for (i = 0, job = svSnapshotJobs; i < numClients; i++, job++) {
+		if (job->entityNumbers.error) { Com_Error(ERR_DROP, "%s", job->entityNumbers.error); }
+		if (job->built) { SV_AllocSnapshotEntities(job->client, &job->entityNumbers); }
+		if (!job->isBot) { job->lastframe = SV_SelectDeltaFrame(job->client, &job->oldframe); }
+	}
+
+	// a delta frame that was still valid when it was picked can be overwritten by
+	// entities allocated to later clients, those have to be written right now
+	for (i = 0, job = svSnapshotJobs; i < numClients; i++, job++) {
+		if (job->oldframe && job->oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities) {
+			SV_WriteSnapshotJob(svSnapshotJobs, i);
+			job->written = qtrue;
+		}
+	}
+
+	// copy out the entity states and delta encode everything else
+	Sys_RunJobs(SV_WriteSnapshotJob, svSnapshotJobs, numClients);
 
-	SV_SendMessageToClient(&msg, client);
+	// transmit in client order
+	for (i = 0, job = svSnapshotJobs; i < numClients; i++, job++) {
+		if (!job->isBot) { SV_TransmitClientSnapshot(job->client, &job->msg); }
+		job->client->lastSnapshotTime = svs.time;
+		job->client->rateDelayed	  = qfalse;
+	}
 }
 
 /*
@@ -582,6 +1197,17 @@ SV_SendClientMessages
 void SV_SendClientMessages(void) {
 	int		  i;
 	client_t *c;
+	client_t *snapshotClients[MAX_CLIENTS];
+	int		  numSnapshotClients;
+	qboolean  prepared;
+
+	if (sv_snapshotThreads->modified) {
+		Sys_SetWorkerThreads(sv_snapshotThreads->integer);
+		sv_snapshotThreads->modified = qfalse;
+	}
+
+	numSnapshotClients = 0;
+	prepared		   = qfalse;
 
 	// send a message to each connected client
 	for (i = 0; i < sv_maxclients->integer; i++) {
@@ -608,9 +1234,21 @@ void SV_SendClientMessages(void) {
 			}
 		}
 
-		// generate and send a new message
-		SV_SendClientSnapshot(c);
+		if (sv_snapshotThreads->integer) {
+			snapshotClients[numSnapshotClients++] = c;
+			continue;
+		}
+
+		// generate and send a new message, the clients share the views
+		// culled for the ones before them
+		if (!prepared) {
+			SV_PrepareSnapshots();
+			prepared = qtrue;
+		}
+		SV_BuildAndSendClientSnapshot(c);
 		c->lastSnapshotTime = svs.time;
 		c->rateDelayed		= qfalse;
 	}
+
+	if (numSnapshotClients) { SV_SendClientSnapshotsThreaded(snapshotClients, numSnapshotClients); }
 }
@@ -52,85 +52,496 @@ clipHandle_t SV_ClipHandleForEntity(const sharedEntity_t *ent) {
 ENTITY CHECKING
 
 To avoid linearly searching through lists of entities during environment testing,
-the world is carved up with an evenly spaced, axially aligned bsp tree.  Entities
-are kept in chains either at the final leafs, or at the first node that splits
-them, which prevents having to deal with multiple fragments of a single entity.
+entities are kept in a dynamic bounding volume tree.  Every leaf holds one entity,
+every inner node encloses its two children, and the tree is kept balanced with
+rotations as entities come and go.  An entity that moves gets a fat box with some
+room around it, so it only has to be reinserted when it leaves that box.
 
 ===============================================================================
 */
 
-typedef struct worldSector_s {
-	int					  axis; // -1 = leaf node
-	float				  dist;
-	struct worldSector_s *children[2];
-	svEntity_t			 *entities;
-} worldSector_t;
+typedef struct entityNode_s {
+	vec3_t				 mins, maxs;  // leafs: the fat entity box, nodes: enclose both children
+	struct entityNode_s *parent;	  // next free node when on the free list
+	struct entityNode_s *children[2]; // NULL for leafs
+	int					 height;	  // leafs are 0
+	svEntity_t			*entity;	  // leafs only
+} entityNode_t;
+
+#define MAX_ENTITY_NODES   (MAX_GENTITIES * 2)
+#define ENTITY_NODE_MARGIN 16 // room given to moving entities
+#define ENTITY_NODE_SLACK  64 // fat boxes this much larger than the entity are refit
+
+static entityNode_t	 sv_entityNodes[MAX_ENTITY_NODES];
+static entityNode_t *sv_entityRoot;
+static entityNode_t *sv_freeEntityNodes;
+static int			 sv_numEntityNodes;
+
+static struct {
+	int links, reinserts;
+	int queries;
+	int nodesTested;
+	int candidates; // entity boxes tested
+	int results;
+
+	int startTime;		   // sv.time the counts start at
+	int leafWalks;		   // leaf lookups for moved entities
+	int leafWalksFromCell; // of those, started below the root
+	int leafWalksSkipped;  // relinked without moving
+} sv_entityTreeStats;
 
-#define AREA_DEPTH 4
-#define AREA_NODES 64
+/*
+===============
+SV_BoxArea
+
+Half the surface area, the cost of a node in the tree
+===============
+*/
+static float SV_BoxArea(const vec3_t mins, const vec3_t maxs) {
+	vec3_t size;
+
+	VectorSubtract(maxs, mins, size);
+	return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+/*
+===============
+SV_UnionArea
+===============
+*/
+static float SV_UnionArea(const entityNode_t *a, const entityNode_t *b) {
+	vec3_t mins, maxs;
+	int	   i;
+
+	for (i = 0; i < 3; i++) {
+		mins[i] = MIN(a->mins[i], b->mins[i]);
+		maxs[i] = MAX(a->maxs[i], b->maxs[i]);
+	}
+	return SV_BoxArea(mins, maxs);
+}
+
+/*
+===============
+SV_FitEntityNode
+
+Recomputes the bounds and height of an inner node from its children
+===============
+*/
+static void SV_FitEntityNode(entityNode_t *node) {
+	entityNode_t *a, *b;
+	int			  i;
+
+	a = node->children[0];
+	b = node->children[1];
+	for (i = 0; i < 3; i++) {
+		node->mins[i] = MIN(a->mins[i], b->mins[i]);
+		node->maxs[i] = MAX(a->maxs[i], b->maxs[i]);
+	}
+	node->height = 1 + MAX(a->height, b->height);
+}
+
+/*
+===============
+SV_AllocEntityNode
+===============
+*/
+static entityNode_t *SV_AllocEntityNode(void) {
+	entityNode_t *node;
+
+	node = sv_freeEntityNodes;
+	if (!node) {
+		Com_Error(ERR_DROP, "SV_AllocEntityNode: no free nodes");
+	}
+	sv_freeEntityNodes = node->parent;
+	sv_numEntityNodes++;
+
+	memset(node, 0, sizeof(*node));
+	return node;
+}
+
+/*
+===============
+SV_FreeEntityNode
+===============
+*/
+static void SV_FreeEntityNode(entityNode_t *node) {
+	node->parent	   = sv_freeEntityNodes;
+	node->height	   = -1;
+	sv_freeEntityNodes = node;
+	sv_numEntityNodes--;
+}
+
+/*
+===============
+SV_ReplaceEntityChild
+
+Puts node in the place of child, below child's parent or at the root
+===============
+*/
+static void SV_ReplaceEntityChild(entityNode_t *parent, entityNode_t *child, entityNode_t *node) {
+	node->parent = parent;
+	if (!parent) {
+		sv_entityRoot = node;
+	} else if (parent->children[0] == child) {
+		parent->children[0] = node;
+	} else {
+		parent->children[1] = node;
+	}
+}
+
+/*
+===============
+SV_BalanceEntityNode
+
+If one child of a is more than one level taller than the other, rotate
+it up to take the place of a.  Returns the root of the subtree.
+===============
+*/
+static entityNode_t *SV_BalanceEntityNode(entityNode_t *a) {
+	entityNode_t *up, *f, *g;
+	int			  balance, side;
+
+	if (!a->children[0] || a->height < 2) { return a; }
+
+	balance = a->children[1]->height - a->children[0]->height;
+	if (balance > 1) {
+		side = 1;
+	} else if (balance < -1) {
+		side = 0;
+	} else {
+		return a;
+	}
+
+	up = a->children[side];
+	f  = up->children[0];
+	g  = up->children[1];
+
+	// swap a and up
+	SV_ReplaceEntityChild(a->parent, a, up);
+	up->children[0] = a;
+	a->parent		= up;
+
+	// the taller grandchild stays with up, the other one moves down to a
+	if (f->height > g->height) {
+		up->children[1]	 = f;
+		a->children[side] = g;
+		g->parent		  = a;
+	} else {
+		up->children[1]	 = g;
+		a->children[side] = f;
+		f->parent		  = a;
+	}
+
+	SV_FitEntityNode(a);
+	SV_FitEntityNode(up);
+	return up;
+}
+
+/*
+===============
+SV_RefitEntityNodes
 
-worldSector_t sv_worldSectors[AREA_NODES];
-int			  sv_numworldSectors;
+Walks up from node fixing bounds and heights after a change below it
+===============
+*/
+static void SV_RefitEntityNodes(entityNode_t *node) {
+	while (node) {
+		node = SV_BalanceEntityNode(node);
+		SV_FitEntityNode(node);
+		node = node->parent;
+	}
+}
+
+/*
+===============
+SV_InsertEntityLeaf
+
+Pairs the leaf with the sibling that grows the tree the least
+===============
+*/
+static void SV_InsertEntityLeaf(entityNode_t *leaf) {
+	entityNode_t *node, *parent, *child;
+	float		  area, combined, inherit, cost, childCost[2];
+	int			  i;
+
+	if (!sv_entityRoot) {
+		sv_entityRoot = leaf;
+		leaf->parent  = NULL;
+		return;
+	}
+
+	// find the best sibling
+	node = sv_entityRoot;
+	while (node->children[0]) {
+		area	 = SV_BoxArea(node->mins, node->maxs);
+		combined = SV_UnionArea(node, leaf);
+
+		// cost of making a new parent for this node and the leaf
+		cost = 2 * combined;
+
+		// minimum cost of pushing the leaf further down the tree
+		inherit = 2 * (combined - area);
+
+		for (i = 0; i < 2; i++) {
+			child = node->children[i];
+			if (!child->children[0]) {
+				childCost[i] = SV_UnionArea(child, leaf) + inherit;
+			} else {
+				childCost[i] = SV_UnionArea(child, leaf) - SV_BoxArea(child->mins, child->maxs) + inherit;
+			}
+		}
+
+		if (cost < childCost[0] && cost < childCost[1]) { break; }
+
+		node = node->children[childCost[1] < childCost[0]];
+	}
+
+	// create a new parent for the sibling and the leaf
+	parent = SV_AllocEntityNode();
+	SV_ReplaceEntityChild(node->parent, node, parent);
+	parent->children[0] = node;
+	parent->children[1] = leaf;
+	node->parent		= parent;
+	leaf->parent		= parent;
+
+	SV_RefitEntityNodes(parent);
+}
+
+/*
+===============
+SV_RemoveEntityLeaf
+===============
+*/
+static void SV_RemoveEntityLeaf(entityNode_t *leaf) {
+	entityNode_t *parent, *sibling;
+
+	if (leaf == sv_entityRoot) {
+		sv_entityRoot = NULL;
+		return;
+	}
+
+	parent	= leaf->parent;
+	sibling = parent->children[parent->children[0] == leaf];
+
+	// the sibling takes the place of the parent
+	SV_ReplaceEntityChild(parent->parent, parent, sibling);
+	SV_FreeEntityNode(parent);
+
+	SV_RefitEntityNodes(sibling->parent);
+}
+
+/*
+===============
+SV_LinkEntityNode
+
+Puts the entity box into the tree, an entity that is already linked is
+only reinserted when it left its fat box
+===============
+*/
+static void SV_LinkEntityNode(svEntity_t *ent, const vec3_t absmin, const vec3_t absmax) {
+	entityNode_t *leaf;
+	float		  margin;
+	int			  i;
+
+	sv_entityTreeStats.links++;
+
+	leaf = ent->worldNode;
+	if (leaf) {
+		for (i = 0; i < 3; i++) {
+			if (absmin[i] < leaf->mins[i] || absmax[i] > leaf->maxs[i]) { break; }
+			if (absmin[i] - leaf->mins[i] > ENTITY_NODE_SLACK || leaf->maxs[i] - absmax[i] > ENTITY_NODE_SLACK) {
+				break;
+			}
+		}
+		if (i == 3) {
+			return; // still inside its fat box
+		}
+
+		SV_RemoveEntityLeaf(leaf);
+		sv_entityTreeStats.reinserts++;
+
+		// it moved, give it some room
+		margin = ENTITY_NODE_MARGIN;
+	} else {
+		leaf			= SV_AllocEntityNode();
+		leaf->entity	= ent;
+		ent->worldNode	= leaf;
+
+		// most entities never move after the first link
+		margin = 0;
+	}
+
+	for (i = 0; i < 3; i++) {
+		leaf->mins[i] = absmin[i] - margin;
+		leaf->maxs[i] = absmax[i] + margin;
+	}
+	leaf->height = 0;
+
+	SV_InsertEntityLeaf(leaf);
+}
+
+/*
+===============
+SV_UnlinkEntityNode
+===============
+*/
+static void SV_UnlinkEntityNode(svEntity_t *ent) {
+	entityNode_t *leaf;
+
+	leaf = ent->worldNode;
+	if (!leaf) {
+		return; // not linked in anywhere
+	}
+
+	SV_RemoveEntityLeaf(leaf);
+	SV_FreeEntityNode(leaf);
+	ent->worldNode = NULL;
+}
 
 /*
 ===============
 SV_SectorList_f
+
+Entity tree statistics since the last call
 ===============
 */
 void SV_SectorList_f(void) {
-	int			   i, c;
-	worldSector_t *sec;
-	svEntity_t	  *ent;
+	int leafs, frames;
+
+	if (!com_sv_running->integer) {
+		Com_Printf("Server is not running.\n");
+		return;
+	}
 
-	for (i = 0; i < AREA_NODES; i++) {
-		sec = &sv_worldSectors[i];
+	leafs = (sv_numEntityNodes + 1) / 2;
+	Com_Printf("entity tree: %i nodes, %i entities, height %i\n", sv_numEntityNodes, sv_entityRoot ? leafs : 0,
+			   sv_entityRoot ? sv_entityRoot->height : 0);
+	Com_Printf("links: %i, %i reinserted\n", sv_entityTreeStats.links, sv_entityTreeStats.reinserts);
+	Com_Printf("area queries: %i\n", sv_entityTreeStats.queries);
+	if (sv_entityTreeStats.queries) {
+		Com_Printf("per query: %.1f nodes tested, %.1f candidates, %.1f entities returned\n",
+				   (float)sv_entityTreeStats.nodesTested / sv_entityTreeStats.queries,
+				   (float)sv_entityTreeStats.candidates / sv_entityTreeStats.queries,
+				   (float)sv_entityTreeStats.results / sv_entityTreeStats.queries);
+	}
 
-		c = 0;
-		for (ent = sec->entities; ent; ent = ent->nextEntityInWorldSector) { c++; }
-		Com_Printf("sector %i: %i entities\n", i, c);
+	frames = (sv.time - sv_entityTreeStats.startTime) * sv_fps->integer / 1000;
+	Com_Printf("leaf lookups: %i, %i started below the root, %i skipped for entities that didn't move\n",
+			   sv_entityTreeStats.leafWalks, sv_entityTreeStats.leafWalksFromCell, sv_entityTreeStats.leafWalksSkipped);
+	if (frames > 0) {
+		Com_Printf("per frame: %.1f lookups, %.1f skipped\n", (float)sv_entityTreeStats.leafWalks / frames,
+				   (float)sv_entityTreeStats.leafWalksSkipped / frames);
 	}
+
+	memset(&sv_entityTreeStats, 0, sizeof(sv_entityTreeStats));
+	sv_entityTreeStats.startTime = sv.time;
 }
 
+/*
+===============================================================================
+
+TRACE CACHE
+
+Traces that were only clipped by the world are kept for the rest of the server
+frame, so the same move issued again by another player, bot or item check
+does not sweep the BSP again.  Such a result can only go stale when something
+that could block the move gets linked, so linking an entity with contents one
+of the cached traces was looking for flushes the cache.
+
+===============================================================================
+*/
+
+#define TRACE_CACHE_SIZE 1024 // must be a power of two
+
+typedef struct {
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	int	   passEntityNum;
+	int	   contentmask;
+	int	   capsule;
+} traceCacheKey_t;
+
+typedef struct {
+	traceCacheKey_t key;
+	int				generation; // stale unless it matches svTraceCache.generation
+	trace_t			trace;
+} traceCacheEntry_t;
+
+static struct {
+	int				  time;		  // sv.time the entries were traced at
+	int				  generation; // bumped to drop every entry
+	int				  contents;	  // contentmasks of the cached traces
+	traceCacheEntry_t entries[TRACE_CACHE_SIZE];
+
+	int hits, misses;
+	int uncached; // also clipped against entities
+	int flushes;  // dropped by entity links
+} svTraceCache;
+
 /*
 ===============
-SV_CreateworldSector
+SV_FlushTraceCache
 
-Builds a uniformly subdivided tree for the given world size
 ===============
 */
-static worldSector_t *SV_CreateworldSector(int depth, vec3_t mins, vec3_t maxs) {
-	worldSector_t *anode;
-	vec3_t		   size;
-	vec3_t		   mins1, maxs1, mins2, maxs2;
+static void SV_FlushTraceCache(void) {
+	svTraceCache.generation++;
+	svTraceCache.contents = 0;
+}
 
-	anode = &sv_worldSectors[sv_numworldSectors];
-	sv_numworldSectors++;
+/*
+===============
+SV_TraceCacheHash
 
-	if (depth == AREA_DEPTH) {
-		anode->axis		   = -1;
-		anode->children[0] = anode->children[1] = NULL;
-		return anode;
+===============
+*/
+static unsigned SV_TraceCacheHash(const traceCacheKey_t *key) {
+	const unsigned *words;
+	unsigned		hash;
+	int				i;
+
+	words = (const unsigned *)key;
+	hash  = 2166136261u;
+	for (i = 0; i < sizeof(*key) / sizeof(*words); i++) {
+		hash = (hash ^ words[i]) * 16777619u;
 	}
 
-	VectorSubtract(maxs, mins, size);
-	if (size[0] > size[1]) {
-		anode->axis = 0;
-	} else {
-		anode->axis = 1;
+	return (hash ^ (hash >> 15)) & (TRACE_CACHE_SIZE - 1);
+}
+
+/*
+===============
+SV_TraceCacheLinked
+
+Drops the cached traces the entity might block now
+===============
+*/
+static void SV_TraceCacheLinked(const sharedEntity_t *gEnt) {
+	if (svTraceCache.contents & gEnt->r.contents) {
+		SV_FlushTraceCache();
+		svTraceCache.flushes++;
 	}
+}
 
-	anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
-	VectorCopy(mins, mins1);
-	VectorCopy(mins, mins2);
-	VectorCopy(maxs, maxs1);
-	VectorCopy(maxs, maxs2);
+/*
+===============
+SV_TraceCacheStats_f
 
-	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
+Reports how well the trace cache did since the last call
+===============
+*/
+void SV_TraceCacheStats_f(void) {
+	int lookups;
 
-	anode->children[0] = SV_CreateworldSector(depth + 1, mins2, maxs2);
-	anode->children[1] = SV_CreateworldSector(depth + 1, mins1, maxs1);
+	if (!sv_traceCache->integer) { Com_Printf("trace cache is disabled (sv_traceCache 0)\n"); }
 
-	return anode;
+	lookups = svTraceCache.hits + svTraceCache.misses;
+	Com_Printf("%i hits, %i misses", svTraceCache.hits, svTraceCache.misses);
+	if (lookups) { Com_Printf(", %.1f%% hit rate", 100.0 * svTraceCache.hits / lookups); }
+	Com_Printf("\n%i misses not cached because they hit entities, %i flushes by entity links\n",
+			   svTraceCache.uncached, svTraceCache.flushes);
+
+	svTraceCache.hits = svTraceCache.misses = svTraceCache.uncached = svTraceCache.flushes = 0;
 }
 
 /*
@@ -140,16 +551,83 @@ SV_ClearWorld
 ===============
 */
 void SV_ClearWorld(void) {
-	clipHandle_t h;
-	vec3_t		 mins, maxs;
+	int i;
+
+	memset(sv_entityNodes, 0, sizeof(sv_entityNodes));
+	sv_entityRoot	   = NULL;
+	sv_freeEntityNodes = NULL;
+	sv_numEntityNodes  = 0;
+	for (i = MAX_ENTITY_NODES - 1; i >= 0; i--) {
+		sv_entityNodes[i].parent = sv_freeEntityNodes;
+		sv_entityNodes[i].height = -1;
+		sv_freeEntityNodes		 = &sv_entityNodes[i];
+	}
+	memset(&sv_entityTreeStats, 0, sizeof(sv_entityTreeStats));
+	sv_entityTreeStats.startTime = sv.time;
+	SV_FlushTraceCache();
 
-	memset(sv_worldSectors, 0, sizeof(sv_worldSectors));
-	sv_numworldSectors = 0;
+	sv.numClusters	   = CM_NumClusters();
+	sv.clusterEntities = Hunk_Alloc(sv.numClusters * sizeof(*sv.clusterEntities), h_high);
+	memset(sv.unclusteredEntities, 0, sizeof(sv.unclusteredEntities));
+}
+
+/*
+===============
+SV_UnlinkEntityClusters
+
+Removes the entity from the cluster lists used for snapshot culling
+===============
+*/
+static void SV_UnlinkEntityClusters(svEntity_t *ent) {
+	clusterLink_t *link;
+	int			   i, num;
+
+	for (i = 0, link = ent->clusterLinks; i < ent->numClusterLinks; i++, link++) {
+		if (link->prev) {
+			link->prev->next = link->next;
+		} else {
+			sv.clusterEntities[link->cluster] = link->next;
+		}
+		if (link->next) { link->next->prev = link->prev; }
+	}
+	ent->numClusterLinks = 0;
+
+	num = ent - sv.svEntities;
+	sv.unclusteredEntities[num >> 3] &= ~(1 << (num & 7));
+}
+
+/*
+===============
+SV_LinkEntityClusters
+
+Adds the entity to the list of every cluster in its clusternums.  Entities
+whose clusters didn't all fit, or that reference clusters outside the
+visibility data, are flagged to be tested by every snapshot instead.
+===============
+*/
+static void SV_LinkEntityClusters(svEntity_t *ent) {
+	clusterLink_t *link;
+	int			   i, num, cluster;
+
+	num = ent - sv.svEntities;
+
+	for (i = 0; i < ent->numClusters; i++) {
+		cluster = ent->clusternums[i];
+		if (cluster < 0 || cluster >= sv.numClusters) {
+			sv.unclusteredEntities[num >> 3] |= 1 << (num & 7);
+			continue;
+		}
 
-	// get world map bounds
-	h = CM_InlineModel(0);
-	CM_ModelBounds(h, mins, maxs);
-	SV_CreateworldSector(0, mins, maxs);
+		link			= &ent->clusterLinks[ent->numClusterLinks++];
+		link->cluster	= cluster;
+		link->entityNum = num;
+		link->prev		= NULL;
+		link->next		= sv.clusterEntities[cluster];
+		if (link->next) { link->next->prev = link; }
+		sv.clusterEntities[cluster] = link;
+	}
+
+	if (ent->lastCluster) { sv.unclusteredEntities[num >> 3] |= 1 << (num & 7); }
 }
 
 /*
@@ -159,33 +637,84 @@ SV_UnlinkEntity
 ===============
 */
 void SV_UnlinkEntity(sharedEntity_t *gEnt) {
-	svEntity_t	  *ent;
-	svEntity_t	  *scan;
-	worldSector_t *ws;
+	svEntity_t *ent;
 
 	ent = SV_SvEntityForGentity(gEnt);
 
 	gEnt->r.linked = qfalse;
 
-	ws = ent->worldSector;
-	if (!ws) {
-		return; // not linked in anywhere
-	}
-	ent->worldSector = NULL;
+	SV_UnlinkEntityClusters(ent);
+	SV_UnlinkEntityNode(ent);
+}
 
-	if (ws->entities == ent) {
-		ws->entities = ent->nextEntityInWorldSector;
-		return;
+/*
+===============
+SV_FindEntityLeafs
+
+Fills in the clusters and areas of the entity from the leafs its abs box
+touches.  Small moves only walk the tree below the cell of the last lookup.
+Returns qfalse if the box is outside the world
+===============
+*/
+#define MAX_TOTAL_ENT_LEAFS 128
+static qboolean SV_FindEntityLeafs(const sharedEntity_t *gEnt, svEntity_t *ent) {
+	int leafs[MAX_TOTAL_ENT_LEAFS];
+	int cluster;
+	int num_leafs;
+	int i;
+	int area;
+	int lastLeaf;
+
+	ent->numClusters = 0;
+	ent->lastCluster = 0;
+	ent->areanum	 = -1;
+	ent->areanum2	 = -1;
+	ent->leafsValid	 = qfalse;
+
+	// get all leafs, including solids
+	num_leafs = CM_BoxLeafnumsCell(gEnt->r.absmin, gEnt->r.absmax, leafs, MAX_TOTAL_ENT_LEAFS, &lastLeaf,
+								   &ent->leafCell);
+	sv_entityTreeStats.leafWalks++;
+	if (ent->leafCell.reused) { sv_entityTreeStats.leafWalksFromCell++; }
+
+	if (!num_leafs) { return qfalse; }
+
+	// set areas, even from clusters that don't fit in the entity array
+	for (i = 0; i < num_leafs; i++) {
+		area = CM_LeafArea(leafs[i]);
+		if (area != -1) {
+			// doors may legally straggle two areas,
+			// but nothing should evern need more than that
+			if (ent->areanum != -1 && ent->areanum != area) {
+				if (ent->areanum2 != -1 && ent->areanum2 != area && sv.state == SS_LOADING) {
+					Com_DPrintf("Object %i touching 3 areas at %f %f %f\n", gEnt->s.number, gEnt->r.absmin[0],
+								gEnt->r.absmin[1], gEnt->r.absmin[2]);
+				}
+				ent->areanum2 = area;
+			} else {
+				ent->areanum = area;
+			}
+		}
 	}
 
-	for (scan = ws->entities; scan; scan = scan->nextEntityInWorldSector) {
-		if (scan->nextEntityInWorldSector == ent) {
-			scan->nextEntityInWorldSector = ent->nextEntityInWorldSector;
-			return;
+	// store as many explicit clusters as we can
+	ent->numClusters = 0;
+	for (i = 0; i < num_leafs; i++) {
+		cluster = CM_LeafCluster(leafs[i]);
+		if (cluster != -1) {
+			ent->clusternums[ent->numClusters++] = cluster;
+			if (ent->numClusters == MAX_ENT_CLUSTERS) { break; }
 		}
 	}
 
-	Com_Printf("WARNING: SV_UnlinkEntity: not found in worldSector\n");
+	// store off a last cluster if we need to
+	if (i != num_leafs) { ent->lastCluster = CM_LeafCluster(lastLeaf); }
+
+	VectorCopy(gEnt->r.absmin, ent->leafMins);
+	VectorCopy(gEnt->r.absmax, ent->leafMaxs);
+	ent->leafsValid = qtrue;
+
+	return qtrue;
 }
 
 /*
@@ -194,24 +723,13 @@ SV_LinkEntity
 
 ===============
 */
-#define MAX_TOTAL_ENT_LEAFS 128
 void SV_LinkEntity(sharedEntity_t *gEnt) {
-	worldSector_t *node;
-	int			   leafs[MAX_TOTAL_ENT_LEAFS];
-	int			   cluster;
-	int			   num_leafs;
-	int			   i, j, k;
-	int			   area;
-	int			   lastLeaf;
-	float		  *origin, *angles;
-	svEntity_t	  *ent;
+	int			i, j, k;
+	float	   *origin, *angles;
+	svEntity_t *ent;
 
 	ent = SV_SvEntityForGentity(gEnt);
 
-	if (ent->worldSector) {
-		SV_UnlinkEntity(gEnt); // unlink from old position
-	}
-
 	// encode the size into the entityState_t for client prediction
 	if (gEnt->r.bmodel) {
 		gEnt->s.solid = SOLID_BMODEL; // a solid_box will never create this value
@@ -266,67 +784,27 @@ void SV_LinkEntity(sharedEntity_t *gEnt) {
 	gEnt->r.absmax[2] += 1;
 
 	// link to PVS leafs
-	ent->numClusters = 0;
-	ent->lastCluster = 0;
-	ent->areanum	 = -1;
-	ent->areanum2	 = -1;
-
-	// get all leafs, including solids
-	num_leafs = CM_BoxLeafnums(gEnt->r.absmin, gEnt->r.absmax, leafs, MAX_TOTAL_ENT_LEAFS, &lastLeaf);
-
-	// if none of the leafs were inside the map, the
-	// entity is outside the world and can be considered unlinked
-	if (!num_leafs) { return; }
-
-	// set areas, even from clusters that don't fit in the entity array
-	for (i = 0; i < num_leafs; i++) {
-		area = CM_LeafArea(leafs[i]);
-		if (area != -1) {
-			// doors may legally straggle two areas,
-			// but nothing should evern need more than that
-			if (ent->areanum != -1 && ent->areanum != area) {
-				if (ent->areanum2 != -1 && ent->areanum2 != area && sv.state == SS_LOADING) {
-					Com_DPrintf("Object %i touching 3 areas at %f %f %f\n", gEnt->s.number, gEnt->r.absmin[0],
-								gEnt->r.absmin[1], gEnt->r.absmin[2]);
-				}
-				ent->areanum2 = area;
-			} else {
-				ent->areanum = area;
-			}
-		}
-	}
-
-	// store as many explicit clusters as we can
-	ent->numClusters = 0;
-	for (i = 0; i < num_leafs; i++) {
-		cluster = CM_LeafCluster(leafs[i]);
-		if (cluster != -1) {
-			ent->clusternums[ent->numClusters++] = cluster;
-			if (ent->numClusters == MAX_ENT_CLUSTERS) { break; }
-		}
+	SV_UnlinkEntityClusters(ent);
+
+	// entities that didn't move keep the leafs they had
+	if (ent->leafsValid && VectorCompare(gEnt->r.absmin, ent->leafMins) &&
+		VectorCompare(gEnt->r.absmax, ent->leafMaxs)) {
+		sv_entityTreeStats.leafWalksSkipped++;
+	} else if (!SV_FindEntityLeafs(gEnt, ent)) {
+		// if none of the leafs were inside the map, the
+		// entity is outside the world and can be considered unlinked
+		SV_UnlinkEntityNode(ent);
+		gEnt->r.linked = qfalse;
+		return;
 	}
 
-	// store off a last cluster if we need to
-	if (i != num_leafs) { ent->lastCluster = CM_LeafCluster(lastLeaf); }
+	SV_LinkEntityClusters(ent);
 
 	gEnt->r.linkcount++;
 
-	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-	while (1) {
-		if (node->axis == -1) break;
-		if (gEnt->r.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (gEnt->r.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break; // crosses the node
-	}
-
-	// link it in
-	ent->worldSector			 = node;
-	ent->nextEntityInWorldSector = node->entities;
-	node->entities				 = ent;
+	// link it in, or just move it if it is already in the tree
+	SV_LinkEntityNode(ent, gEnt->r.absmin, gEnt->r.absmax);
+	SV_TraceCacheLinked(gEnt);
 
 	gEnt->r.linked = qtrue;
 }
@@ -346,6 +824,7 @@ typedef struct {
 	const float *maxs;
 	int			*list;
 	int			 count, maxcount;
+	qboolean	 overflowed;
 } areaParms_t;
 
 /*
@@ -354,37 +833,45 @@ SV_AreaEntities_r
 
 ====================
 */
-static void SV_AreaEntities_r(worldSector_t *node, areaParms_t *ap) {
-	svEntity_t	   *check, *next;
+static void SV_AreaEntities_r(const entityNode_t *node, areaParms_t *ap) {
 	sharedEntity_t *gcheck;
 
-	for (check = node->entities; check; check = next) {
-		next = check->nextEntityInWorldSector;
+	while (!ap->overflowed) {
+		sv_entityTreeStats.nodesTested++;
 
-		gcheck = SV_GEntityForSvEntity(check);
-
-		if (gcheck->r.absmin[0] > ap->maxs[0] || gcheck->r.absmin[1] > ap->maxs[1] ||
-			gcheck->r.absmin[2] > ap->maxs[2] || gcheck->r.absmax[0] < ap->mins[0] ||
-			gcheck->r.absmax[1] < ap->mins[1] || gcheck->r.absmax[2] < ap->mins[2]) {
-			continue;
+		if (node->mins[0] > ap->maxs[0] || node->mins[1] > ap->maxs[1] || node->mins[2] > ap->maxs[2] ||
+			node->maxs[0] < ap->mins[0] || node->maxs[1] < ap->mins[1] || node->maxs[2] < ap->mins[2]) {
+			return;
 		}
 
-		if (ap->count == ap->maxcount) {
-			Com_Printf("SV_AreaEntities: MAXCOUNT\n");
-			return;
+		if (!node->children[0]) {
+			break;
 		}
 
-		ap->list[ap->count] = check - sv.svEntities;
-		ap->count++;
+		// recurse down one side and loop on the other
+		SV_AreaEntities_r(node->children[0], ap);
+		node = node->children[1];
+	}
+
+	if (ap->overflowed) { return; }
+
+	// the fat box overlaps, check the real one
+	sv_entityTreeStats.candidates++;
+
+	gcheck = SV_GEntityForSvEntity(node->entity);
+
+	if (gcheck->r.absmin[0] > ap->maxs[0] || gcheck->r.absmin[1] > ap->maxs[1] || gcheck->r.absmin[2] > ap->maxs[2] ||
+		gcheck->r.absmax[0] < ap->mins[0] || gcheck->r.absmax[1] < ap->mins[1] || gcheck->r.absmax[2] < ap->mins[2]) {
+		return;
 	}
 
-	if (node->axis == -1) {
-		return; // terminal node
+	if (ap->count == ap->maxcount) {
+		ap->overflowed = qtrue;
+		return;
 	}
 
-	// recurse down both sides
-	if (ap->maxs[node->axis] > node->dist) { SV_AreaEntities_r(node->children[0], ap); }
-	if (ap->mins[node->axis] < node->dist) { SV_AreaEntities_r(node->children[1], ap); }
+	ap->list[ap->count] = node->entity - sv.svEntities;
+	ap->count++;
 }
 
 /*
@@ -395,13 +882,19 @@ SV_AreaEntities
 int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount) {
 	areaParms_t ap;
 
-	ap.mins		= mins;
-	ap.maxs		= maxs;
-	ap.list		= entityList;
-	ap.count	= 0;
-	ap.maxcount = maxcount;
+	ap.mins		  = mins;
+	ap.maxs		  = maxs;
+	ap.list		  = entityList;
+	ap.count	  = 0;
+	ap.maxcount	  = maxcount;
+	ap.overflowed = qfalse;
+
+	if (sv_entityRoot) { SV_AreaEntities_r(sv_entityRoot, &ap); }
 
-	SV_AreaEntities_r(sv_worldSectors, &ap);
+	if (ap.overflowed) { Com_Printf("SV_AreaEntities: MAXCOUNT\n"); }
+
+	sv_entityTreeStats.queries++;
+	sv_entityTreeStats.results += ap.count;
 
 	return ap.count;
 }
@@ -463,19 +956,19 @@ void SV_ClipToEntity(trace_t *trace, const vec3_t start, const vec3_t mins, cons
 ====================
 SV_ClipMoveToEntities
 
+touchlist may hold entities around more than this move, the ones
+outside of the move bounds are skipped.
+Returns the number of entities that were clipped against
 ====================
 */
-static void SV_ClipMoveToEntities(moveclip_t *clip) {
-	int				i, num;
-	int				touchlist[MAX_GENTITIES];
+static int SV_ClipMoveToEntities(moveclip_t *clip, const int *touchlist, int num) {
+	int				i, numClipped;
 	sharedEntity_t *touch;
 	int				passOwnerNum;
 	trace_t			trace;
 	clipHandle_t	clipHandle;
 	float		   *origin, *angles;
 
-	num = SV_AreaEntities(clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
-
 	if (clip->passEntityNum != ENTITYNUM_NONE) {
 		passOwnerNum = (SV_GentityNum(clip->passEntityNum))->r.ownerNum;
 		if (passOwnerNum == ENTITYNUM_NONE) { passOwnerNum = -1; }
@@ -483,10 +976,18 @@ static void SV_ClipMoveToEntities(moveclip_t *clip) {
 		passOwnerNum = -1;
 	}
 
+	numClipped = 0;
 	for (i = 0; i < num; i++) {
-		if (clip->trace.allsolid) { return; }
+		if (clip->trace.allsolid) { break; }
 		touch = SV_GentityNum(touchlist[i]);
 
+		// same test SV_AreaEntities does
+		if (touch->r.absmin[0] > clip->boxmaxs[0] || touch->r.absmin[1] > clip->boxmaxs[1] ||
+			touch->r.absmin[2] > clip->boxmaxs[2] || touch->r.absmax[0] < clip->boxmins[0] ||
+			touch->r.absmax[1] < clip->boxmins[1] || touch->r.absmax[2] < clip->boxmins[2]) {
+			continue;
+		}
+
 		// see if we should ignore this entity
 		if (clip->passEntityNum != ENTITYNUM_NONE) {
 			if (touchlist[i] == clip->passEntityNum) {
@@ -516,6 +1017,7 @@ static void SV_ClipMoveToEntities(moveclip_t *clip) {
 
 		CM_TransformedBoxTrace(&trace, (float *)clip->start, (float *)clip->end, (float *)clip->mins,
 							   (float *)clip->maxs, clipHandle, clip->contentmask, origin, angles, clip->capsule);
+		numClipped++;
 
 		if (trace.allsolid) {
 			clip->trace.allsolid = qtrue;
@@ -536,6 +1038,92 @@ static void SV_ClipMoveToEntities(moveclip_t *clip) {
 			clip->trace.startsolid |= oldStart;
 		}
 	}
+
+	return numClipped;
+}
+
+/*
+==================
+SV_TraceMoves
+
+The world is swept with a single CM_BoxTraceBatch and the entities
+around all of the moves are gathered with a single area query.
+Returns qtrue if any entity was clipped against
+==================
+*/
+static qboolean SV_TraceMoves(trace_t *results, const traceRay_t *rays, int numRays, int passEntityNum,
+							  int contentmask, int capsule) {
+	moveclip_t clip;
+	int		   touchlist[MAX_GENTITIES];
+	int		   i, r, num;
+	int		   numClipped;
+	vec3_t	   mins, maxs;
+
+	if (numRays <= 0) { return qfalse; }
+
+	// clip to world
+	CM_BoxTraceBatch(results, rays, numRays, 0, contentmask, capsule);
+
+	ClearBounds(mins, maxs);
+	for (r = 0; r < numRays; r++) {
+		results[r].entityNum = results[r].fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
+		if (results[r].fraction == 0) {
+			continue; // blocked immediately by the world
+		}
+
+		// create the bounding box of the entire move
+		for (i = 0; i < 3; i++) {
+			if (rays[r].end[i] > rays[r].start[i]) {
+				mins[i] = MIN(mins[i], rays[r].start[i] + rays[r].mins[i] - 1);
+				maxs[i] = MAX(maxs[i], rays[r].end[i] + rays[r].maxs[i] + 1);
+			} else {
+				mins[i] = MIN(mins[i], rays[r].end[i] + rays[r].mins[i] - 1);
+				maxs[i] = MAX(maxs[i], rays[r].start[i] + rays[r].maxs[i] + 1);
+			}
+		}
+	}
+	if (mins[0] > maxs[0]) {
+		return qfalse; // all blocked by the world
+	}
+
+	num = SV_AreaEntities(mins, maxs, touchlist, MAX_GENTITIES);
+
+	numClipped = 0;
+	for (r = 0; r < numRays; r++) {
+		if (results[r].fraction == 0) { continue; }
+
+		memset(&clip, 0, sizeof(moveclip_t));
+		clip.trace		 = results[r];
+		clip.contentmask = contentmask;
+		clip.start		 = rays[r].start;
+		//	VectorCopy( clip.trace.endpos, clip.end );
+		VectorCopy(rays[r].end, clip.end);
+		clip.mins		   = rays[r].mins;
+		clip.maxs		   = rays[r].maxs;
+		clip.passEntityNum = passEntityNum;
+		clip.capsule	   = capsule;
+
+		// create the bounding box of the entire move
+		// we can limit it to the part of the move not
+		// already clipped off by the world, which can be
+		// a significant savings for line of sight and shot traces
+		for (i = 0; i < 3; i++) {
+			if (clip.end[i] > clip.start[i]) {
+				clip.boxmins[i] = clip.start[i] + clip.mins[i] - 1;
+				clip.boxmaxs[i] = clip.end[i] + clip.maxs[i] + 1;
+			} else {
+				clip.boxmins[i] = clip.end[i] + clip.mins[i] - 1;
+				clip.boxmaxs[i] = clip.start[i] + clip.maxs[i] + 1;
+			}
+		}
+
+		// clip to other solid entities
+		numClipped += SV_ClipMoveToEntities(&clip, touchlist, num);
+
+		results[r] = clip.trace;
+	}
+
+	return numClipped != 0;
 }
 
 /*
@@ -548,49 +1136,66 @@ passEntityNum and entities owned by passEntityNum are explicitly not checked.
 */
 void SV_Trace(trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int passEntityNum,
 			  int contentmask, int capsule) {
-	moveclip_t clip;
-	int		   i;
+	traceRay_t		   ray;
+	traceCacheKey_t	   key;
+	traceCacheEntry_t *entry;
 
 	if (!mins) { mins = vec3_origin; }
 	if (!maxs) { maxs = vec3_origin; }
 
-	memset(&clip, 0, sizeof(moveclip_t));
+	VectorCopy(start, ray.start);
+	VectorCopy(end, ray.end);
+	VectorCopy(mins, ray.mins);
+	VectorCopy(maxs, ray.maxs);
 
-	// clip to world
-	CM_BoxTrace(&clip.trace, start, end, mins, maxs, 0, contentmask, capsule);
-	clip.trace.entityNum = clip.trace.fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
-	if (clip.trace.fraction == 0) {
-		*results = clip.trace;
-		return; // blocked immediately by the world
-	}
-
-	clip.contentmask = contentmask;
-	clip.start		 = start;
-	//	VectorCopy( clip.trace.endpos, clip.end );
-	VectorCopy(end, clip.end);
-	clip.mins		   = mins;
-	clip.maxs		   = maxs;
-	clip.passEntityNum = passEntityNum;
-	clip.capsule	   = capsule;
-
-	// create the bounding box of the entire move
-	// we can limit it to the part of the move not
-	// already clipped off by the world, which can be
-	// a significant savings for line of sight and shot traces
-	for (i = 0; i < 3; i++) {
-		if (end[i] > start[i]) {
-			clip.boxmins[i] = clip.start[i] + clip.mins[i] - 1;
-			clip.boxmaxs[i] = clip.end[i] + clip.maxs[i] + 1;
-		} else {
-			clip.boxmins[i] = clip.end[i] + clip.mins[i] - 1;
-			clip.boxmaxs[i] = clip.start[i] + clip.maxs[i] + 1;
-		}
+	if (!sv_traceCache->integer) {
+		SV_TraceMoves(results, &ray, 1, passEntityNum, contentmask, capsule);
+		return;
+	}
+
+	if (svTraceCache.time != sv.time) {
+		SV_FlushTraceCache();
+		svTraceCache.time = sv.time;
+	}
+
+	VectorCopy(start, key.start);
+	VectorCopy(end, key.end);
+	VectorCopy(mins, key.mins);
+	VectorCopy(maxs, key.maxs);
+	key.passEntityNum = passEntityNum;
+	key.contentmask	  = contentmask;
+	key.capsule		  = capsule;
+
+	// only an exact match, a nearby move may stop somewhere else
+	entry = &svTraceCache.entries[SV_TraceCacheHash(&key)];
+	if (entry->generation == svTraceCache.generation && !memcmp(&entry->key, &key, sizeof(key))) {
+		*results = entry->trace;
+		svTraceCache.hits++;
+		return;
+	}
+	svTraceCache.misses++;
+
+	if (SV_TraceMoves(results, &ray, 1, passEntityNum, contentmask, capsule)) {
+		svTraceCache.uncached++;
+		return;
 	}
 
-	// clip to other solid entities
-	SV_ClipMoveToEntities(&clip);
+	entry->key		  = key;
+	entry->generation = svTraceCache.generation;
+	entry->trace	  = *results;
+	svTraceCache.contents |= contentmask;
+}
 
-	*results = clip.trace;
+/*
+==================
+SV_TraceBatch
+
+SV_Trace for numRays moves with the same pass entity and contents.
+==================
+*/
+void SV_TraceBatch(trace_t *results, const traceRay_t *rays, int numRays, int passEntityNum, int contentmask,
+				   int capsule) {
+	SV_TraceMoves(results, rays, numRays, passEntityNum, contentmask, capsule);
 }
 
 /*
@@ -0,0 +1,202 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sys_thread.c -- worker threads for data parallel jobs
+
+#include "qcommon/q_shared.h"
+#include "qcommon/qcommon.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+==============================================================================
+
+A small fixed pool of worker threads that run a job function over a range of
+indexes.  Sys_RunJobs blocks until every index has been processed, and the
+calling thread works on the range as well, so a pool of N workers gives N + 1
+threads of parallelism.
+
+Job functions must not call anything that is not thread safe: no Com_Printf,
+no Com_Error, no zone or hunk allocation, no cvar changes.
+
+==============================================================================
+*/
+
+typedef struct {
+	pthread_t threads[MAX_WORKER_THREADS];
+	int		  numThreads;
+
+	pthread_mutex_t lock;
+	pthread_cond_t	wake; // a new batch was posted or the pool is shutting down
+	pthread_cond_t	done; // the last worker left the current batch
+
+	int		 generation; // incremented for every batch
+	int		 active;	 // workers still inside the current batch
+	qboolean quit;
+
+	sysJobFunc_t func;
+	void		*data;
+	int			 count;
+	atomic_int	 next; // next index to hand out
+} workerPool_t;
+
+static workerPool_t pool;
+static qboolean		poolInitialized;
+
+/*
+=================
+Sys_DrainJobs
+
+Processes indexes of the current batch until none are left
+=================
+*/
+static void Sys_DrainJobs(sysJobFunc_t func, void *data, int count) {
+	int index;
+
+	while ((index = atomic_fetch_add_explicit(&pool.next, 1, memory_order_relaxed)) < count) { func(data, index); }
+}
+
+/*
+=================
+Sys_WorkerThread
+
+arg is the batch generation when the worker was created, only later batches
+are its to work on
+=================
+*/
+static void *Sys_WorkerThread(void *arg) {
+	int			 generation = (int)(intptr_t)arg;
+	sysJobFunc_t func;
+	void		*data;
+	int			 count;
+
+	pthread_mutex_lock(&pool.lock);
+	for (;;) {
+		while (pool.generation == generation && !pool.quit) { pthread_cond_wait(&pool.wake, &pool.lock); }
+		if (pool.quit) { break; }
+
+		generation = pool.generation;
+		func	   = pool.func;
+		data	   = pool.data;
+		count	   = pool.count;
+		pthread_mutex_unlock(&pool.lock);
+
+		Sys_DrainJobs(func, data, count);
+
+		pthread_mutex_lock(&pool.lock);
+		if (--pool.active == 0) { pthread_cond_signal(&pool.done); }
+	}
+	pthread_mutex_unlock(&pool.lock);
+
+	return NULL;
+}
+
+/*
+=================
+Sys_SetWorkerThreads
+
+(Re)creates the pool with the given number of workers, 0 stops all of them
+=================
+*/
+void Sys_SetWorkerThreads(int count) {
+	int i;
+
+	if (count < 0) {
+		count = 0;
+	} else if (count > MAX_WORKER_THREADS) {
+		count = MAX_WORKER_THREADS;
+	}
+
+	if (!poolInitialized) {
+		pthread_mutex_init(&pool.lock, NULL);
+		pthread_cond_init(&pool.wake, NULL);
+		pthread_cond_init(&pool.done, NULL);
+		poolInitialized = qtrue;
+	}
+
+	if (count == pool.numThreads) { return; }
+
+	// stop the old workers
+	if (pool.numThreads) {
+		pthread_mutex_lock(&pool.lock);
+		pool.quit = qtrue;
+		pthread_cond_broadcast(&pool.wake);
+		pthread_mutex_unlock(&pool.lock);
+
+		for (i = 0; i < pool.numThreads; i++) { pthread_join(pool.threads[i], NULL); }
+		pool.numThreads = 0;
+		pool.quit		= qfalse;
+	}
+
+	for (i = 0; i < count; i++) {
+		// no batch is running here, and one posted before the worker gets
+		// going has a newer generation, so it can't be missed or run twice
+		if (pthread_create(&pool.threads[i], NULL, Sys_WorkerThread, (void *)(intptr_t)pool.generation)) {
+			Com_Printf("WARNING: could only start %i of %i worker threads\n", i, count);
+			break;
+		}
+		pool.numThreads++;
+	}
+}
+
+/*
+=================
+Sys_WorkerThreads
+=================
+*/
+int Sys_WorkerThreads(void) { return pool.numThreads; }
+
+/*
+=================
+Sys_RunJobs
+
+Calls func(data, index) for every index in [0, count) and returns when all
+of them have completed.  Runs serially on the calling thread if no workers
+have been started.
+=================
+*/
+void Sys_RunJobs(sysJobFunc_t func, void *data, int count) {
+	int i;
+
+	if (count <= 0) { return; }
+
+	if (!pool.numThreads || count == 1) {
+		for (i = 0; i < count; i++) { func(data, i); }
+		return;
+	}
+
+	pthread_mutex_lock(&pool.lock);
+	pool.func  = func;
+	pool.data  = data;
+	pool.count = count;
+	atomic_store_explicit(&pool.next, 0, memory_order_relaxed);
+	pool.active = pool.numThreads;
+	pool.generation++;
+	pthread_cond_broadcast(&pool.wake);
+	pthread_mutex_unlock(&pool.lock);
+
+	Sys_DrainJobs(func, data, count);
+
+	pthread_mutex_lock(&pool.lock);
+	while (pool.active > 0) { pthread_cond_wait(&pool.done, &pool.lock); }
+	pthread_mutex_unlock(&pool.lock);
+}
@@ -20,6 +20,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 ===========================================================================
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // register names in ucontext_t, dl_iterate_phdr
+#endif
+
 #include "qcommon/q_shared.h"
 #include "qcommon/qcommon.h"
 #include "sys_local.h"
@@ -38,6 +42,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <fcntl.h>
 #include <fenv.h>
 #include <sys/wait.h>
+#include <pthread.h>
+#include <ucontext.h>
+#ifdef __linux__
+#include <link.h>
+#endif
 
 qboolean stdinIsATTY;
 
@@ -157,6 +166,21 @@ int Sys_Milliseconds(void) {
 	return curtime;
 }
 
+/*
+================
+Sys_Microseconds
+
+A monotonic clock for timing short stretches of code
+================
+*/
+int64_t Sys_Microseconds(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /*
 ==================
 Sys_RandomBytes
@@ -230,6 +254,190 @@ FILE *Sys_FOpen(const char *ospath, const char *mode) {
 	return fopen(ospath, mode);
 }
 
+/*
+==============
+Sys_MapFile
+
+Maps length bytes of f starting at offset read only, returns NULL if the
+file can't be mapped. The view stays valid after f is closed.
+==============
+*/
+void *Sys_MapFile(FILE *f, long offset, long length, void **handle) {
+	long  page, delta;
+	void *base;
+
+	if (offset < 0 || length <= 0) { return NULL; }
+
+	page  = sysconf(_SC_PAGESIZE);
+	delta = offset % page;
+	base  = mmap(NULL, delta + length, PROT_READ, MAP_PRIVATE, fileno(f), offset - delta);
+	if (base == MAP_FAILED) { return NULL; }
+
+	*handle = base;
+	return (byte *)base + delta;
+}
+
+/*
+==============
+Sys_UnmapFile
+==============
+*/
+void Sys_UnmapFile(void *data, long length, void *handle) {
+	munmap(handle, ((byte *)data - (byte *)handle) + length);
+}
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+#define SAMPLE_CONTEXT_SUPPORTED
+#elif defined(__APPLE__) && (defined(__x86_64__) || defined(__aarch64__))
+#define SAMPLE_CONTEXT_SUPPORTED
+#endif
+
+static sysSampleFunc_t volatile sampleFunc;
+static pthread_t				sampleThread;
+
+#ifdef SAMPLE_CONTEXT_SUPPORTED
+/*
+==============
+Sys_SampleSignal
+
+The profiling timer counts cpu time of the whole process and the signal
+lands on whichever thread is running, samples of other threads are ignored.
+==============
+*/
+static void Sys_SampleSignal(int sig, siginfo_t *info, void *context) {
+	ucontext_t	   *uc;
+	sysSampleFunc_t	func;
+	int				savedErrno;
+
+	uc	 = context;
+	func = sampleFunc;
+	if (!func || !pthread_equal(pthread_self(), sampleThread)) { return; }
+
+	savedErrno = errno;
+#if defined(__linux__) && defined(__x86_64__)
+	func((void *)uc->uc_mcontext.gregs[REG_RIP], (void *)uc->uc_mcontext.gregs[REG_RSP]);
+#elif defined(__linux__) && defined(__i386__)
+	func((void *)uc->uc_mcontext.gregs[REG_EIP], (void *)uc->uc_mcontext.gregs[REG_ESP]);
+#elif defined(__linux__) && defined(__aarch64__)
+	func((void *)uc->uc_mcontext.pc, (void *)uc->uc_mcontext.sp);
+#elif defined(__APPLE__) && defined(__x86_64__)
+	func((void *)uc->uc_mcontext->__ss.__rip, (void *)uc->uc_mcontext->__ss.__rsp);
+#elif defined(__APPLE__) && defined(__aarch64__)
+	func((void *)uc->uc_mcontext->__ss.__pc, (void *)uc->uc_mcontext->__ss.__sp);
+#endif
+	errno = savedErrno;
+}
+#endif
+
+/*
+==============
+Sys_StartSampling
+
+Calls func hz times per second of cpu time with the main thread's registers,
+must be called from the main thread.
+==============
+*/
+qboolean Sys_StartSampling(int hz, sysSampleFunc_t func) {
+#ifdef SAMPLE_CONTEXT_SUPPORTED
+	struct sigaction sa;
+	struct itimerval timer;
+
+	if (hz < 1 || hz > 10000) { return qfalse; }
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = Sys_SampleSignal;
+	sa.sa_flags		= SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, NULL)) { return qfalse; }
+
+	sampleThread = pthread_self();
+	sampleFunc	 = func;
+
+	timer.it_interval.tv_sec  = hz == 1 ? 1 : 0;
+	timer.it_interval.tv_usec = hz == 1 ? 0 : 1000000 / hz;
+	timer.it_value			  = timer.it_interval;
+	if (setitimer(ITIMER_PROF, &timer, NULL)) {
+		sampleFunc = NULL;
+		return qfalse;
+	}
+
+	return qtrue;
+#else
+	return qfalse;
+#endif
+}
+
+/*
+==============
+Sys_StopSampling
+==============
+*/
+void Sys_StopSampling(void) {
+#ifdef SAMPLE_CONTEXT_SUPPORTED
+	struct itimerval timer;
+
+	memset(&timer, 0, sizeof(timer));
+	setitimer(ITIMER_PROF, &timer, NULL);
+
+	// a signal that is already pending sees the cleared callback
+	sampleFunc = NULL;
+	signal(SIGPROF, SIG_IGN);
+#endif
+}
+
+#ifdef __linux__
+typedef struct {
+	byte  *address;
+	byte  *base;
+	byte  *code;
+	size_t codeSize;
+} moduleSearch_t;
+
+static int Sys_FindModuleCode(struct dl_phdr_info *info, size_t size, void *data) {
+	moduleSearch_t *search = data;
+	byte		   *start;
+	int				i;
+
+	for (i = 0; i < info->dlpi_phnum; i++) {
+		if (info->dlpi_phdr[i].p_type != PT_LOAD || !(info->dlpi_phdr[i].p_flags & PF_X)) { continue; }
+
+		start = (byte *)info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+		if (search->address >= start && search->address < start + info->dlpi_phdr[i].p_memsz) {
+			search->base	 = (byte *)info->dlpi_addr;
+			search->code	 = start;
+			search->codeSize = info->dlpi_phdr[i].p_memsz;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+#endif
+
+/*
+==============
+Sys_ModuleCode
+
+base is the load bias, so address - base is what addr2line expects.
+==============
+*/
+qboolean Sys_ModuleCode(void *address, byte **base, byte **code, size_t *codeSize) {
+#ifdef __linux__
+	moduleSearch_t search;
+
+	memset(&search, 0, sizeof(search));
+	search.address = address;
+	if (!dl_iterate_phdr(Sys_FindModuleCode, &search)) { return qfalse; }
+
+	*base	  = search.base;
+	*code	  = search.code;
+	*codeSize = search.codeSize;
+	return qtrue;
+#else
+	return qfalse;
+#endif
+}
+
 /*
 ==================
 Sys_Mkdir
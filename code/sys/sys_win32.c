@@ -269,6 +269,24 @@ int Sys_Milliseconds(void) {
 	return sys_curtime;
 }
 
+/*
+================
+Sys_Microseconds
+
+The counter is split into whole seconds first so the scaling can't overflow
+================
+*/
+int64_t Sys_Microseconds(void) {
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER	     counter;
+
+	if (!frequency.QuadPart) { QueryPerformanceFrequency(&frequency); }
+	QueryPerformanceCounter(&counter);
+
+	return counter.QuadPart / frequency.QuadPart * 1000000 +
+		   counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+}
+
 /*
 ================
 Sys_RandomBytes
@@ -376,6 +394,167 @@ FILE *Sys_FOpen(const char *ospath, const char *mode) {
 	return fopen(ospath, mode);
 }
 
+/*
+==============
+Sys_MapFile
+
+Maps length bytes of f starting at offset read only, returns NULL if the
+file can't be mapped. The view stays valid after f is closed.
+==============
+*/
+void *Sys_MapFile(FILE *f, long offset, long length, void **handle) {
+	SYSTEM_INFO info;
+	HANDLE		mapping;
+	long		delta;
+	void	   *base;
+
+	if (offset < 0 || length <= 0) { return NULL; }
+
+	mapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(f)), NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) { return NULL; }
+
+	GetSystemInfo(&info);
+	delta = offset % info.dwAllocationGranularity;
+	base  = MapViewOfFile(mapping, FILE_MAP_READ, 0, offset - delta, delta + length);
+
+	// the view keeps the mapping object alive
+	CloseHandle(mapping);
+	if (!base) { return NULL; }
+
+	*handle = base;
+	return (byte *)base + delta;
+}
+
+/*
+==============
+Sys_UnmapFile
+==============
+*/
+void Sys_UnmapFile(void *data, long length, void *handle) { UnmapViewOfFile(handle); }
+
+static HANDLE		   sampleThread;
+static HANDLE		   sampleTarget;
+static volatile LONG   sampleRunning;
+static DWORD		   sampleInterval;
+static sysSampleFunc_t sampleFunc;
+
+/*
+==============
+Sys_SampleThread
+
+Suspends the main thread to read its registers, sleeping time is sampled too.
+==============
+*/
+static DWORD WINAPI Sys_SampleThread(LPVOID arg) {
+	CONTEXT context;
+
+	while (sampleRunning) {
+		Sleep(sampleInterval);
+		if (SuspendThread(sampleTarget) == (DWORD)-1) { continue; }
+
+		memset(&context, 0, sizeof(context));
+		context.ContextFlags = CONTEXT_CONTROL;
+		if (GetThreadContext(sampleTarget, &context)) {
+#if defined(_M_X64) || defined(__x86_64__)
+			sampleFunc((void *)context.Rip, (void *)context.Rsp);
+#elif defined(_M_ARM64) || defined(__aarch64__)
+			sampleFunc((void *)context.Pc, (void *)context.Sp);
+#else
+			sampleFunc((void *)context.Eip, (void *)context.Esp);
+#endif
+		}
+
+		ResumeThread(sampleTarget);
+	}
+
+	return 0;
+}
+
+/*
+==============
+Sys_StartSampling
+
+Calls func hz times per second with the main thread's registers, must be
+called from the main thread.
+==============
+*/
+qboolean Sys_StartSampling(int hz, sysSampleFunc_t func) {
+	if (hz < 1 || hz > 1000 || sampleThread) { return qfalse; }
+
+	if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &sampleTarget,
+						 THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, 0)) {
+		return qfalse;
+	}
+
+	sampleFunc	   = func;
+	sampleInterval = 1000 / hz;
+	sampleRunning  = 1;
+
+	sampleThread = CreateThread(NULL, 0, Sys_SampleThread, NULL, 0, NULL);
+	if (!sampleThread) {
+		CloseHandle(sampleTarget);
+		return qfalse;
+	}
+	SetThreadPriority(sampleThread, THREAD_PRIORITY_TIME_CRITICAL);
+
+	return qtrue;
+}
+
+/*
+==============
+Sys_StopSampling
+==============
+*/
+void Sys_StopSampling(void) {
+	if (!sampleThread) { return; }
+
+	InterlockedExchange(&sampleRunning, 0);
+	WaitForSingleObject(sampleThread, INFINITE);
+
+	CloseHandle(sampleThread);
+	CloseHandle(sampleTarget);
+	sampleThread = NULL;
+	sampleTarget = NULL;
+}
+
+/*
+==============
+Sys_ModuleCode
+
+base is the module handle, so address - base is the relative virtual address.
+==============
+*/
+qboolean Sys_ModuleCode(void *address, byte **base, byte **code, size_t *codeSize) {
+	HMODULE				  module;
+	IMAGE_DOS_HEADER	 *dos;
+	IMAGE_NT_HEADERS	 *nt;
+	IMAGE_SECTION_HEADER *section;
+	byte				 *start;
+	int					  i;
+
+	if (!GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+						   address, &module)) {
+		return qfalse;
+	}
+
+	dos		= (IMAGE_DOS_HEADER *)module;
+	nt		= (IMAGE_NT_HEADERS *)((byte *)dos + dos->e_lfanew);
+	section = IMAGE_FIRST_SECTION(nt);
+	for (i = 0; i < nt->FileHeader.NumberOfSections; i++, section++) {
+		if (!(section->Characteristics & IMAGE_SCN_MEM_EXECUTE)) { continue; }
+
+		start = (byte *)dos + section->VirtualAddress;
+		if ((byte *)address >= start && (byte *)address < start + section->Misc.VirtualSize) {
+			*base	  = (byte *)dos;
+			*code	  = start;
+			*codeSize = section->Misc.VirtualSize;
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
 /*
 ==============
 Sys_Mkdir
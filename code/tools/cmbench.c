@@ -0,0 +1,529 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cmbench.c -- replays collision query logs written by cmrecord
+
+/*
+
+usage: cmbench [-base <dir>] [-reps <n>] [-v] [-scalar] [-threads <n>] <log> [log...]
+
+Every log is replayed against the bsp it was recorded on, loaded from
+<dir>/maps/<name>.bsp with the unmodified collision code.  The results of
+all queries are checked against the recorded ones, then every query is
+timed and the ns per query percentiles are printed per query type.
+
+-scalar also checks every query with the brush planes tested one lane at a
+time instead of with SSE, the results have to match bit for bit, and times
+the queries that way.
+
+-threads replays every query <reps> times more from <n> threads at once and
+checks all the results again, to catch collision code that isn't reentrant.
+
+The map has to be extracted from its pk3, there is no filesystem here.
+
+*/
+
+#include "qcommon/cm_local.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define MAX_REPORTED_MISMATCHES 10
+
+static const char *basePath = ".";
+static int		   numReps	= 4;
+static qboolean	   verbose;
+static qboolean	   checkScalar;
+static int		   numThreads = 1;
+
+static const char *queryNames[CMQ_NUM_TYPES] = {"point", "transformed point", "trace", "transformed trace"};
+
+/*
+===============================================================================
+
+ENGINE STUBS
+
+Just enough of qcommon for the collision code to load a map.
+
+===============================================================================
+*/
+
+void QDECL Com_Error(int level, const char *fmt, ...) {
+	va_list argptr;
+
+	va_start(argptr, fmt);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, fmt, argptr);
+	fprintf(stderr, "\n");
+	va_end(argptr);
+	exit(1);
+}
+
+void QDECL Com_Printf(const char *fmt, ...) {
+	va_list argptr;
+
+	va_start(argptr, fmt);
+	vprintf(fmt, argptr);
+	va_end(argptr);
+}
+
+void QDECL Com_DPrintf(const char *fmt, ...) {
+	va_list argptr;
+
+	if (!verbose) { return; }
+
+	va_start(argptr, fmt);
+	vprintf(fmt, argptr);
+	va_end(argptr);
+}
+
+cvar_t *Cvar_Get(const char *var_name, const char *value, int flags) {
+	cvar_t *var;
+
+	// never freed, there are only a handful
+	var			 = calloc(1, sizeof(*var));
+	var->name	 = (char *)var_name;
+	var->string	 = (char *)value;
+	var->value	 = atof(value);
+	var->integer = atoi(value);
+	var->flags	 = flags;
+
+	return var;
+}
+
+int Cmd_Argc(void) { return 0; }
+
+char *Cmd_Argv(int arg) { return ""; }
+
+// the map has to live in one block like the real hunk, submodel leafs
+// keep their brush lists as int offsets from cm.leafbrushes
+#define BENCH_HUNK_SIZE (512 * 1024 * 1024)
+
+static byte *hunkData;
+static int	 hunkUsed;
+
+static void Bench_ClearHunk(void) {
+	if (!hunkData) {
+		hunkData = calloc(1, BENCH_HUNK_SIZE);
+		if (!hunkData) { Com_Error(ERR_FATAL, "couldn't allocate the hunk"); }
+	} else {
+		memset(hunkData, 0, hunkUsed);
+	}
+	hunkUsed = 0;
+}
+
+#ifdef HUNK_DEBUG
+void *Hunk_AllocDebug(int size, ha_pref preference, char *label, char *file, int line) {
+#else
+void *Hunk_Alloc(int size, ha_pref preference) {
+#endif
+	void *buf;
+
+	size = (size + 31) & ~31;
+	if (size < 0 || size > BENCH_HUNK_SIZE - hunkUsed) { Com_Error(ERR_FATAL, "Hunk_Alloc failed on %i", size); }
+
+	buf = hunkData + hunkUsed;
+	hunkUsed += size;
+
+	return buf;
+}
+
+void *Hunk_AllocateTempMemory(int size) {
+	void *buf;
+
+	buf = calloc(1, size);
+	if (!buf) { Com_Error(ERR_FATAL, "Hunk_AllocateTempMemory failed on %i", size); }
+
+	return buf;
+}
+
+void Hunk_FreeTempMemory(void *buf) { free(buf); }
+
+#ifdef ZONE_DEBUG
+void *Z_MallocDebug(int size, char *label, char *file, int line) {
+#else
+void *Z_Malloc(int size) {
+#endif
+	return Hunk_AllocateTempMemory(size);
+}
+
+void Z_Free(void *ptr) { free(ptr); }
+
+long FS_ReadFile(const char *qpath, void **buffer) {
+	char  path[MAX_OSPATH];
+	FILE *f;
+	long  len;
+
+	*buffer = NULL;
+
+	Com_sprintf(path, sizeof(path), "%s/%s", basePath, qpath);
+	f = fopen(path, "rb");
+	if (!f) { return -1; }
+
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	*buffer = Hunk_AllocateTempMemory(len + 1);
+	if (fread(*buffer, 1, len, f) != len) {
+		fclose(f);
+		free(*buffer);
+		*buffer = NULL;
+		return -1;
+	}
+	fclose(f);
+
+	return len;
+}
+
+void FS_FreeFile(void *buffer) { free(buffer); }
+
+// always read into the hunk so timings don't depend on the page cache
+long FS_MapFile(const char *qpath, const void **buffer) {
+	*buffer = NULL;
+	return -1;
+}
+
+void FS_UnmapFile(const void *buffer) {}
+
+// there is no home path, so no patch collision cache either
+const char *FS_GetCurrentGameDir(void) { return BASEGAME; }
+
+long FS_SV_FOpenFileRead(const char *filename, fileHandle_t *fp) {
+	*fp = 0;
+	return -1;
+}
+
+fileHandle_t FS_SV_FOpenFileWrite(const char *filename) { return 0; }
+
+fileHandle_t FS_FOpenFileWrite(const char *filename) { return 0; }
+
+int FS_Read(void *buffer, int len, fileHandle_t f) { return 0; }
+
+int FS_Write(const void *buffer, int len, fileHandle_t f) { return 0; }
+
+void FS_FCloseFile(fileHandle_t f) {}
+
+void BotDrawDebugPolygons(void (*drawPoly)(int color, int numPoints, float *points), int value) {}
+
+/*
+===============================================================================
+
+REPLAY
+
+===============================================================================
+*/
+
+typedef struct {
+	int	   count;
+	int	   mismatches;
+	float *ns; // per query
+} queryStats_t;
+
+typedef struct {
+	const cmQuery_t *queries;
+	int				 numQueries;
+	atomic_int		 mismatches;
+} stressJob_t;
+
+/*
+==================
+Bench_Nanoseconds
+==================
+*/
+static double Bench_Nanoseconds(void) {
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER		 now;
+
+	if (!freq.QuadPart) { QueryPerformanceFrequency(&freq); }
+	QueryPerformanceCounter(&now);
+	return now.QuadPart * 1e9 / freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+/*
+==================
+Bench_TimerOverhead
+
+Cost of one pair of Bench_Nanoseconds calls, taken off every sample
+==================
+*/
+static double Bench_TimerOverhead(void) {
+	double best, start, t;
+	int	   i;
+
+	best = 1e9;
+	for (i = 0; i < 1000; i++) {
+		start = Bench_Nanoseconds();
+		t	  = Bench_Nanoseconds() - start;
+		if (t < best) { best = t; }
+	}
+
+	return best;
+}
+
+static int Bench_CompareFloats(const void *a, const void *b) {
+	float fa = *(const float *)a;
+	float fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+/*
+==================
+Bench_PrintStats
+==================
+*/
+static void Bench_PrintStats(const char *name, queryStats_t *stats) {
+	double total;
+	int	   i;
+
+	if (!stats->count) { return; }
+
+	qsort(stats->ns, stats->count, sizeof(stats->ns[0]), Bench_CompareFloats);
+
+	total = 0;
+	for (i = 0; i < stats->count; i++) { total += stats->ns[i]; }
+
+	Com_Printf("%-18s %9i %8i %9.1f %9.1f %9.1f %9.1f %10.1f\n", name, stats->count, stats->mismatches,
+			   total / stats->count, stats->ns[stats->count / 2], stats->ns[(int)(stats->count * 0.9)],
+			   stats->ns[(int)(stats->count * 0.99)], stats->ns[stats->count - 1]);
+}
+
+/*
+==================
+Bench_StressQuery
+
+Runs on any thread, so it may only count what went wrong
+==================
+*/
+static void Bench_StressQuery(void *data, int index) {
+	stressJob_t		*job   = data;
+	const cmQuery_t *query = &job->queries[index % job->numQueries];
+	cmQuery_t		 result;
+
+	memset(&result, 0, sizeof(result));
+	CM_RunQuery(query, &result);
+	if (!CM_SameQueryResult(query, &result)) { atomic_fetch_add_explicit(&job->mismatches, 1, memory_order_relaxed); }
+}
+
+/*
+==================
+Bench_ReplayLog
+==================
+*/
+static qboolean Bench_ReplayLog(const char *logName) {
+	cmRecordHeader_t header;
+	queryStats_t	 stats[CMQ_NUM_TYPES + 1];
+	cmQuery_t		*queries, result;
+	byte			*data;
+	FILE			*f;
+	long			 length;
+	int				 ofs, size, numQueries, checksum;
+	const char		*path;
+	stressJob_t		 job;
+	int				 i, j, threads;
+	double			 overhead, start, ns;
+
+	f = fopen(logName, "rb");
+	if (!f) {
+		Com_Printf("Couldn't open %s\n", logName);
+		return qfalse;
+	}
+	fseek(f, 0, SEEK_END);
+	length = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	data = malloc(length + 1);
+	if (fread(data, 1, length, f) != length) {
+		Com_Printf("Couldn't read %s\n", logName);
+		fclose(f);
+		free(data);
+		return qfalse;
+	}
+	fclose(f);
+
+	if (length < (long)sizeof(header)) {
+		Com_Printf("%s is not a collision log\n", logName);
+		free(data);
+		return qfalse;
+	}
+	memcpy(&header, data, sizeof(header));
+	header.ident	= LittleLong(header.ident);
+	header.version	= LittleLong(header.version);
+	header.checksum = LittleLong(header.checksum);
+	header.map[sizeof(header.map) - 1] = 0;
+	if (header.ident != CM_RECORD_IDENT || header.version != CM_RECORD_VERSION) {
+		Com_Printf("%s is not a version %i collision log\n", logName, CM_RECORD_VERSION);
+		free(data);
+		return qfalse;
+	}
+
+	Bench_ClearHunk();
+	CM_LoadMap(header.map, qfalse, &checksum);
+	if (checksum != header.checksum) {
+		Com_Printf("%s was recorded on a different version of %s\n", logName, header.map);
+		free(data);
+		return qfalse;
+	}
+
+	// decode everything up front so only the queries are timed
+	numQueries = 0;
+	for (ofs = sizeof(header); (size = CM_ReadQuery(data + ofs, length - ofs, &result)); ofs += size) { numQueries++; }
+
+	queries = calloc(numQueries + 1, sizeof(*queries));
+	for (i = 0, ofs = sizeof(header); i < numQueries; i++) {
+		ofs += CM_ReadQuery(data + ofs, length - ofs, &queries[i]);
+		if (!queries[i].tempBox && (queries[i].model < 0 || queries[i].model >= CM_NumInlineModels())) { break; }
+	}
+	if (i != numQueries || ofs != length) {
+		Com_Printf("WARNING: %s is damaged after %i queries\n", logName, i);
+		numQueries = i;
+	}
+	free(data);
+
+	memset(stats, 0, sizeof(stats));
+	for (i = 0; i < numQueries; i++) { stats[queries[i].type].count++; }
+	for (i = 0; i < CMQ_NUM_TYPES; i++) {
+		stats[i].ns	   = calloc(stats[i].count + 1, sizeof(float));
+		stats[i].count = 0;
+	}
+	stats[CMQ_NUM_TYPES].ns = calloc(numQueries + 1, sizeof(float));
+
+	// check the results
+	for (i = 0; i < numQueries; i++) {
+		memset(&result, 0, sizeof(result));
+		CM_RunQuery(&queries[i], &result);
+		path = "";
+		if (CM_SameQueryResult(&queries[i], &result)) {
+			if (!checkScalar) { continue; }
+
+			cm_scalarPlanes = qtrue;
+			memset(&result, 0, sizeof(result));
+			CM_RunQuery(&queries[i], &result);
+			cm_scalarPlanes = qfalse;
+			if (CM_SameQueryResult(&queries[i], &result)) { continue; }
+			path = " scalar";
+		}
+
+		stats[queries[i].type].mismatches++;
+		stats[CMQ_NUM_TYPES].mismatches++;
+		if (stats[CMQ_NUM_TYPES].mismatches <= MAX_REPORTED_MISMATCHES) {
+			if (queries[i].type == CMQ_POINT || queries[i].type == CMQ_TRANSFORMED_POINT) {
+				Com_Printf("query %i (%s)%s: contents %i, recorded %i\n", i, queryNames[queries[i].type], path,
+						   result.contents, queries[i].contents);
+			} else {
+				Com_Printf("query %i (%s)%s: fraction %f contents %i solid %i/%i, recorded %f contents %i solid %i/%i\n",
+						   i, queryNames[queries[i].type], path, result.trace.fraction, result.trace.contents,
+						   result.trace.startsolid, result.trace.allsolid, queries[i].trace.fraction,
+						   queries[i].trace.contents, queries[i].trace.startsolid, queries[i].trace.allsolid);
+			}
+		}
+	}
+
+	// time them
+	cm_scalarPlanes = checkScalar;
+	overhead		= Bench_TimerOverhead();
+	for (i = 0; i < numQueries; i++) {
+		start = Bench_Nanoseconds();
+		for (j = 0; j < numReps; j++) { CM_RunQuery(&queries[i], &result); }
+		ns = (Bench_Nanoseconds() - start - overhead) / numReps;
+		if (ns < 0) { ns = 0; }
+
+		stats[queries[i].type].ns[stats[queries[i].type].count++] = ns;
+		stats[CMQ_NUM_TYPES].ns[stats[CMQ_NUM_TYPES].count++]	  = ns;
+	}
+	cm_scalarPlanes = qfalse;
+
+	// check them again with every thread hammering the same map
+	job.queries	   = queries;
+	job.numQueries = numQueries;
+	atomic_init(&job.mismatches, 0);
+	threads = 1;
+	if (numThreads > 1 && numQueries) {
+		Sys_SetWorkerThreads(numThreads - 1);
+		threads = Sys_WorkerThreads() + 1;
+		Sys_RunJobs(Bench_StressQuery, &job, numQueries * numReps);
+		Sys_SetWorkerThreads(0);
+	}
+
+	Com_Printf("\n%s: %s, %i queries%s\n", logName, header.map, numQueries, checkScalar ? ", scalar plane tests" : "");
+	Com_Printf("%-18s %9s %8s %9s %9s %9s %9s %10s\n", "ns/query", "count", "mismatch", "mean", "p50", "p90", "p99",
+			   "max");
+	for (i = 0; i < CMQ_NUM_TYPES; i++) { Bench_PrintStats(queryNames[i], &stats[i]); }
+	Bench_PrintStats("all", &stats[CMQ_NUM_TYPES]);
+	if (threads > 1) {
+		Com_Printf("%i threads: %i queries, %i mismatches\n", threads, numQueries * numReps,
+				   atomic_load(&job.mismatches));
+	}
+
+	for (i = 0; i <= CMQ_NUM_TYPES; i++) { free(stats[i].ns); }
+	free(queries);
+
+	return stats[CMQ_NUM_TYPES].mismatches == 0 && atomic_load(&job.mismatches) == 0;
+}
+
+int main(int argc, char **argv) {
+	qboolean ok;
+	int		 i;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (!strcmp(argv[i], "-base") && i + 1 < argc) {
+			basePath = argv[++i];
+		} else if (!strcmp(argv[i], "-reps") && i + 1 < argc) {
+			numReps = atoi(argv[++i]);
+			if (numReps < 1) { numReps = 1; }
+		} else if (!strcmp(argv[i], "-v")) {
+			verbose = qtrue;
+		} else if (!strcmp(argv[i], "-scalar")) {
+			checkScalar = qtrue;
+		} else if (!strcmp(argv[i], "-threads") && i + 1 < argc) {
+			numThreads = atoi(argv[++i]);
+			if (numThreads < 1) { numThreads = 1; }
+		} else {
+			break;
+		}
+	}
+
+	if (i == argc) {
+		fprintf(stderr, "usage: cmbench [-base <dir>] [-reps <n>] [-v] [-scalar] [-threads <n>] <log> [log...]\n");
+		return 1;
+	}
+
+	ok = qtrue;
+	for (; i < argc; i++) {
+		if (!Bench_ReplayLog(argv[i])) { ok = qfalse; }
+	}
+
+	return ok ? 0 : 2;
+}